@@ -40,9 +40,26 @@ typedef enum {
 	DXGI_FORMAT_R32G32B32_FLOAT        = 6,
 	DXGI_FORMAT_R32G32_FLOAT           = 16,
 	DXGI_FORMAT_R8G8B8A8_UNORM         = 28,
+	DXGI_FORMAT_R32_TYPELESS           = 39,
 	DXGI_FORMAT_D32_FLOAT              = 40,
+	DXGI_FORMAT_R32_FLOAT              = 41,
 	DXGI_FORMAT_R32_UINT               = 42,
 	DXGI_FORMAT_R16_UINT               = 57,
+	DXGI_FORMAT_BC1_TYPELESS           = 70,
+	DXGI_FORMAT_BC1_UNORM              = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB         = 72,
+	DXGI_FORMAT_BC2_TYPELESS           = 73,
+	DXGI_FORMAT_BC2_UNORM              = 74,
+	DXGI_FORMAT_BC2_UNORM_SRGB         = 75,
+	DXGI_FORMAT_BC3_TYPELESS           = 76,
+	DXGI_FORMAT_BC3_UNORM              = 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB         = 78,
+	DXGI_FORMAT_BC4_TYPELESS           = 79,
+	DXGI_FORMAT_BC4_UNORM              = 80,
+	DXGI_FORMAT_BC4_SNORM              = 81,
+	DXGI_FORMAT_BC5_TYPELESS           = 82,
+	DXGI_FORMAT_BC5_UNORM              = 83,
+	DXGI_FORMAT_BC5_SNORM              = 84,
 	DXGI_FORMAT_B8G8R8A8_UNORM         = 87,
 } DXGI_FORMAT;
 
@@ -58,6 +75,12 @@ typedef enum {
 	D3D11_USAGE_STAGING    = 3,  /* CPU ↔ GPU 복사용 */
 } D3D11_USAGE;
 
+/* CPU 접근 플래그 (DYNAMIC/STAGING 리소스) */
+typedef enum {
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ  = 0x20000,
+} D3D11_CPU_ACCESS_FLAG;
+
 /* 리소스 바인딩 플래그 (비트 OR 조합) */
 typedef enum {
 	D3D11_BIND_VERTEX_BUFFER    = 0x001,
@@ -110,11 +133,30 @@ typedef enum {
 	D3D11_MAP_WRITE_NO_OVERWRITE = 5,
 } D3D11_MAP;
 
+/* Device context 종류 (GetType) */
+typedef enum {
+	D3D11_DEVICE_CONTEXT_IMMEDIATE = 0,
+	D3D11_DEVICE_CONTEXT_DEFERRED  = 1,
+} D3D11_DEVICE_CONTEXT_TYPE;
+
 /* 텍스처 차원 */
 typedef enum {
+	D3D11_SRV_DIMENSION_BUFFER    = 1,
 	D3D11_SRV_DIMENSION_TEXTURE2D = 4,
+	D3D11_SRV_DIMENSION_BUFFEREX  = 11,
 } D3D11_SRV_DIMENSION;
 
+typedef enum {
+	D3D11_UAV_DIMENSION_BUFFER    = 1,
+	D3D11_UAV_DIMENSION_TEXTURE2D = 4,
+} D3D11_UAV_DIMENSION;
+
+/* 버퍼 MiscFlags / UAV 플래그 */
+#define D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS 0x20
+#define D3D11_RESOURCE_MISC_BUFFER_STRUCTURED      0x40
+#define D3D11_BUFFER_UAV_FLAG_RAW                  0x1
+#define D3D11_BUFFEREX_SRV_FLAG_RAW                0x1
+
 /* 비교 함수 (깊이 테스트, 스텐실 테스트) */
 typedef enum {
 	D3D11_COMPARISON_NEVER         = 1,
@@ -150,10 +192,26 @@ typedef enum {
 typedef enum {
 	D3D11_BLEND_ZERO             = 1,
 	D3D11_BLEND_ONE              = 2,
+	D3D11_BLEND_SRC_COLOR        = 3,
+	D3D11_BLEND_INV_SRC_COLOR    = 4,
 	D3D11_BLEND_SRC_ALPHA        = 5,
 	D3D11_BLEND_INV_SRC_ALPHA    = 6,
+	D3D11_BLEND_DEST_ALPHA       = 7,
+	D3D11_BLEND_INV_DEST_ALPHA   = 8,
+	D3D11_BLEND_DEST_COLOR       = 9,
+	D3D11_BLEND_INV_DEST_COLOR   = 10,
+	D3D11_BLEND_SRC_ALPHA_SAT    = 11,
+	D3D11_BLEND_BLEND_FACTOR     = 14,
+	D3D11_BLEND_INV_BLEND_FACTOR = 15,
 } D3D11_BLEND;
 
+/* 렌더 타깃 쓰기 마스크 */
+#define D3D11_COLOR_WRITE_ENABLE_RED    1
+#define D3D11_COLOR_WRITE_ENABLE_GREEN  2
+#define D3D11_COLOR_WRITE_ENABLE_BLUE   4
+#define D3D11_COLOR_WRITE_ENABLE_ALPHA  8
+#define D3D11_COLOR_WRITE_ENABLE_ALL    0xF
+
 /* 블렌드 연산 */
 typedef enum {
 	D3D11_BLEND_OP_ADD          = 1,
@@ -169,15 +227,21 @@ typedef enum {
 
 /* 텍스처 필터링 */
 typedef enum {
-	D3D11_FILTER_MIN_MAG_MIP_POINT  = 0,
-	D3D11_FILTER_MIN_MAG_MIP_LINEAR = 0x15,
+	D3D11_FILTER_MIN_MAG_MIP_POINT          = 0,
+	D3D11_FILTER_MIN_MAG_POINT_MIP_LINEAR   = 0x1,
+	D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT   = 0x10,
+	D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT   = 0x14,
+	D3D11_FILTER_MIN_MAG_MIP_LINEAR         = 0x15,
+	D3D11_FILTER_ANISOTROPIC                = 0x55,
 } D3D11_FILTER;
 
 /* 텍스처 주소 모드 */
 typedef enum {
-	D3D11_TEXTURE_ADDRESS_WRAP   = 1,
-	D3D11_TEXTURE_ADDRESS_MIRROR = 2,
-	D3D11_TEXTURE_ADDRESS_CLAMP  = 3,
+	D3D11_TEXTURE_ADDRESS_WRAP        = 1,
+	D3D11_TEXTURE_ADDRESS_MIRROR      = 2,
+	D3D11_TEXTURE_ADDRESS_CLAMP       = 3,
+	D3D11_TEXTURE_ADDRESS_BORDER      = 4,
+	D3D11_TEXTURE_ADDRESS_MIRROR_ONCE = 5,
 } D3D11_TEXTURE_ADDRESS_MODE;
 
 /* D3D11 Create Device 플래그 */
@@ -265,6 +329,24 @@ typedef struct {
 	float MaxDepth;
 } D3D11_VIEWPORT;
 
+/* 시저 사각형 (right/bottom은 제외 경계) */
+typedef struct {
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} D3D11_RECT;
+
+/* UpdateSubresource 대상 상자 (right/bottom/back은 제외 경계) */
+typedef struct {
+	UINT left;
+	UINT top;
+	UINT front;
+	UINT right;
+	UINT bottom;
+	UINT back;
+} D3D11_BOX;
+
 /* 2D 텍스처 생성 파라미터 */
 typedef struct {
 	UINT             Width;
@@ -288,6 +370,27 @@ typedef struct {
 	};
 } D3D11_RENDER_TARGET_VIEW_DESC;
 
+/* 셰이더 리소스 뷰 생성 파라미터 */
+typedef struct {
+	DXGI_FORMAT Format;
+	UINT        ViewDimension;   /* D3D11_SRV_DIMENSION */
+	union {
+		struct { UINT FirstElement; UINT NumElements; } Buffer;
+		struct { UINT MostDetailedMip; UINT MipLevels; } Texture2D;
+		struct { UINT FirstElement; UINT NumElements; UINT Flags; } BufferEx;
+	};
+} D3D11_SHADER_RESOURCE_VIEW_DESC;
+
+/* UAV 생성 파라미터 */
+typedef struct {
+	DXGI_FORMAT Format;
+	UINT        ViewDimension;   /* D3D11_UAV_DIMENSION */
+	union {
+		struct { UINT FirstElement; UINT NumElements; UINT Flags; } Buffer;
+		struct { UINT MipSlice; } Texture2D;
+	};
+} D3D11_UNORDERED_ACCESS_VIEW_DESC;
+
 /* 입력 레이아웃 요소 (버텍스 포맷 설명)
  *
  * DirectX 버텍스 셰이더의 입력을 정의:
@@ -305,6 +408,15 @@ typedef struct {
 	UINT        InstanceDataStepRate;
 } D3D11_INPUT_ELEMENT_DESC;
 
+/* InputSlotClass: 정점마다 / 인스턴스마다 (InstanceDataStepRate개마다) 진행 */
+typedef enum {
+	D3D11_INPUT_PER_VERTEX_DATA   = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1,
+} D3D11_INPUT_CLASSIFICATION;
+
+/* AlignedByteOffset: 앞 요소 바로 뒤에 배치 */
+#define D3D11_APPEND_ALIGNED_ELEMENT 0xffffffff
+
 /* Map 결과 */
 typedef struct {
 	void *pData;
@@ -388,6 +500,33 @@ typedef struct {
 	float                      MaxLOD;
 } D3D11_SAMPLER_DESC;
 
+/* 쿼리 종류 (CreateQuery / CreatePredicate) */
+typedef enum {
+	D3D11_QUERY_EVENT                = 0,
+	D3D11_QUERY_OCCLUSION            = 1,
+	D3D11_QUERY_TIMESTAMP            = 2,
+	D3D11_QUERY_TIMESTAMP_DISJOINT   = 3,
+	D3D11_QUERY_PIPELINE_STATISTICS  = 4,
+	D3D11_QUERY_OCCLUSION_PREDICATE  = 5,
+} D3D11_QUERY;
+
+/* MiscFlags: 결과가 아직 없으면 기다리지 않고 그려도 됨 */
+#define D3D11_QUERY_MISC_PREDICATEHINT 0x1
+
+typedef struct {
+	D3D11_QUERY Query;
+	UINT        MiscFlags;
+} D3D11_QUERY_DESC;
+
+/* TIMESTAMP_DISJOINT의 GetData 결과 */
+typedef struct {
+	uint64_t Frequency;     /* TIMESTAMP 틱/초 */
+	BOOL     Disjoint;      /* 구간 중 주파수가 바뀌었으면 TRUE */
+} D3D11_QUERY_DATA_TIMESTAMP_DISJOINT;
+
+/* GetData 플래그: 결과가 없어도 쌓인 명령을 실행하지 않음 */
+#define D3D11_ASYNC_GETDATA_DONOTFLUSH 0x1
+
 /* ============================================================
  * COM 인터페이스 전방 선언
  * ============================================================
@@ -511,10 +650,6 @@ typedef struct ID3D11DeviceVtbl {
 	HRESULT (__attribute__((ms_abi)) *CreateVertexShader)(void *This,
 		const void *pShaderBytecode, size_t BytecodeLength,
 		void *pClassLinkage, void **ppVertexShader);
-	HRESULT (__attribute__((ms_abi)) *CreateHullShader)(void *This,
-		const void *p, size_t l, void *c, void **pp);
-	HRESULT (__attribute__((ms_abi)) *CreateDomainShader)(void *This,
-		const void *p, size_t l, void *c, void **pp);
 	HRESULT (__attribute__((ms_abi)) *CreateGeometryShader)(void *This,
 		const void *p, size_t l, void *c, void **pp);
 	HRESULT (__attribute__((ms_abi)) *CreateGeometryShaderWithStreamOutput)(void *This,
@@ -523,6 +658,14 @@ typedef struct ID3D11DeviceVtbl {
 	HRESULT (__attribute__((ms_abi)) *CreatePixelShader)(void *This,
 		const void *pShaderBytecode, size_t BytecodeLength,
 		void *pClassLinkage, void **ppPixelShader);
+	HRESULT (__attribute__((ms_abi)) *CreateHullShader)(void *This,
+		const void *p, size_t l, void *c, void **pp);
+	HRESULT (__attribute__((ms_abi)) *CreateDomainShader)(void *This,
+		const void *p, size_t l, void *c, void **pp);
+	HRESULT (__attribute__((ms_abi)) *CreateComputeShader)(void *This,
+		const void *pShaderBytecode, size_t BytecodeLength,
+		void *pClassLinkage, void **ppComputeShader);
+	HRESULT (__attribute__((ms_abi)) *CreateClassLinkage)(void *This, void **pp);
 	/* ... 이후 메서드는 Phase 4에서 사용하지 않으므로 생략 가능 ... */
 	/* 하지만 vtable 순서가 중요하므로 placeholder 유지 */
 	HRESULT (__attribute__((ms_abi)) *CreateBlendState)(void *T, void *d, void **pp);
@@ -614,7 +757,7 @@ typedef struct ID3D11DeviceContextVtbl {
 	void (__attribute__((ms_abi)) *RSSetState)(void *T, void *p);
 	void (__attribute__((ms_abi)) *RSSetViewports)(void *This, UINT NumViewports,
 						       const D3D11_VIEWPORT *pViewports);
-	void (__attribute__((ms_abi)) *RSSetScissorRects)(void *T, UINT n, const void *p);
+	void (__attribute__((ms_abi)) *RSSetScissorRects)(void *T, UINT n, const D3D11_RECT *p);
 	void (__attribute__((ms_abi)) *CopySubresourceRegion)(void *T,
 		void *dst, UINT di, UINT dx, UINT dy, UINT dz,
 		void *src, UINT si, void *sb);
@@ -675,7 +818,7 @@ typedef struct ID3D11DeviceContextVtbl {
 	void (__attribute__((ms_abi)) *SOGetTargets)(void *T, UINT n, void **pp);
 	void (__attribute__((ms_abi)) *RSGetState)(void *T, void **pp);
 	void (__attribute__((ms_abi)) *RSGetViewports)(void *T, UINT *n, D3D11_VIEWPORT *p);
-	void (__attribute__((ms_abi)) *RSGetScissorRects)(void *T, UINT *n, void *p);
+	void (__attribute__((ms_abi)) *RSGetScissorRects)(void *T, UINT *n, D3D11_RECT *p);
 	/* 나머지 Get 메서드... */
 	void (__attribute__((ms_abi)) *HSGetShaderResources)(void *T, UINT s, UINT n, void **pp);
 	void (__attribute__((ms_abi)) *HSGetShader)(void *T, void **pp, void **ci, UINT *n);
@@ -697,4 +840,19 @@ typedef struct ID3D11DeviceContextVtbl {
 	HRESULT (__attribute__((ms_abi)) *FinishCommandList)(void *T, BOOL r, void **pp);
 } ID3D11DeviceContextVtbl;
 
+/* ID3D11CommandList vtable (FinishCommandList 결과) */
+typedef struct ID3D11CommandListVtbl {
+	/* IUnknown */
+	HRESULT (__attribute__((ms_abi)) *QueryInterface)(void *This, REFIID riid, void **ppv);
+	ULONG   (__attribute__((ms_abi)) *AddRef)(void *This);
+	ULONG   (__attribute__((ms_abi)) *Release)(void *This);
+	/* ID3D11DeviceChild */
+	void    (__attribute__((ms_abi)) *GetDevice)(void *This, void **ppDevice);
+	HRESULT (__attribute__((ms_abi)) *GetPrivateData)(void *T, REFIID g, UINT *s, void *d);
+	HRESULT (__attribute__((ms_abi)) *SetPrivateData)(void *T, REFIID g, UINT s, const void *d);
+	HRESULT (__attribute__((ms_abi)) *SetPrivateDataInterface)(void *T, REFIID g, void *d);
+	/* ID3D11CommandList */
+	UINT    (__attribute__((ms_abi)) *GetContextFlags)(void *This);
+} ID3D11CommandListVtbl;
+
 #endif /* CITC_D3D11_TYPES_H */
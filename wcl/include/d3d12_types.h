@@ -189,12 +189,12 @@ typedef struct {
 } D3D12_RESOURCE_DESC;
 
 typedef struct {
-	float left, top, right, bottom;
-	float minDepth, maxDepth;
+	float TopLeftX, TopLeftY, Width, Height;
+	float MinDepth, MaxDepth;
 } D3D12_VIEWPORT;
 
 typedef struct {
-	long left, top, right, bottom;
+	LONG left, top, right, bottom;
 } D3D12_RECT;
 
 typedef struct {
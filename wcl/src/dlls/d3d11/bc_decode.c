@@ -0,0 +1,175 @@
+/*
+ * bc_decode.c — 블록 압축 텍스처 (BC1~BC5) 디코더
+ * ================================================
+ *
+ * 보간 색/값은 D3D 명세의 가중치로 정수 나눗셈해서 구한다
+ * (하드웨어마다 1 LSB 정도 차이가 허용되는 부분).
+ */
+
+#include "bc_decode.h"
+
+/* DXGI_FORMAT 값 (d3d11_types.h와 같음) */
+enum {
+	FMT_BC1_TYPELESS = 70, FMT_BC1_UNORM_SRGB = 72,
+	FMT_BC2_TYPELESS = 73, FMT_BC2_UNORM_SRGB = 75,
+	FMT_BC3_TYPELESS = 76, FMT_BC3_UNORM_SRGB = 78,
+	FMT_BC4_TYPELESS = 79, FMT_BC4_UNORM = 80, FMT_BC4_SNORM = 81,
+	FMT_BC5_TYPELESS = 82, FMT_BC5_UNORM = 83, FMT_BC5_SNORM = 84,
+};
+
+enum bc_format bc_format_from_dxgi(int f)
+{
+	if (f >= FMT_BC1_TYPELESS && f <= FMT_BC1_UNORM_SRGB) return BC_1;
+	if (f >= FMT_BC2_TYPELESS && f <= FMT_BC2_UNORM_SRGB) return BC_2;
+	if (f >= FMT_BC3_TYPELESS && f <= FMT_BC3_UNORM_SRGB) return BC_3;
+	if (f == FMT_BC4_TYPELESS || f == FMT_BC4_UNORM) return BC_4_UNORM;
+	if (f == FMT_BC4_SNORM) return BC_4_SNORM;
+	if (f == FMT_BC5_TYPELESS || f == FMT_BC5_UNORM) return BC_5_UNORM;
+	if (f == FMT_BC5_SNORM) return BC_5_SNORM;
+	return BC_NONE;
+}
+
+int bc_block_bytes(enum bc_format fmt)
+{
+	switch (fmt) {
+	case BC_1:
+	case BC_4_UNORM:
+	case BC_4_SNORM:
+		return 8;
+	case BC_NONE:
+		return 0;
+	default:
+		return 16;
+	}
+}
+
+/* ---- 색 블록 (BC1, BC2/BC3의 뒤 8바이트) ---- */
+
+static void rgb565_expand(unsigned c, int rgb[3])
+{
+	int r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+	rgb[0] = r << 3 | r >> 2;
+	rgb[1] = g << 2 | g >> 4;
+	rgb[2] = b << 3 | b >> 2;
+}
+
+static uint32_t argb(int a, const int rgb[3])
+{
+	return (uint32_t)a << 24 | (uint32_t)rgb[0] << 16 |
+	       (uint32_t)rgb[1] << 8 | (uint32_t)rgb[2];
+}
+
+/*
+ * three_color: c0 <= c1이면 3색 + 투명 검정 모드 허용 (BC1만).
+ * BC2/BC3의 색 블록은 항상 4색 모드.
+ */
+static void bc1_color(const uint8_t *b, int three_color, uint32_t out[16])
+{
+	unsigned c0 = b[0] | b[1] << 8, c1 = b[2] | b[3] << 8;
+	int e0[3], e1[3], m[3];
+	uint32_t pal[4];
+
+	rgb565_expand(c0, e0);
+	rgb565_expand(c1, e1);
+	pal[0] = argb(255, e0);
+	pal[1] = argb(255, e1);
+	if (c0 > c1 || !three_color) {
+		for (int ch = 0; ch < 3; ch++)
+			m[ch] = (2 * e0[ch] + e1[ch] + 1) / 3;
+		pal[2] = argb(255, m);
+		for (int ch = 0; ch < 3; ch++)
+			m[ch] = (e0[ch] + 2 * e1[ch] + 1) / 3;
+		pal[3] = argb(255, m);
+	} else {
+		for (int ch = 0; ch < 3; ch++)
+			m[ch] = (e0[ch] + e1[ch] + 1) / 2;
+		pal[2] = argb(255, m);
+		pal[3] = 0;
+	}
+
+	uint32_t idx = b[4] | b[5] << 8 | b[6] << 16 | (uint32_t)b[7] << 24;
+	for (int k = 0; k < 16; k++)
+		out[k] = pal[idx >> (k * 2) & 3];
+}
+
+/* ---- 단일 채널 블록 (BC3 알파, BC4, BC5) ---- */
+
+static void bc4_channel(const uint8_t *b, int snorm, uint8_t out[16])
+{
+	int v0, v1, pal[8];
+	if (snorm) {
+		v0 = (int8_t)b[0];
+		v1 = (int8_t)b[1];
+		if (v0 < -127) v0 = -127;
+		if (v1 < -127) v1 = -127;
+	} else {
+		v0 = b[0];
+		v1 = b[1];
+	}
+
+	pal[0] = v0;
+	pal[1] = v1;
+	if (v0 > v1) {
+		for (int i = 1; i <= 6; i++)
+			pal[1 + i] = ((7 - i) * v0 + i * v1) / 7;
+	} else {
+		for (int i = 1; i <= 4; i++)
+			pal[1 + i] = ((5 - i) * v0 + i * v1) / 5;
+		pal[6] = snorm ? -127 : 0;
+		pal[7] = snorm ? 127 : 255;
+	}
+
+	/* SNORM → [0, 1]만 남겨 8비트로 */
+	if (snorm)
+		for (int i = 0; i < 8; i++)
+			pal[i] = pal[i] <= 0 ? 0 : (pal[i] * 255 + 63) / 127;
+
+	uint64_t idx = 0;
+	for (int i = 0; i < 6; i++)
+		idx |= (uint64_t)b[2 + i] << (i * 8);
+	for (int k = 0; k < 16; k++)
+		out[k] = (uint8_t)pal[idx >> (k * 3) & 7];
+}
+
+void bc_decode_block(enum bc_format fmt, const uint8_t *block,
+		     uint32_t out[BC_BLOCK_DIM * BC_BLOCK_DIM])
+{
+	uint8_t ch0[16], ch1[16];
+
+	switch (fmt) {
+	case BC_1:
+		bc1_color(block, 1, out);
+		break;
+	case BC_2:
+		bc1_color(block + 8, 0, out);
+		for (int k = 0; k < 16; k++) {
+			uint32_t a = block[k / 2] >> (k % 2 * 4) & 0xF;
+			out[k] = (out[k] & 0xFFFFFF) | (a * 17) << 24;
+		}
+		break;
+	case BC_3:
+		bc1_color(block + 8, 0, out);
+		bc4_channel(block, 0, ch0);
+		for (int k = 0; k < 16; k++)
+			out[k] = (out[k] & 0xFFFFFF) | (uint32_t)ch0[k] << 24;
+		break;
+	case BC_4_UNORM:
+	case BC_4_SNORM:
+		bc4_channel(block, fmt == BC_4_SNORM, ch0);
+		for (int k = 0; k < 16; k++)
+			out[k] = 0xFF000000u | (uint32_t)ch0[k] << 16;
+		break;
+	case BC_5_UNORM:
+	case BC_5_SNORM:
+		bc4_channel(block, fmt == BC_5_SNORM, ch0);
+		bc4_channel(block + 8, fmt == BC_5_SNORM, ch1);
+		for (int k = 0; k < 16; k++)
+			out[k] = 0xFF000000u | (uint32_t)ch0[k] << 16 |
+				 (uint32_t)ch1[k] << 8;
+		break;
+	default:
+		for (int k = 0; k < 16; k++)
+			out[k] = 0;
+		break;
+	}
+}
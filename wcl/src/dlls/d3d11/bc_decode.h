@@ -0,0 +1,49 @@
+/*
+ * bc_decode.h — 블록 압축 텍스처 (BC1~BC5) 디코더
+ * ================================================
+ *
+ * BCn 포맷은 4x4 텍셀을 고정 크기 블록 하나로 압축한다:
+ *
+ *   BC1  8바이트   색 끝점 2개 (RGB565) + 2비트 인덱스 16개
+ *   BC2  16바이트  4비트 명시 알파 16개 + BC1 색 블록
+ *   BC3  16바이트  BC4식 알파 블록 + BC1 색 블록
+ *   BC4  8바이트   단일 채널 끝점 2개 + 3비트 인덱스 16개
+ *   BC5  16바이트  BC4 블록 두 개 (R, G)
+ *
+ * 텍스처는 압축된 그대로 메모리에 두고, 샘플러가 필요한 블록만
+ * 풀어 쓴다 (d3d11.c의 블록 캐시). 여기는 블록 하나를 푸는 순수 함수뿐.
+ *
+ * 출력은 래스터라이저 텍셀과 같은 ARGB8888 (알파는 비트 24..31).
+ * BC4/BC5는 (r, 0, 0) / (r, g, 0), SNORM은 음수를 0으로 clamp해
+ * [0, 1] 범위만 남긴다 (텍셀이 8비트 UNORM이므로).
+ */
+
+#ifndef CITC_BC_DECODE_H
+#define CITC_BC_DECODE_H
+
+#include <stdint.h>
+
+#define BC_BLOCK_DIM 4   /* 블록 한 변의 텍셀 수 */
+
+enum bc_format {
+	BC_NONE = 0,
+	BC_1,
+	BC_2,
+	BC_3,
+	BC_4_UNORM,
+	BC_4_SNORM,
+	BC_5_UNORM,
+	BC_5_SNORM,
+};
+
+/* DXGI_FORMAT 값 → enum bc_format (압축 포맷이 아니면 BC_NONE) */
+enum bc_format bc_format_from_dxgi(int dxgi_format);
+
+/* 블록 하나의 바이트 수 (8 또는 16) */
+int bc_block_bytes(enum bc_format fmt);
+
+/* 블록 하나를 텍셀 16개로 (행 우선: out[y * 4 + x]) */
+void bc_decode_block(enum bc_format fmt, const uint8_t *block,
+		     uint32_t out[BC_BLOCK_DIM * BC_BLOCK_DIM]);
+
+#endif /* CITC_BC_DECODE_H */
@@ -31,36 +31,48 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <float.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "../../../include/win32.h"
 #include "../../../include/d3d11_types.h"
 #include "../../../include/stub_entry.h"
 #include "../dxgi/dxgi.h"
 #include "dxbc.h"
+#include "dxbc_jit.h"
 #include "spirv_emit.h"
 #include "shader_cache.h"
 #include "vk_backend.h"
+#include "thread_pool.h"
+#include "handle_table.h"
+#include "raster_simd.h"
+#include "bc_decode.h"
+#include "d3d11.h"
 
 /* ============================================================
- * 핸들 오프셋
+ * 핸들 종류 태그 (handle_table.h — 핸들 비트 48..55)
  * ============================================================ */
-#define DX_RESOURCE_OFFSET  0x52000
-#define DX_VIEW_OFFSET      0x53000
-#define DX_SHADER_OFFSET    0x54000
-#define DX_LAYOUT_OFFSET    0x56000
-#define DX_STATE_OFFSET     0x57000
-#define DX_SAMPLER_OFFSET   0x58000
+#define DX_HANDLE_RESOURCE  0x52
+#define DX_HANDLE_VIEW      0x53
+#define DX_HANDLE_SHADER    0x54
+#define DX_HANDLE_LAYOUT    0x56
+#define DX_HANDLE_STATE     0x57
+#define DX_HANDLE_SAMPLER   0x58
+#define DX_HANDLE_QUERY     0x59
 
 /* ============================================================
  * 리소스 테이블 (gdi32 패턴)
  * ============================================================
  *
- * D3D11 리소스 (버퍼, 텍스처)를 정적 테이블에 저장.
- * 핸들 = (void*)(index + DX_RESOURCE_OFFSET)
+ * D3D11 리소스 (버퍼, 텍스처)를 핸들 테이블에 저장 (handle_table.h).
+ * 핸들 = DX_HANDLE_RESOURCE 태그 | 세대 | 슬롯 인덱스. 다른 테이블도 같은 방식.
+ * 인덱스는 해제 전까지 바뀌지 않으므로 파이프라인 상태는 인덱스를 보관한다.
  */
-#define MAX_D3D_RESOURCES 256
 
 enum d3d_resource_type {
 	D3D_RES_FREE = 0,
@@ -68,6 +80,55 @@ enum d3d_resource_type {
 	D3D_RES_TEXTURE2D,
 };
 
+/*
+ * Hierarchical-Z: 깊이 버퍼 HIZ_TILE x HIZ_TILE 타일마다 min/max.
+ * [zmin, zmax]는 항상 타일의 실제 깊이를 포함한다 (쓰기 시 넓히기만 함).
+ * dirty면 범위가 느슨할 수 있으므로 필요할 때 타일을 다시 읽어 좁힌다.
+ */
+#define HIZ_TILE 8
+
+/*
+ * 빠른 clear: Clear*View는 픽셀을 쓰지 않고 CLEAR_TILE x CLEAR_TILE
+ * 타일마다 "clear 값으로 채워야 함" 플래그만 켠다 (fast_clear_*).
+ * 타일 크기는 bin 타일(BIN_TILE_SIZE)과 같다.
+ */
+#define CLEAR_TILE 64
+
+struct hiz_tile {
+	float zmin, zmax;
+	int dirty;
+};
+
+/*
+ * 버퍼 이름 바꾸기 (renaming): bin에 쌓인 Draw가 아직 읽을 버퍼를
+ * Map(WRITE_DISCARD)/UpdateSubresource로 덮어쓰면, 제자리에 쓰는 대신
+ * data를 새 블록으로 바꾼다. 물러난 블록은 spare에 두었다가 그 블록을
+ * 참조한 Draw가 모두 래스터라이징된 뒤 (bin_flush) 다시 쓴다.
+ */
+#define BUF_RENAME_MAX_BYTES (8u << 20)  /* 리소스당 spare 상한 */
+
+struct buf_block {
+	void *mem;
+	uint64_t fence;         /* 마지막으로 참조한 bin 배치 (g_buf_batch) */
+};
+
+/*
+ * 샘플링용 밉 체인: 텍스처의 pixels(행 우선, RT/Map이 보는 배치)와 별도로
+ * 4x4 텍셀 타일 배치의 사본을 둔다. 타일 하나가 64바이트 = 캐시 라인 하나라
+ * 축소/회전된 샘플링도 한두 라인 안에서 이웃 텍셀을 찾는다.
+ */
+#define TEX_TILE     4
+#define TEX_MAX_MIPS 15   /* 16384 x 16384까지 */
+
+struct tex_mip {
+	const uint32_t *texels;  /* XRGB8888, 타일 순서 */
+	const uint8_t *blocks;   /* BC 포맷이면 압축 블록 (타일 = 블록) */
+	int width, height;
+	int tiles_w;             /* 행당 타일 수 */
+	uint8_t bc;              /* enum bc_format, BC_NONE = texels */
+	uint8_t block_bytes;
+};
+
 struct d3d_resource {
 	int active;
 	enum d3d_resource_type type;
@@ -76,94 +137,485 @@ struct d3d_resource {
 
 	/* BUFFER 전용 */
 	D3D11_BUFFER_DESC buf_desc;
+	uint64_t fence;         /* data를 마지막으로 참조한 bin 배치 */
+	struct buf_block *spare; /* 이름 바꾸기로 물러난 블록 */
+	int spare_count, spare_cap;
 
 	/* TEXTURE2D 전용 */
 	int width, height;
 	DXGI_FORMAT format;
 	uint32_t *pixels;       /* XRGB8888 (렌더 타깃일 때) */
 	float *depth;           /* D32_FLOAT 깊이 버퍼 */
+	struct hiz_tile *hiz;   /* 깊이 버퍼의 HiZ (hiz_w x hiz_h 타일) */
+	int hiz_w, hiz_h;
+
+	/* 샘플링용 밉 체인 (tex_mips_build) */
+	int bc;                 /* enum bc_format — 압축 텍스처 (data = 블록) */
+	int mip_levels;         /* 만들 레벨 수 (desc.MipLevels, 0 = 전체) */
+	int mip_count;          /* 만들어진 레벨 수, 0 = 없음 */
+	struct tex_mip mips[TEX_MAX_MIPS];
+	uint32_t *mip_data;     /* 모든 레벨 (64바이트 정렬) */
+	unsigned pix_gen;       /* pixels가 바뀔 때마다 증가 */
+	unsigned mip_gen;       /* mips를 만든 시점의 pix_gen */
+
+	/* 빠른 clear (타일 단위 지연 채우기) */
+	uint8_t *clear_tiles;   /* clear_tw x clear_th, 1 = 아직 안 채움 */
+	int clear_tw, clear_th;
+	int clear_pending;      /* 켜진 플래그가 남아 있을 수 있음 */
+	uint32_t clear_color;   /* pixels를 채울 값 */
+	float clear_depth;      /* depth를 채울 값 */
 
 	/* SwapChain 연동 */
 	int is_swapchain_buffer; /* 1이면 pixels는 SwapChain 소유 */
 };
 
-static struct d3d_resource resource_table[MAX_D3D_RESOURCES];
+static struct handle_table g_resources =
+	HANDLE_TABLE_INIT(struct d3d_resource, DX_HANDLE_RESOURCE);
+
+static inline struct d3d_resource *resource_at(int idx)
+{
+	return ht_slot(&g_resources, idx);
+}
+
+/* HiZ 전체를 한 값으로 (깊이 clear) */
+static void hiz_reset(struct d3d_resource *r, float z)
+{
+	int n = r->hiz_w * r->hiz_h;
+	for (int i = 0; i < n; i++) {
+		r->hiz[i].zmin = z;
+		r->hiz[i].zmax = z;
+		r->hiz[i].dirty = 0;
+	}
+}
+
+/* CPU가 깊이 버퍼를 직접 바꿨을 때 (Map/UpdateSubresource) */
+static void hiz_invalidate(struct d3d_resource *r)
+{
+	int n = r->hiz_w * r->hiz_h;
+	for (int i = 0; i < n; i++) {
+		r->hiz[i].zmin = -INFINITY;
+		r->hiz[i].zmax = INFINITY;
+		r->hiz[i].dirty = 1;
+	}
+}
+
+/*
+ * 빠른 clear
+ * ==========
+ *
+ * 전체 화면 clear는 매 프레임 RT/깊이 버퍼 전체를 한 번 더 쓴다.
+ * 대신 플래그만 켜 두고, 실제 채우기는 타일이 처음 쓰이거나 읽힐 때로 미룬다:
+ *   - 래스터라이저: bin_tile_job이 자기 타일만 채운 뒤 그림
+ *     (채우기가 그리기 직전이라 타일이 캐시에 올라와 있음)
+ *   - CPU 읽기/샘플링: Map, CopyResource, Present, SRV 바인딩
+ *     → 그 리소스만 전체 채움 (손대지 않은 RT/깊이 버퍼는 그대로)
+ *   - UpdateSubresource: 어차피 전부 덮어쓰므로 플래그만 끔
+ *
+ * 타일 작업끼리는 서로 다른 플래그만 건드리므로 락이 필요 없다.
+ * clear_pending은 메인 스레드(Clear/flush)에서만 바뀐다.
+ */
+
+/* clear 플래그 켜기. 메모리 부족이면 -1 (호출자가 즉시 채움) */
+static int fast_clear_begin(struct d3d_resource *r)
+{
+	int tw = (r->width + CLEAR_TILE - 1) / CLEAR_TILE;
+	int th = (r->height + CLEAR_TILE - 1) / CLEAR_TILE;
+	if (!r->clear_tiles || r->clear_tw != tw || r->clear_th != th) {
+		uint8_t *t = realloc(r->clear_tiles, (size_t)tw * th);
+		if (!t) return -1;
+		r->clear_tiles = t;
+		r->clear_tw = tw;
+		r->clear_th = th;
+	}
+	memset(r->clear_tiles, 1, (size_t)tw * th);
+	r->clear_pending = 1;
+	return 0;
+}
+
+static void fast_clear_fill_tile(struct d3d_resource *r, int tx, int ty)
+{
+	int x0 = tx * CLEAR_TILE, y0 = ty * CLEAR_TILE;
+	int x1 = x0 + CLEAR_TILE, y1 = y0 + CLEAR_TILE;
+	if (x1 > r->width) x1 = r->width;
+	if (y1 > r->height) y1 = r->height;
+
+	for (int y = y0; y < y1; y++) {
+		size_t row = (size_t)y * r->width;
+		if (r->pixels) {
+			for (int x = x0; x < x1; x++)
+				r->pixels[row + x] = r->clear_color;
+		} else if (r->depth) {
+			for (int x = x0; x < x1; x++)
+				r->depth[row + x] = r->clear_depth;
+		}
+	}
+}
+
+/* 타일 하나를 채움 (래스터라이저 타일 작업에서 호출) */
+static void fast_clear_resolve_tile(struct d3d_resource *r, int tx, int ty)
+{
+	if (!r->clear_pending || tx >= r->clear_tw || ty >= r->clear_th)
+		return;
+	uint8_t *flag = &r->clear_tiles[ty * r->clear_tw + tx];
+	if (*flag) {
+		fast_clear_fill_tile(r, tx, ty);
+		*flag = 0;
+	}
+}
+
+/* 남은 타일을 모두 채움 (CPU가 읽기 전) */
+static void fast_clear_resolve(struct d3d_resource *r)
+{
+	if (!r->clear_pending) return;
+	for (int ty = 0; ty < r->clear_th; ty++)
+		for (int tx = 0; tx < r->clear_tw; tx++)
+			fast_clear_resolve_tile(r, tx, ty);
+	r->clear_pending = 0;
+}
+
+/* 남은 clear를 버림 (리소스 전체를 덮어쓸 때) */
+static void fast_clear_discard(struct d3d_resource *r)
+{
+	r->clear_pending = 0;
+}
+
+/*
+ * 버퍼 이름 바꾸기
+ * ================
+ *
+ * g_buf_batch: 지금 bin에 쌓이는 Draw 묶음 번호. bin_begin_draw가 Draw가
+ * 읽는 PS CB의 fence를 이 값으로 찍고, bin_flush가 끝나면 1 증가한다.
+ * 따라서 fence != g_buf_batch인 블록은 더 이상 아무 Draw도 읽지 않는다.
+ *
+ * g_buf_gen: data 포인터가 바뀔 때마다 증가. 파이프라인 스냅샷은
+ * VB/CB 포인터를 캐시하므로 pipeline_update가 이 값을 보고 다시 푼다.
+ */
+static uint64_t g_buf_batch = 1;
+static unsigned g_buf_gen;
+
+static int buf_in_use(const struct d3d_resource *r)
+{
+	return r->fence == g_buf_batch;
+}
+
+/*
+ * 쌓인 Draw가 읽는 버퍼라면 data를 쓸 수 있는 블록으로 교체.
+ * 새 블록 내용은 정의되지 않음 (호출자가 전부 덮어씀).
+ * 반환: 0 = data에 바로 써도 됨, -1 = 블록 부족 (호출자가 bin_flush)
+ */
+static int buf_rename(struct d3d_resource *r)
+{
+	if (!buf_in_use(r))
+		return 0;
+
+	int i;
+	for (i = 0; i < r->spare_count; i++)
+		if (r->spare[i].fence != g_buf_batch)
+			break;
+
+	if (i == r->spare_count) {
+		if ((size_t)(r->spare_count + 1) * r->size > BUF_RENAME_MAX_BYTES)
+			return -1;
+		if (r->spare_count == r->spare_cap) {
+			int cap = r->spare_cap ? r->spare_cap * 2 : 4;
+			struct buf_block *ns =
+				realloc(r->spare, sizeof(*ns) * cap);
+			if (!ns) return -1;
+			r->spare = ns;
+			r->spare_cap = cap;
+		}
+		void *mem = malloc(r->size);
+		if (!mem) return -1;
+		r->spare[i].mem = mem;
+		r->spare[i].fence = 0;
+		r->spare_count++;
+	}
+
+	struct buf_block old = { r->data, r->fence };
+	r->data = r->spare[i].mem;
+	r->fence = r->spare[i].fence;
+	r->spare[i] = old;
+	g_buf_gen++;
+	return 0;
+}
+
+/*
+ * 밉 체인
+ * =======
+ *
+ * 레벨 0은 pixels를 타일 배치로 옮긴 것이고, 그 아래는 2x2 박스 필터로
+ * 만든다 (홀수 크기는 가장자리 텍셀을 반복). CreateTexture2D는 레벨 0
+ * 데이터만 보관하므로 아래 레벨은 항상 여기서 만든다.
+ *
+ * 만드는 시점:
+ *   - CreateTexture2D (초기 데이터가 있을 때), UpdateSubresource, GenerateMips
+ *   - 그 밖에 pixels가 바뀐 경우 (Draw/Clear/Map) pix_gen만 올려 두고
+ *     다음에 SRV로 샘플링하는 Draw에서 (pipeline_update)
+ * 호출자는 이 텍스처를 읽는 Draw가 bin에 남아 있지 않음을 보장해야 한다.
+ */
+
+/*
+ * BC 블록 캐시 — 압축 텍스처는 블록을 압축된 그대로 두고, 샘플링할 때
+ * 풀어 둔 블록을 여기서 재사용한다. 래스터 타일 작업은 여러 워커에서
+ * 돌므로 스레드마다 하나. 블록 좌표의 하위 3비트로 자리를 정하는
+ * direct-mapped라 화면에서 가까운 8x8 블록 창이 서로 밀어내지 않는다.
+ * g_bc_epoch가 바뀌면 (압축 데이터를 다시 썼으면) 전부 무효.
+ */
+#define BC_CACHE_DIM 8
+
+struct bc_cache_line {
+	const uint8_t *block;
+	unsigned epoch;
+	uint32_t texels[BC_BLOCK_DIM * BC_BLOCK_DIM];
+};
+
+static __thread struct bc_cache_line bc_cache[BC_CACHE_DIM * BC_CACHE_DIM];
+static unsigned g_bc_epoch = 1;
+
+static uint32_t bc_fetch(const struct tex_mip *m, int x, int y)
+{
+	int bx = x / BC_BLOCK_DIM, by = y / BC_BLOCK_DIM;
+	const uint8_t *block = m->blocks +
+		((size_t)by * m->tiles_w + bx) * m->block_bytes;
+	struct bc_cache_line *line =
+		&bc_cache[(by % BC_CACHE_DIM) * BC_CACHE_DIM + bx % BC_CACHE_DIM];
+	unsigned epoch = __atomic_load_n(&g_bc_epoch, __ATOMIC_RELAXED);
+	if (line->block != block || line->epoch != epoch) {
+		bc_decode_block(m->bc, block, line->texels);
+		line->block = block;
+		line->epoch = epoch;
+	}
+	return line->texels[(y % BC_BLOCK_DIM) * BC_BLOCK_DIM + x % BC_BLOCK_DIM];
+}
+
+static inline uint32_t tex_fetch(const struct tex_mip *m, int x, int y)
+{
+	if (m->bc)
+		return bc_fetch(m, x, y);
+	return m->texels[((size_t)(y / TEX_TILE) * m->tiles_w + x / TEX_TILE) *
+			 (TEX_TILE * TEX_TILE) +
+			 (y % TEX_TILE) * TEX_TILE + x % TEX_TILE];
+}
+
+static inline uint32_t *tex_texel(struct tex_mip *m, int x, int y)
+{
+	return (uint32_t *)&m->texels[
+		((size_t)(y / TEX_TILE) * m->tiles_w + x / TEX_TILE) *
+		(TEX_TILE * TEX_TILE) + (y % TEX_TILE) * TEX_TILE + x % TEX_TILE];
+}
+
+/* 2x2 박스 필터 (채널별 반올림 평균) */
+static uint32_t texel_avg4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t out = 0;
+	for (int sh = 0; sh < 24; sh += 8) {
+		uint32_t sum = (a >> sh & 0xFF) + (b >> sh & 0xFF) +
+			       (c >> sh & 0xFF) + (d >> sh & 0xFF);
+		out |= ((sum + 2) >> 2) << sh;
+	}
+	return out;
+}
+
+/*
+ * 레벨 크기/타일 수 채우기. 반환: 레벨 수.
+ * TEX_TILE과 BC 블록 크기가 같아 두 배치가 같은 타일 격자를 쓴다.
+ */
+static int tex_mip_layout(struct d3d_resource *r)
+{
+	int levels = 1;
+	while (levels < TEX_MAX_MIPS &&
+	       (r->width >> levels || r->height >> levels))
+		levels++;
+	if (r->mip_levels > 0 && r->mip_levels < levels)
+		levels = r->mip_levels;
+
+	for (int l = 0; l < levels; l++) {
+		int w = r->width >> l, h = r->height >> l;
+		r->mips[l].width = w < 1 ? 1 : w;
+		r->mips[l].height = h < 1 ? 1 : h;
+		r->mips[l].tiles_w = (r->mips[l].width + TEX_TILE - 1) / TEX_TILE;
+	}
+	return levels;
+}
+
+static size_t tex_mip_tiles(const struct tex_mip *m)
+{
+	return (size_t)m->tiles_w * ((m->height + TEX_TILE - 1) / TEX_TILE);
+}
+
+/*
+ * BC 텍스처: 모든 레벨을 압축된 그대로 한 블록에 (data = 레벨 0).
+ * 아래 레벨은 다시 압축할 수 없으므로 만들지 않고 앱이 준 초기 데이터를
+ * 쓴다 (DDS처럼 레벨마다 데이터가 있는 경우). 없으면 0.
+ * MipLevels = 0 (전체 체인)이면 초기 데이터 배열도 전체 체인의
+ * 레벨 수만큼 있다 (D3D11 규칙) — 체인 길이를 먼저 정하고 모두 읽는다.
+ */
+static int tex_bc_init(struct d3d_resource *r,
+		       const D3D11_SUBRESOURCE_DATA *init)
+{
+	int bytes = bc_block_bytes(r->bc);
+	int levels = tex_mip_layout(r);
+	size_t total = 0;
+	for (int l = 0; l < levels; l++)
+		total += tex_mip_tiles(&r->mips[l]) * bytes;
+
+	uint8_t *mem = calloc(1, total);
+	if (!mem)
+		return -1;
+	r->data = mem;
+	r->size = tex_mip_tiles(&r->mips[0]) * bytes;
+
+	for (int l = 0; l < levels; l++) {
+		struct tex_mip *m = &r->mips[l];
+		m->blocks = mem;
+		m->bc = (uint8_t)r->bc;
+		m->block_bytes = (uint8_t)bytes;
+		size_t row = (size_t)m->tiles_w * bytes;
+		int rows = (m->height + TEX_TILE - 1) / TEX_TILE;
+		if (init && init[l].pSysMem) {
+			size_t pitch = init[l].SysMemPitch ? init[l].SysMemPitch
+							   : row;
+			for (int y = 0; y < rows; y++)
+				memcpy(mem + y * row,
+				       (const uint8_t *)init[l].pSysMem + y * pitch,
+				       row);
+		}
+		mem += row * rows;
+	}
+	r->mip_count = levels;
+	return 0;
+}
+
+static void tex_mips_build(struct d3d_resource *r)
+{
+	r->mip_gen = r->pix_gen;
+	if (r->bc) {
+		/* 블록은 제자리에 있음 — 풀어 둔 캐시만 버림 */
+		__atomic_add_fetch(&g_bc_epoch, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (!r->pixels || r->width <= 0 || r->height <= 0)
+		return;
+
+	if (!r->mip_data) {
+		int levels = tex_mip_layout(r);
+		size_t total = 0;
+		for (int l = 0; l < levels; l++)
+			total += tex_mip_tiles(&r->mips[l]) * TEX_TILE * TEX_TILE;
+		/* 레벨 크기가 16텍셀 배수라 레벨마다 64바이트 정렬이 유지됨 */
+		r->mip_data = aligned_alloc(64, total * sizeof(uint32_t));
+		if (!r->mip_data)
+			return;
+		uint32_t *t = r->mip_data;
+		for (int l = 0; l < levels; l++) {
+			r->mips[l].texels = t;
+			t += tex_mip_tiles(&r->mips[l]) * TEX_TILE * TEX_TILE;
+		}
+		r->mip_count = levels;
+	}
+
+	struct tex_mip *m0 = &r->mips[0];
+	for (int y = 0; y < r->height; y++) {
+		const uint32_t *row = r->pixels + (size_t)y * r->width;
+		for (int x = 0; x < r->width; x++)
+			*tex_texel(m0, x, y) = row[x];
+	}
+
+	for (int l = 1; l < r->mip_count; l++) {
+		const struct tex_mip *src = &r->mips[l - 1];
+		struct tex_mip *dst = &r->mips[l];
+		for (int y = 0; y < dst->height; y++) {
+			int y0 = y * 2 < src->height ? y * 2 : src->height - 1;
+			int y1 = y * 2 + 1 < src->height ? y * 2 + 1 : y0;
+			for (int x = 0; x < dst->width; x++) {
+				int x0 = x * 2 < src->width ? x * 2 : src->width - 1;
+				int x1 = x * 2 + 1 < src->width ? x * 2 + 1 : x0;
+				*tex_texel(dst, x, y) = texel_avg4(
+					tex_fetch(src, x0, y0), tex_fetch(src, x1, y0),
+					tex_fetch(src, x0, y1), tex_fetch(src, x1, y1));
+			}
+		}
+	}
+}
 
 static int alloc_resource(void)
 {
-	for (int i = 0; i < MAX_D3D_RESOURCES; i++)
-		if (!resource_table[i].active)
-			return i;
-	return -1;
+	return ht_alloc(&g_resources);
+}
+
+/* 생성 실패, SwapChain 백버퍼 교체 시 슬롯 반환 */
+static void free_resource(int idx)
+{
+	resource_at(idx)->active = 0;
+	ht_free(&g_resources, idx);
 }
 
 static void *resource_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_RESOURCE_OFFSET);
+	return ht_handle(&g_resources, idx);
 }
 
 static int handle_to_resource_idx(void *handle)
 {
-	uintptr_t val = (uintptr_t)handle;
-	if (val < DX_RESOURCE_OFFSET) return -1;
-	int idx = (int)(val - DX_RESOURCE_OFFSET);
-	if (idx < 0 || idx >= MAX_D3D_RESOURCES) return -1;
-	if (!resource_table[idx].active) return -1;
+	int idx = ht_lookup(&g_resources, handle);
+	if (idx < 0 || !resource_at(idx)->active) return -1;
 	return idx;
 }
 
 /* ============================================================
  * 뷰 테이블
  * ============================================================ */
-#define MAX_D3D_VIEWS 128
 
 enum d3d_view_type {
 	D3D_VIEW_FREE = 0,
 	D3D_VIEW_RTV,
 	D3D_VIEW_SRV,
 	D3D_VIEW_DSV,
+	D3D_VIEW_UAV,
 };
 
 struct d3d_view {
 	int active;
 	enum d3d_view_type type;
 	int resource_idx;
+	uint32_t buf_offset;    /* 버퍼 뷰: 바이트 범위 */
+	uint32_t buf_size;
 };
 
-static struct d3d_view view_table[MAX_D3D_VIEWS];
+static struct handle_table g_views =
+	HANDLE_TABLE_INIT(struct d3d_view, DX_HANDLE_VIEW);
+
+static inline struct d3d_view *view_at(int idx)
+{
+	return ht_slot(&g_views, idx);
+}
 
 static int alloc_view(void)
 {
-	for (int i = 0; i < MAX_D3D_VIEWS; i++)
-		if (!view_table[i].active)
-			return i;
-	return -1;
+	return ht_alloc(&g_views);
 }
 
 static void *view_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_VIEW_OFFSET);
+	return ht_handle(&g_views, idx);
 }
 
 static int handle_to_view_idx(void *handle)
 {
-	uintptr_t val = (uintptr_t)handle;
-	if (val < DX_VIEW_OFFSET) return -1;
-	int idx = (int)(val - DX_VIEW_OFFSET);
-	if (idx < 0 || idx >= MAX_D3D_VIEWS) return -1;
-	if (!view_table[idx].active) return -1;
+	int idx = ht_lookup(&g_views, handle);
+	if (idx < 0 || !view_at(idx)->active) return -1;
 	return idx;
 }
 
 /* ============================================================
  * 셰이더 테이블
  * ============================================================ */
-#define MAX_D3D_SHADERS 64
 
 enum d3d_shader_type {
 	D3D_SHADER_FREE = 0,
 	D3D_SHADER_VERTEX,
 	D3D_SHADER_PIXEL,
+	D3D_SHADER_COMPUTE,
 };
 
 struct d3d_shader {
@@ -172,67 +624,429 @@ struct d3d_shader {
 	void *bytecode;
 	size_t bytecode_size;
 	struct dxbc_info dxbc;  /* DXBC 파싱 결과 */
+	struct dxbc_kernel kernel;  /* 네이티브 커널 (VS/PS 관용구), 없으면 NONE */
 	/* SPIR-V 변환 결과 (Class 43-44) */
 	uint32_t *spirv;
 	size_t spirv_size;
 };
 
-static struct d3d_shader shader_table[MAX_D3D_SHADERS];
+static struct handle_table g_shaders =
+	HANDLE_TABLE_INIT(struct d3d_shader, DX_HANDLE_SHADER);
+
+static inline struct d3d_shader *shader_at(int idx)
+{
+	return ht_slot(&g_shaders, idx);
+}
+
+/*
+ * 네이티브 셰이더 커널: 생성 시 dxbc_classify()로 흔한 VS/PS 모양을
+ * 알아보고, Draw에서는 VM 대신 전용 경로로 실행한다
+ * (vs_stage_shade, raster_triangle의 색/텍스처 경로).
+ * 기본 켜짐 — CITC_D3D11_KERNELS=0 이면 항상 VM/JIT (비교/디버깅용).
+ */
+static int g_kernels_enabled = -1;
+
+static int kernels_enabled(void)
+{
+	int en = __atomic_load_n(&g_kernels_enabled, __ATOMIC_RELAXED);
+	if (en < 0) {
+		const char *env = getenv("CITC_D3D11_KERNELS");
+		en = (env && env[0] == '0') ? 0 : 1;
+		__atomic_store_n(&g_kernels_enabled, en, __ATOMIC_RELAXED);
+	}
+	return en;
+}
 
 static int alloc_shader(void)
 {
-	for (int i = 0; i < MAX_D3D_SHADERS; i++)
-		if (!shader_table[i].active)
-			return i;
-	return -1;
+	return ht_alloc(&g_shaders);
+}
+
+/* 생성 실패 시 슬롯 반환 */
+static void free_shader(int idx)
+{
+	shader_at(idx)->active = 0;
+	ht_free(&g_shaders, idx);
 }
 
 static void *shader_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_SHADER_OFFSET);
+	return ht_handle(&g_shaders, idx);
+}
+
+static int handle_to_shader_idx(void *handle)
+{
+	int idx = ht_lookup(&g_shaders, handle);
+	if (idx < 0 || !shader_at(idx)->active) return -1;
+	return idx;
 }
 
 /* ============================================================
  * InputLayout 테이블
  * ============================================================ */
-#define MAX_D3D_LAYOUTS 32
 #define MAX_INPUT_ELEMENTS 16
+#define MAX_VB_SLOTS 8          /* IASetVertexBuffers 슬롯 (D3D11은 32) */
+
+/*
+ * 정점 fetch 계획
+ * ===============
+ *
+ * InputLayout 생성 시 시맨틱 → VS 입력 레지스터 매핑과 오프셋/포맷을
+ * 한 번 풀어 두고, 포맷 조합에 맞는 fetch 루틴을 고른다.
+ * Draw는 시맨틱 문자열 비교 없이 plan만 보고, 정점마다 포맷 분기 없이
+ * 특수화된 루틴으로 VB → struct vs_input 배열을 채운다.
+ *
+ *   v0 = POSITION (SV_Position)   xyz, w = 1
+ *   v1 = COLOR                    없으면 (1,1,1,1)
+ *   v2 = TEXCOORD                 없으면 (0,0,0,0)
+ *
+ * struct vs_input은 shader_vm.inputs[0..2]와 같은 배치라 그대로 복사된다.
+ * 위 세 요소는 POSITION과 같은 VB 슬롯의 정점 단위 요소에서 읽는다.
+ *
+ * 인스턴스 단위 요소 (PER_INSTANCE_DATA)와 SV_InstanceID는 인스턴스가
+ * 바뀔 때만 읽어 VS 입력 레지스터에 넣어 둔다 (vs_stage_set_instance).
+ * 레지스터 번호는 CreateInputLayout에 넘어온 VS의 입력 시그니처에서
+ * 시맨틱 이름/인덱스로 찾고, 시그니처가 없으면 v3부터 차례로 배정한다.
+ */
+#define FETCH_POS 0
+#define FETCH_COL 1
+#define FETCH_TC  2
+#define FETCH_REGS 3
+
+struct vs_input {
+	float v[FETCH_REGS][4];
+};
+
+struct fetch_plan;
+typedef void (*vertex_fetch_fn)(const struct fetch_plan *p,
+				const uint8_t *vb, UINT stride,
+				UINT first, UINT count, struct vs_input *out);
+
+/* 인스턴스 단위 입력 요소 하나 */
+struct fetch_inst {
+	int reg;                        /* VS 입력 레지스터 */
+	UINT slot;                      /* VB 슬롯 */
+	UINT offset;                    /* 요소 내 바이트 오프셋 */
+	DXGI_FORMAT format;
+	UINT step;                      /* InstanceDataStepRate (0 = 항상 첫 요소) */
+};
+
+struct fetch_plan {
+	int offset[FETCH_REGS];         /* 정점 내 바이트 오프셋, -1 = 없음 */
+	DXGI_FORMAT format[FETCH_REGS];
+	vertex_fetch_fn fetch;
+	UINT slot;                      /* 정점 단위 요소의 VB 슬롯 */
+
+	struct fetch_inst inst[MAX_INPUT_ELEMENTS];
+	int inst_count;
+	int instance_id_reg;            /* SV_InstanceID 레지스터, -1 = 없음 */
+	unsigned inst_regs;             /* 인스턴스 값이 들어가는 레지스터 마스크 */
+};
+
+/* 요소 하나 읽기 (인스턴스 요소, 8비트 색) — 빠진 성분은 (0, 0, 0, 1) */
+static void fetch_format(DXGI_FORMAT fmt, const uint8_t *src, float d[4])
+{
+	const float *f = (const float *)src;
+
+	d[0] = d[1] = d[2] = 0.0f;
+	d[3] = 1.0f;
+	switch (fmt) {
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: d[3] = f[3]; /* fall through */
+	case DXGI_FORMAT_R32G32B32_FLOAT:    d[2] = f[2]; /* fall through */
+	case DXGI_FORMAT_R32G32_FLOAT:       d[1] = f[1]; /* fall through */
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:           /* 정수는 비트 그대로 */
+		memcpy(d, f, 4);
+		break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		for (int k = 0; k < 4; k++)
+			d[k] = src[k] * (1.0f / 255.0f);
+		if (fmt == DXGI_FORMAT_B8G8R8A8_UNORM) {
+			float t = d[0]; d[0] = d[2]; d[2] = t;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* 레지스터 하나 읽기 — 특수화되지 않은 포맷용 */
+static void fetch_element(int reg, DXGI_FORMAT fmt, const uint8_t *src,
+			  float d[4])
+{
+	const float *f = (const float *)src;
+
+	switch (reg) {
+	case FETCH_POS:
+		d[0] = f[0]; d[1] = f[1];
+		d[2] = (fmt == DXGI_FORMAT_R32G32_FLOAT) ? 0.0f : f[2];
+		d[3] = 1.0f;
+		break;
+	case FETCH_COL:
+		if (fmt == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+			d[0] = f[0]; d[1] = f[1]; d[2] = f[2]; d[3] = f[3];
+		} else if (fmt == DXGI_FORMAT_R32G32B32_FLOAT) {
+			d[0] = f[0]; d[1] = f[1]; d[2] = f[2]; d[3] = 1.0f;
+		} else if (fmt == DXGI_FORMAT_R8G8B8A8_UNORM ||
+			   fmt == DXGI_FORMAT_B8G8R8A8_UNORM) {
+			fetch_format(fmt, src, d);
+		} else {
+			d[0] = d[1] = d[2] = d[3] = 1.0f;
+		}
+		break;
+	default:
+		d[0] = f[0]; d[1] = f[1]; d[2] = 0.0f; d[3] = 0.0f;
+		break;
+	}
+}
+
+static void fetch_generic(const struct fetch_plan *p, const uint8_t *vb,
+			  UINT stride, UINT first, UINT count,
+			  struct vs_input *out)
+{
+	static const float defaults[FETCH_REGS][4] = {
+		{ 0, 0, 0, 1 }, { 1, 1, 1, 1 }, { 0, 0, 0, 0 },
+	};
+	const uint8_t *v = vb + (size_t)first * stride;
+	for (UINT i = 0; i < count; i++, v += stride) {
+		for (int r = 0; r < FETCH_REGS; r++) {
+			if (p->offset[r] >= 0)
+				fetch_element(r, p->format[r],
+					      v + p->offset[r], out[i].v[r]);
+			else
+				memcpy(out[i].v[r], defaults[r], 16);
+		}
+	}
+}
+
+/* 특수화 fetch 루틴 — 포맷별 읽기 매크로 조합 */
+#define FETCH_POS_F3(s, d) do {						\
+	const float *f_ = (const float *)(s);				\
+	(d)[0] = f_[0]; (d)[1] = f_[1]; (d)[2] = f_[2]; (d)[3] = 1.0f;	\
+} while (0)
+#define FETCH_COL_NONE(s, d) do {					\
+	(d)[0] = (d)[1] = (d)[2] = (d)[3] = 1.0f;			\
+} while (0)
+#define FETCH_COL_F4(s, d) do {						\
+	const float *f_ = (const float *)(s);				\
+	(d)[0] = f_[0]; (d)[1] = f_[1]; (d)[2] = f_[2]; (d)[3] = f_[3];	\
+} while (0)
+#define FETCH_COL_F3(s, d) do {						\
+	const float *f_ = (const float *)(s);				\
+	(d)[0] = f_[0]; (d)[1] = f_[1]; (d)[2] = f_[2]; (d)[3] = 1.0f;	\
+} while (0)
+#define FETCH_COL_U8(s, d) do {						\
+	const uint8_t *b_ = (s);					\
+	(d)[0] = b_[0] * (1.0f / 255.0f);				\
+	(d)[1] = b_[1] * (1.0f / 255.0f);				\
+	(d)[2] = b_[2] * (1.0f / 255.0f);				\
+	(d)[3] = b_[3] * (1.0f / 255.0f);				\
+} while (0)
+#define FETCH_TC_NONE(s, d) do {					\
+	(d)[0] = (d)[1] = (d)[2] = (d)[3] = 0.0f;			\
+} while (0)
+#define FETCH_TC_F2(s, d) do {						\
+	const float *f_ = (const float *)(s);				\
+	(d)[0] = f_[0]; (d)[1] = f_[1]; (d)[2] = 0.0f; (d)[3] = 0.0f;	\
+} while (0)
+
+#define DEFINE_FETCH(name, COL, TC)					\
+static void name(const struct fetch_plan *p, const uint8_t *vb,		\
+		 UINT stride, UINT first, UINT count,			\
+		 struct vs_input *out)					\
+{									\
+	const uint8_t *v = vb + (size_t)first * stride;			\
+	for (UINT i = 0; i < count; i++, v += stride) {			\
+		FETCH_POS_F3(v + p->offset[FETCH_POS], out[i].v[FETCH_POS]); \
+		COL(v + p->offset[FETCH_COL], out[i].v[FETCH_COL]);	\
+		TC(v + p->offset[FETCH_TC], out[i].v[FETCH_TC]);	\
+	}								\
+}
+
+DEFINE_FETCH(fetch_p3,      FETCH_COL_NONE, FETCH_TC_NONE)
+DEFINE_FETCH(fetch_p3_t2,   FETCH_COL_NONE, FETCH_TC_F2)
+DEFINE_FETCH(fetch_p3c4,    FETCH_COL_F4,   FETCH_TC_NONE)
+DEFINE_FETCH(fetch_p3c4_t2, FETCH_COL_F4,   FETCH_TC_F2)
+DEFINE_FETCH(fetch_p3c3,    FETCH_COL_F3,   FETCH_TC_NONE)
+DEFINE_FETCH(fetch_p3c3_t2, FETCH_COL_F3,   FETCH_TC_F2)
+DEFINE_FETCH(fetch_p3cb,    FETCH_COL_U8,   FETCH_TC_NONE)
+DEFINE_FETCH(fetch_p3cb_t2, FETCH_COL_U8,   FETCH_TC_F2)
+
+/* [COLOR 종류][TEXCOORD 유무] */
+static const vertex_fetch_fn fetch_table[4][2] = {
+	{ fetch_p3,   fetch_p3_t2 },    /* COLOR 없음 */
+	{ fetch_p3c4, fetch_p3c4_t2 },  /* R32G32B32A32_FLOAT */
+	{ fetch_p3c3, fetch_p3c3_t2 },  /* R32G32B32_FLOAT */
+	{ fetch_p3cb, fetch_p3cb_t2 },  /* R8G8B8A8_UNORM */
+};
+
+static UINT dxgi_format_size(DXGI_FORMAT fmt)
+{
+	switch (fmt) {
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:    return 12;
+	case DXGI_FORMAT_R32G32_FLOAT:       return 8;
+	case DXGI_FORMAT_R16_UINT:           return 2;
+	default:                             return 4;
+	}
+}
+
+/*
+ * 시맨틱 이름의 첫 정점 단위 요소 인덱스, 없으면 -1.
+ * slot >= 0이면 그 VB 슬롯의 요소만 본다.
+ */
+static int find_element(const D3D11_INPUT_ELEMENT_DESC *el, int count,
+			const char *semantic, int slot)
+{
+	for (int i = 0; i < count; i++) {
+		if (el[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA)
+			continue;
+		if (slot >= 0 && el[i].InputSlot != (UINT)slot)
+			continue;
+		if (el[i].SemanticName && strcmp(el[i].SemanticName, semantic) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* VS 입력 시그니처에서 시맨틱의 레지스터, 없으면 -1 */
+static int sig_find_register(const struct dxbc_info *sig, const char *name,
+			     UINT index)
+{
+	if (!sig || !name) return -1;
+	for (int i = 0; i < sig->num_inputs; i++)
+		if (strcasecmp(sig->inputs[i].name, name) == 0 &&
+		    (UINT)sig->inputs[i].semantic_idx == index)
+			return sig->inputs[i].register_num;
+	return -1;
+}
+
+/*
+ * 레이아웃 요소 → fetch 계획 (CreateInputLayout에서 1회)
+ * sig: 레이아웃과 함께 넘어온 VS 입력 시그니처 (NULL = 없음)
+ */
+static void fetch_plan_build(struct fetch_plan *p,
+			     const D3D11_INPUT_ELEMENT_DESC *el, int count,
+			     const struct dxbc_info *sig)
+{
+	/* APPEND_ALIGNED_ELEMENT → 실제 오프셋 (슬롯마다 따로 누적) */
+	UINT offsets[MAX_INPUT_ELEMENTS];
+	UINT next[MAX_VB_SLOTS] = { 0 };
+	for (int i = 0; i < count; i++) {
+		UINT slot = el[i].InputSlot < MAX_VB_SLOTS ? el[i].InputSlot : 0;
+		offsets[i] = el[i].AlignedByteOffset;
+		if (offsets[i] == D3D11_APPEND_ALIGNED_ELEMENT)
+			offsets[i] = next[slot];
+		next[slot] = offsets[i] + dxgi_format_size(el[i].Format);
+	}
+
+	int idx[FETCH_REGS];
+	idx[FETCH_POS] = find_element(el, count, "POSITION", -1);
+	if (idx[FETCH_POS] < 0)
+		idx[FETCH_POS] = find_element(el, count, "SV_Position", -1);
+	p->slot = idx[FETCH_POS] >= 0 ? el[idx[FETCH_POS]].InputSlot : 0;
+	idx[FETCH_COL] = find_element(el, count, "COLOR", (int)p->slot);
+	idx[FETCH_TC] = find_element(el, count, "TEXCOORD", (int)p->slot);
+
+	for (int r = 0; r < FETCH_REGS; r++) {
+		p->offset[r] = idx[r] >= 0 ? (int)offsets[idx[r]] : -1;
+		p->format[r] = idx[r] >= 0 ? el[idx[r]].Format
+					   : DXGI_FORMAT_UNKNOWN;
+	}
+
+	/* 인스턴스 단위 요소 → VS 입력 레지스터 */
+	p->inst_count = 0;
+	p->inst_regs = 0;
+	int next_reg = FETCH_REGS;
+	for (int i = 0; i < count; i++) {
+		if (el[i].InputSlotClass != D3D11_INPUT_PER_INSTANCE_DATA ||
+		    el[i].InputSlot >= MAX_VB_SLOTS)
+			continue;
+		int reg = sig_find_register(sig, el[i].SemanticName,
+					    el[i].SemanticIndex);
+		if (reg < 0 && (!sig || sig->num_inputs == 0))
+			reg = next_reg++;
+		if (reg < 0 || reg >= DXBC_MAX_INPUTS)
+			continue;
+		struct fetch_inst *fi = &p->inst[p->inst_count++];
+		fi->reg = reg;
+		fi->slot = el[i].InputSlot;
+		fi->offset = offsets[i];
+		fi->format = el[i].Format;
+		fi->step = el[i].InstanceDataStepRate;
+		p->inst_regs |= 1u << reg;
+	}
+
+	p->instance_id_reg = sig_find_register(sig, "SV_InstanceID", 0);
+	if (p->instance_id_reg >= DXBC_MAX_INPUTS)
+		p->instance_id_reg = -1;
+	if (p->instance_id_reg >= 0)
+		p->inst_regs |= 1u << p->instance_id_reg;
+
+	/* 포맷 조합 → 특수화 루틴 (없으면 일반 루틴) */
+	p->fetch = fetch_generic;
+	DXGI_FORMAT pf = p->format[FETCH_POS];
+	if (pf != DXGI_FORMAT_R32G32B32_FLOAT &&
+	    pf != DXGI_FORMAT_R32G32B32A32_FLOAT)
+		return;
+
+	int col;
+	switch (p->offset[FETCH_COL] < 0 ? DXGI_FORMAT_UNKNOWN
+					 : p->format[FETCH_COL]) {
+	case DXGI_FORMAT_UNKNOWN:            col = 0; break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: col = 1; break;
+	case DXGI_FORMAT_R32G32B32_FLOAT:    col = 2; break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:     col = 3; break;
+	default:                             return;
+	}
+
+	int tc;
+	if (p->offset[FETCH_TC] < 0)
+		tc = 0;
+	else if (p->format[FETCH_TC] == DXGI_FORMAT_R32G32_FLOAT)
+		tc = 1;
+	else
+		return;
+
+	p->fetch = fetch_table[col][tc];
+}
 
 struct d3d_input_layout {
 	int active;
 	D3D11_INPUT_ELEMENT_DESC elements[MAX_INPUT_ELEMENTS];
 	int num_elements;
+	struct fetch_plan plan;     /* 생성 시 계산한 정점 fetch 계획 */
 };
 
-static struct d3d_input_layout layout_table[MAX_D3D_LAYOUTS];
+static struct handle_table g_layouts =
+	HANDLE_TABLE_INIT(struct d3d_input_layout, DX_HANDLE_LAYOUT);
+
+static inline struct d3d_input_layout *layout_at(int idx)
+{
+	return ht_slot(&g_layouts, idx);
+}
 
 static int alloc_layout(void)
 {
-	for (int i = 0; i < MAX_D3D_LAYOUTS; i++)
-		if (!layout_table[i].active)
-			return i;
-	return -1;
+	return ht_alloc(&g_layouts);
 }
 
 static void *layout_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_LAYOUT_OFFSET);
+	return ht_handle(&g_layouts, idx);
 }
 
 static int handle_to_layout_idx(void *handle)
 {
-	uintptr_t val = (uintptr_t)handle;
-	if (val < DX_LAYOUT_OFFSET) return -1;
-	int idx = (int)(val - DX_LAYOUT_OFFSET);
-	if (idx < 0 || idx >= MAX_D3D_LAYOUTS) return -1;
-	if (!layout_table[idx].active) return -1;
+	int idx = ht_lookup(&g_layouts, handle);
+	if (idx < 0 || !layout_at(idx)->active) return -1;
 	return idx;
 }
 
 /* ============================================================
  * 상태 오브젝트 테이블 (DepthStencil, Blend, Rasterizer)
  * ============================================================ */
-#define MAX_D3D_STATES 64
 
 enum d3d_state_type {
 	D3D_STATE_FREE = 0,
@@ -251,66 +1065,135 @@ struct d3d_state {
 	};
 };
 
-static struct d3d_state state_table[MAX_D3D_STATES];
+static struct handle_table g_states =
+	HANDLE_TABLE_INIT(struct d3d_state, DX_HANDLE_STATE);
+
+static inline struct d3d_state *state_at(int idx)
+{
+	return ht_slot(&g_states, idx);
+}
 
 static int alloc_state(void)
 {
-	for (int i = 0; i < MAX_D3D_STATES; i++)
-		if (!state_table[i].active)
-			return i;
-	return -1;
+	return ht_alloc(&g_states);
 }
 
 static void *state_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_STATE_OFFSET);
+	return ht_handle(&g_states, idx);
 }
 
 static int handle_to_state_idx(void *handle)
 {
-	uintptr_t val = (uintptr_t)handle;
-	if (val < DX_STATE_OFFSET) return -1;
-	int idx = (int)(val - DX_STATE_OFFSET);
-	if (idx < 0 || idx >= MAX_D3D_STATES) return -1;
-	if (!state_table[idx].active) return -1;
+	int idx = ht_lookup(&g_states, handle);
+	if (idx < 0 || !state_at(idx)->active) return -1;
 	return idx;
 }
 
 /* ============================================================
  * 샘플러 테이블
  * ============================================================ */
-#define MAX_D3D_SAMPLERS 32
 
 struct d3d_sampler {
 	int active;
 	D3D11_SAMPLER_DESC desc;
 };
 
-static struct d3d_sampler sampler_table[MAX_D3D_SAMPLERS];
+static struct handle_table g_samplers =
+	HANDLE_TABLE_INIT(struct d3d_sampler, DX_HANDLE_SAMPLER);
 
-static int alloc_sampler(void)
+static inline struct d3d_sampler *sampler_at(int idx)
 {
-	for (int i = 0; i < MAX_D3D_SAMPLERS; i++)
-		if (!sampler_table[i].active)
-			return i;
-	return -1;
+	return ht_slot(&g_samplers, idx);
 }
 
-static void *sampler_to_handle(int idx)
+static int alloc_sampler(void)
+{
+	return ht_alloc(&g_samplers);
+}
+
+static void *sampler_to_handle(int idx)
 {
-	return (void *)(uintptr_t)(idx + DX_SAMPLER_OFFSET);
+	return ht_handle(&g_samplers, idx);
 }
 
 static int handle_to_sampler_idx(void *handle)
 {
-	uintptr_t val = (uintptr_t)handle;
-	if (val < DX_SAMPLER_OFFSET) return -1;
-	int idx = (int)(val - DX_SAMPLER_OFFSET);
-	if (idx < 0 || idx >= MAX_D3D_SAMPLERS) return -1;
-	if (!sampler_table[idx].active) return -1;
+	int idx = ht_lookup(&g_samplers, handle);
+	if (idx < 0 || !sampler_at(idx)->active) return -1;
+	return idx;
+}
+
+/* ============================================================
+ * 쿼리 테이블 (ID3D11Query, ID3D11Predicate)
+ * ============================================================
+ *
+ * 래스터라이징은 bin flush 때 일어나므로 결과도 그때 정해진다.
+ *   OCCLUSION(_PREDICATE): Begin~End 사이 Draw의 raster_params.occ가
+ *     samples를 가리키고, 타일 워커가 깊이 테스트를 통과한 픽셀 수를 더함
+ *   EVENT: End 앞의 Draw가 모두 래스터라이징되면 완료
+ *   TIMESTAMP: End에서 bin을 비우고 그 시각 (ns)
+ *   TIMESTAMP_DISJOINT: 주파수 1 GHz, 끊김 없음
+ * End 뒤의 첫 bin_flush가 pending 목록의 쿼리를 모두 done으로 표시.
+ *
+ * 오클루전 쿼리는 겹쳐 진행할 수 있다 (컨텍스트당 QUERY_MAX_OCC개):
+ * Draw는 활성인 쿼리 모두에 픽셀 수를 더한다. 목록이 가득 찬 뒤의
+ * Begin은 세지 못하므로 그 쿼리의 GetData가 E_FAIL을 돌려준다.
+ */
+#define QUERY_MAX_OCC 8
+
+struct d3d_query {
+	int active;
+	D3D11_QUERY type;
+	int hint;               /* PREDICATEHINT: 결과 전이면 기다리지 않고 그림 */
+	int building;           /* Begin ~ End 사이 */
+	int pending;            /* End 뒤 flush 대기 (g_query_pending에 있음) */
+	int done;               /* 결과 준비됨 (GetData가 atomic으로 읽음) */
+	int overflow;           /* Begin 때 활성 목록이 가득 차 세지 못함 */
+	uint64_t samples;       /* 통과 픽셀 수 (타일 워커가 atomic 덧셈) */
+	uint64_t timestamp;     /* TIMESTAMP 값 (ns) */
+};
+
+static struct handle_table g_queries =
+	HANDLE_TABLE_INIT(struct d3d_query, DX_HANDLE_QUERY);
+
+static inline struct d3d_query *query_at(int idx)
+{
+	return ht_slot(&g_queries, idx);
+}
+
+/* End 뒤 아직 래스터라이징되지 않은 쿼리 (bin을 가진 스레드만 접근) */
+static int *g_query_pending;
+static int g_query_pending_count, g_query_pending_cap;
+
+static int alloc_query(void)
+{
+	return ht_alloc(&g_queries);
+}
+
+static void *query_to_handle(int idx)
+{
+	return ht_handle(&g_queries, idx);
+}
+
+static int handle_to_query_idx(void *handle)
+{
+	int idx = ht_lookup(&g_queries, handle);
+	if (idx < 0 || !query_at(idx)->active) return -1;
 	return idx;
 }
 
+/* bin_flush가 호출: 대기 중인 쿼리의 Draw가 모두 끝남 */
+static void query_resolve_pending(void)
+{
+	for (int i = 0; i < g_query_pending_count; i++) {
+		struct d3d_query *q = query_at(g_query_pending[i]);
+		q->pending = 0;
+		__atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+	}
+	g_query_pending_count = 0;
+}
+
 /* ============================================================
  * 유틸리티
  * ============================================================ */
@@ -367,7 +1250,7 @@ dev_CreateBuffer(void *This, const D3D11_BUFFER_DESC *pDesc,
 	int idx = alloc_resource();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	struct d3d_resource *r = &resource_table[idx];
+	struct d3d_resource *r = resource_at(idx);
 	memset(r, 0, sizeof(*r));
 	r->active = 1;
 	r->type = D3D_RES_BUFFER;
@@ -375,7 +1258,7 @@ dev_CreateBuffer(void *This, const D3D11_BUFFER_DESC *pDesc,
 	r->size = pDesc->ByteWidth;
 
 	r->data = calloc(1, pDesc->ByteWidth);
-	if (!r->data) { r->active = 0; return E_OUTOFMEMORY; }
+	if (!r->data) { free_resource(idx); return E_OUTOFMEMORY; }
 
 	if (pInitialData && pInitialData->pSysMem)
 		memcpy(r->data, pInitialData->pSysMem, pDesc->ByteWidth);
@@ -400,34 +1283,53 @@ dev_CreateTexture2D(void *This, const D3D11_TEXTURE2D_DESC *pDesc,
 	int idx = alloc_resource();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	struct d3d_resource *r = &resource_table[idx];
+	struct d3d_resource *r = resource_at(idx);
 	memset(r, 0, sizeof(*r));
 	r->active = 1;
 	r->type = D3D_RES_TEXTURE2D;
 	r->width = (int)pDesc->Width;
 	r->height = (int)pDesc->Height;
 	r->format = pDesc->Format;
+	r->mip_levels = (int)pDesc->MipLevels;
 
 	size_t pixel_count = (size_t)pDesc->Width * pDesc->Height;
 
 	if (pDesc->Format == DXGI_FORMAT_D32_FLOAT) {
 		/* 깊이 버퍼: float 배열, 1.0f로 초기화 */
 		r->depth = malloc(pixel_count * sizeof(float));
-		if (!r->depth) { r->active = 0; return E_OUTOFMEMORY; }
+		if (!r->depth) { free_resource(idx); return E_OUTOFMEMORY; }
 		for (size_t i = 0; i < pixel_count; i++)
 			r->depth[i] = 1.0f;
+		r->hiz_w = (r->width + HIZ_TILE - 1) / HIZ_TILE;
+		r->hiz_h = (r->height + HIZ_TILE - 1) / HIZ_TILE;
+		r->hiz = malloc((size_t)r->hiz_w * r->hiz_h *
+				sizeof(struct hiz_tile));
+		if (!r->hiz) {
+			free(r->depth);
+			free_resource(idx);
+			return E_OUTOFMEMORY;
+		}
+		hiz_reset(r, 1.0f);
 		r->data = r->depth;
 		r->size = pixel_count * sizeof(float);
 		r->pixels = NULL;
+	} else if ((r->bc = bc_format_from_dxgi(pDesc->Format)) != BC_NONE) {
+		/* 블록 압축: 압축된 그대로 보관, 샘플링할 때 블록 단위로 풂 */
+		if (tex_bc_init(r, pInitialData) < 0) {
+			free_resource(idx);
+			return E_OUTOFMEMORY;
+		}
 	} else {
 		r->pixels = calloc(pixel_count, sizeof(uint32_t));
-		if (!r->pixels) { r->active = 0; return E_OUTOFMEMORY; }
+		if (!r->pixels) { free_resource(idx); return E_OUTOFMEMORY; }
 		r->data = r->pixels;
 		r->size = pixel_count * 4;
 		r->depth = NULL;
 
-		if (pInitialData && pInitialData->pSysMem)
+		if (pInitialData && pInitialData->pSysMem) {
 			memcpy(r->pixels, pInitialData->pSysMem, r->size);
+			tex_mips_build(r);
+		}
 	}
 
 	*ppTexture2D = resource_to_handle(idx);
@@ -439,12 +1341,36 @@ static HRESULT __attribute__((ms_abi))
 dev_CreateTexture3D(void *T, void *d, void *i, void **pp)
 { (void)T; (void)d; (void)i; (void)pp; return E_FAIL; }
 
+/*
+ * 버퍼 뷰 범위 (원소 단위 → 바이트). 원소 크기는 structured 버퍼면
+ * StructureByteStride, raw 뷰와 R32 계열은 4바이트.
+ */
+static void view_set_buffer_range(struct d3d_view *v,
+				  const struct d3d_resource *r,
+				  DXGI_FORMAT format, int raw,
+				  UINT first, UINT num)
+{
+	uint64_t elem = 4;
+	if (!raw && (r->buf_desc.MiscFlags &
+		     D3D11_RESOURCE_MISC_BUFFER_STRUCTURED) &&
+	    r->buf_desc.StructureByteStride)
+		elem = r->buf_desc.StructureByteStride;
+	else if (format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+		elem = 16;
+
+	uint64_t off = first * elem, len = num * elem;
+	if (off > r->size) off = r->size;
+	if (len > r->size - off) len = r->size - off;
+	v->buf_offset = (uint32_t)off;
+	v->buf_size = (uint32_t)len;
+}
+
 /* CreateShaderResourceView */
 static HRESULT __attribute__((ms_abi))
 dev_CreateShaderResourceView(void *This, void *pResource,
 			     void *pDesc, void **ppSRView)
 {
-	(void)This; (void)pDesc;
+	(void)This;
 	if (!ppSRView) return E_POINTER;
 
 	int res_idx = handle_to_resource_idx(pResource);
@@ -453,18 +1379,63 @@ dev_CreateShaderResourceView(void *This, void *pResource,
 	int vidx = alloc_view();
 	if (vidx < 0) return E_OUTOFMEMORY;
 
-	view_table[vidx].active = 1;
-	view_table[vidx].type = D3D_VIEW_SRV;
-	view_table[vidx].resource_idx = res_idx;
+	struct d3d_view *v = view_at(vidx);
+	struct d3d_resource *r = resource_at(res_idx);
+	v->active = 1;
+	v->type = D3D_VIEW_SRV;
+	v->resource_idx = res_idx;
+	v->buf_offset = 0;
+	v->buf_size = (uint32_t)r->size;
+
+	/* 버퍼 SRV (compute의 t# — StructuredBuffer/ByteAddressBuffer) */
+	const D3D11_SHADER_RESOURCE_VIEW_DESC *d = pDesc;
+	if (r->type == D3D_RES_BUFFER && d) {
+		if (d->ViewDimension == D3D11_SRV_DIMENSION_BUFFEREX)
+			view_set_buffer_range(v, r, d->Format,
+				d->BufferEx.Flags & D3D11_BUFFEREX_SRV_FLAG_RAW,
+				d->BufferEx.FirstElement, d->BufferEx.NumElements);
+		else if (d->ViewDimension == D3D11_SRV_DIMENSION_BUFFER)
+			view_set_buffer_range(v, r, d->Format, 0,
+				d->Buffer.FirstElement, d->Buffer.NumElements);
+	}
 
 	*ppSRView = view_to_handle(vidx);
 	return S_OK;
 }
 
-/* CreateUnorderedAccessView — 스텁 */
+/* CreateUnorderedAccessView — 버퍼만 (raw / structured) */
 static HRESULT __attribute__((ms_abi))
-dev_CreateUnorderedAccessView(void *T, void *r, void *d, void **pp)
-{ (void)T; (void)r; (void)d; if (pp) *pp = NULL; return E_FAIL; }
+dev_CreateUnorderedAccessView(void *This, void *pResource, void *pDesc,
+			      void **ppUAView)
+{
+	(void)This;
+	if (!ppUAView) return E_POINTER;
+
+	int res_idx = handle_to_resource_idx(pResource);
+	if (res_idx < 0) return E_INVALIDARG;
+	struct d3d_resource *r = resource_at(res_idx);
+	if (r->type != D3D_RES_BUFFER) return E_INVALIDARG;
+
+	int vidx = alloc_view();
+	if (vidx < 0) return E_OUTOFMEMORY;
+
+	struct d3d_view *v = view_at(vidx);
+	v->active = 1;
+	v->type = D3D_VIEW_UAV;
+	v->resource_idx = res_idx;
+	v->buf_offset = 0;
+	v->buf_size = (uint32_t)r->size;
+
+	const D3D11_UNORDERED_ACCESS_VIEW_DESC *d = pDesc;
+	if (d && d->ViewDimension == D3D11_UAV_DIMENSION_BUFFER)
+		view_set_buffer_range(v, r, d->Format,
+				      d->Buffer.Flags & D3D11_BUFFER_UAV_FLAG_RAW,
+				      d->Buffer.FirstElement,
+				      d->Buffer.NumElements);
+
+	*ppUAView = view_to_handle(vidx);
+	return S_OK;
+}
 
 /* CreateRenderTargetView */
 static HRESULT __attribute__((ms_abi))
@@ -490,7 +1461,7 @@ dev_CreateRenderTargetView(void *This, void *pResource,
 			int idx = alloc_resource();
 			if (idx < 0) return E_OUTOFMEMORY;
 
-			struct d3d_resource *r = &resource_table[idx];
+			struct d3d_resource *r = resource_at(idx);
 			memset(r, 0, sizeof(*r));
 			r->active = 1;
 			r->type = D3D_RES_TEXTURE2D;
@@ -512,9 +1483,9 @@ dev_CreateRenderTargetView(void *This, void *pResource,
 	int vidx = alloc_view();
 	if (vidx < 0) return E_OUTOFMEMORY;
 
-	view_table[vidx].active = 1;
-	view_table[vidx].type = D3D_VIEW_RTV;
-	view_table[vidx].resource_idx = res_idx;
+	view_at(vidx)->active = 1;
+	view_at(vidx)->type = D3D_VIEW_RTV;
+	view_at(vidx)->resource_idx = res_idx;
 
 	*ppRTView = view_to_handle(vidx);
 	return S_OK;
@@ -534,9 +1505,9 @@ dev_CreateDepthStencilView(void *This, void *pResource,
 	int vidx = alloc_view();
 	if (vidx < 0) return E_OUTOFMEMORY;
 
-	view_table[vidx].active = 1;
-	view_table[vidx].type = D3D_VIEW_DSV;
-	view_table[vidx].resource_idx = res_idx;
+	view_at(vidx)->active = 1;
+	view_at(vidx)->type = D3D_VIEW_DSV;
+	view_at(vidx)->resource_idx = res_idx;
 
 	*ppDSView = view_to_handle(vidx);
 	return S_OK;
@@ -551,14 +1522,13 @@ dev_CreateInputLayout(void *This,
 		      size_t BytecodeLength,
 		      void **ppInputLayout)
 {
-	(void)This; (void)pShaderBytecodeWithInputSignature;
-	(void)BytecodeLength;
+	(void)This;
 	if (!ppInputLayout) return E_POINTER;
 
 	int idx = alloc_layout();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	struct d3d_input_layout *l = &layout_table[idx];
+	struct d3d_input_layout *l = layout_at(idx);
 	memset(l, 0, sizeof(*l));
 	l->active = 1;
 	l->num_elements = (int)(NumElements < MAX_INPUT_ELEMENTS ? NumElements : MAX_INPUT_ELEMENTS);
@@ -566,6 +1536,13 @@ dev_CreateInputLayout(void *This,
 	for (int i = 0; i < l->num_elements; i++)
 		l->elements[i] = pInputElementDescs[i];
 
+	/* 인스턴스 요소/SV_InstanceID 레지스터는 VS 입력 시그니처로 결정 */
+	struct dxbc_info sig;
+	int has_sig = dxbc_parse(pShaderBytecodeWithInputSignature,
+				 BytecodeLength, &sig) == 0;
+	fetch_plan_build(&l->plan, l->elements, l->num_elements,
+			 has_sig ? &sig : NULL);
+
 	*ppInputLayout = layout_to_handle(idx);
 	return S_OK;
 }
@@ -581,34 +1558,40 @@ dev_CreateVertexShader(void *This, const void *pBytecode, size_t Length,
 	int idx = alloc_shader();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	shader_table[idx].active = 1;
-	shader_table[idx].type = D3D_SHADER_VERTEX;
-	shader_table[idx].bytecode_size = Length;
-	shader_table[idx].bytecode = NULL;
-	shader_table[idx].spirv = NULL;
-	shader_table[idx].spirv_size = 0;
-	memset(&shader_table[idx].dxbc, 0, sizeof(struct dxbc_info));
+	shader_at(idx)->active = 1;
+	shader_at(idx)->type = D3D_SHADER_VERTEX;
+	shader_at(idx)->bytecode_size = Length;
+	shader_at(idx)->bytecode = NULL;
+	shader_at(idx)->spirv = NULL;
+	shader_at(idx)->spirv_size = 0;
+	memset(&shader_at(idx)->dxbc, 0, sizeof(struct dxbc_info));
+	memset(&shader_at(idx)->kernel, 0, sizeof(struct dxbc_kernel));
 	if (pBytecode && Length > 0) {
-		shader_table[idx].bytecode = malloc(Length);
-		if (shader_table[idx].bytecode) {
-			memcpy(shader_table[idx].bytecode, pBytecode, Length);
-			dxbc_parse(shader_table[idx].bytecode, Length,
-				   &shader_table[idx].dxbc);
+		shader_at(idx)->bytecode = malloc(Length);
+		if (shader_at(idx)->bytecode) {
+			memcpy(shader_at(idx)->bytecode, pBytecode, Length);
+			dxbc_parse(shader_at(idx)->bytecode, Length,
+				   &shader_at(idx)->dxbc);
+			if (dxbc_lower(&shader_at(idx)->dxbc) == 0)
+				dxbc_jit_compile(&shader_at(idx)->dxbc);
+			if (kernels_enabled())
+				dxbc_classify(&shader_at(idx)->dxbc,
+					      &shader_at(idx)->kernel);
 			/* Shader cache 조회 (Class 53) */
-			if (shader_table[idx].dxbc.valid) {
+			if (shader_at(idx)->dxbc.valid) {
 				if (shader_cache_lookup(
 					    pBytecode, Length,
-					    &shader_table[idx].spirv,
-					    &shader_table[idx].spirv_size) != 0) {
+					    &shader_at(idx)->spirv,
+					    &shader_at(idx)->spirv_size) != 0) {
 					/* 캐시 미스 → 컴파일 + 저장 */
-					dxbc_to_spirv(&shader_table[idx].dxbc,
-						      &shader_table[idx].spirv,
-						      &shader_table[idx].spirv_size);
-					if (shader_table[idx].spirv)
+					dxbc_to_spirv(&shader_at(idx)->dxbc,
+						      &shader_at(idx)->spirv,
+						      &shader_at(idx)->spirv_size);
+					if (shader_at(idx)->spirv)
 						shader_cache_store(
 							pBytecode, Length,
-							shader_table[idx].spirv,
-							shader_table[idx].spirv_size);
+							shader_at(idx)->spirv,
+							shader_at(idx)->spirv_size);
 				}
 			}
 		}
@@ -634,6 +1617,48 @@ dev_CreateGeometryShaderWithStreamOutput(void *T, const void *p, size_t l,
 { (void)T; (void)p; (void)l; (void)so; (void)ne; (void)bs;
   (void)nb; (void)rs; (void)c; if (pp) *pp = NULL; return E_FAIL; }
 
+/*
+ * CreateComputeShader — SoA VM 전용이라 JIT/SPIR-V 변환은 하지 않음
+ * (Vulkan 경로는 compute 파이프라인이 없음)
+ */
+static HRESULT __attribute__((ms_abi))
+dev_CreateComputeShader(void *This, const void *pBytecode, size_t Length,
+			void *pClassLinkage, void **ppComputeShader)
+{
+	(void)This; (void)pClassLinkage;
+	if (!ppComputeShader) return E_POINTER;
+	if (!pBytecode || Length == 0) return E_INVALIDARG;
+
+	int idx = alloc_shader();
+	if (idx < 0) return E_OUTOFMEMORY;
+
+	struct d3d_shader *sh = shader_at(idx);
+	memset(sh, 0, sizeof(*sh));
+	sh->bytecode = malloc(Length);
+	if (!sh->bytecode) {
+		free_shader(idx);
+		return E_OUTOFMEMORY;
+	}
+	memcpy(sh->bytecode, pBytecode, Length);
+	sh->bytecode_size = Length;
+	if (dxbc_parse(sh->bytecode, Length, &sh->dxbc) != 0 ||
+	    dxbc_lower(&sh->dxbc) != 0) {
+		free(sh->bytecode);
+		free_shader(idx);
+		return E_INVALIDARG;
+	}
+	sh->active = 1;
+	sh->type = D3D_SHADER_COMPUTE;
+
+	*ppComputeShader = shader_to_handle(idx);
+	return S_OK;
+}
+
+/* CreateClassLinkage — 동적 셰이더 링크는 미지원 */
+static HRESULT __attribute__((ms_abi))
+dev_CreateClassLinkage(void *This, void **ppLinkage)
+{ (void)This; if (ppLinkage) *ppLinkage = NULL; return E_FAIL; }
+
 /* CreatePixelShader */
 static HRESULT __attribute__((ms_abi))
 dev_CreatePixelShader(void *This, const void *pBytecode, size_t Length,
@@ -645,33 +1670,39 @@ dev_CreatePixelShader(void *This, const void *pBytecode, size_t Length,
 	int idx = alloc_shader();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	shader_table[idx].active = 1;
-	shader_table[idx].type = D3D_SHADER_PIXEL;
-	shader_table[idx].bytecode_size = Length;
-	shader_table[idx].bytecode = NULL;
-	shader_table[idx].spirv = NULL;
-	shader_table[idx].spirv_size = 0;
-	memset(&shader_table[idx].dxbc, 0, sizeof(struct dxbc_info));
+	shader_at(idx)->active = 1;
+	shader_at(idx)->type = D3D_SHADER_PIXEL;
+	shader_at(idx)->bytecode_size = Length;
+	shader_at(idx)->bytecode = NULL;
+	shader_at(idx)->spirv = NULL;
+	shader_at(idx)->spirv_size = 0;
+	memset(&shader_at(idx)->dxbc, 0, sizeof(struct dxbc_info));
+	memset(&shader_at(idx)->kernel, 0, sizeof(struct dxbc_kernel));
 	if (pBytecode && Length > 0) {
-		shader_table[idx].bytecode = malloc(Length);
-		if (shader_table[idx].bytecode) {
-			memcpy(shader_table[idx].bytecode, pBytecode, Length);
-			dxbc_parse(shader_table[idx].bytecode, Length,
-				   &shader_table[idx].dxbc);
+		shader_at(idx)->bytecode = malloc(Length);
+		if (shader_at(idx)->bytecode) {
+			memcpy(shader_at(idx)->bytecode, pBytecode, Length);
+			dxbc_parse(shader_at(idx)->bytecode, Length,
+				   &shader_at(idx)->dxbc);
+			if (dxbc_lower(&shader_at(idx)->dxbc) == 0)
+				dxbc_jit_compile(&shader_at(idx)->dxbc);
+			if (kernels_enabled())
+				dxbc_classify(&shader_at(idx)->dxbc,
+					      &shader_at(idx)->kernel);
 			/* Shader cache 조회 (Class 53) */
-			if (shader_table[idx].dxbc.valid) {
+			if (shader_at(idx)->dxbc.valid) {
 				if (shader_cache_lookup(
 					    pBytecode, Length,
-					    &shader_table[idx].spirv,
-					    &shader_table[idx].spirv_size) != 0) {
-					dxbc_to_spirv(&shader_table[idx].dxbc,
-						      &shader_table[idx].spirv,
-						      &shader_table[idx].spirv_size);
-					if (shader_table[idx].spirv)
+					    &shader_at(idx)->spirv,
+					    &shader_at(idx)->spirv_size) != 0) {
+					dxbc_to_spirv(&shader_at(idx)->dxbc,
+						      &shader_at(idx)->spirv,
+						      &shader_at(idx)->spirv_size);
+					if (shader_at(idx)->spirv)
 						shader_cache_store(
 							pBytecode, Length,
-							shader_table[idx].spirv,
-							shader_table[idx].spirv_size);
+							shader_at(idx)->spirv,
+							shader_at(idx)->spirv_size);
 				}
 			}
 		}
@@ -692,9 +1723,9 @@ dev_CreateDepthStencilState(void *This, const D3D11_DEPTH_STENCIL_DESC *pDesc,
 	int idx = alloc_state();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	state_table[idx].active = 1;
-	state_table[idx].type = D3D_STATE_DEPTH_STENCIL;
-	state_table[idx].ds = *pDesc;
+	state_at(idx)->active = 1;
+	state_at(idx)->type = D3D_STATE_DEPTH_STENCIL;
+	state_at(idx)->ds = *pDesc;
 
 	*ppDepthStencilState = state_to_handle(idx);
 	return S_OK;
@@ -711,9 +1742,9 @@ dev_CreateBlendState(void *This, const D3D11_BLEND_DESC *pDesc,
 	int idx = alloc_state();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	state_table[idx].active = 1;
-	state_table[idx].type = D3D_STATE_BLEND;
-	state_table[idx].blend = *pDesc;
+	state_at(idx)->active = 1;
+	state_at(idx)->type = D3D_STATE_BLEND;
+	state_at(idx)->blend = *pDesc;
 
 	*ppBlendState = state_to_handle(idx);
 	return S_OK;
@@ -730,9 +1761,9 @@ dev_CreateRasterizerState(void *This, const D3D11_RASTERIZER_DESC *pDesc,
 	int idx = alloc_state();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	state_table[idx].active = 1;
-	state_table[idx].type = D3D_STATE_RASTERIZER;
-	state_table[idx].rs = *pDesc;
+	state_at(idx)->active = 1;
+	state_at(idx)->type = D3D_STATE_RASTERIZER;
+	state_at(idx)->rs = *pDesc;
 
 	*ppRasterizerState = state_to_handle(idx);
 	return S_OK;
@@ -749,13 +1780,58 @@ dev_CreateSamplerState(void *This, const D3D11_SAMPLER_DESC *pDesc,
 	int idx = alloc_sampler();
 	if (idx < 0) return E_OUTOFMEMORY;
 
-	sampler_table[idx].active = 1;
-	sampler_table[idx].desc = *pDesc;
+	sampler_at(idx)->active = 1;
+	sampler_at(idx)->desc = *pDesc;
 
 	*ppSamplerState = sampler_to_handle(idx);
 	return S_OK;
 }
 
+/* CreateQuery / CreatePredicate */
+static HRESULT query_create(const D3D11_QUERY_DESC *pDesc, void **ppQuery)
+{
+	if (!pDesc || !ppQuery) return E_POINTER;
+	switch (pDesc->Query) {
+	case D3D11_QUERY_EVENT:
+	case D3D11_QUERY_OCCLUSION:
+	case D3D11_QUERY_TIMESTAMP:
+	case D3D11_QUERY_TIMESTAMP_DISJOINT:
+	case D3D11_QUERY_OCCLUSION_PREDICATE:
+		break;
+	default:
+		return E_INVALIDARG;   /* 파이프라인 통계, SO 쿼리는 미지원 */
+	}
+
+	int idx = alloc_query();
+	if (idx < 0) return E_OUTOFMEMORY;
+
+	struct d3d_query *q = query_at(idx);
+	memset(q, 0, sizeof(*q));
+	q->active = 1;
+	q->type = pDesc->Query;
+	q->hint = (pDesc->MiscFlags & D3D11_QUERY_MISC_PREDICATEHINT) != 0;
+
+	*ppQuery = query_to_handle(idx);
+	return S_OK;
+}
+
+static HRESULT __attribute__((ms_abi))
+dev_CreateQuery(void *This, const D3D11_QUERY_DESC *pDesc, void **ppQuery)
+{
+	(void)This;
+	return query_create(pDesc, ppQuery);
+}
+
+static HRESULT __attribute__((ms_abi))
+dev_CreatePredicate(void *This, const D3D11_QUERY_DESC *pDesc,
+		    void **ppPredicate)
+{
+	(void)This;
+	if (pDesc && pDesc->Query != D3D11_QUERY_OCCLUSION_PREDICATE)
+		return E_INVALIDARG;
+	return query_create(pDesc, ppPredicate);
+}
+
 /* 나머지 Device 메서드 — 스텁 */
 static HRESULT __attribute__((ms_abi)) dev_stub_hr(void *T, ...) { (void)T; return E_FAIL; }
 static HRESULT __attribute__((ms_abi)) dev_stub_hr_ok(void *T, ...) { (void)T; return S_OK; }
@@ -771,6 +1847,8 @@ dev_GetFeatureLevel(void *This)
 
 static void __attribute__((ms_abi))
 dev_GetImmediateContext(void *This, void **ppContext);
+static HRESULT __attribute__((ms_abi))
+dev_CreateDeferredContext(void *This, UINT ContextFlags, void **ppContext);
 
 /* forward declaration — context 생성 후 설정 */
 static struct d3d11_context *g_context;
@@ -803,19 +1881,21 @@ static ID3D11DeviceVtbl g_device_vtbl = {
 	.CreateDepthStencilView        = dev_CreateDepthStencilView,
 	.CreateInputLayout             = dev_CreateInputLayout,
 	.CreateVertexShader            = dev_CreateVertexShader,
-	.CreateHullShader              = dev_CreateHullShader,
-	.CreateDomainShader            = dev_CreateDomainShader,
 	.CreateGeometryShader          = dev_CreateGeometryShader,
 	.CreateGeometryShaderWithStreamOutput = dev_CreateGeometryShaderWithStreamOutput,
 	.CreatePixelShader             = dev_CreatePixelShader,
+	.CreateHullShader              = dev_CreateHullShader,
+	.CreateDomainShader            = dev_CreateDomainShader,
+	.CreateComputeShader           = dev_CreateComputeShader,
+	.CreateClassLinkage            = dev_CreateClassLinkage,
 	.CreateBlendState              = (void *)dev_CreateBlendState,
 	.CreateDepthStencilState       = (void *)dev_CreateDepthStencilState,
 	.CreateRasterizerState         = (void *)dev_CreateRasterizerState,
 	.CreateSamplerState            = (void *)dev_CreateSamplerState,
-	.CreateQuery                   = (void *)dev_stub_hr,
-	.CreatePredicate               = (void *)dev_stub_hr,
+	.CreateQuery                   = (void *)dev_CreateQuery,
+	.CreatePredicate               = (void *)dev_CreatePredicate,
 	.CreateCounter                 = (void *)dev_stub_hr,
-	.CreateDeferredContext          = (void *)dev_stub_hr,
+	.CreateDeferredContext         = dev_CreateDeferredContext,
 	.OpenSharedResource            = (void *)dev_stub_hr,
 	.CheckFormatSupport            = (void *)dev_stub_hr,
 	.CheckMultisampleQualityLevels = (void *)dev_stub_hr,
@@ -833,17 +1913,173 @@ static ID3D11DeviceVtbl g_device_vtbl = {
 	.GetExceptionMode              = (void *)dev_stub_uint,
 };
 
+/* ============================================================
+ * 동적 해상도 (CITC_D3D11_DYNRES=<프레임 예산 ms>)
+ * ============================================================
+ *
+ * 래스터라이저가 예산을 못 맞추면 SwapChain 백버퍼에 그리는 Draw의
+ * 뷰포트/시저를 배율 s로 줄여 백버퍼의 왼쪽 위 일부에만 그리고,
+ * Present가 그 영역을 bilinear로 창 크기까지 늘린다
+ * (d3d11_dynres_present, raster_simd.c의 upscale 커널).
+ *
+ * 배율은 Present 간격(앱 + Draw + Present 시간)으로 프레임마다 조정:
+ *   예산 초과    → 픽셀 수가 s²에 비례한다고 보고 s * sqrt(예산/시간)
+ *   예산 80% 미만 → 한 단계(1/32)씩만 키움 (진동 방지)
+ * 범위는 0.5 ~ 1.0. 기본 꺼짐.
+ *
+ * 한계: 백버퍼를 Map/복사로 읽으면 줄어든 그림이 보인다.
+ */
+#define DYNRES_STEPS   32   /* 배율 = q / DYNRES_STEPS */
+#define DYNRES_MIN_Q   16   /* 최소 0.5 */
+#define DYNRES_MIN_DIM 16   /* 이보다 작은 백버퍼는 줄이지 않음 */
+
+static struct {
+	int enabled;            /* -1 = 아직 환경변수 안 읽음 */
+	double budget_ms;
+	int q;                  /* 현재 배율 (Draw가 원자적으로 읽음) */
+	int have_last;
+	struct timespec last;   /* 직전 Present 시각 */
+} g_dynres = { .enabled = -1, .q = DYNRES_STEPS };
+
+static int dynres_enabled(void)
+{
+	int en = __atomic_load_n(&g_dynres.enabled, __ATOMIC_ACQUIRE);
+	if (en < 0) {
+		const char *env = getenv("CITC_D3D11_DYNRES");
+		double ms = env ? strtod(env, NULL) : 0.0;
+		en = ms > 0.0;
+		if (en)
+			g_dynres.budget_ms = ms;
+		__atomic_store_n(&g_dynres.enabled, en, __ATOMIC_RELEASE);
+	}
+	return en;
+}
+
+/* rt에 그릴 때의 배율 q (DYNRES_STEPS = 줄이지 않음) */
+static int dynres_scale(const struct d3d_resource *rt)
+{
+	if (!rt || !rt->is_swapchain_buffer ||
+	    rt->width < DYNRES_MIN_DIM || rt->height < DYNRES_MIN_DIM ||
+	    !dynres_enabled())
+		return DYNRES_STEPS;
+	return __atomic_load_n(&g_dynres.q, __ATOMIC_RELAXED);
+}
+
+/* q로 줄였을 때 n 픽셀 중 그려지는 개수 (뷰포트 0..n의 픽셀 중심 규칙) */
+static int dynres_extent(int n, int q)
+{
+	int m = (int)ceil((double)n * q / DYNRES_STEPS - 0.5);
+	return m < 2 ? 2 : m;
+}
+
+/* Present마다: 직전 Present부터의 시간으로 다음 프레임 배율 결정 */
+static void dynres_update(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (g_dynres.have_last) {
+		double ms = (double)(now.tv_sec - g_dynres.last.tv_sec) * 1e3 +
+			    (double)(now.tv_nsec - g_dynres.last.tv_nsec) / 1e6;
+		double budget = g_dynres.budget_ms;
+		int q = g_dynres.q;
+		if (ms > budget) {
+			int nq = (int)(q * sqrt(budget / ms));
+			q = nq < q ? nq : q - 1;
+		} else if (ms < budget * 0.8) {
+			q++;
+		}
+		if (q < DYNRES_MIN_Q) q = DYNRES_MIN_Q;
+		if (q > DYNRES_STEPS) q = DYNRES_STEPS;
+		__atomic_store_n(&g_dynres.q, q, __ATOMIC_RELAXED);
+	}
+	g_dynres.last = now;
+	g_dynres.have_last = 1;
+}
+
 /* ============================================================
  * ID3D11DeviceContext 구현
  * ============================================================ */
 
+/* Draw에 필요한 래스터 상태 (pipeline_update, 비닝 스냅샷) */
+struct raster_params {
+	struct d3d_resource *rt;
+	D3D11_VIEWPORT vp;         /* 값 복사 (비닝 스냅샷용) */
+	int vp_scale;              /* vp/시저에 적용한 동적 해상도 배율 q */
+	/* 깊이 테스트 */
+	float *depth_buf;          /* NULL이면 깊이 테스트 안함 */
+	struct d3d_resource *ds;   /* depth_buf의 리소스 */
+	struct hiz_tile *hiz;      /* depth_buf의 HiZ (NULL = 없음) */
+	int hiz_w;                 /* 타일 행당 개수 */
+	int depth_enable;
+	int depth_write;
+	D3D11_COMPARISON_FUNC depth_func;
+	/* 컬링 */
+	D3D11_CULL_MODE cull_mode;
+	/* 클리핑 */
+	int clip_rect[4];          /* 뷰포트 ∩ 시저, {x0, y0, x1, y1} 포함 범위 */
+	int depth_clip;            /* near/far 평면 클리핑 (DepthClipEnable) */
+	/* 텍스처 */
+	const struct d3d_resource *texture;  /* NULL이면 텍스처 없음 */
+	const D3D11_SAMPLER_DESC *sampler;   /* NULL이면 기본 */
+	/* PS 셰이더 VM */
+	const struct dxbc_info *ps_dxbc;     /* NULL이면 고정 함수 */
+	enum dxbc_kernel_kind ps_kernel;     /* ps_dxbc 대신 쓰는 네이티브 커널 */
+	const float *ps_cb[4];              /* PS 상수 버퍼 */
+	int ps_cb_size[4];
+	struct d3d_resource *ps_cb_res[4];  /* ps_cb의 리소스 (fence 표시용) */
+	/* 출력 병합 (RT0 블렌드) */
+	raster_blend_fn blend_fn;           /* 전용 커널, NULL = 일반 경로 */
+	D3D11_RENDER_TARGET_BLEND_DESC blend;  /* 일반 경로용 (값 복사) */
+	float blend_factor[4];
+	int blend_src_alpha;                /* 소스 알파가 결과에 쓰임 */
+	int blend_opaque;                   /* 대상을 읽지 않고 덮어씀 (TBDR 가능) */
+	/* 오클루전 쿼리: 통과 픽셀 수를 더할 곳 */
+	uint64_t *occ[QUERY_MAX_OCC];
+	int occ_count;
+};
+
+/* Draw에 필요한 VS/IA 상태 (vs_stage_init, 아래 버텍스 처리 절) */
+struct vs_stage {
+	const uint8_t *vb_data;           /* 정점 단위 요소 슬롯 (plan->slot) */
+	UINT stride;
+	const struct fetch_plan *plan;
+	/* 슬롯별 VB (오프셋 적용, 인스턴스 요소용), NULL = 없음 */
+	const uint8_t *slot_data[MAX_VB_SLOTS];
+	size_t slot_size[MAX_VB_SLOTS];
+	UINT slot_stride[MAX_VB_SLOTS];
+	float inst_in[DXBC_MAX_INPUTS][4]; /* 현재 인스턴스의 입력 (plan->inst_regs) */
+	int inst_low;                     /* 인스턴스 레지스터가 v0..v2와 겹침 */
+	int has_texcoord;
+	const struct dxbc_info *vs_dxbc;  /* NULL이면 고정 함수 */
+	const struct dxbc_kernel *kernel; /* 네이티브 커널 (VM 대신), NULL = 없음 */
+	float xform[4][4];                /* VS_XFORM 열 벡터 (Draw마다 cb0에서) */
+	const float *cb[4];
+	int cb_size[4];
+	const float *mvp;                 /* 고정 함수 MVP (vs_cb[0]), NULL = 없음 */
+	struct shader_vm vm;              /* VS VM (VS 상태가 바뀔 때 초기화) */
+};
+
+/*
+ * 파이프라인 스냅샷 dirty 비트
+ *
+ * context는 Draw가 쓰는 raster_params/vs_stage를 들고 있고, Set* 호출은
+ * 해당 그룹에 dirty 비트만 켠다. Draw는 켜진 그룹만 테이블을 다시 풀어
+ * 재구성하므로 상태가 그대로인 연속 Draw는 조회 비용이 없다.
+ * (뷰/상태/셰이더 객체는 생성 후 바뀌지 않으므로 인덱스가 같으면 결과도 같다)
+ */
+#define PIPE_DIRTY_OM  0x1   /* RTV/DSV, DepthStencil/Blend state */
+#define PIPE_DIRTY_RS  0x2   /* Rasterizer state, 뷰포트 */
+#define PIPE_DIRTY_PS  0x4   /* PS 셰이더, SRV, 샘플러, CB */
+#define PIPE_DIRTY_VS  0x8   /* VS 셰이더, CB, InputLayout, VB */
+#define PIPE_DIRTY_ALL 0xf
+
 struct d3d11_context {
 	ID3D11DeviceContextVtbl *lpVtbl;
 	ULONG ref_count;
 
 	/* IA 스테이지 */
-	int vb_resource_idx;
-	UINT vb_stride, vb_offset;
+	int vb_resource_idx[MAX_VB_SLOTS];
+	UINT vb_stride[MAX_VB_SLOTS], vb_offset[MAX_VB_SLOTS];
 	int ib_resource_idx;
 	DXGI_FORMAT ib_format;
 	int input_layout_idx;
@@ -864,16 +2100,45 @@ struct d3d11_context {
 	int ps_srv_idx[8];     /* view_table 인덱스, -1 = unbound */
 	int ps_sampler_idx[8]; /* sampler_table 인덱스, -1 = unbound */
 
+	/* CS 스테이지 (Dispatch 때 바로 읽으므로 스냅샷 없음) */
+	int cs_idx;
+	int cs_cb_idx[8];      /* resource_table 인덱스 */
+	int cs_srv_idx[8];     /* view_table 인덱스 (버퍼 SRV) */
+	int cs_uav_idx[8];     /* view_table 인덱스 */
+
 	/* 상태 오브젝트 인덱스 (state_table, -1 = 기본값) */
 	int ds_state_idx;   /* DepthStencil */
 	int blend_state_idx;
 	int rs_state_idx;   /* Rasterizer */
 	UINT stencil_ref;
+	float blend_factor[4];  /* OMSetBlendState (BLEND_FACTOR용) */
 
 	/* RS 스테이지 */
 	D3D11_VIEWPORT viewport;
+	D3D11_RECT scissor;     /* 0번만 사용 (RS 상태의 ScissorEnable일 때) */
+	UINT num_scissors;
+
+	/* 쿼리 (Begin/End는 상태가 아니므로 ClearState가 건드리지 않음) */
+	struct d3d_query *occ_queries[QUERY_MAX_OCC];  /* 진행 중인 오클루전 쿼리 */
+	int occ_query_count;
+	struct d3d_query *pred;       /* SetPredication, NULL = 항상 그림 */
+	void *pred_handle;            /* GetPredication이 돌려줄 핸들 */
+	BOOL pred_value;              /* 결과가 이 값이면 Draw 생략 */
+
+	/* 현재 파이프라인 스냅샷 (pipeline_update) */
+	unsigned pipe_dirty;          /* PIPE_DIRTY_* */
+	unsigned pipe_buf_gen;        /* 스냅샷 당시 g_buf_gen */
+	struct raster_params pipe;    /* rt == NULL이면 Draw 불가 */
+	struct d3d_resource *pipe_srv; /* pipe.texture (fast clear 해소용) */
+	struct vs_stage vs;
+	int vs_ok;                    /* vs_stage_init 결과 (0 = 사용 가능) */
+
+	/* Deferred context 전용 명령 기록기 (immediate는 NULL) */
+	struct cmd_recorder *rec;
 };
 
+static void cmd_recorder_free(struct cmd_recorder *rec);
+
 /* IUnknown */
 static HRESULT __attribute__((ms_abi))
 ctx_QueryInterface(void *This, REFIID riid, void **ppv)
@@ -886,8 +2151,11 @@ ctx_Release(void *This)
 {
 	struct d3d11_context *c = This;
 	ULONG r = --c->ref_count;
-	if (r == 0)
+	if (r == 0) {
+		if (c->rec)
+			cmd_recorder_free(c->rec);
 		free(c);
+	}
 	return r;
 }
 
@@ -910,6 +2178,7 @@ ctx_VSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
 			 void *const *ppConstantBuffers)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_VS;
 	for (UINT i = 0; i < NumBuffers && (StartSlot + i) < 8; i++) {
 		if (ppConstantBuffers && ppConstantBuffers[i])
 			c->vs_cb_idx[StartSlot + i] =
@@ -923,9 +2192,9 @@ static void __attribute__((ms_abi))
 ctx_VSSetShader(void *This, void *pVS, void *const *ppCI, UINT nCI)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_VS;
 	(void)ppCI; (void)nCI;
-	uintptr_t val = (uintptr_t)pVS;
-	c->vs_idx = (val >= DX_SHADER_OFFSET) ? (int)(val - DX_SHADER_OFFSET) : -1;
+	c->vs_idx = handle_to_shader_idx(pVS);
 }
 
 /* PS 스테이지 */
@@ -934,6 +2203,7 @@ ctx_PSSetShaderResources(void *This, UINT StartSlot, UINT NumViews,
 			 void *const *ppSRViews)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_PS;
 	for (UINT i = 0; i < NumViews && (StartSlot + i) < 8; i++) {
 		if (ppSRViews && ppSRViews[i])
 			c->ps_srv_idx[StartSlot + i] =
@@ -947,6 +2217,7 @@ ctx_PSSetSamplers(void *This, UINT StartSlot, UINT NumSamplers,
 		  void *const *ppSamplers)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_PS;
 	for (UINT i = 0; i < NumSamplers && (StartSlot + i) < 8; i++) {
 		if (ppSamplers && ppSamplers[i])
 			c->ps_sampler_idx[StartSlot + i] =
@@ -960,9 +2231,9 @@ static void __attribute__((ms_abi))
 ctx_PSSetShader(void *This, void *pPS, void *const *ppCI, UINT nCI)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_PS;
 	(void)ppCI; (void)nCI;
-	uintptr_t val = (uintptr_t)pPS;
-	c->ps_idx = (val >= DX_SHADER_OFFSET) ? (int)(val - DX_SHADER_OFFSET) : -1;
+	c->ps_idx = handle_to_shader_idx(pPS);
 }
 
 /* IA 스테이지 */
@@ -970,6 +2241,7 @@ static void __attribute__((ms_abi))
 ctx_IASetInputLayout(void *This, void *pInputLayout)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_VS;
 	c->input_layout_idx = handle_to_layout_idx(pInputLayout);
 }
 
@@ -979,13 +2251,17 @@ ctx_IASetVertexBuffers(void *This, UINT StartSlot, UINT NumBuffers,
 		       const UINT *pStrides, const UINT *pOffsets)
 {
 	struct d3d11_context *c = This;
-	(void)StartSlot; (void)NumBuffers;
-	if (ppVertexBuffers && ppVertexBuffers[0])
-		c->vb_resource_idx = handle_to_resource_idx(ppVertexBuffers[0]);
-	else
-		c->vb_resource_idx = -1;
-	c->vb_stride = pStrides ? pStrides[0] : 0;
-	c->vb_offset = pOffsets ? pOffsets[0] : 0;
+	c->pipe_dirty |= PIPE_DIRTY_VS;
+	for (UINT i = 0; i < NumBuffers && StartSlot + i < MAX_VB_SLOTS; i++) {
+		UINT s = StartSlot + i;
+		if (ppVertexBuffers && ppVertexBuffers[i])
+			c->vb_resource_idx[s] =
+				handle_to_resource_idx(ppVertexBuffers[i]);
+		else
+			c->vb_resource_idx[s] = -1;
+		c->vb_stride[s] = pStrides ? pStrides[i] : 0;
+		c->vb_offset[s] = pOffsets ? pOffsets[i] : 0;
+	}
 }
 
 static void __attribute__((ms_abi))
@@ -1015,6 +2291,7 @@ ctx_OMSetRenderTargets(void *This, UINT NumViews,
 		       void *pDepthStencilView)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_OM;
 	if (ppRenderTargetViews && NumViews > 0 && ppRenderTargetViews[0])
 		c->rtv_idx = handle_to_view_idx(ppRenderTargetViews[0]);
 	else
@@ -1031,6 +2308,7 @@ static void __attribute__((ms_abi))
 ctx_OMSetDepthStencilState(void *This, void *pState, UINT StencilRef)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_OM;
 	c->ds_state_idx = pState ? handle_to_state_idx(pState) : -1;
 	c->stencil_ref = StencilRef;
 }
@@ -1040,8 +2318,11 @@ ctx_OMSetBlendState(void *This, void *pState,
 		    const float BlendFactor[4], UINT SampleMask)
 {
 	struct d3d11_context *c = This;
-	(void)BlendFactor; (void)SampleMask;
+	c->pipe_dirty |= PIPE_DIRTY_OM;
+	(void)SampleMask;
 	c->blend_state_idx = pState ? handle_to_state_idx(pState) : -1;
+	for (int i = 0; i < 4; i++)
+		c->blend_factor[i] = BlendFactor ? BlendFactor[i] : 1.0f;
 }
 
 /* RS 상태 바인딩 */
@@ -1049,6 +2330,7 @@ static void __attribute__((ms_abi))
 ctx_RSSetState(void *This, void *pState)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_RS;
 	c->rs_state_idx = pState ? handle_to_state_idx(pState) : -1;
 }
 
@@ -1058,15 +2340,50 @@ ctx_RSSetViewports(void *This, UINT NumViewports,
 		   const D3D11_VIEWPORT *pViewports)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_RS;
 	if (pViewports && NumViewports > 0)
 		c->viewport = pViewports[0];
 }
 
+static void __attribute__((ms_abi))
+ctx_RSSetScissorRects(void *This, UINT NumRects, const D3D11_RECT *pRects)
+{
+	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_RS;
+	c->num_scissors = pRects ? NumRects : 0;
+	if (c->num_scissors > 0)
+		c->scissor = pRects[0];
+}
+
+static void __attribute__((ms_abi))
+ctx_RSGetViewports(void *This, UINT *pNumViewports, D3D11_VIEWPORT *pViewports)
+{
+	struct d3d11_context *c = This;
+	if (!pNumViewports) return;
+	if (pViewports && *pNumViewports > 0)
+		pViewports[0] = c->viewport;
+	*pNumViewports = 1;
+}
+
+static void __attribute__((ms_abi))
+ctx_RSGetScissorRects(void *This, UINT *pNumRects, D3D11_RECT *pRects)
+{
+	struct d3d11_context *c = This;
+	if (!pNumRects) return;
+	if (pRects && *pNumRects > 0 && c->num_scissors > 0)
+		pRects[0] = c->scissor;
+	*pNumRects = c->num_scissors > 0 ? 1 : 0;
+}
+
+/* 타일 bin flush (래스터라이저 절, 아래) — 빠른 clear는 채우지 않음 */
+static void bin_flush(int keep_last);
+
 /*
  * ClearRenderTargetView — RTV를 단색으로 초기화
  *
  * 가장 기본적인 렌더링 동작:
  *   RTV가 가리키는 텍스처의 모든 픽셀을 clearColor로 채움.
+ *   실제 채우기는 타일이 쓰이거나 읽힐 때까지 미룸 (빠른 clear).
  */
 static void __attribute__((ms_abi))
 ctx_ClearRenderTargetView(void *This, void *pRenderTargetView,
@@ -1076,16 +2393,23 @@ ctx_ClearRenderTargetView(void *This, void *pRenderTargetView,
 	int vidx = handle_to_view_idx(pRenderTargetView);
 	if (vidx < 0) return;
 
-	int ridx = view_table[vidx].resource_idx;
-	if (ridx < 0 || ridx >= MAX_D3D_RESOURCES) return;
+	int ridx = view_at(vidx)->resource_idx;
+	if (ridx < 0) return;
 
-	struct d3d_resource *r = &resource_table[ridx];
+	struct d3d_resource *r = resource_at(ridx);
 	if (!r->active || !r->pixels) return;
 
-	uint32_t c = float4_to_xrgb(ColorRGBA);
-	int count = r->width * r->height;
-	for (int i = 0; i < count; i++)
-		r->pixels[i] = c;
+	/* 앞선 Draw가 bin에 남아 있으면 먼저 그림 */
+	bin_flush(0);
+
+	/* 픽셀은 나중에 타일 단위로 채움 (빠른 clear) */
+	r->clear_color = float4_to_xrgb(ColorRGBA);
+	r->pix_gen++;
+	if (fast_clear_begin(r) < 0) {
+		int count = r->width * r->height;
+		for (int i = 0; i < count; i++)
+			r->pixels[i] = r->clear_color;
+	}
 
 #ifdef CITC_VULKAN_ENABLED
 	/* GPU도 같이 clear (Class 42에서 GPU Draw 시 사용) */
@@ -1096,13 +2420,69 @@ ctx_ClearRenderTargetView(void *This, void *pRenderTargetView,
 #endif
 }
 
+/* Map의 RowPitch: 텍스처는 한 행 (BC는 블록 한 줄), 버퍼는 전체 */
+static UINT resource_row_pitch(const struct d3d_resource *r)
+{
+	if (r->type != D3D_RES_TEXTURE2D)
+		return (UINT)r->size;
+	if (r->bc)
+		return (UINT)(r->mips[0].tiles_w * bc_block_bytes(r->bc));
+	return (UINT)(r->width * 4);
+}
+
+/*
+ * UpdateSubresource 대상 영역: pDstBox (NULL = 전체)를 data 안의 바이트
+ * 범위로 — offset부터 row_bytes씩 rows행, 행 간격 pitch.
+ * BC 텍스처는 4x4 블록 단위. 빈 상자거나 범위를 벗어나면 -1.
+ */
+struct update_region {
+	size_t offset;
+	size_t row_bytes;
+	size_t pitch;
+	UINT rows;
+};
+
+static int update_region_of(const struct d3d_resource *r,
+			    const D3D11_BOX *box, struct update_region *u)
+{
+	if (r->type != D3D_RES_TEXTURE2D) {
+		size_t left = box ? box->left : 0;
+		size_t right = box ? box->right : r->size;
+		if (left >= right || right > r->size) return -1;
+		u->offset = left;
+		u->row_bytes = right - left;
+		u->pitch = u->row_bytes;
+		u->rows = 1;
+		return 0;
+	}
+
+	UINT unit = r->bc ? 4 : 1;
+	size_t texel = r->bc ? (size_t)bc_block_bytes(r->bc) : 4;
+	UINT w = ((UINT)r->width + unit - 1) / unit;
+	UINT h = ((UINT)r->height + unit - 1) / unit;
+	UINT x0 = 0, y0 = 0, x1 = w, y1 = h;
+	if (box) {
+		if (box->front >= box->back) return -1;
+		x0 = box->left / unit;
+		y0 = box->top / unit;
+		x1 = (box->right + unit - 1) / unit;
+		y1 = (box->bottom + unit - 1) / unit;
+	}
+	if (x0 >= x1 || y0 >= y1 || x1 > w || y1 > h) return -1;
+	u->pitch = resource_row_pitch(r);
+	u->offset = (size_t)y0 * u->pitch + x0 * texel;
+	u->row_bytes = (x1 - x0) * texel;
+	u->rows = y1 - y0;
+	return 0;
+}
+
 /* Map/Unmap — 리소스 CPU 접근 */
 static HRESULT __attribute__((ms_abi))
 ctx_Map(void *This, void *pResource, UINT Subresource,
 	D3D11_MAP MapType, UINT MapFlags,
 	D3D11_MAPPED_SUBRESOURCE *pMapped)
 {
-	(void)This; (void)Subresource; (void)MapType; (void)MapFlags;
+	(void)This; (void)Subresource; (void)MapFlags;
 	if (!pMapped) return E_POINTER;
 
 	int idx = handle_to_resource_idx(pResource);
@@ -1113,10 +2493,32 @@ ctx_Map(void *This, void *pResource, UINT Subresource,
 
 	if (idx < 0) return E_INVALIDARG;
 
-	struct d3d_resource *r = &resource_table[idx];
+	struct d3d_resource *r = resource_at(idx);
+
+	/* 텍스처는 bin에 쌓인 Draw의 결과/입력일 수 있음 → 먼저 flush.
+	 * 버퍼는 VS가 Draw 시점에 소비하고, 나중에 읽는 것은 PS CB뿐:
+	 *   WRITE_DISCARD  → 쌓인 Draw가 읽는 중이면 새 블록으로 이름 바꾸기
+	 *   NO_OVERWRITE   → 앱이 사용 중인 영역은 안 쓴다고 약속 → 그대로
+	 *   WRITE/READ_WRITE → 쌓인 Draw가 읽는 중이면 flush */
+	if (r->type != D3D_RES_BUFFER) {
+		d3d11_flush();
+		fast_clear_resolve(r);
+	} else if (MapType == D3D11_MAP_WRITE_DISCARD) {
+		if (buf_rename(r) < 0)
+			bin_flush(0);
+	} else if (MapType != D3D11_MAP_WRITE_NO_OVERWRITE &&
+		   MapType != D3D11_MAP_READ && buf_in_use(r)) {
+		bin_flush(0);
+	}
+	if (MapType != D3D11_MAP_READ) {
+		if (r->hiz)
+			hiz_invalidate(r);
+		if (r->type == D3D_RES_TEXTURE2D)
+			r->pix_gen++;
+	}
+
 	pMapped->pData = r->data;
-	pMapped->RowPitch = (r->type == D3D_RES_TEXTURE2D) ?
-			    (UINT)(r->width * 4) : (UINT)r->size;
+	pMapped->RowPitch = resource_row_pitch(r);
 	pMapped->DepthPitch = 0;
 	return S_OK;
 }
@@ -1131,16 +2533,59 @@ ctx_UpdateSubresource(void *This, void *pDstResource, UINT DstSubresource,
 		      void *pDstBox, const void *pSrcData,
 		      UINT SrcRowPitch, UINT SrcDepthPitch)
 {
-	(void)This; (void)DstSubresource; (void)pDstBox;
-	(void)SrcRowPitch; (void)SrcDepthPitch;
+	(void)This; (void)DstSubresource; (void)SrcDepthPitch;
 	if (!pSrcData) return;
 
 	int idx = handle_to_resource_idx(pDstResource);
 	if (idx < 0) return;
 
-	struct d3d_resource *r = &resource_table[idx];
-	if (r->data && r->size > 0)
-		memcpy(r->data, pSrcData, r->size);
+	struct d3d_resource *r = resource_at(idx);
+	struct update_region u;
+	if (!r->data || update_region_of(r, pDstBox, &u) < 0) return;
+
+	if (u.offset == 0 && u.row_bytes == u.pitch &&
+	    (size_t)u.rows * u.pitch == r->size) {
+		/* 버퍼는 쌓인 Draw가 읽는 중이면 이름 바꾸기 (전체를 덮어씀) */
+		if (r->type != D3D_RES_BUFFER || buf_rename(r) < 0)
+			bin_flush(0);
+		/* 전체를 덮어쓰므로 남은 clear는 채울 필요 없음 */
+		fast_clear_discard(r);
+	} else {
+		/* 일부만 씀 — 나머지 내용과 남은 clear를 살려 둠 */
+		if (r->type != D3D_RES_BUFFER || buf_in_use(r))
+			bin_flush(0);
+		fast_clear_resolve(r);
+	}
+	size_t src_pitch = SrcRowPitch ? SrcRowPitch : u.row_bytes;
+	for (UINT y = 0; y < u.rows; y++)
+		memcpy((uint8_t *)r->data + u.offset + y * u.pitch,
+		       (const uint8_t *)pSrcData + y * src_pitch, u.row_bytes);
+	if (r->hiz)
+		hiz_invalidate(r);
+	if (r->type == D3D_RES_TEXTURE2D) {
+		r->pix_gen++;
+		tex_mips_build(r);
+	}
+}
+
+/* GenerateMips — SRV가 가리키는 텍스처의 밉 체인을 레벨 0에서 다시 만듦 */
+static void __attribute__((ms_abi))
+ctx_GenerateMips(void *This, void *pShaderResourceView)
+{
+	(void)This;
+	int vidx = handle_to_view_idx(pShaderResourceView);
+	if (vidx < 0) return;
+
+	int ridx = view_at(vidx)->resource_idx;
+	if (ridx < 0) return;
+
+	struct d3d_resource *r = resource_at(ridx);
+	if (!r->active || !r->pixels) return;
+
+	/* 쌓인 Draw가 레벨 0에 그리거나 이전 밉을 읽을 수 있음 */
+	bin_flush(0);
+	fast_clear_resolve(r);
+	tex_mips_build(r);
 }
 
 /* ClearDepthStencilView — 깊이/스텐실 버퍼 초기화 */
@@ -1152,14 +2597,21 @@ ctx_ClearDepthStencilView(void *This, void *pDSView,
 	int vidx = handle_to_view_idx(pDSView);
 	if (vidx < 0) return;
 
-	int ridx = view_table[vidx].resource_idx;
-	if (ridx < 0 || ridx >= MAX_D3D_RESOURCES) return;
+	int ridx = view_at(vidx)->resource_idx;
+	if (ridx < 0) return;
 
-	struct d3d_resource *r = &resource_table[ridx];
+	struct d3d_resource *r = resource_at(ridx);
 	if ((ClearFlags & D3D11_CLEAR_DEPTH) && r->depth) {
-		int count = r->width * r->height;
-		for (int i = 0; i < count; i++)
-			r->depth[i] = Depth;
+		bin_flush(0);
+		r->clear_depth = Depth;
+		if (fast_clear_begin(r) < 0) {
+			int count = r->width * r->height;
+			for (int i = 0; i < count; i++)
+				r->depth[i] = Depth;
+		}
+		/* HiZ는 바로 clear 값으로 — 채우기 전에도 타일 기각 가능 */
+		if (r->hiz)
+			hiz_reset(r, Depth);
 	}
 }
 
@@ -1172,8 +2624,8 @@ ctx_ClearDepthStencilView(void *This, void *pDSView,
  * 소프트웨어 파이프라인:
  *   1. VB에서 버텍스 읽기 (InputLayout으로 POSITION, COLOR 추출)
  *   2. NDC → 스크린 좌표 변환 (viewport transform)
- *   3. 삼각형별 edge function으로 내부 픽셀 결정
- *   4. Barycentric 보간으로 색상 계산
+ *   3. 28.4 고정소수점 setup — edge 평면 + top-left 규칙
+ *   4. 속성(z, 색상, UV) 평면식으로 보간 (픽셀당 덧셈만)
  *   5. 렌더 타깃에 쓰기
  */
 
@@ -1195,96 +2647,194 @@ static void mat4_mul_vec4(const float m[16], const float v[4], float out[4])
 }
 
 struct sw_vertex {
-	float pos[4];      /* x, y, z, w (NDC / clip space) */
+	float pos[4];      /* x, y, z, w (클립 공간, bin 이후에는 x/y 스크린, z NDC) */
 	float color[4];    /* r, g, b, a */
 	float texcoord[2]; /* u, v */
 	int has_texcoord;
 };
 
-/* edge function: 점 P가 엣지 AB의 어느 쪽에 있는지 */
-static float edge_func(float ax, float ay, float bx, float by,
-		       float px, float py)
-{
-	return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
-}
+/*
+ * 텍스처 샘플링
+ * =============
+ *
+ * D3D11 규칙을 따른다:
+ *   - 텍셀 중심은 (i + 0.5) / size — 포인트는 floor(u * size),
+ *     선형은 u * size - 0.5 주변 2x2
+ *   - 주소 모드는 정수 텍셀 좌표에 적용 (탭마다)
+ *   - LOD = log2(쿼드 UV 미분의 최대 길이, 텍셀 단위) + MipLODBias,
+ *     [MinLOD, MaxLOD]로 clamp. LOD <= 0이면 확대 필터, 아니면 축소 필터
+ *   - Filter 비트: 0x01 = 밉 선형, 0x04 = 확대 선형, 0x10 = 축소 선형
+ *     (비등방은 삼선형으로 처리)
+ *
+ * 이중선형 가중치는 8비트 고정소수점이라 4탭 합이 정수 연산이고,
+ * float 변환은 레벨당 채널마다 한 번뿐이다.
+ */
 
-/* 텍스처 주소 모드 적용 */
-static float apply_address_mode(float coord, D3D11_TEXTURE_ADDRESS_MODE mode)
+#define TEX_FILTER_MIP_LINEAR 0x01
+#define TEX_FILTER_MAG_LINEAR 0x04
+#define TEX_FILTER_MIN_LINEAR 0x10
+
+/* 샘플러 미지정 시 D3D11 기본 상태 */
+static const D3D11_SAMPLER_DESC default_sampler = {
+	.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR,
+	.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP,
+	.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP,
+	.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP,
+	.MaxAnisotropy = 1,
+	.ComparisonFunc = D3D11_COMPARISON_NEVER,
+	.BorderColor = { 1.0f, 1.0f, 1.0f, 1.0f },
+	.MinLOD = -FLT_MAX,
+	.MaxLOD = FLT_MAX,
+};
+
+/* 정수 텍셀 좌표에 주소 모드 적용. BORDER 밖이면 -1 */
+static int tex_address(int i, int size, D3D11_TEXTURE_ADDRESS_MODE mode)
 {
 	switch (mode) {
 	case D3D11_TEXTURE_ADDRESS_WRAP:
-		coord = coord - floorf(coord); /* fmod → [0,1) */
-		break;
+		i %= size;
+		return i < 0 ? i + size : i;
 	case D3D11_TEXTURE_ADDRESS_MIRROR: {
-		float t = coord - floorf(coord);
-		int period = (int)floorf(coord);
-		if (period & 1) t = 1.0f - t;
-		coord = t;
-		break;
+		int period = size * 2;
+		i %= period;
+		if (i < 0) i += period;
+		return i < size ? i : period - 1 - i;
 	}
+	case D3D11_TEXTURE_ADDRESS_BORDER:
+		return (i < 0 || i >= size) ? -1 : i;
+	case D3D11_TEXTURE_ADDRESS_MIRROR_ONCE:
+		if (i < 0) i = -1 - i;
+		/* fall through */
 	case D3D11_TEXTURE_ADDRESS_CLAMP:
 	default:
-		if (coord < 0.0f) coord = 0.0f;
-		if (coord > 1.0f) coord = 1.0f;
-		break;
+		return i < 0 ? 0 : i >= size ? size - 1 : i;
 	}
-	return coord;
 }
 
-/* UV → 텍셀 샘플링 (POINT 필터링) */
-static void sample_texture(const struct d3d_resource *tex,
-			   const D3D11_SAMPLER_DESC *samp,
-			   float u, float v, float out[4])
+/* 텍셀 좌표 → int (주소 모드가 감당할 범위로 제한) */
+static inline int tex_coord_floor(float c)
 {
-	if (!tex || !tex->pixels) {
-		out[0] = out[1] = out[2] = out[3] = 1.0f;
+	if (!(c > -1e8f)) return -100000000;  /* NaN 포함 */
+	if (c > 1e8f) return 100000000;
+	return (int)floorf(c);
+}
+
+/* 레벨 하나에서 포인트/이중선형 샘플 → 8비트 채널 값 * 65536 */
+static void tex_sample_level(const struct tex_mip *m,
+			     const D3D11_SAMPLER_DESC *samp, uint32_t border,
+			     float u, float v, int linear, uint32_t acc[3])
+{
+	if (!linear) {
+		int x = tex_address(tex_coord_floor(u * m->width), m->width,
+				    samp->AddressU);
+		int y = tex_address(tex_coord_floor(v * m->height), m->height,
+				    samp->AddressV);
+		uint32_t t = (x < 0 || y < 0) ? border : tex_fetch(m, x, y);
+		for (int ch = 0; ch < 3; ch++)
+			acc[ch] = (t >> (16 - ch * 8) & 0xFF) << 16;
 		return;
 	}
 
-	D3D11_TEXTURE_ADDRESS_MODE addr_u = D3D11_TEXTURE_ADDRESS_CLAMP;
-	D3D11_TEXTURE_ADDRESS_MODE addr_v = D3D11_TEXTURE_ADDRESS_CLAMP;
-	if (samp) {
-		addr_u = samp->AddressU;
-		addr_v = samp->AddressV;
+	float fx = u * m->width - 0.5f, fy = v * m->height - 0.5f;
+	int ix = tex_coord_floor(fx), iy = tex_coord_floor(fy);
+	float wx = fx - floorf(fx), wy = fy - floorf(fy);
+	if (!(wx >= 0.0f && wx < 1.0f)) wx = 0.0f;  /* NaN/inf */
+	if (!(wy >= 0.0f && wy < 1.0f)) wy = 0.0f;
+	uint32_t ax = (uint32_t)(wx * 256.0f), ay = (uint32_t)(wy * 256.0f);
+
+	int x0 = tex_address(ix, m->width, samp->AddressU);
+	int x1 = tex_address(ix + 1, m->width, samp->AddressU);
+	int y0 = tex_address(iy, m->height, samp->AddressV);
+	int y1 = tex_address(iy + 1, m->height, samp->AddressV);
+	uint32_t t00 = (x0 < 0 || y0 < 0) ? border : tex_fetch(m, x0, y0);
+	uint32_t t10 = (x1 < 0 || y0 < 0) ? border : tex_fetch(m, x1, y0);
+	uint32_t t01 = (x0 < 0 || y1 < 0) ? border : tex_fetch(m, x0, y1);
+	uint32_t t11 = (x1 < 0 || y1 < 0) ? border : tex_fetch(m, x1, y1);
+
+	for (int ch = 0; ch < 3; ch++) {
+		int sh = 16 - ch * 8;
+		uint32_t top = (t00 >> sh & 0xFF) * (256 - ax) +
+			       (t10 >> sh & 0xFF) * ax;
+		uint32_t bot = (t01 >> sh & 0xFF) * (256 - ax) +
+			       (t11 >> sh & 0xFF) * ax;
+		acc[ch] = top * (256 - ay) + bot * ay;
 	}
+}
 
-	u = apply_address_mode(u, addr_u);
-	v = apply_address_mode(v, addr_v);
+/*
+ * 쿼드 미분으로 LOD 계산 (바이어스/clamp 전)
+ * dudx..dvdy: 픽셀 하나 이동 시 UV 변화량
+ */
+static float texture_lod(const struct d3d_resource *tex,
+			 float dudx, float dvdx, float dudy, float dvdy)
+{
+	float w = (float)tex->width, h = (float)tex->height;
+	float lx = dudx * dudx * w * w + dvdx * dvdx * h * h;
+	float ly = dudy * dudy * w * w + dvdy * dvdy * h * h;
+	float rho2 = lx > ly ? lx : ly;
+	if (!(rho2 > 0.0f))
+		return -FLT_MAX;
+	return 0.5f * log2f(rho2);
+}
 
-	int tx = (int)(u * (tex->width  - 1) + 0.5f);
-	int ty = (int)(v * (tex->height - 1) + 0.5f);
-	if (tx < 0) tx = 0;
-	if (tx >= tex->width)  tx = tex->width - 1;
-	if (ty < 0) ty = 0;
-	if (ty >= tex->height) ty = tex->height - 1;
+/* UV → 텍스처 색 (lod: texture_lod 결과) */
+static void sample_texture(const struct d3d_resource *tex,
+			   const D3D11_SAMPLER_DESC *samp,
+			   float u, float v, float lod, float out[4])
+{
+	if (!tex || !tex->mip_count) {
+		out[0] = out[1] = out[2] = out[3] = 1.0f;
+		return;
+	}
+	if (!samp)
+		samp = &default_sampler;
+
+	float lambda = lod + samp->MipLODBias;
+	if (lambda < samp->MinLOD) lambda = samp->MinLOD;
+	if (lambda > samp->MaxLOD) lambda = samp->MaxLOD;
+
+	uint32_t border = float4_to_xrgb(samp->BorderColor);
+	unsigned filter = (unsigned)samp->Filter;
+	uint32_t acc[3], acc2[3];
+	float scale = 1.0f / (255.0f * 65536.0f);
+
+	if (!(lambda > 0.0f)) {
+		/* 확대: 레벨 0 */
+		tex_sample_level(&tex->mips[0], samp, border, u, v,
+				 filter & TEX_FILTER_MAG_LINEAR, acc);
+		for (int ch = 0; ch < 3; ch++)
+			out[ch] = (float)acc[ch] * scale;
+		out[3] = 1.0f;
+		return;
+	}
 
-	uint32_t pixel = tex->pixels[ty * tex->width + tx];
-	/* XRGB8888 → float4 */
-	out[0] = (float)((pixel >> 16) & 0xFF) / 255.0f;
-	out[1] = (float)((pixel >>  8) & 0xFF) / 255.0f;
-	out[2] = (float)((pixel >>  0) & 0xFF) / 255.0f;
+	int linear = filter & TEX_FILTER_MIN_LINEAR;
+	int last = tex->mip_count - 1;
+	if (!(filter & TEX_FILTER_MIP_LINEAR)) {
+		int l = (int)(lambda + 0.5f);
+		if (l > last) l = last;
+		tex_sample_level(&tex->mips[l], samp, border, u, v, linear, acc);
+		for (int ch = 0; ch < 3; ch++)
+			out[ch] = (float)acc[ch] * scale;
+	} else {
+		int l = lambda < (float)last ? (int)lambda : last;
+		float f = lambda - (float)l;
+		tex_sample_level(&tex->mips[l], samp, border, u, v, linear, acc);
+		if (l < last && f > 0.0f) {
+			tex_sample_level(&tex->mips[l + 1], samp, border, u, v,
+					 linear, acc2);
+			for (int ch = 0; ch < 3; ch++)
+				out[ch] = ((float)acc[ch] * (1.0f - f) +
+					   (float)acc2[ch] * f) * scale;
+		} else {
+			for (int ch = 0; ch < 3; ch++)
+				out[ch] = (float)acc[ch] * scale;
+		}
+	}
 	out[3] = 1.0f;
 }
 
 /* 래스터라이저 파라미터 */
-struct raster_params {
-	struct d3d_resource *rt;
-	const D3D11_VIEWPORT *vp;
-	/* 깊이 테스트 */
-	float *depth_buf;          /* NULL이면 깊이 테스트 안함 */
-	int depth_enable;
-	int depth_write;
-	D3D11_COMPARISON_FUNC depth_func;
-	/* 컬링 */
-	D3D11_CULL_MODE cull_mode;
-	/* 텍스처 */
-	const struct d3d_resource *texture;  /* NULL이면 텍스처 없음 */
-	const D3D11_SAMPLER_DESC *sampler;   /* NULL이면 기본 */
-	/* PS 셰이더 VM */
-	const struct dxbc_info *ps_dxbc;     /* NULL이면 고정 함수 */
-	const float *ps_cb[4];              /* PS 상수 버퍼 */
-	int ps_cb_size[4];
-};
 
 /* 비교 함수 평가 */
 static int depth_compare(D3D11_COMPARISON_FUNC func, float src, float dst)
@@ -1302,207 +2852,681 @@ static int depth_compare(D3D11_COMPARISON_FUNC func, float src, float dst)
 	}
 }
 
-static void rasterize_triangle(const struct raster_params *p,
-			       const struct sw_vertex v[3])
+/*
+ * HiZ 질의
+ * ========
+ *
+ * 삼각형(또는 블록)의 깊이 범위 [zmin, zmax]가 타일의 기존 깊이에 대해
+ * 모든 픽셀에서 깊이 테스트를 실패하는지 판정한다.
+ *   LESS(_EQUAL):       zmin >(=) 타일 zmax 이면 전부 실패
+ *   GREATER(_EQUAL):    zmax <(=) 타일 zmin 이면 전부 실패
+ * 나머지 비교 함수는 판정하지 않는다.
+ *
+ * 타일 범위가 느슨할(dirty) 때는 먼저 느슨한 범위로 판정해 보고,
+ * 그걸로 결론이 안 날 때만 타일 64픽셀을 다시 읽어 범위를 좁힌다.
+ */
+static int hiz_usable(const struct raster_params *p)
 {
-	if (!p->rt || !p->rt->pixels) return;
+	if (!p->hiz || !p->depth_enable || !p->depth_buf)
+		return 0;
+	switch (p->depth_func) {
+	case D3D11_COMPARISON_LESS:
+	case D3D11_COMPARISON_LESS_EQUAL:
+	case D3D11_COMPARISON_GREATER:
+	case D3D11_COMPARISON_GREATER_EQUAL:
+		return 1;
+	default:
+		return 0;
+	}
+}
 
-	int rt_w = p->rt->width;
-	int rt_h = p->rt->height;
+static void hiz_refresh(const struct raster_params *p, struct hiz_tile *t,
+			int tx, int ty)
+{
+	int rt_w = p->rt->width, rt_h = p->rt->height;
+	int x1 = (tx + 1) * HIZ_TILE < rt_w ? (tx + 1) * HIZ_TILE : rt_w;
+	int y1 = (ty + 1) * HIZ_TILE < rt_h ? (ty + 1) * HIZ_TILE : rt_h;
+	float zmin = INFINITY, zmax = -INFINITY;
+
+	for (int y = ty * HIZ_TILE; y < y1; y++) {
+		const float *row = p->depth_buf + (size_t)y * rt_w;
+		for (int x = tx * HIZ_TILE; x < x1; x++) {
+			float z = row[x];
+			if (z < zmin) zmin = z;
+			if (z > zmax) zmax = z;
+		}
+	}
+	t->zmin = zmin;
+	t->zmax = zmax;
+	t->dirty = 0;
+}
+
+/* 범위만으로 판정: 1 = 전부 실패 */
+static int hiz_test(D3D11_COMPARISON_FUNC func, const struct hiz_tile *t,
+		    float zmin, float zmax)
+{
+	switch (func) {
+	case D3D11_COMPARISON_LESS:          return zmin >= t->zmax;
+	case D3D11_COMPARISON_LESS_EQUAL:    return zmin > t->zmax;
+	case D3D11_COMPARISON_GREATER:       return zmax <= t->zmin;
+	case D3D11_COMPARISON_GREATER_EQUAL: return zmax < t->zmin;
+	default:                             return 0;
+	}
+}
+
+static int hiz_rejects(const struct raster_params *p, int tx, int ty,
+		       float zmin, float zmax)
+{
+	struct hiz_tile *t = &p->hiz[ty * p->hiz_w + tx];
+	if (hiz_test(p->depth_func, t, zmin, zmax))
+		return 1;
+	if (!t->dirty)
+		return 0;
+
+	/* 느슨한 범위의 반대쪽 끝조차 넘지 못하면 좁혀도 소용없음 */
+	int less = p->depth_func == D3D11_COMPARISON_LESS ||
+		   p->depth_func == D3D11_COMPARISON_LESS_EQUAL;
+	if (less ? zmin < t->zmin : zmax > t->zmax)
+		return 0;
+
+	hiz_refresh(p, t, tx, ty);
+	return hiz_test(p->depth_func, t, zmin, zmax);
+}
+
+/* 깊이 쓰기 반영: 범위를 넓히고 dirty 표시 */
+static void hiz_update(struct hiz_tile *t, float zmin, float zmax)
+{
+	if (zmin < t->zmin) t->zmin = zmin;
+	if (zmax > t->zmax) t->zmax = zmax;
+	t->dirty = 1;
+}
+
+/*
+ * 28.4 고정소수점 삼각형 setup
+ * ============================
+ *
+ * 스크린 좌표를 1/16 픽셀 격자에 스냅한 뒤 정수로 edge 평면을 구한다.
+ *   w_i(P) = a_i*Px + b_i*Py + c_i      (P, 정점 모두 28.4)
+ * edge i는 정점 (i+1, i+2). 면적 부호로 winding을 정규화해
+ * 내부 = 세 w 모두 >= 0 이 되도록 한다.
+ *
+ * Top-left 규칙 (D3D):
+ *   edge 위에 정확히 놓인 픽셀 중심은 top 또는 left edge일 때만 포함.
+ *   정규화된 평면에서 내부 방향 법선 (a, b)가
+ *     left  edge: a > 0 (오른쪽을 향함)
+ *     top   edge: a == 0 && b > 0 (아래를 향하는 수평 edge)
+ *   나머지 edge는 c에서 1을 빼 w == 0 을 바깥으로 만든다.
+ *   → 인접 삼각형의 공유 edge 픽셀이 정확히 한 번만 칠해진다.
+ *
+ * 정수 범위: 좌표는 guard band(±RASTER_GUARD_BAND px)로 제한되므로
+ *   |a|,|b| <= 2^18, |c| <= 2^36 → 평면 평가는 int64.
+ *   커널에는 ±2^30으로 클램프한 int32를 넘긴다 (span 안에서의 변화량
+ *   |a*16*8| <= 2^25 이므로 클램프된 edge는 span 전체에서 부호 유지).
+ */
+
+#define RASTER_GUARD_BAND  8192.0f
+#define RASTER_EDGE_CLAMP  (1 << 30)
+
+struct tri_setup {
+	int64_t ea[3], eb[3], ec[3];  /* 정규화된 edge 평면 (bias 없음) */
+	int64_t bias[3];              /* top-left: 0, 그 외: 1 */
+	int64_t area;                 /* 2배 면적 (> 0) */
+	int bbox[4];                  /* {min_x, min_y, max_x, max_y} 포함 범위 */
+};
+
+/* floor(n / 16) — 음수에서도 내림 */
+static int64_t fixed_floor16(int64_t n)
+{
+	return n >= 0 ? n / 16 : -((-n + 15) / 16);
+}
+
+/*
+ * 스크린 공간 삼각형 setup.
+ * v[i].pos[0..1] = 스크린 좌표 (픽셀), guard band 안이어야 함.
+ * 반환: 1 = 그릴 것 있음, 0 = 퇴화/컬링/화면 밖.
+ */
+static int tri_setup_fixed(const struct raster_params *p,
+			   const struct sw_vertex v[3],
+			   struct tri_setup *s)
+{
+	int64_t X[3], Y[3];
+	for (int i = 0; i < 3; i++) {
+		X[i] = (int64_t)lrintf(v[i].pos[0] * 16.0f);
+		Y[i] = (int64_t)lrintf(v[i].pos[1] * 16.0f);
+	}
+
+	/* 2배 면적 — 양수 = CW (기본 앞면), 음수 = CCW (뒷면) */
+	int64_t area = (X[1] - X[0]) * (Y[2] - Y[0]) -
+		       (Y[1] - Y[0]) * (X[2] - X[0]);
+	if (area == 0) return 0; /* 퇴화 삼각형 */
+
+	if (p->cull_mode == D3D11_CULL_BACK && area < 0)
+		return 0;
+	if (p->cull_mode == D3D11_CULL_FRONT && area > 0)
+		return 0;
+
+	int64_t sign = area > 0 ? 1 : -1;
+	s->area = area * sign;
 
-	/* NDC(-1~1) → 스크린 좌표 변환 */
-	float sx[3], sy[3];
 	for (int i = 0; i < 3; i++) {
-		sx[i] = p->vp->TopLeftX + (v[i].pos[0] + 1.0f) * 0.5f * p->vp->Width;
-		sy[i] = p->vp->TopLeftY + (1.0f - v[i].pos[1]) * 0.5f * p->vp->Height;
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		int64_t dx = X[i2] - X[i1];
+		int64_t dy = Y[i2] - Y[i1];
+		s->ea[i] = -dy * sign;
+		s->eb[i] = dx * sign;
+		s->ec[i] = (dy * X[i1] - dx * Y[i1]) * sign;
+		int top_left = s->ea[i] > 0 || (s->ea[i] == 0 && s->eb[i] > 0);
+		s->bias[i] = top_left ? 0 : 1;
 	}
 
-	/* 바운딩 박스 */
-	float fmin_x = sx[0], fmax_x = sx[0];
-	float fmin_y = sy[0], fmax_y = sy[0];
+	/* 바운딩 박스: 픽셀 중심 (x*16 + 8)이 [min, max] 안인 픽셀 */
+	int64_t min_X = X[0], max_X = X[0], min_Y = Y[0], max_Y = Y[0];
 	for (int i = 1; i < 3; i++) {
-		if (sx[i] < fmin_x) fmin_x = sx[i];
-		if (sx[i] > fmax_x) fmax_x = sx[i];
-		if (sy[i] < fmin_y) fmin_y = sy[i];
-		if (sy[i] > fmax_y) fmax_y = sy[i];
+		if (X[i] < min_X) min_X = X[i];
+		if (X[i] > max_X) max_X = X[i];
+		if (Y[i] < min_Y) min_Y = Y[i];
+		if (Y[i] > max_Y) max_Y = Y[i];
+	}
+	int64_t min_x = -fixed_floor16(8 - min_X);  /* ceil((min - 8) / 16) */
+	int64_t min_y = -fixed_floor16(8 - min_Y);
+	int64_t max_x = fixed_floor16(max_X - 8);
+	int64_t max_y = fixed_floor16(max_Y - 8);
+
+	/* 뷰포트 ∩ 시저 ∩ RT */
+	if (min_x < p->clip_rect[0]) min_x = p->clip_rect[0];
+	if (min_y < p->clip_rect[1]) min_y = p->clip_rect[1];
+	if (max_x > p->clip_rect[2]) max_x = p->clip_rect[2];
+	if (max_y > p->clip_rect[3]) max_y = p->clip_rect[3];
+	if (max_x >= p->rt->width)  max_x = p->rt->width - 1;
+	if (max_y >= p->rt->height) max_y = p->rt->height - 1;
+	if (min_x > max_x || min_y > max_y) return 0;
+
+	s->bbox[0] = (int)min_x; s->bbox[1] = (int)min_y;
+	s->bbox[2] = (int)max_x; s->bbox[3] = (int)max_y;
+	return 1;
+}
+
+static int32_t clamp_edge(int64_t w)
+{
+	if (w > RASTER_EDGE_CLAMP) return RASTER_EDGE_CLAMP;
+	if (w < -RASTER_EDGE_CLAMP) return -RASTER_EDGE_CLAMP;
+	return (int32_t)w;
+}
+
+/* ============================================================
+ * 출력 병합 — 일반 블렌드 경로
+ * ============================================================
+ *
+ * 전용 커널(raster_simd.c)이 없는 팩터/연산/쓰기 마스크 조합.
+ * 렌더 타깃이 XRGB라 대상 알파는 항상 1이고, 알파 채널 블렌드
+ * (SrcBlendAlpha 등)는 결과에 남지 않으므로 계산하지 않는다.
+ */
+
+static const float k_ones[RASTER_SPAN] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+
+static float blend_factor_value(D3D11_BLEND f, int ch, const float s[4],
+				const float d[3], const float bf[4])
+{
+	switch (f) {
+	case D3D11_BLEND_ZERO:             return 0.0f;
+	case D3D11_BLEND_SRC_COLOR:        return s[ch];
+	case D3D11_BLEND_INV_SRC_COLOR:    return 1.0f - s[ch];
+	case D3D11_BLEND_SRC_ALPHA:        return s[3];
+	case D3D11_BLEND_INV_SRC_ALPHA:    return 1.0f - s[3];
+	case D3D11_BLEND_DEST_ALPHA:       return 1.0f;
+	case D3D11_BLEND_INV_DEST_ALPHA:   return 0.0f;
+	case D3D11_BLEND_DEST_COLOR:       return d[ch];
+	case D3D11_BLEND_INV_DEST_COLOR:   return 1.0f - d[ch];
+	case D3D11_BLEND_SRC_ALPHA_SAT:    return 0.0f;  /* min(As, 1 - Ad) */
+	case D3D11_BLEND_BLEND_FACTOR:     return bf[ch];
+	case D3D11_BLEND_INV_BLEND_FACTOR: return 1.0f - bf[ch];
+	default:                           return 1.0f;  /* ONE, 미지원 */
 	}
+}
 
-	int min_x = (int)floorf(fmin_x);
-	int max_x = (int)ceilf(fmax_x);
-	int min_y = (int)floorf(fmin_y);
-	int max_y = (int)ceilf(fmax_y);
+static void om_blend_generic(const struct raster_params *p, uint32_t *row0,
+			     uint32_t *row1, const float *const src[4],
+			     unsigned mask)
+{
+	const D3D11_RENDER_TARGET_BLEND_DESC *b = &p->blend;
+	uint32_t keep = 0;  /* 쓰기 마스크로 보존할 대상 비트 */
+	if (!(b->RenderTargetWriteMask & D3D11_COLOR_WRITE_ENABLE_RED))
+		keep |= 0xFF0000;
+	if (!(b->RenderTargetWriteMask & D3D11_COLOR_WRITE_ENABLE_GREEN))
+		keep |= 0x00FF00;
+	if (!(b->RenderTargetWriteMask & D3D11_COLOR_WRITE_ENABLE_BLUE))
+		keep |= 0x0000FF;
+
+	for (unsigned m = mask; m; m &= m - 1) {
+		int k = __builtin_ctz(m);
+		uint32_t *px = k < RASTER_BLOCK_W ? &row0[k]
+						  : &row1[k - RASTER_BLOCK_W];
+		uint32_t dst = *px;
+		float s[4], d[3], o[4];
+		for (int ch = 0; ch < 4; ch++) {
+			float c = src[ch][k];  /* UNORM 타깃: 소스를 [0, 1]로 */
+			s[ch] = c > 0.0f ? (c < 1.0f ? c : 1.0f) : 0.0f;
+		}
+		for (int ch = 0; ch < 3; ch++)
+			d[ch] = (float)(dst >> (16 - ch * 8) & 0xFF) / 255.0f;
+
+		for (int ch = 0; ch < 3; ch++) {
+			if (!b->BlendEnable) {
+				o[ch] = s[ch];
+				continue;
+			}
+			float sf = blend_factor_value(b->SrcBlend, ch, s, d,
+						      p->blend_factor);
+			float df = blend_factor_value(b->DestBlend, ch, s, d,
+						      p->blend_factor);
+			switch (b->BlendOp) {
+			case D3D11_BLEND_OP_SUBTRACT:
+				o[ch] = s[ch] * sf - d[ch] * df;
+				break;
+			case D3D11_BLEND_OP_REV_SUBTRACT:
+				o[ch] = d[ch] * df - s[ch] * sf;
+				break;
+			case D3D11_BLEND_OP_MIN:
+				o[ch] = s[ch] < d[ch] ? s[ch] : d[ch];
+				break;
+			case D3D11_BLEND_OP_MAX:
+				o[ch] = s[ch] > d[ch] ? s[ch] : d[ch];
+				break;
+			default:
+				o[ch] = s[ch] * sf + d[ch] * df;
+				break;
+			}
+		}
+		o[3] = 1.0f;
+		*px = (float4_to_xrgb(o) & ~keep) | (dst & keep);
+	}
+}
 
-	if (min_x < 0) min_x = 0;
-	if (min_y < 0) min_y = 0;
-	if (max_x >= rt_w) max_x = rt_w - 1;
-	if (max_y >= rt_h) max_y = rt_h - 1;
+/*
+ * 타일 기반 지연 셰이딩 (TBDR) 패스 — bin_tile_job 참고
+ *
+ *   RASTER_VISIBILITY  깊이 테스트(와 깊이 쓰기)만 하고 통과한 픽셀에
+ *                      삼각형 id를 기록. 나중 것이 덮어쓰므로 남는 id는
+ *                      순서대로 그렸을 때 마지막으로 색을 쓸 삼각형
+ *   RASTER_SHADE       ids == id인 픽셀만 셰이딩 + 출력 병합
+ *                      (깊이는 이미 최종값이라 테스트하지 않음)
+ *
+ * 바리센트릭은 저장하지 않는다 — 셰이딩 패스가 같은 edge/속성 평면을
+ * 다시 세우므로 같은 값이 나오고, 2x2 쿼드의 UV 차분도 그대로 얻는다.
+ */
+enum raster_pass {
+	RASTER_VISIBILITY,
+	RASTER_SHADE,
+};
 
-	/* 삼각형 전체 면적 (2배) — 부호로 앞/뒷면 판별 */
-	float area = edge_func(sx[0], sy[0], sx[1], sy[1], sx[2], sy[2]);
-	if (fabsf(area) < 0.001f) return; /* 퇴화 삼각형 */
+struct raster_vis {
+	enum raster_pass pass;
+	uint32_t *ids;   /* clip 영역 픽셀별 id (행 폭 = clip 폭) */
+	uint32_t id;
+};
 
-	/* 컬링: area > 0 = CW (기본 앞면), area < 0 = CCW (뒷면) */
-	if (p->cull_mode == D3D11_CULL_BACK && area < 0)
-		return;
-	if (p->cull_mode == D3D11_CULL_FRONT && area > 0)
-		return;
+/*
+ * 삼각형 래스터라이징 (타일 단위)
+ *
+ * v: 스크린 공간 정점 (bin_triangle에서 viewport 변환 + guard band 클리핑).
+ * clip = {x0, y0, x1, y1} (포함 범위) — 담당 타일 영역.
+ * vis: NULL이면 테스트부터 출력 병합까지 한 번에, 아니면 TBDR 패스 하나.
+ * 타일끼리 픽셀이 겹치지 않으므로 워커 스레드 간 동기화가 필요 없다.
+ */
+static void rasterize_triangle(const struct raster_params *p,
+			       const struct sw_vertex v[3],
+			       const int clip[4],
+			       const struct raster_vis *vis)
+{
+	if (!p->rt || !p->rt->pixels) return;
 
-	float inv_area = 1.0f / area;
+	int rt_w = p->rt->width;
+	int rt_h = p->rt->height;
 
-	for (int y = min_y; y <= max_y; y++) {
-		for (int x = min_x; x <= max_x; x++) {
-			float px = (float)x + 0.5f;
-			float py = (float)y + 0.5f;
+	struct tri_setup s;
+	if (!tri_setup_fixed(p, v, &s)) return;
 
-			float w0 = edge_func(sx[1], sy[1], sx[2], sy[2], px, py);
-			float w1 = edge_func(sx[2], sy[2], sx[0], sy[0], px, py);
-			float w2 = edge_func(sx[0], sy[0], sx[1], sy[1], px, py);
+	int min_x = s.bbox[0] > clip[0] ? s.bbox[0] : clip[0];
+	int min_y = s.bbox[1] > clip[1] ? s.bbox[1] : clip[1];
+	int max_x = s.bbox[2] < clip[2] ? s.bbox[2] : clip[2];
+	int max_y = s.bbox[3] < clip[3] ? s.bbox[3] : clip[3];
+	if (min_x > max_x || min_y > max_y) return;
 
-			/* 삼각형 내부 (winding order에 따라 부호 통일) */
-			int inside;
-			if (area > 0)
-				inside = (w0 >= 0 && w1 >= 0 && w2 >= 0);
-			else
-				inside = (w0 <= 0 && w1 <= 0 && w2 <= 0);
-
-			if (!inside) continue;
-
-			/* barycentric 좌표 정규화 */
-			float b0 = w0 * inv_area;
-			float b1 = w1 * inv_area;
-			float b2 = w2 * inv_area;
-
-			/* 깊이 보간 + 테스트 */
-			if (p->depth_enable && p->depth_buf) {
-				float z = b0 * v[0].pos[2] + b1 * v[1].pos[2]
-					+ b2 * v[2].pos[2];
-				int pi = y * rt_w + x;
-				if (!depth_compare(p->depth_func, z,
-						   p->depth_buf[pi]))
+	/*
+	 * HiZ: 삼각형의 깊이 범위(정점 z의 min/max)로 담당 영역의
+	 * 8x8 타일이 전부 가려지는지 먼저 본다 — 그렇다면 setup도 생략.
+	 * 평면 보간의 반올림 오차를 감안해 범위를 살짝 넓혀 둔다.
+	 */
+	/* 셰이딩 패스는 보이는 픽셀이 이미 정해졌으므로 HiZ 불필요 */
+	int use_hiz = hiz_usable(p) && !(vis && vis->pass == RASTER_SHADE);
+	float tri_zmin = 0.0f, tri_zmax = 0.0f;
+	if (use_hiz) {
+		tri_zmin = tri_zmax = v[0].pos[2];
+		for (int i = 1; i < 3; i++) {
+			if (v[i].pos[2] < tri_zmin) tri_zmin = v[i].pos[2];
+			if (v[i].pos[2] > tri_zmax) tri_zmax = v[i].pos[2];
+		}
+		tri_zmin -= 1e-6f * (1.0f + fabsf(tri_zmin));
+		tri_zmax += 1e-6f * (1.0f + fabsf(tri_zmax));
+		if (!(tri_zmin <= tri_zmax)) {
+			use_hiz = 0;  /* NaN */
+		} else {
+			int hidden = 1;
+			for (int ty = min_y / HIZ_TILE;
+			     hidden && ty <= max_y / HIZ_TILE; ty++)
+				for (int tx = min_x / HIZ_TILE;
+				     tx <= max_x / HIZ_TILE; tx++)
+					if (!hiz_rejects(p, tx, ty, tri_zmin,
+							 tri_zmax)) {
+						hidden = 0;
+						break;
+					}
+			if (hidden)
+				return;
+		}
+	}
+
+	/*
+	 * 속성 평면: 바리센트릭 b_i = w_i / area 가 선형이므로
+	 *   attr(x, y) = Σ attr_i * b_i(x, y)
+	 * 기준 픽셀(블록 원점)에서의 값과 x/y 기울기만 구해 두고
+	 * 이후로는 덧셈으로 진행.
+	 */
+	int depth_only = vis && vis->pass == RASTER_VISIBILITY;
+	int use_ps = !depth_only && p->ps_dxbc && p->ps_dxbc->valid;
+	int use_tex = !depth_only && !use_ps && p->texture && v[0].has_texcoord &&
+		      p->ps_kernel != DXBC_KERNEL_PS_COLOR;
+	int use_alpha = !depth_only && p->blend_src_alpha;
+	/* 0=z, 1..3=색상, 4..5=UV, 6=알파 (블렌드가 쓸 때만) */
+	int num_attrs = depth_only ? 1 : use_alpha ? 7 : use_tex ? 6 : 4;
+	float vals[RASTER_MAX_ATTRS][3];
+	for (int i = 0; i < 3; i++) {
+		vals[0][i] = v[i].pos[2];
+		vals[1][i] = v[i].color[0];
+		vals[2][i] = v[i].color[1];
+		vals[3][i] = v[i].color[2];
+		vals[4][i] = v[i].texcoord[0];
+		vals[5][i] = v[i].texcoord[1];
+		vals[6][i] = v[i].color[3];
+	}
+
+	/*
+	 * 4x2 블록 단위 순회. 블록 원점은 x는 4의 배수, y는 짝수로 맞춰
+	 * 2x2 쿼드가 화면 기준으로 정렬되고 블록이 HiZ 타일을 넘지 않게 한다
+	 * (bbox 밖 레인은 valid에서 제외).
+	 */
+	int bx0 = min_x & ~(RASTER_BLOCK_W - 1);
+	int by0 = min_y & ~1;
+	int64_t px0 = (int64_t)bx0 * 16 + 8;
+	int64_t py0 = (int64_t)by0 * 16 + 8;
+	double inv_area = 1.0 / (double)s.area;
+	double b_org[3], b_dx[3], b_dy[3];
+	for (int i = 0; i < 3; i++) {
+		b_org[i] = (double)(s.ea[i] * px0 + s.eb[i] * py0 + s.ec[i]) * inv_area;
+		b_dx[i] = (double)(s.ea[i] * 16) * inv_area;
+		b_dy[i] = (double)(s.eb[i] * 16) * inv_area;
+	}
+
+	struct raster_tri t;
+	float attr_row[RASTER_MAX_ATTRS], dady_block[RASTER_MAX_ATTRS];
+	float dadx_block[RASTER_MAX_ATTRS];
+	t.num_attrs = num_attrs;
+	for (int a = 0; a < num_attrs; a++) {
+		double org = 0, dx = 0, dy = 0;
+		for (int i = 0; i < 3; i++) {
+			org += vals[a][i] * b_org[i];
+			dx += vals[a][i] * b_dx[i];
+			dy += vals[a][i] * b_dy[i];
+		}
+		attr_row[a] = (float)org;
+		dady_block[a] = (float)(dy * RASTER_BLOCK_H);
+		dadx_block[a] = (float)(dx * RASTER_BLOCK_W);
+		for (int k = 0; k < RASTER_SPAN; k++)
+			t.attr_lane[a][k] = (float)(dx * (k % RASTER_BLOCK_W) +
+						    dy * (k / RASTER_BLOCK_W));
+	}
+
+	/* edge: 픽셀당 x 증분 = a*16, y 증분 = b*16 */
+	int64_t w_row[3], w_block_step[3];
+	for (int i = 0; i < 3; i++) {
+		w_row[i] = s.ea[i] * px0 + s.eb[i] * py0 + s.ec[i] - s.bias[i];
+		w_block_step[i] = s.ea[i] * 16 * RASTER_BLOCK_W;
+		for (int k = 0; k < RASTER_SPAN; k++)
+			t.edge_lane[i][k] = (int32_t)(s.ea[i] * 16 * (k % RASTER_BLOCK_W) +
+						      s.eb[i] * 16 * (k / RASTER_BLOCK_W));
+	}
+
+	raster_span_fn span_fn = raster_span_select();
+	struct raster_span sp;
+	int ids_w = clip[2] - clip[0] + 1;
+
+	/* PS VM (SoA): CB와 상수 입력은 삼각형당 한 번만 설정,
+	 * 블록마다 바뀌는 입력(v0, v1의 rgb)만 루프에서 갱신 */
+	struct shader_vm_soa ps_vm;
+	if (use_ps) {
+		memset(ps_vm.inputs, 0, sizeof(ps_vm.inputs));
+		memset(ps_vm.outputs, 0, sizeof(ps_vm.outputs));
+		for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+			ps_vm.inputs[0][3][k] = 1.0f;
+			ps_vm.inputs[1][3][k] = 1.0f;
+		}
+		for (int ci = 0; ci < 4; ci++) {
+			ps_vm.cb[ci] = p->ps_cb[ci];
+			ps_vm.cb_size[ci] = p->ps_cb_size[ci];
+		}
+	}
+
+	/* 오클루전 쿼리: 깊이 테스트 통과 픽셀 (TBDR은 깊이 패스에서 셈) */
+	int count_occ = p->occ_count && !(vis && vis->pass == RASTER_SHADE);
+	uint64_t occ_samples = 0;
+
+	for (int by = by0; by <= max_y; by += RASTER_BLOCK_H) {
+		int64_t w64[3] = { w_row[0], w_row[1], w_row[2] };
+		float attr[RASTER_MAX_ATTRS];
+		for (int a = 0; a < num_attrs; a++)
+			attr[a] = attr_row[a];
+
+		/* 행별 유효 레인 (블록 행이 bbox 안에 있는지) */
+		unsigned row_valid = 0;
+		for (int r = 0; r < RASTER_BLOCK_H; r++)
+			if (by + r >= min_y && by + r <= max_y)
+				row_valid |= ((1u << RASTER_BLOCK_W) - 1) <<
+					     (r * RASTER_BLOCK_W);
+
+		for (int bx = bx0; bx <= max_x; bx += RASTER_BLOCK_W) {
+			/* 열별 유효 레인: [min_x, max_x] 안의 열만 */
+			int lo = min_x - bx, hi = max_x - bx + 1;
+			if (lo < 0) lo = 0;
+			if (hi > RASTER_BLOCK_W) hi = RASTER_BLOCK_W;
+			unsigned cols = ((1u << hi) - 1) & ~((1u << lo) - 1);
+			unsigned col_valid = cols | cols << RASTER_BLOCK_W;
+
+			int32_t w[3] = {
+				clamp_edge(w64[0]), clamp_edge(w64[1]),
+				clamp_edge(w64[2]),
+			};
+			/* HiZ 타일 단위로 가려진 블록 생략 */
+			int hidden = use_hiz &&
+				hiz_rejects(p, bx / HIZ_TILE, by / HIZ_TILE,
+					    tri_zmin, tri_zmax);
+			if (!hidden)
+				span_fn(&t, w, attr, row_valid & col_valid, &sp);
+			for (int i = 0; i < 3; i++)
+				w64[i] += w_block_step[i];
+			for (int a = 0; a < num_attrs; a++)
+				attr[a] += dadx_block[a];
+			if (hidden || !sp.mask)
+				continue;
+
+			unsigned shade = sp.mask;
+			uint32_t *ids = vis ? vis->ids + (by - clip[1]) * ids_w +
+					      bx - clip[0] : NULL;
+			if (vis && vis->pass == RASTER_SHADE) {
+				for (unsigned m = sp.mask; m; m &= m - 1) {
+					int k = __builtin_ctz(m);
+					if (ids[k / RASTER_BLOCK_W * ids_w +
+						k % RASTER_BLOCK_W] != vis->id)
+						shade &= ~(1u << k);
+				}
+				if (!shade)
+					continue;
+			} else if (p->depth_enable && p->depth_buf) {
+				/* 깊이 테스트 — 통과한 레인만 셰이딩 */
+				float wz_min = INFINITY, wz_max = -INFINITY;
+				for (unsigned m = sp.mask; m; m &= m - 1) {
+					int k = __builtin_ctz(m);
+					int pi = (by + k / RASTER_BLOCK_W) * rt_w +
+						 bx + k % RASTER_BLOCK_W;
+					float z = sp.attr[0][k];
+					if (!depth_compare(p->depth_func, z,
+							   p->depth_buf[pi])) {
+						shade &= ~(1u << k);
+						continue;
+					}
+					if (p->depth_write) {
+						p->depth_buf[pi] = z;
+						if (z < wz_min) wz_min = z;
+						if (z > wz_max) wz_max = z;
+					}
+				}
+				/* 쓴 깊이로 HiZ 범위 갱신 */
+				if (p->hiz && wz_min <= wz_max)
+					hiz_update(&p->hiz[(by / HIZ_TILE) * p->hiz_w +
+							   bx / HIZ_TILE],
+						   wz_min, wz_max);
+				if (!shade)
 					continue;
-				if (p->depth_write)
-					p->depth_buf[pi] = z;
+			}
+			if (count_occ)
+				occ_samples += (unsigned)__builtin_popcount(shade);
+			if (depth_only) {
+				for (unsigned m = shade; m; m &= m - 1) {
+					int k = __builtin_ctz(m);
+					ids[k / RASTER_BLOCK_W * ids_w +
+					    k % RASTER_BLOCK_W] = vis->id;
+				}
+				continue;
 			}
 
-			/* 색상 보간 */
-			float cr = b0 * v[0].color[0] + b1 * v[1].color[0] + b2 * v[2].color[0];
-			float cg = b0 * v[0].color[1] + b1 * v[1].color[1] + b2 * v[2].color[1];
-			float cb_c = b0 * v[0].color[2] + b1 * v[1].color[2] + b2 * v[2].color[2];
-
-			/* PS VM 실행 (있으면 고정 함수 대체) */
-			if (p->ps_dxbc && p->ps_dxbc->valid) {
-				struct shader_vm ps_vm;
-				memset(&ps_vm, 0, sizeof(ps_vm));
-				/* PS 입력: 보간된 VS 출력
-				 * v0 = 색상 (기존 PS 호환)
-				 * v1 = 색상 (VS o1→PS v1 매핑) */
-				ps_vm.inputs[0][0] = cr;
-				ps_vm.inputs[0][1] = cg;
-				ps_vm.inputs[0][2] = cb_c;
-				ps_vm.inputs[0][3] = 1.0f;
-				ps_vm.inputs[1][0] = cr;
-				ps_vm.inputs[1][1] = cg;
-				ps_vm.inputs[1][2] = cb_c;
-				ps_vm.inputs[1][3] = 1.0f;
-				for (int ci = 0; ci < 4; ci++) {
-					ps_vm.cb[ci] = p->ps_cb[ci];
-					ps_vm.cb_size[ci] = p->ps_cb_size[ci];
+			/* PS VM 실행 (있으면 고정 함수 대체)
+			 * PS 입력: 보간된 VS 출력
+			 * v0 = 색상 (기존 PS 호환)
+			 * v1 = 색상 (VS o1→PS v1 매핑) */
+			int ps_ok = 0;
+			if (use_ps) {
+				int nch = use_alpha ? 4 : 3;  /* 아니면 w = 1 */
+				for (int ch = 0; ch < nch; ch++) {
+					const float *a = sp.attr[ch < 3 ? 1 + ch : 6];
+					memcpy(ps_vm.inputs[0][ch], a,
+					       sizeof(ps_vm.inputs[0][ch]));
+					memcpy(ps_vm.inputs[1][ch], a,
+					       sizeof(ps_vm.inputs[1][ch]));
 				}
-				if (shader_vm_execute(&ps_vm, p->ps_dxbc) == 0) {
-					cr = ps_vm.outputs[0][0];
-					cg = ps_vm.outputs[0][1];
-					cb_c = ps_vm.outputs[0][2];
+				ps_ok = shader_vm_execute_soa(&ps_vm, p->ps_dxbc,
+							      shade) == 0;
+			}
+
+			/* 출력 병합: 레인별 소스 색 (채널별 SoA) → 블렌드 */
+			const float *src[4] = {
+				sp.attr[1], sp.attr[2], sp.attr[3],
+				use_alpha ? sp.attr[6] : k_ones,
+			};
+			float tex_src[4][RASTER_SPAN];
+			if (ps_ok) {
+				for (int ch = 0; ch < 4; ch++)
+					src[ch] = ps_vm.outputs[0][ch];
+			} else if (use_tex) {
+				/* PS_TEX 커널은 색 없이 텍스처만 (1 * 텍셀) */
+				if (p->ps_kernel == DXBC_KERNEL_PS_TEX)
+					for (int ch = 0; ch < 4; ch++)
+						src[ch] = k_ones;
+				/* 텍스처 샘플링 (색상과 modulate).
+				 * LOD는 2x2 쿼드(레인 q, q+1, q+4)의 UV 차분으로 —
+				 * 커버되지 않은 레인도 보간값이 있음 */
+				float lod[2];
+				for (int q = 0; q < 2; q++) {
+					int l = q * 2;
+					lod[q] = texture_lod(p->texture,
+						sp.attr[4][l + 1] - sp.attr[4][l],
+						sp.attr[5][l + 1] - sp.attr[5][l],
+						sp.attr[4][l + 4] - sp.attr[4][l],
+						sp.attr[5][l + 4] - sp.attr[5][l]);
 				}
-			} else {
-				/* 텍스처 샘플링 (있으면 색상과 modulate) */
-				if (p->texture && v[0].has_texcoord) {
-					float tu = b0 * v[0].texcoord[0] + b1 * v[1].texcoord[0]
-						 + b2 * v[2].texcoord[0];
-					float tv = b0 * v[0].texcoord[1] + b1 * v[1].texcoord[1]
-						 + b2 * v[2].texcoord[1];
+				for (unsigned m = shade; m; m &= m - 1) {
+					int k = __builtin_ctz(m);
 					float tex_color[4];
 					sample_texture(p->texture, p->sampler,
-						       tu, tv, tex_color);
-					cr *= tex_color[0];
-					cg *= tex_color[1];
-					cb_c *= tex_color[2];
+						       sp.attr[4][k], sp.attr[5][k],
+						       lod[(k % RASTER_BLOCK_W) / 2],
+						       tex_color);
+					for (int ch = 0; ch < 4; ch++)
+						tex_src[ch][k] = src[ch][k] *
+								 tex_color[ch];
 				}
+				for (int ch = 0; ch < 4; ch++)
+					src[ch] = tex_src[ch];
 			}
 
-			float rgba[4] = { cr, cg, cb_c, 1.0f };
-			p->rt->pixels[y * rt_w + x] = float4_to_xrgb(rgba);
+			uint32_t *row0 = p->rt->pixels + (size_t)by * rt_w + bx;
+			uint32_t *row1 = by + 1 < rt_h ? row0 + rt_w : row0;
+			if (p->blend_fn)
+				p->blend_fn(row0, row1, src, shade);
+			else
+				om_blend_generic(p, row0, row1, src, shade);
 		}
-	}
-}
 
-/* InputLayout에서 시맨틱으로 오프셋 찾기 */
-static int find_semantic_offset(const struct d3d_input_layout *layout,
-				const char *semantic, int *out_format)
-{
-	for (int i = 0; i < layout->num_elements; i++) {
-		if (layout->elements[i].SemanticName &&
-		    strcmp(layout->elements[i].SemanticName, semantic) == 0) {
-			if (out_format)
-				*out_format = (int)layout->elements[i].Format;
-			return (int)layout->elements[i].AlignedByteOffset;
-		}
+		for (int i = 0; i < 3; i++)
+			w_row[i] += s.eb[i] * 16 * RASTER_BLOCK_H;
+		for (int a = 0; a < num_attrs; a++)
+			attr_row[a] += dady_block[a];
 	}
-	return -1;
-}
-
-/* VB에서 float 읽기 (format에 따라) */
-static void read_float2(const uint8_t *base, int format, float out[2])
-{
-	(void)format;
-	const float *f = (const float *)base;
-	out[0] = f[0]; out[1] = f[1];
-}
 
-static void read_float3(const uint8_t *base, int format, float out[3])
-{
-	(void)format;
-	const float *f = (const float *)base;
-	out[0] = f[0]; out[1] = f[1]; out[2] = f[2];
+	if (occ_samples)
+		for (int i = 0; i < p->occ_count; i++)
+			__atomic_fetch_add(p->occ[i], occ_samples, __ATOMIC_RELAXED);
 }
 
-static void read_float4(const uint8_t *base, int format, float out[4])
+/* 래스터 파라미터: OM (렌더 타깃, 깊이 버퍼, DepthStencil state) */
+static void raster_params_update_om(const struct d3d11_context *c,
+				    struct raster_params *p)
 {
-	if (format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
-		const float *f = (const float *)base;
-		out[0] = f[0]; out[1] = f[1]; out[2] = f[2]; out[3] = f[3];
-	} else if (format == DXGI_FORMAT_R32G32B32_FLOAT) {
-		const float *f = (const float *)base;
-		out[0] = f[0]; out[1] = f[1]; out[2] = f[2]; out[3] = 1.0f;
-	} else {
-		out[0] = out[1] = out[2] = 1.0f; out[3] = 1.0f;
+	p->rt = NULL;
+	if (c->rtv_idx >= 0) {
+		int ridx = view_at(c->rtv_idx)->resource_idx;
+		if (ridx >= 0)
+			p->rt = resource_at(ridx);
 	}
-}
-
-/* 컨텍스트에서 래스터 파라미터 구성 */
-static void build_raster_params(struct d3d11_context *c,
-				struct d3d_resource *rt,
-				struct raster_params *p)
-{
-	p->rt = rt;
-	p->vp = &c->viewport;
+	struct d3d_resource *rt = p->rt;
 
 	/* 깊이 테스트 설정 */
 	p->depth_buf = NULL;
+	p->ds = NULL;
+	p->hiz = NULL;
+	p->hiz_w = 0;
 	p->depth_enable = 0;
 	p->depth_write = 0;
 	p->depth_func = D3D11_COMPARISON_LESS;
 
 	if (c->dsv_idx >= 0) {
-		int ds_ridx = view_table[c->dsv_idx].resource_idx;
+		int ds_ridx = view_at(c->dsv_idx)->resource_idx;
 		if (ds_ridx >= 0) {
-			struct d3d_resource *ds = &resource_table[ds_ridx];
-			if (ds->depth)
+			struct d3d_resource *ds = resource_at(ds_ridx);
+			if (ds->depth) {
 				p->depth_buf = ds->depth;
+				p->ds = ds;
+				/* 렌더 타깃과 크기가 같을 때만 (래스터라이저가
+				 * 깊이 버퍼를 RT 폭으로 인덱싱하므로) */
+				if (ds->hiz && rt && ds->width == rt->width &&
+				    ds->height == rt->height) {
+					p->hiz = ds->hiz;
+					p->hiz_w = ds->hiz_w;
+				}
+			}
 		}
 	}
 
 	if (c->ds_state_idx >= 0) {
-		struct d3d_state *s = &state_table[c->ds_state_idx];
+		struct d3d_state *s = state_at(c->ds_state_idx);
 		if (s->type == D3D_STATE_DEPTH_STENCIL) {
 			p->depth_enable = s->ds.DepthEnable;
 			p->depth_write = (s->ds.DepthWriteMask ==
@@ -1511,105 +3535,797 @@ static void build_raster_params(struct d3d11_context *c,
 		}
 	}
 
-	/* 컬링 설정 */
-	p->cull_mode = D3D11_CULL_NONE; /* 기본: 컬링 없음 */
+	/* 블렌드 (RT0): 자주 쓰는 조합은 전용 커널, 나머지는 일반 경로 */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	memcpy(p->blend_factor, c->blend_factor, sizeof(p->blend_factor));
+	if (c->blend_state_idx >= 0) {
+		struct d3d_state *s = state_at(c->blend_state_idx);
+		if (s->type == D3D_STATE_BLEND)
+			p->blend = s->blend.RenderTarget[0];
+	}
+
+	const D3D11_RENDER_TARGET_BLEND_DESC *b = &p->blend;
+	int mode = -1;
+	if ((b->RenderTargetWriteMask & 7) == 7) {  /* XRGB: 알파 쓰기 무관 */
+		if (!b->BlendEnable)
+			mode = RASTER_BLEND_OPAQUE;
+		else if (b->BlendOp != D3D11_BLEND_OP_ADD)
+			mode = -1;
+		else if (b->SrcBlend == D3D11_BLEND_ONE &&
+			 b->DestBlend == D3D11_BLEND_ZERO)
+			mode = RASTER_BLEND_OPAQUE;
+		else if (b->SrcBlend == D3D11_BLEND_SRC_ALPHA &&
+			 b->DestBlend == D3D11_BLEND_INV_SRC_ALPHA)
+			mode = RASTER_BLEND_ALPHA;
+		else if (b->SrcBlend == D3D11_BLEND_ONE &&
+			 b->DestBlend == D3D11_BLEND_ONE)
+			mode = RASTER_BLEND_ADD;
+		else if (b->SrcBlend == D3D11_BLEND_ONE &&
+			 b->DestBlend == D3D11_BLEND_INV_SRC_ALPHA)
+			mode = RASTER_BLEND_PREMUL;
+	}
+	p->blend_fn = mode >= 0 ? raster_blend_select(mode) : NULL;
+	p->blend_opaque = mode == RASTER_BLEND_OPAQUE;
+	p->blend_src_alpha = mode == RASTER_BLEND_ALPHA ||
+			     mode == RASTER_BLEND_PREMUL ||
+			     (mode < 0 && b->BlendEnable);
+}
+
+/* 래스터 파라미터: RS (뷰포트, 시저, 컬링) */
+static void raster_params_update_rs(const struct d3d11_context *c,
+				    struct raster_params *p)
+{
+	p->vp = c->viewport;
+	D3D11_RECT sc_rect = c->scissor;
+
+	/* 동적 해상도: 뷰포트는 배율만큼, 시저는 바깥쪽으로 반올림 */
+	p->vp_scale = dynres_scale(p->rt);
+	if (p->vp_scale != DYNRES_STEPS) {
+		float sf = (float)p->vp_scale / DYNRES_STEPS;
+		p->vp.TopLeftX *= sf;
+		p->vp.TopLeftY *= sf;
+		p->vp.Width *= sf;
+		p->vp.Height *= sf;
+		sc_rect.left = (LONG)floorf((float)sc_rect.left * sf);
+		sc_rect.top = (LONG)floorf((float)sc_rect.top * sf);
+		sc_rect.right = (LONG)ceilf((float)sc_rect.right * sf);
+		sc_rect.bottom = (LONG)ceilf((float)sc_rect.bottom * sf);
+	}
+
+	/* 컬링 설정 (기본: 컬링 없음, 깊이 클리핑 켬) */
+	p->cull_mode = D3D11_CULL_NONE;
+	p->depth_clip = 1;
+	int scissor = 0;
 	if (c->rs_state_idx >= 0) {
-		struct d3d_state *s = &state_table[c->rs_state_idx];
-		if (s->type == D3D_STATE_RASTERIZER)
+		struct d3d_state *s = state_at(c->rs_state_idx);
+		if (s->type == D3D_STATE_RASTERIZER) {
 			p->cull_mode = s->rs.CullMode;
+			p->depth_clip = s->rs.DepthClipEnable;
+			scissor = s->rs.ScissorEnable;
+		}
+	}
+
+	/*
+	 * 픽셀 중심 (x + 0.5)이 [TopLeftX, TopLeftX + Width) 안인 픽셀.
+	 * 시저는 정수 사각형 [left, right). 둘 다 RT 크기와 무관한 범위라
+	 * RT 클램프는 tri_setup_fixed에서.
+	 */
+	double vx0 = ceil(p->vp.TopLeftX - 0.5);
+	double vy0 = ceil(p->vp.TopLeftY - 0.5);
+	double vx1 = ceil(p->vp.TopLeftX + p->vp.Width - 0.5) - 1;
+	double vy1 = ceil(p->vp.TopLeftY + p->vp.Height - 0.5) - 1;
+	p->clip_rect[0] = vx0 > 0 ? (vx0 < INT_MAX ? (int)vx0 : INT_MAX) : 0;
+	p->clip_rect[1] = vy0 > 0 ? (vy0 < INT_MAX ? (int)vy0 : INT_MAX) : 0;
+	p->clip_rect[2] = vx1 > -1 ? (vx1 < INT_MAX ? (int)vx1 : INT_MAX) : -1;
+	p->clip_rect[3] = vy1 > -1 ? (vy1 < INT_MAX ? (int)vy1 : INT_MAX) : -1;
+	if (scissor) {
+		const D3D11_RECT *r = &sc_rect;
+		if (c->num_scissors == 0) {
+			/* 시저 켬 + 사각형 없음 = 아무것도 안 그림 */
+			p->clip_rect[2] = p->clip_rect[3] = -1;
+		} else {
+			if (r->left > p->clip_rect[0]) p->clip_rect[0] = r->left;
+			if (r->top > p->clip_rect[1]) p->clip_rect[1] = r->top;
+			if (r->right - 1 < p->clip_rect[2]) p->clip_rect[2] = r->right - 1;
+			if (r->bottom - 1 < p->clip_rect[3]) p->clip_rect[3] = r->bottom - 1;
+		}
 	}
+}
 
+/* 래스터 파라미터: PS (텍스처, 샘플러, 셰이더, CB) */
+static void raster_params_update_ps(struct d3d11_context *c,
+				    struct raster_params *p)
+{
 	/* 텍스처 설정 */
 	p->texture = NULL;
 	p->sampler = NULL;
+	c->pipe_srv = NULL;
 	if (c->ps_srv_idx[0] >= 0) {
-		int srv_ridx = view_table[c->ps_srv_idx[0]].resource_idx;
-		if (srv_ridx >= 0)
-			p->texture = &resource_table[srv_ridx];
+		int srv_ridx = view_at(c->ps_srv_idx[0])->resource_idx;
+		if (srv_ridx >= 0) {
+			c->pipe_srv = resource_at(srv_ridx);
+			p->texture = c->pipe_srv;
+		}
 	}
 	if (c->ps_sampler_idx[0] >= 0)
-		p->sampler = &sampler_table[c->ps_sampler_idx[0]].desc;
+		p->sampler = &sampler_at(c->ps_sampler_idx[0])->desc;
 
 	/* PS 셰이더 VM 설정 */
 	p->ps_dxbc = NULL;
+	p->ps_kernel = DXBC_KERNEL_NONE;
 	memset(p->ps_cb, 0, sizeof(p->ps_cb));
 	memset(p->ps_cb_size, 0, sizeof(p->ps_cb_size));
-	if (c->ps_idx >= 0 && shader_table[c->ps_idx].dxbc.valid)
-		p->ps_dxbc = &shader_table[c->ps_idx].dxbc;
+	memset(p->ps_cb_res, 0, sizeof(p->ps_cb_res));
+	if (c->ps_idx >= 0 && shader_at(c->ps_idx)->dxbc.valid) {
+		/* 커널은 고정 함수 경로 그대로: 색 출력, 또는 t0/s0 샘플
+		 * (* 색). 텍스처 관용구는 t0이 바인딩됐을 때만 */
+		enum dxbc_kernel_kind k = shader_at(c->ps_idx)->kernel.kind;
+		if (k == DXBC_KERNEL_PS_COLOR ||
+		    (p->texture && (k == DXBC_KERNEL_PS_TEX ||
+				    k == DXBC_KERNEL_PS_TEX_COLOR)))
+			p->ps_kernel = k;
+		else
+			p->ps_dxbc = &shader_at(c->ps_idx)->dxbc;
+	}
 	/* PS CB 바인딩 */
 	for (int i = 0; i < 4 && i < 8; i++) {
 		if (c->ps_cb_idx[i] >= 0) {
 			struct d3d_resource *r =
-				&resource_table[c->ps_cb_idx[i]];
+				resource_at(c->ps_cb_idx[i]);
 			if (r->data) {
 				p->ps_cb[i] = (const float *)r->data;
 				p->ps_cb_size[i] = (int)r->size;
+				p->ps_cb_res[i] = r;
 			}
 		}
 	}
 }
 
+static int vs_stage_init(struct d3d11_context *c, struct vs_stage *vs);
+static void vs_stage_load_xform(struct vs_stage *vs);
+
+/*
+ * Draw 직전: dirty 그룹만 다시 풀어 파이프라인 스냅샷 갱신.
+ * 반환: Draw에 쓸 raster_params, 그릴 수 없으면 (RT/VS 입력 없음) NULL
+ */
+static const struct raster_params *pipeline_update(struct d3d11_context *c)
+{
+	unsigned dirty = c->pipe_dirty;
+	/* 이름 바꾸기로 버퍼 data가 바뀌었으면 VB/CB 포인터를 다시 풂 */
+	if (c->pipe_buf_gen != g_buf_gen) {
+		c->pipe_buf_gen = g_buf_gen;
+		dirty |= PIPE_DIRTY_VS | PIPE_DIRTY_PS;
+	}
+	if (dirty & PIPE_DIRTY_OM)
+		raster_params_update_om(c, &c->pipe);
+	/* 동적 해상도 배율은 Present마다 바뀔 수 있음 */
+	if (c->pipe.vp_scale != dynres_scale(c->pipe.rt))
+		dirty |= PIPE_DIRTY_RS;
+	if (dirty) {
+		if (dirty & PIPE_DIRTY_RS)
+			raster_params_update_rs(c, &c->pipe);
+		if (dirty & PIPE_DIRTY_PS)
+			raster_params_update_ps(c, &c->pipe);
+		if (dirty & PIPE_DIRTY_VS)
+			c->vs_ok = vs_stage_init(c, &c->vs);
+		c->pipe_dirty = 0;
+	}
+
+	/* 샘플링은 타일과 무관하게 읽으므로 clear를 다 채움
+	 * (Clear는 Set* 없이도 일어나므로 Draw마다 확인).
+	 * pixels가 바뀌었으면 (RT로 그렸거나 Map) 밉 체인을 다시 만듦 —
+	 * 쌓인 Draw가 그 RT에 그리거나 이전 밉을 읽을 수 있으므로 먼저 flush */
+	if (c->pipe_srv) {
+		struct d3d_resource *srv = c->pipe_srv;
+		if (srv->mip_gen != srv->pix_gen)
+			bin_flush(0);
+		fast_clear_resolve(srv);
+		if (srv->mip_gen != srv->pix_gen)
+			tex_mips_build(srv);
+	}
+
+	if (!c->pipe.rt || c->vs_ok < 0)
+		return NULL;
+	/* CB는 dirty 없이 제자리 갱신될 수 있으므로 커널 행렬은 Draw마다 */
+	vs_stage_load_xform(&c->vs);
+	for (int i = 0; i < c->occ_query_count; i++)
+		c->pipe.occ[i] = &c->occ_queries[i]->samples;
+	c->pipe.occ_count = c->occ_query_count;
+	return &c->pipe;
+}
+
 /* ============================================================
- * Vulkan GPU Draw 헬퍼 (Class 44)
+ * 타일 비닝 + 멀티스레드 래스터라이징
  * ============================================================
  *
- * 바인딩된 VS/PS의 SPIR-V로 파이프라인 생성(캐시),
- * VB 데이터 업로드, CB(UBO) 업로드 후 GPU Draw 실행.
- * 성공 시 1 반환, 실패 시 0 (SW fallback).
+ * Draw 호출 시점에는 버텍스 처리(VS)만 하고, 변환된 삼각형을
+ * 64x64 타일별 bin에 쌓아 둔다. 실제 래스터라이징은 flush 시점에
+ * 워커 스레드들이 타일 단위로 나눠서 수행.
+ *
+ *   Draw → VS → 삼각형 → bin[타일] 목록에 추가 (제출 순서 유지)
+ *   flush → thread_pool_run(타일 수) → 타일별로 bin 순회
+ *
+ * 타일은 서로 픽셀이 겹치지 않으므로 RT/깊이 버퍼 쓰기에 락이 필요 없고,
+ * bin 안에서 제출 순서가 유지되므로 결과는 직렬 실행과 동일하다.
+ *
+ * Draw별 상태(raster_params)는 스냅샷으로 보관. PS 상수 버퍼는
+ * 복사하지 않고 fence만 찍는다 — 이후 Map(WRITE_DISCARD)/
+ * UpdateSubresource는 버퍼 이름 바꾸기로 새 블록에 쓰므로
+ * 쌓인 Draw는 자기가 본 버전을 계속 읽는다.
+ *
+ * flush 시점: Present, 텍스처 Map/UpdateSubresource, Clear,
+ *             렌더 타깃 변경, ID3D11DeviceContext::Flush
  */
-#ifdef CITC_VULKAN_ENABLED
-static int vk_gpu_draw(struct d3d11_context *c,
-                       const uint8_t *vb_data, UINT vb_size,
-                       UINT vertex_stride,
-                       UINT vertex_count, UINT start_vertex,
-                       const uint8_t *ib_data, UINT ib_size,
-                       UINT index_count, int ib_r16,
-                       int rt_width, int rt_height)
-{
-	(void)start_vertex; /* TODO: VB 오프셋 지원 */
 
-	if (!use_vulkan || !g_vk_rt.active)
-		return 0;
+#define BIN_TILE_SIZE CLEAR_TILE  /* 빠른 clear 타일과 일치해야 함 */
+#define BIN_MAX_TRIS  65536   /* 초과하면 중간 flush (메모리 상한) */
 
-	/* VS/PS의 SPIR-V가 있어야 GPU 경로 */
-	if (c->vs_idx < 0 || c->ps_idx < 0)
-		return 0;
-	struct d3d_shader *vs = &shader_table[c->vs_idx];
-	struct d3d_shader *ps = &shader_table[c->ps_idx];
-	if (!vs->spirv || !ps->spirv)
-		return 0;
+struct bin_tri {
+	struct sw_vertex v[3];
+	int draw;                 /* bin_draw 인덱스 */
+};
 
-	/* depth test 여부 */
-	int depth_test = 0;
-	if (c->dsv_idx >= 0 && c->ds_state_idx >= 0) {
-		struct d3d_state *s = &state_table[c->ds_state_idx];
-		if (s->type == D3D_STATE_DEPTH_STENCIL && s->ds.DepthEnable)
-			depth_test = 1;
+struct bin_draw {
+	struct raster_params rp;
+};
+
+struct tile_bin {
+	uint32_t *tris;           /* bin_tri 인덱스 (제출 순서) */
+	int count, cap;
+};
+
+static struct {
+	struct d3d_resource *rt;  /* 현재 bin이 가리키는 렌더 타깃 */
+	struct d3d_resource *ds;  /* 깊이 버퍼 (NULL = 없음) */
+	int tiles_x, tiles_y;
+
+	struct tile_bin *bins;
+	int bin_cap;
+	int *live;                /* 삼각형이 있는 타일 목록 (작업 단위) */
+	int live_count;
+
+	struct bin_tri *tris;
+	int tri_count, tri_cap;
+
+	struct bin_draw *draws;
+	int draw_count, draw_cap;
+} g_bin;
+
+/* Draw가 읽는 PS CB 블록을 현재 배치에서 사용 중으로 표시 */
+static void bin_draw_fence(const struct raster_params *rp)
+{
+	for (int i = 0; i < 4; i++)
+		if (rp->ps_cb_res[i])
+			rp->ps_cb_res[i]->fence = g_buf_batch;
+}
+
+/*
+ * TBDR 모드 (CITC_D3D11_TBDR=1)
+ * =============================
+ *
+ * 타일 bin 안에서 블렌드 없는 (대상을 덮어쓰는) Draw가 이어지는 구간은
+ *   1. 가시성 패스: 구간의 삼각형을 순서대로 깊이만 래스터라이징하며
+ *      픽셀마다 마지막으로 통과한 삼각형 (구간 안 번호)을 기록
+ *   2. 셰이딩 패스: 기록이 남은 삼각형만 다시 세워 그 픽셀들만 셰이딩
+ * 으로 처리해 PS를 보이는 픽셀당 한 번만 실행한다. 덮어쓰기 출력은
+ * 마지막으로 깊이 테스트를 통과한 조각의 색만 남고 PS에는 부작용
+ * (discard, 깊이 출력, UAV)이 없으므로 결과는 순서대로 그린 것과 같다.
+ * 블렌드 Draw를 만나면 그때까지의 구간을 셰이딩한 뒤 기존 방식으로.
+ */
+static int g_tbdr_enabled = -1;
+
+static int tbdr_enabled(void)
+{
+	int en = __atomic_load_n(&g_tbdr_enabled, __ATOMIC_RELAXED);
+	if (en < 0) {
+		const char *env = getenv("CITC_D3D11_TBDR");
+		en = (env && env[0] == '1') ? 1 : 0;
+		__atomic_store_n(&g_tbdr_enabled, en, __ATOMIC_RELAXED);
 	}
+	return en;
+}
 
-	/* CB(UBO) 여부 */
-	int has_ubo = (c->vs_cb_idx[0] >= 0);
+#define TBDR_NONE UINT32_MAX
 
-	/* 정점 속성 수 결정 */
-	int num_attrs = 1; /* 최소 pos */
-	if (c->input_layout_idx >= 0) {
-		struct d3d_input_layout *layout = &layout_table[c->input_layout_idx];
-		for (int i = 0; i < layout->num_elements; i++) {
-			if (strcmp(layout->elements[i].SemanticName, "COLOR") == 0)
-				num_attrs = num_attrs < 2 ? 2 : num_attrs;
-			else if (strcmp(layout->elements[i].SemanticName, "TEXCOORD") == 0)
-				num_attrs = num_attrs < 3 ? 3 : num_attrs;
+static __thread uint32_t tbdr_ids[BIN_TILE_SIZE * BIN_TILE_SIZE];
+static __thread uint64_t *tbdr_seen;   /* 구간 안 번호별 "보임" 비트 */
+static __thread int tbdr_seen_cap;     /* 비트 수 */
+
+/* 구간 b->tris[start, end)의 가시성 결과를 셰이딩 */
+static void tbdr_shade_run(const struct tile_bin *b, int start, int end,
+			   const int clip[4])
+{
+	int n = end - start;
+	if (n > tbdr_seen_cap) {
+		int cap = (n + 63) & ~63;
+		uint64_t *ns = realloc(tbdr_seen, sizeof(*ns) * (cap / 64));
+		if (!ns) {
+			/* 비트맵 없이: 구간 전체를 셰이딩 패스로 */
+			for (int i = start; i < end; i++) {
+				const struct bin_tri *tri = &g_bin.tris[b->tris[i]];
+				struct raster_vis vis = {
+					RASTER_SHADE, tbdr_ids, (uint32_t)(i - start)
+				};
+				rasterize_triangle(&g_bin.draws[tri->draw].rp,
+						   tri->v, clip, &vis);
+			}
+			return;
 		}
+		tbdr_seen = ns;
+		tbdr_seen_cap = cap;
+	}
+	memset(tbdr_seen, 0, sizeof(*tbdr_seen) * ((n + 63) / 64));
+	for (int k = 0; k < BIN_TILE_SIZE * BIN_TILE_SIZE; k++) {
+		uint32_t id = tbdr_ids[k];
+		if (id != TBDR_NONE)
+			tbdr_seen[id / 64] |= 1ull << (id % 64);
 	}
 
-	/* 파이프라인 캐시 lookup */
-	struct vk_cached_pipeline *cp = vk_cache_find(&g_vk_pcache,
-		vs->spirv, ps->spirv, depth_test);
+	for (int w = 0; w < (n + 63) / 64; w++) {
+		for (uint64_t m = tbdr_seen[w]; m; m &= m - 1) {
+			int id = w * 64 + __builtin_ctzll(m);
+			const struct bin_tri *tri = &g_bin.tris[b->tris[start + id]];
+			struct raster_vis vis = { RASTER_SHADE, tbdr_ids, (uint32_t)id };
+			rasterize_triangle(&g_bin.draws[tri->draw].rp, tri->v,
+					   clip, &vis);
+		}
+	}
+}
 
-	if (!cp) {
-		/* 새 파이프라인 생성 */
-		cp = vk_cache_insert(&g_vk_pcache);
-		if (!cp) return 0; /* 캐시 꽉 참 */
+static void bin_tile_job(void *arg, int job)
+{
+	(void)arg;
+	int t = g_bin.live[job];
+	int tx = t % g_bin.tiles_x;
+	int ty = t / g_bin.tiles_x;
+	int clip[4] = {
+		tx * BIN_TILE_SIZE,
+		ty * BIN_TILE_SIZE,
+		tx * BIN_TILE_SIZE + BIN_TILE_SIZE - 1,
+		ty * BIN_TILE_SIZE + BIN_TILE_SIZE - 1,
+	};
+
+	/* 남은 clear를 이 타일만 채운 뒤 그림 */
+	fast_clear_resolve_tile(g_bin.rt, tx, ty);
+	if (g_bin.ds)
+		fast_clear_resolve_tile(g_bin.ds, tx, ty);
+
+	const struct tile_bin *b = &g_bin.bins[t];
+	if (!tbdr_enabled()) {
+		for (int i = 0; i < b->count; i++) {
+			const struct bin_tri *tri = &g_bin.tris[b->tris[i]];
+			rasterize_triangle(&g_bin.draws[tri->draw].rp, tri->v,
+					   clip, NULL);
+		}
+		return;
+	}
+
+	/* 불투명 Draw가 이어지는 구간은 가시성 → 셰이딩 두 패스로 */
+	int run = -1;
+	for (int i = 0; i < b->count; i++) {
+		const struct bin_tri *tri = &g_bin.tris[b->tris[i]];
+		const struct raster_params *rp = &g_bin.draws[tri->draw].rp;
+		if (rp->blend_opaque) {
+			if (run < 0) {
+				memset(tbdr_ids, 0xFF, sizeof(tbdr_ids));
+				run = i;
+			}
+			struct raster_vis vis = {
+				RASTER_VISIBILITY, tbdr_ids, (uint32_t)(i - run)
+			};
+			rasterize_triangle(rp, tri->v, clip, &vis);
+			continue;
+		}
+		if (run >= 0) {
+			tbdr_shade_run(b, run, i, clip);
+			run = -1;
+		}
+		rasterize_triangle(rp, tri->v, clip, NULL);
+	}
+	if (run >= 0)
+		tbdr_shade_run(b, run, b->count, clip);
+}
+
+/*
+ * 쌓인 bin을 모두 래스터라이징.
+ * keep_last: 진행 중인 Draw의 스냅샷은 남겨둠 (BIN_MAX_TRIS 중간 flush).
+ */
+static void bin_flush(int keep_last)
+{
+	if (g_bin.tri_count > 0)
+		thread_pool_run(bin_tile_job, NULL, g_bin.live_count);
+
+	for (int i = 0; i < g_bin.live_count; i++)
+		g_bin.bins[g_bin.live[i]].count = 0;
+	g_bin.live_count = 0;
+	g_bin.tri_count = 0;
+
+	/* 이제 아무 Draw도 이전 배치의 버퍼 블록을 읽지 않음 */
+	g_buf_batch++;
+	query_resolve_pending();
+
+	int keep = (keep_last && g_bin.draw_count > 0) ? 1 : 0;
+	if (keep) {
+		g_bin.draws[0] = g_bin.draws[g_bin.draw_count - 1];
+		bin_draw_fence(&g_bin.draws[0].rp);
+	}
+	g_bin.draw_count = keep;
+}
+
+static void async_sync(void);
+
+void d3d11_flush(void)
+{
+	/* 비동기 모드: 렌더 스레드가 큐를 다 소비할 때까지 대기 */
+	async_sync();
+	bin_flush(0);
+}
+
+void d3d11_resolve_resource(int resource_idx)
+{
+	if (resource_idx < 0 || resource_idx >= ht_count(&g_resources))
+		return;
+	struct d3d_resource *r = ht_get(&g_resources, resource_idx);
+	if (r && r->active)
+		fast_clear_resolve(r);
+}
+
+/* RT 크기에 맞게 타일 그리드 준비 */
+static int bin_setup_target(struct d3d_resource *rt, struct d3d_resource *ds)
+{
+	/* 타일 그리드가 RT와 다른 깊이 버퍼는 타일 단위로 채울 수 없음 */
+	if (ds && (ds->width != rt->width || ds->height != rt->height))
+		fast_clear_resolve(ds);
+
+	if (g_bin.rt == rt && g_bin.ds == ds)
+		return 0;
+
+	bin_flush(0);
+
+	int tx = (rt->width + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+	int ty = (rt->height + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+	int n = tx * ty;
+	if (n > g_bin.bin_cap) {
+		struct tile_bin *nb = realloc(g_bin.bins, sizeof(*nb) * n);
+		int *nl = realloc(g_bin.live, sizeof(*nl) * n);
+		if (nb) g_bin.bins = nb;
+		if (nl) g_bin.live = nl;
+		if (!nb || !nl) return -1;
+		memset(&g_bin.bins[g_bin.bin_cap], 0,
+		       sizeof(*nb) * (n - g_bin.bin_cap));
+		g_bin.bin_cap = n;
+	}
+
+	g_bin.rt = rt;
+	g_bin.ds = ds;
+	g_bin.tiles_x = tx;
+	g_bin.tiles_y = ty;
+	return 0;
+}
+
+/*
+ * Draw 시작 — 래스터 상태 스냅샷 등록.
+ * 반환: 0 성공, -1 실패 (Draw 생략)
+ */
+static int bin_begin_draw(const struct raster_params *rp)
+{
+	if (!rp->rt || !rp->rt->pixels) return -1;
+	if (bin_setup_target(rp->rt, rp->ds) < 0) return -1;
+
+	if (g_bin.draw_count == g_bin.draw_cap) {
+		int cap = g_bin.draw_cap ? g_bin.draw_cap * 2 : 64;
+		struct bin_draw *nd = realloc(g_bin.draws, sizeof(*nd) * cap);
+		if (!nd) return -1;
+		g_bin.draws = nd;
+		g_bin.draw_cap = cap;
+	}
+
+	struct bin_draw *d = &g_bin.draws[g_bin.draw_count];
+	d->rp = *rp;
+	bin_draw_fence(rp);
+	rp->rt->pix_gen++;  /* 샘플링용 밉 체인이 낡음 */
+
+	g_bin.draw_count++;
+	return 0;
+}
+
+/*
+ * 삼각형 하나를 bbox의 모든 타일에 넣을 자리를 미리 확보.
+ * 일부 타일에만 들어가면 구멍이 나므로, 자리가 없으면 아무 데도 넣지 않는다.
+ * 반환: 0 성공, -1 메모리 부족
+ */
+static int bin_reserve(const struct tri_setup *s)
+{
+	if (g_bin.tri_count == g_bin.tri_cap) {
+		int cap = g_bin.tri_cap ? g_bin.tri_cap * 2 : 1024;
+		struct bin_tri *nt = realloc(g_bin.tris, sizeof(*nt) * cap);
+		if (!nt) return -1;
+		g_bin.tris = nt;
+		g_bin.tri_cap = cap;
+	}
+
+	int tx0 = s->bbox[0] / BIN_TILE_SIZE, tx1 = s->bbox[2] / BIN_TILE_SIZE;
+	int ty0 = s->bbox[1] / BIN_TILE_SIZE, ty1 = s->bbox[3] / BIN_TILE_SIZE;
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			struct tile_bin *b = &g_bin.bins[ty * g_bin.tiles_x + tx];
+			if (b->count < b->cap)
+				continue;
+			int cap = b->cap ? b->cap * 2 : 64;
+			uint32_t *nt = realloc(b->tris, sizeof(*nt) * cap);
+			if (!nt) return -1;
+			b->tris = nt;
+			b->cap = cap;
+		}
+	}
+	return 0;
+}
+
+/* 정점 선형 보간 (클리핑용) */
+static void sw_vertex_lerp(const struct sw_vertex *a, const struct sw_vertex *b,
+			   float t, struct sw_vertex *out)
+{
+	for (int i = 0; i < 4; i++) {
+		out->pos[i] = a->pos[i] + (b->pos[i] - a->pos[i]) * t;
+		out->color[i] = a->color[i] + (b->color[i] - a->color[i]) * t;
+	}
+	for (int i = 0; i < 2; i++)
+		out->texcoord[i] = a->texcoord[i] +
+				   (b->texcoord[i] - a->texcoord[i]) * t;
+	out->has_texcoord = a->has_texcoord;
+}
+
+/* 스크린 공간 삼각형 하나를 겹치는 타일들의 bin에 추가 */
+static void bin_screen_triangle(const struct raster_params *p,
+				const struct sw_vertex v[3])
+{
+	struct tri_setup s;
+	if (!tri_setup_fixed(p, v, &s))
+		return;
+
+	if (g_bin.tri_count >= BIN_MAX_TRIS)
+		bin_flush(1);
+
+	/*
+	 * 메모리 부족: 쌓인 삼각형을 먼저 그려 bin을 비우고 다시 시도.
+	 * 비운 bin은 용량을 그대로 가지므로 보통 두 번째에 성공한다.
+	 * 그래도 실패하면 이 삼각형만 통째로 생략.
+	 */
+	if (bin_reserve(&s) < 0) {
+		bin_flush(1);
+		if (bin_reserve(&s) < 0)
+			return;
+	}
+
+	uint32_t ti = (uint32_t)g_bin.tri_count++;
+	memcpy(g_bin.tris[ti].v, v, sizeof(g_bin.tris[ti].v));
+	g_bin.tris[ti].draw = g_bin.draw_count - 1;
+
+	int tx0 = s.bbox[0] / BIN_TILE_SIZE, tx1 = s.bbox[2] / BIN_TILE_SIZE;
+	int ty0 = s.bbox[1] / BIN_TILE_SIZE, ty1 = s.bbox[3] / BIN_TILE_SIZE;
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			int t = ty * g_bin.tiles_x + tx;
+			struct tile_bin *b = &g_bin.bins[t];
+			if (b->count == 0)
+				g_bin.live[g_bin.live_count++] = t;
+			b->tris[b->count++] = ti;
+		}
+	}
+}
+
+/*
+ * 클리핑
+ * ======
+ *
+ * 1. 클립 공간 (원근 나눗셈 전)
+ *    바깥 코드로 한 평면 밖에 세 정점이 모두 있는 삼각형은 버린다.
+ *    w ≈ 0을 지나는 삼각형은 나눗셈 뒤 좌표가 발산해 거대한 bbox를
+ *    만들므로, w >= CLIP_W_MIN과 near(z >= 0)/far(z <= w) 평면으로
+ *    Sutherland–Hodgman 클리핑을 먼저 한다. x/y 평면은 자르지 않고
+ *    bbox를 뷰포트 ∩ 시저로 제한하는 것으로 대신한다 (tri_setup_fixed).
+ *
+ * 2. 스크린 공간 guard band
+ *    28.4 고정소수점 범위를 넘는 정점이 있을 때만 수행.
+ *
+ * 래스터라이저는 속성을 스크린 공간에서 선형(affine) 보간하므로,
+ * 교점 값이 래스터라이저가 그 점에서 쓸 값과 정확히 같은 것은 2단계
+ * (나눗셈 뒤 스크린 공간 t)뿐이다. 1단계는 나눗셈 전 클립 공간 t로
+ * 보간하므로 원근이 있으면 (w가 정점마다 다르면) 약간 다르다.
+ * 결과 다각형 (최대 3 + 3 + 4각형)은 팬(fan)으로 나눠 bin에 추가.
+ */
+#define CLIP_MAX_VERTS 12
+#define CLIP_W_MIN     1e-5f
+
+#define CLIP_OUT_LEFT   0x01
+#define CLIP_OUT_RIGHT  0x02
+#define CLIP_OUT_BOTTOM 0x04
+#define CLIP_OUT_TOP    0x08
+#define CLIP_OUT_NEAR   0x10
+#define CLIP_OUT_FAR    0x20
+#define CLIP_OUT_W      0x40
+
+static unsigned clip_outcode(const float *c, int depth_clip)
+{
+	unsigned o = 0;
+	if (c[0] < -c[3]) o |= CLIP_OUT_LEFT;
+	if (c[0] > c[3])  o |= CLIP_OUT_RIGHT;
+	if (c[1] < -c[3]) o |= CLIP_OUT_BOTTOM;
+	if (c[1] > c[3])  o |= CLIP_OUT_TOP;
+	if (c[3] < CLIP_W_MIN) o |= CLIP_OUT_W;
+	if (depth_clip) {
+		if (c[2] < 0)    o |= CLIP_OUT_NEAR;
+		if (c[2] > c[3]) o |= CLIP_OUT_FAR;
+	}
+	return o;
+}
+
+/* 클립 공간 평면까지의 부호 거리 (>= 0 = 안쪽) */
+static float clip_plane_dist(const float *c, unsigned plane)
+{
+	switch (plane) {
+	case CLIP_OUT_NEAR: return c[2];
+	case CLIP_OUT_FAR:  return c[3] - c[2];
+	default:            return c[3] - CLIP_W_MIN;
+	}
+}
+
+static int clip_poly_plane(const struct sw_vertex *in, int n,
+			   struct sw_vertex *out, unsigned plane)
+{
+	int m = 0;
+	for (int i = 0; i < n; i++) {
+		const struct sw_vertex *a = &in[i];
+		const struct sw_vertex *b = &in[(i + 1) % n];
+		float da = clip_plane_dist(a->pos, plane);
+		float db = clip_plane_dist(b->pos, plane);
+		if (da >= 0)
+			out[m++] = *a;
+		if ((da >= 0) != (db >= 0))
+			sw_vertex_lerp(a, b, da / (da - db), &out[m++]);
+	}
+	return m;
+}
+
+static int clip_poly_edge(const struct sw_vertex *in, int n,
+			  struct sw_vertex *out, int axis, float sign)
+{
+	int m = 0;
+	for (int i = 0; i < n; i++) {
+		const struct sw_vertex *a = &in[i];
+		const struct sw_vertex *b = &in[(i + 1) % n];
+		/* 내부: sign * coord <= guard band */
+		float da = RASTER_GUARD_BAND - sign * a->pos[axis];
+		float db = RASTER_GUARD_BAND - sign * b->pos[axis];
+		if (da >= 0)
+			out[m++] = *a;
+		if ((da >= 0) != (db >= 0))
+			sw_vertex_lerp(a, b, da / (da - db), &out[m++]);
+	}
+	return m;
+}
+
+/* 변환된 (클립 공간) 삼각형을 겹치는 타일들의 bin에 추가 (현재 Draw 소속) */
+static void bin_triangle(const struct sw_vertex v[3])
+{
+	if (g_bin.draw_count == 0) return;
+
+	const struct raster_params *p = &g_bin.draws[g_bin.draw_count - 1].rp;
+
+	unsigned oc[3];
+	for (int i = 0; i < 3; i++)
+		oc[i] = clip_outcode(v[i].pos, p->depth_clip);
+	if (oc[0] & oc[1] & oc[2])
+		return;  /* 한 평면 밖에 전부 */
+
+	struct sw_vertex poly_a[CLIP_MAX_VERTS], poly_b[CLIP_MAX_VERTS];
+	int n = 3;
+	memcpy(poly_a, v, sizeof(*v) * 3);
+
+	unsigned cross = (oc[0] | oc[1] | oc[2]) &
+			 (CLIP_OUT_W | CLIP_OUT_NEAR | CLIP_OUT_FAR);
+	static const unsigned planes[3] = {
+		CLIP_OUT_W, CLIP_OUT_NEAR, CLIP_OUT_FAR
+	};
+	for (int k = 0; k < 3 && n >= 3; k++) {
+		if (!(cross & planes[k])) continue;
+		n = clip_poly_plane(poly_a, n, poly_b, planes[k]);
+		memcpy(poly_a, poly_b, sizeof(*poly_a) * n);
+	}
+	if (n < 3) return;
+
+	/* 원근 나눗셈 + viewport 변환: NDC(-1~1) → 스크린 좌표 */
+	int inside = 1;
+	for (int i = 0; i < n; i++) {
+		float *pos = poly_a[i].pos;
+		float w = pos[3];
+		if (!(w >= CLIP_W_MIN)) w = CLIP_W_MIN;  /* 깊이 클리핑 끔 + 교점 오차 */
+		float rw = 1.0f / w;
+		pos[0] = p->vp.TopLeftX + (pos[0] * rw + 1.0f) * 0.5f * p->vp.Width;
+		pos[1] = p->vp.TopLeftY + (1.0f - pos[1] * rw) * 0.5f * p->vp.Height;
+		pos[2] *= rw;
+		if (!isfinite(pos[0]) || !isfinite(pos[1]))
+			return;
+		if (fabsf(pos[0]) > RASTER_GUARD_BAND ||
+		    fabsf(pos[1]) > RASTER_GUARD_BAND)
+			inside = 0;
+	}
+
+	if (!inside) {
+		n = clip_poly_edge(poly_a, n, poly_b, 0, 1.0f);
+		n = clip_poly_edge(poly_b, n, poly_a, 0, -1.0f);
+		n = clip_poly_edge(poly_a, n, poly_b, 1, 1.0f);
+		n = clip_poly_edge(poly_b, n, poly_a, 1, -1.0f);
+	}
+
+	for (int i = 1; i + 1 < n; i++) {
+		struct sw_vertex tri[3] = { poly_a[0], poly_a[i], poly_a[i + 1] };
+		bin_screen_triangle(p, tri);
+		/* 중간 flush로 스냅샷이 0번으로 옮겨졌을 수 있음 */
+		p = &g_bin.draws[g_bin.draw_count - 1].rp;
+	}
+}
+
+/* ============================================================
+ * Vulkan GPU Draw 헬퍼 (Class 44)
+ * ============================================================
+ *
+ * 바인딩된 VS/PS의 SPIR-V로 파이프라인 생성(캐시),
+ * VB 데이터 업로드, CB(UBO) 업로드 후 GPU Draw 실행.
+ * 성공 시 1 반환, 실패 시 0 (SW fallback).
+ */
+#ifdef CITC_VULKAN_ENABLED
+static int vk_gpu_draw(struct d3d11_context *c,
+                       const uint8_t *vb_data, UINT vb_size,
+                       UINT vertex_stride,
+                       UINT vertex_count, UINT start_vertex,
+                       const uint8_t *ib_data, UINT ib_size,
+                       UINT index_count, int ib_r16,
+                       int rt_width, int rt_height)
+{
+	(void)start_vertex; /* TODO: VB 오프셋 지원 */
+
+	if (!use_vulkan || !g_vk_rt.active)
+		return 0;
+
+	/* VS/PS의 SPIR-V가 있어야 GPU 경로 */
+	if (c->vs_idx < 0 || c->ps_idx < 0)
+		return 0;
+	struct d3d_shader *vs = shader_at(c->vs_idx);
+	struct d3d_shader *ps = shader_at(c->ps_idx);
+	if (!vs->spirv || !ps->spirv)
+		return 0;
+
+	/* depth test 여부 */
+	int depth_test = 0;
+	if (c->dsv_idx >= 0 && c->ds_state_idx >= 0) {
+		struct d3d_state *s = state_at(c->ds_state_idx);
+		if (s->type == D3D_STATE_DEPTH_STENCIL && s->ds.DepthEnable)
+			depth_test = 1;
+	}
+
+	/* CB(UBO) 여부 */
+	int has_ubo = (c->vs_cb_idx[0] >= 0);
+
+	/* 정점 속성 수 결정 */
+	int num_attrs = 1; /* 최소 pos */
+	if (c->input_layout_idx >= 0) {
+		const struct fetch_plan *fp = &layout_at(c->input_layout_idx)->plan;
+		if (fp->offset[FETCH_TC] >= 0)
+			num_attrs = 3;
+		else if (fp->offset[FETCH_COL] >= 0)
+			num_attrs = 2;
+	}
+
+	/* 파이프라인 캐시 lookup */
+	struct vk_cached_pipeline *cp = vk_cache_find(&g_vk_pcache,
+		vs->spirv, ps->spirv, depth_test);
+
+	if (!cp) {
+		/* 새 파이프라인 생성 */
+		cp = vk_cache_insert(&g_vk_pcache);
+		if (!cp) return 0; /* 캐시 꽉 참 */
 
 		if (vk_create_user_pipeline(&g_vk, &g_vk_rt,
 				vs->spirv, vs->spirv_size,
@@ -1655,7 +4371,7 @@ static int vk_gpu_draw(struct d3d11_context *c,
 	/* UBO 업로드 */
 	VkDescriptorSet ds = VK_NULL_HANDLE;
 	if (has_ubo && cp->ds_layout) {
-		struct d3d_resource *cb_res = &resource_table[c->vs_cb_idx[0]];
+		struct d3d_resource *cb_res = resource_at(c->vs_cb_idx[0]);
 		if (cb_res->data && cb_res->size > 0) {
 			VkDeviceSize needed_ubo = (VkDeviceSize)cb_res->size;
 			if (!g_vk_ubo.buffer || g_vk_ubo.size < needed_ubo) {
@@ -1696,377 +4412,711 @@ static int vk_gpu_draw(struct d3d11_context *c,
 #endif /* CITC_VULKAN_ENABLED */
 
 /*
- * Draw — 소프트웨어 렌더링 파이프라인 실행
+ * 버텍스 처리 (IA fetch + VS)
  *
- * 현재 바인딩된 VB, InputLayout, RTV를 사용하여
- * 삼각형 단위로 래스터라이징.
+ * Draw마다 한 번 vs_stage_init()으로 VB/셰이더/CB를 풀어 두고,
+ * 정점은 레이아웃의 fetch 계획으로 읽은 뒤 vs_stage_shade()로 변환.
+ * Draw는 VS_FETCH_BATCH개씩 묶어 fetch하고, DrawIndexed는 캐시 miss마다
+ * vs_stage_run()으로 한 개씩 처리한다.
  */
-static void __attribute__((ms_abi))
-ctx_Draw(void *This, UINT VertexCount, UINT StartVertexLocation)
+#define VS_FETCH_BATCH 64
+
+/* 반환: 0 성공, -1 Draw 불가 (VB/레이아웃 없음) */
+static int vs_stage_init(struct d3d11_context *c, struct vs_stage *vs)
 {
-	struct d3d11_context *c = This;
+	memset(vs, 0, sizeof(*vs));
+
+	/* InputLayout (fetch 계획은 생성 시 계산됨) */
+	if (c->input_layout_idx < 0) return -1;
+	vs->plan = &layout_at(c->input_layout_idx)->plan;
+	if (vs->plan->offset[FETCH_POS] < 0) return -1;
+	vs->has_texcoord = vs->plan->offset[FETCH_TC] >= 0;
+	vs->inst_low = (vs->plan->inst_regs & ((1u << FETCH_REGS) - 1)) != 0;
+
+	/* VB 데이터 (오프셋 적용) */
+	for (int s = 0; s < MAX_VB_SLOTS; s++) {
+		if (c->vb_resource_idx[s] < 0) continue;
+		struct d3d_resource *vb = resource_at(c->vb_resource_idx[s]);
+		if (!vb->data || c->vb_offset[s] >= vb->size) continue;
+		vs->slot_data[s] = (const uint8_t *)vb->data + c->vb_offset[s];
+		vs->slot_size[s] = vb->size - c->vb_offset[s];
+		vs->slot_stride[s] = c->vb_stride[s];
+	}
+	vs->vb_data = vs->slot_data[vs->plan->slot];
+	vs->stride = vs->slot_stride[vs->plan->slot];
+	if (!vs->vb_data || vs->stride == 0) return -1;
 
-	/* RTV → 렌더 타깃 리소스 */
-	if (c->rtv_idx < 0) return;
-	int ridx = view_table[c->rtv_idx].resource_idx;
-	if (ridx < 0) return;
-	struct d3d_resource *rt = &resource_table[ridx];
+	/* VS DXBC VM 사용 여부 확인 */
+	if (c->vs_idx >= 0 && shader_at(c->vs_idx)->dxbc.valid)
+		vs->vs_dxbc = &shader_at(c->vs_idx)->dxbc;
+
+	/* VS CB 바인딩 */
+	for (int ci = 0; ci < 4; ci++) {
+		if (c->vs_cb_idx[ci] >= 0) {
+			struct d3d_resource *cb = resource_at(c->vs_cb_idx[ci]);
+			if (cb->data) {
+				vs->cb[ci] = (const float *)cb->data;
+				vs->cb_size[ci] = (int)cb->size;
+			}
+		}
+	}
+	if (vs->cb[0] && vs->cb_size[0] >= 64)
+		vs->mvp = vs->cb[0];
+
+	/* VS VM: CB는 여기서 한 번만 설정 */
+	if (vs->vs_dxbc) {
+		struct shader_vm *vm = &vs->vm;
+		for (int ci = 0; ci < 4; ci++) {
+			vm->cb[ci] = vs->cb[ci];
+			vm->cb_size[ci] = vs->cb_size[ci];
+		}
+	}
 
-	/* 래스터 파라미터 구성 */
-	struct raster_params rp;
-	build_raster_params(c, rt, &rp);
+	/* 네이티브 커널: 커널은 v0..v2만 읽으므로 인스턴스 입력이 거기
+	 * 겹치면 VM. 변환 커널은 cb0에 행렬 전체가 있어야 함 */
+	if (vs->vs_dxbc && !vs->inst_low) {
+		const struct dxbc_kernel *k = &shader_at(c->vs_idx)->kernel;
+		if (k->kind == DXBC_KERNEL_VS_PASS ||
+		    (k->kind == DXBC_KERNEL_VS_XFORM && vs->mvp))
+			vs->kernel = k;
+	}
+	return 0;
+}
 
-	/* VB 데이터 */
-	if (c->vb_resource_idx < 0) return;
-	struct d3d_resource *vb = &resource_table[c->vb_resource_idx];
-	if (!vb->data) return;
+/*
+ * VS_XFORM 커널: o0 = v0.x*col0 + v0.y*col1 + v0.z*col2 + v0.w*col3.
+ * dp4 형태는 cb0를 전치해 열로, mul/mad 형태는 cb0 행이 그대로 열.
+ * 어느 쪽이든 성분별 덧셈 순서가 VM의 dp4/mad 사슬과 같아
+ * 결과가 비트 단위로 같다.
+ */
+typedef float vs_v4 __attribute__((vector_size(16)));
+
+static void vs_stage_load_xform(struct vs_stage *vs)
+{
+	if (!vs->kernel || vs->kernel->kind != DXBC_KERNEL_VS_XFORM)
+		return;
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			vs->xform[r][c] = vs->kernel->transposed ?
+				vs->mvp[c * 4 + r] : vs->mvp[r * 4 + c];
+}
+
+static void vs_kernel_xform(const float cols[4][4], const float v[4],
+			    float out[4])
+{
+	vs_v4 c0, c1, c2, c3;
+	memcpy(&c0, cols[0], 16);
+	memcpy(&c1, cols[1], 16);
+	memcpy(&c2, cols[2], 16);
+	memcpy(&c3, cols[3], 16);
+	vs_v4 r = c0 * v[0];
+	r = r + c1 * v[1];
+	r = r + c2 * v[2];
+	r = r + c3 * v[3];
+	memcpy(out, &r, 16);
+}
 
-	/* InputLayout */
-	if (c->input_layout_idx < 0) return;
-	struct d3d_input_layout *layout = &layout_table[c->input_layout_idx];
+/* 인스턴스 입력 중 v0..v2에 겹치는 것을 정점 입력 위에 다시 씀 */
+static void vs_stage_restore_instance(struct vs_stage *vs)
+{
+	for (int r = 0; r < FETCH_REGS; r++)
+		if (vs->plan->inst_regs & (1u << r))
+			memcpy(vs->vm.inputs[r], vs->inst_in[r], 16);
+}
 
-	/* POSITION, COLOR, TEXCOORD 오프셋 찾기 */
-	int pos_fmt = 0, col_fmt = 0, tc_fmt = 0;
-	int pos_off = find_semantic_offset(layout, "POSITION", &pos_fmt);
-	int col_off = find_semantic_offset(layout, "COLOR", &col_fmt);
-	int tc_off = find_semantic_offset(layout, "TEXCOORD", &tc_fmt);
+/*
+ * 인스턴스 시작: 인스턴스 단위 요소와 SV_InstanceID를 VS 입력에 넣음.
+ * instance는 SV_InstanceID (0부터), 데이터는 start_instance부터 읽는다.
+ */
+static void vs_stage_set_instance(struct vs_stage *vs, UINT instance,
+				  UINT start_instance)
+{
+	const struct fetch_plan *p = vs->plan;
+	if (!p->inst_regs || !vs->vs_dxbc)
+		return;
 
-	if (pos_off < 0)
-		pos_off = find_semantic_offset(layout, "SV_Position", &pos_fmt);
-	if (pos_off < 0) return;
+	for (int i = 0; i < p->inst_count; i++) {
+		const struct fetch_inst *fi = &p->inst[i];
+		float *d = vs->inst_in[fi->reg];
+		UINT elem = start_instance + (fi->step ? instance / fi->step : 0);
+		size_t off = (size_t)elem * vs->slot_stride[fi->slot] + fi->offset;
+		/* 범위 밖은 0 (D3D11 규칙) */
+		if (vs->slot_data[fi->slot] &&
+		    off + dxgi_format_size(fi->format) <= vs->slot_size[fi->slot])
+			fetch_format(fi->format, vs->slot_data[fi->slot] + off, d);
+		else
+			memset(d, 0, 16);
+	}
+	if (p->instance_id_reg >= 0) {
+		/* 정수 입력은 비트 그대로 (셰이더가 utof로 변환) */
+		float *d = vs->inst_in[p->instance_id_reg];
+		memcpy(&d[0], &instance, 4);
+		d[1] = d[2] = d[3] = 0.0f;
+	}
 
-	UINT stride = c->vb_stride;
-	if (stride == 0) return;
+	for (int r = 0; r < DXBC_MAX_INPUTS; r++)
+		if (p->inst_regs & (1u << r))
+			memcpy(vs->vm.inputs[r], vs->inst_in[r], 16);
+}
 
-	const uint8_t *vb_data = (const uint8_t *)vb->data;
+/* fetch된 정점 하나 변환 → 클립 공간 sw_vertex */
+static void vs_stage_shade(struct vs_stage *vs, const struct vs_input *in,
+			   struct sw_vertex *out)
+{
+	float clip[4];
 
-#ifdef CITC_VULKAN_ENABLED
-	/* GPU 경로 (SW와 병렬 실행 — Present에서 readback) */
-	vk_gpu_draw(c, (const uint8_t *)vb->data, (UINT)vb->size,
-		    stride, VertexCount, StartVertexLocation,
-		    NULL, 0, 0, 0, rt->width, rt->height);
-#endif
+	if (vs->kernel) {
+		/* === 네이티브 커널 === (쓰지 않는 출력은 VM처럼 0) */
+		unsigned pass = vs->kernel->pass_mask;
+		if (vs->kernel->kind == DXBC_KERNEL_VS_XFORM)
+			vs_kernel_xform(vs->xform, in->v[FETCH_POS], clip);
+		else
+			memcpy(clip, in->v[FETCH_POS], 16);
+		if (pass & (1u << FETCH_COL))
+			memcpy(out->color, in->v[FETCH_COL], 16);
+		else
+			memset(out->color, 0, 16);
+		int tc = vs->has_texcoord && (pass & (1u << FETCH_TC));
+		out->texcoord[0] = tc ? in->v[FETCH_TC][0] : 0.0f;
+		out->texcoord[1] = tc ? in->v[FETCH_TC][1] : 0.0f;
+	} else if (vs->vs_dxbc) {
+		/* === VS VM 경로 === */
+		struct shader_vm *vm = &vs->vm;
+
+		/* 입력 레지스터 설정 (v0=POS, v1=COL, v2=TC) */
+		memcpy(vm->inputs, in->v, sizeof(in->v));
+		if (vs->inst_low)
+			vs_stage_restore_instance(vs);
+
+		/* VM 실행 */
+		shader_vm_execute(vm, vs->vs_dxbc);
+
+		/* o0 = SV_Position, o1 = COLOR, o2 = TEXCOORD */
+		memcpy(clip, vm->outputs[0], 16);
+		memcpy(out->color, vm->outputs[1], 16);
+		out->texcoord[0] = vs->has_texcoord ? vm->outputs[2][0] : 0.0f;
+		out->texcoord[1] = vs->has_texcoord ? vm->outputs[2][1] : 0.0f;
+	} else {
+		/* === 고정 함수 경로 === */
+		/* MVP 변환 */
+		if (vs->mvp)
+			mat4_mul_vec4(vs->mvp, in->v[FETCH_POS], clip);
+		else
+			memcpy(clip, in->v[FETCH_POS], 16);
 
-	/* VS DXBC VM 사용 여부 확인 */
-	int use_vs_vm = 0;
-	struct dxbc_info *vs_dxbc = NULL;
-	if (c->vs_idx >= 0 && shader_table[c->vs_idx].dxbc.valid) {
-		vs_dxbc = &shader_table[c->vs_idx].dxbc;
-		use_vs_vm = 1;
+		memcpy(out->color, in->v[FETCH_COL], 16);
+		out->texcoord[0] = in->v[FETCH_TC][0];
+		out->texcoord[1] = in->v[FETCH_TC][1];
 	}
+	out->has_texcoord = vs->has_texcoord;
 
-	/* 삼각형 리스트 래스터라이징 */
-	if (c->topology == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {
-		for (UINT i = StartVertexLocation; i + 2 < StartVertexLocation + VertexCount; i += 3) {
-			struct sw_vertex tri[3];
+	/* 원근 나눗셈은 클리핑 뒤 (bin_triangle) */
+	memcpy(out->pos, clip, 16);
+}
 
-			for (int j = 0; j < 3; j++) {
-				const uint8_t *v = vb_data + (i + j) * stride;
-
-				if (use_vs_vm) {
-					/* === VS VM 경로 === */
-					struct shader_vm vm;
-					memset(&vm, 0, sizeof(vm));
-
-					/* 입력 레지스터 설정 (v0=POS, v1=COL, v2=TC) */
-					read_float3(v + pos_off, pos_fmt,
-						    vm.inputs[0]);
-					vm.inputs[0][3] = 1.0f;
-
-					if (col_off >= 0)
-						read_float4(v + col_off,
-							    col_fmt,
-							    vm.inputs[1]);
-					else {
-						vm.inputs[1][0] = 1.0f;
-						vm.inputs[1][1] = 1.0f;
-						vm.inputs[1][2] = 1.0f;
-						vm.inputs[1][3] = 1.0f;
-					}
+/* 정점 하나 fetch + 변환 */
+static void vs_stage_run(struct vs_stage *vs, UINT index,
+			 struct sw_vertex *out)
+{
+	struct vs_input in;
+	vs->plan->fetch(vs->plan, vs->vb_data, vs->stride, index, 1, &in);
+	vs_stage_shade(vs, &in, out);
+}
 
-					if (tc_off >= 0) {
-						read_float2(v + tc_off,
-							    tc_fmt,
-							    vm.inputs[2]);
-					}
+/*
+ * Post-transform 버텍스 캐시 (DrawIndexed)
+ * =========================================
+ *
+ * 인덱스 메시는 한 정점을 평균 ~6개 삼각형이 공유하므로
+ * 인덱스마다 VS를 돌리면 같은 정점을 여러 번 변환하게 된다.
+ *
+ *   인덱스 범위가 작으면 (대부분): [min_idx, max_idx] 크기의 direct-mapped 배열
+ *     → Draw당 고유 정점마다 VS 정확히 1회
+ *   범위가 지나치게 크거나 인덱스 수에 비해 넓으면 (희소 인덱스, 큰 공유
+ *   VB의 작은 Draw): 64-entry direct-mapped 캐시 (idx & 63)
+ *
+ * 매 Draw마다 배열을 지우지 않도록 엔트리에 Draw 번호(stamp)를 기록.
+ */
+#define VCACHE_SMALL_SIZE   64
+#define VCACHE_MAX_RANGE    (1 << 20)   /* direct-mapped 최대 정점 수 */
+#define VCACHE_RANGE_PER_INDEX 4        /* direct-mapped 최대 범위 / 인덱스 수 */
+
+struct vcache_entry {
+	uint32_t stamp;
+	UINT index;
+	struct sw_vertex v;
+};
 
-					/* VS CB 바인딩 */
-					for (int ci = 0; ci < 4; ci++) {
-						if (c->vs_cb_idx[ci] >= 0) {
-							struct d3d_resource *cb2 =
-								&resource_table[c->vs_cb_idx[ci]];
-							if (cb2->data) {
-								vm.cb[ci] = (const float *)cb2->data;
-								vm.cb_size[ci] = (int)cb2->size;
-							}
-						}
-					}
+static struct {
+	struct vcache_entry *entries;
+	size_t cap;
+	uint32_t stamp;
+} g_vcache;
 
-					/* VM 실행 */
-					shader_vm_execute(&vm, vs_dxbc);
-
-					/* o0 = SV_Position (perspective divide) */
-					float *clip = vm.outputs[0];
-					if (fabsf(clip[3]) > 1e-6f) {
-						tri[j].pos[0] = clip[0] / clip[3];
-						tri[j].pos[1] = clip[1] / clip[3];
-						tri[j].pos[2] = clip[2] / clip[3];
-						tri[j].pos[3] = clip[3];
-					} else {
-						memcpy(tri[j].pos, clip, 16);
-					}
+/*
+ * 인스턴싱: 인스턴스마다 정점 단위 입력은 같고 인스턴스 입력만 다르다.
+ * 인스턴스가 여럿이면 정점 입력을 한 번만 fetch해 두고 (g_vs_prefetch)
+ * 인스턴스마다 vs_stage_set_instance() 후 VS만 다시 돌린다.
+ */
+#define VS_PREFETCH_MAX (1 << 16)   /* 미리 fetch할 최대 정점 수 */
 
-					/* o1 = COLOR */
-					memcpy(tri[j].color, vm.outputs[1], 16);
-
-					/* TEXCOORD */
-					if (tc_off >= 0) {
-						tri[j].texcoord[0] = vm.outputs[2][0];
-						tri[j].texcoord[1] = vm.outputs[2][1];
-						tri[j].has_texcoord = 1;
-					} else {
-						tri[j].texcoord[0] = 0;
-						tri[j].texcoord[1] = 0;
-						tri[j].has_texcoord = 0;
-					}
-				} else {
-					/* === 고정 함수 경로 === */
-					float raw_pos[4];
-					read_float3(v + pos_off, pos_fmt,
-						    raw_pos);
-					raw_pos[3] = 1.0f;
-
-					/* MVP 변환 */
-					if (c->vs_cb_idx[0] >= 0) {
-						struct d3d_resource *cb =
-							&resource_table[c->vs_cb_idx[0]];
-						if (cb->data && cb->size >= 64) {
-							float transformed[4];
-							mat4_mul_vec4(
-								(const float *)cb->data,
-								raw_pos, transformed);
-							if (fabsf(transformed[3]) > 1e-6f) {
-								tri[j].pos[0] = transformed[0] / transformed[3];
-								tri[j].pos[1] = transformed[1] / transformed[3];
-								tri[j].pos[2] = transformed[2] / transformed[3];
-								tri[j].pos[3] = transformed[3];
-							} else {
-								memcpy(tri[j].pos, transformed, 16);
-							}
-						} else {
-							memcpy(tri[j].pos, raw_pos, 16);
-						}
-					} else {
-						memcpy(tri[j].pos, raw_pos, 16);
-					}
+static struct {
+	struct vs_input *in;
+	size_t cap;
+} g_vs_prefetch;
 
-					if (col_off >= 0)
-						read_float4(v + col_off, col_fmt, tri[j].color);
-					else {
-						tri[j].color[0] = 1.0f;
-						tri[j].color[1] = 1.0f;
-						tri[j].color[2] = 1.0f;
-						tri[j].color[3] = 1.0f;
-					}
+/* 정점 [first, first + count) 입력을 fetch, 실패하면 NULL */
+static const struct vs_input *vs_prefetch(struct vs_stage *vs, UINT first,
+					  UINT count)
+{
+	if (count > g_vs_prefetch.cap) {
+		struct vs_input *ni = realloc(g_vs_prefetch.in,
+					      sizeof(*ni) * count);
+		if (!ni) return NULL;
+		g_vs_prefetch.in = ni;
+		g_vs_prefetch.cap = count;
+	}
+	vs->plan->fetch(vs->plan, vs->vb_data, vs->stride, first, count,
+			g_vs_prefetch.in);
+	return g_vs_prefetch.in;
+}
 
-					if (tc_off >= 0) {
-						read_float2(v + tc_off, tc_fmt, tri[j].texcoord);
-						tri[j].has_texcoord = 1;
-					} else {
-						tri[j].texcoord[0] = tri[j].texcoord[1] = 0.0f;
-						tri[j].has_texcoord = 0;
-					}
-				}
+/* 새 stamp — 이전 Draw/인스턴스의 캐시 엔트리를 모두 무효화 */
+static uint32_t vcache_next_stamp(void)
+{
+	if (++g_vcache.stamp == 0) {
+		/* stamp 한 바퀴 → 전체 무효화 */
+		for (size_t i = 0; i < g_vcache.cap; i++)
+			g_vcache.entries[i].stamp = 0;
+		g_vcache.stamp = 1;
+	}
+	return g_vcache.stamp;
+}
+
+/* Draw / DrawInstanced 공통: 삼각형 리스트 → 타일 bin */
+static void draw_vertices(struct d3d11_context *c,
+			  const struct raster_params *rp, UINT VertexCount,
+			  UINT StartVertexLocation, UINT InstanceCount,
+			  UINT StartInstanceLocation)
+{
+	struct vs_stage *vs = &c->vs;
+
+	if (c->topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ||
+	    bin_begin_draw(rp) < 0)
+		return;
+
+	UINT count = VertexCount / 3 * 3;
+	const struct vs_input *pre = NULL;
+	if (InstanceCount > 1 && count <= VS_PREFETCH_MAX)
+		pre = vs_prefetch(vs, StartVertexLocation, count);
+
+	for (UINT inst = 0; inst < InstanceCount; inst++) {
+		vs_stage_set_instance(vs, inst, StartInstanceLocation);
+
+		if (pre) {
+			for (UINT k = 0; k < count; k += 3) {
+				struct sw_vertex tri[3];
+				for (int j = 0; j < 3; j++)
+					vs_stage_shade(vs, &pre[k + j], &tri[j]);
+				bin_triangle(tri);
 			}
+			continue;
+		}
 
-			rasterize_triangle(&rp, tri);
+		/* 삼각형 단위로 끊기도록 배치 크기는 3의 배수 */
+		struct vs_input in[VS_FETCH_BATCH / 3 * 3];
+		UINT end = StartVertexLocation + count;
+		for (UINT i = StartVertexLocation; i < end; ) {
+			UINT n = end - i;
+			if (n > VS_FETCH_BATCH / 3 * 3)
+				n = VS_FETCH_BATCH / 3 * 3;
+			vs->plan->fetch(vs->plan, vs->vb_data, vs->stride, i, n, in);
+			for (UINT k = 0; k < n; k += 3) {
+				struct sw_vertex tri[3];
+				for (int j = 0; j < 3; j++)
+					vs_stage_shade(vs, &in[k + j], &tri[j]);
+				bin_triangle(tri);
+			}
+			i += n;
 		}
 	}
 }
 
-/* DrawIndexed */
-static void __attribute__((ms_abi))
-ctx_DrawIndexed(void *This, UINT IndexCount,
-		UINT StartIndexLocation, int BaseVertexLocation)
+/* DrawIndexed / DrawIndexedInstanced 공통 */
+static void draw_indexed(struct d3d11_context *c,
+			 const struct raster_params *rp, UINT IndexCount,
+			 UINT StartIndexLocation, int BaseVertexLocation,
+			 UINT InstanceCount, UINT StartInstanceLocation)
 {
-	struct d3d11_context *c = This;
+	struct vs_stage *vs = &c->vs;
 
-	if (c->rtv_idx < 0) return;
-	int ridx = view_table[c->rtv_idx].resource_idx;
-	if (ridx < 0) return;
-	struct d3d_resource *rt = &resource_table[ridx];
+	if (c->ib_resource_idx < 0) return;
+	struct d3d_resource *ib = resource_at(c->ib_resource_idx);
+	if (!ib->data) return;
 
-	struct raster_params rp;
-	build_raster_params(c, rt, &rp);
+	const uint8_t *ib_data = (const uint8_t *)ib->data;
+	int ib_r16 = (c->ib_format == DXGI_FORMAT_R16_UINT);
 
-	if (c->vb_resource_idx < 0 || c->ib_resource_idx < 0) return;
-	struct d3d_resource *vb = &resource_table[c->vb_resource_idx];
-	struct d3d_resource *ib = &resource_table[c->ib_resource_idx];
-	if (!vb->data || !ib->data) return;
+	if (c->topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ||
+	    bin_begin_draw(rp) < 0)
+		return;
 
-	if (c->input_layout_idx < 0) return;
-	struct d3d_input_layout *layout = &layout_table[c->input_layout_idx];
+	UINT tri_end = StartIndexLocation + IndexCount / 3 * 3;
 
-	int pos_fmt = 0, col_fmt = 0, tc_fmt = 0;
-	int pos_off = find_semantic_offset(layout, "POSITION", &pos_fmt);
-	int col_off = find_semantic_offset(layout, "COLOR", &col_fmt);
-	int tc_off = find_semantic_offset(layout, "TEXCOORD", &tc_fmt);
-	if (pos_off < 0)
-		pos_off = find_semantic_offset(layout, "SV_Position", &pos_fmt);
-	if (pos_off < 0) return;
+	/* 인덱스 범위 → 캐시 방식 결정 (인스턴스 전체에서 1회) */
+	UINT min_idx = UINT32_MAX, max_idx = 0;
+	for (UINT i = StartIndexLocation; i < tri_end; i++) {
+		UINT idx = ib_r16 ? ((const uint16_t *)ib_data)[i]
+				  : ((const uint32_t *)ib_data)[i];
+		if (idx < min_idx) min_idx = idx;
+		if (idx > max_idx) max_idx = idx;
+	}
+	if (min_idx > max_idx) return;
+
+	size_t range = (size_t)max_idx - min_idx + 1;
+	int direct = range <= VCACHE_MAX_RANGE &&
+		     range <= (size_t)IndexCount * VCACHE_RANGE_PER_INDEX;
+	size_t need = direct ? range : VCACHE_SMALL_SIZE;
+	if (need > g_vcache.cap) {
+		struct vcache_entry *ne = realloc(g_vcache.entries,
+						  sizeof(*ne) * need);
+		if (!ne) return;
+		memset(ne + g_vcache.cap, 0,
+		       sizeof(*ne) * (need - g_vcache.cap));
+		g_vcache.entries = ne;
+		g_vcache.cap = need;
+	}
 
-	UINT stride = c->vb_stride;
-	if (stride == 0) return;
+	/* 여러 인스턴스면 사용 범위의 정점 입력을 한 번만 fetch */
+	const struct vs_input *pre = NULL;
+	if (InstanceCount > 1 && range <= VS_PREFETCH_MAX)
+		pre = vs_prefetch(vs, (UINT)((int)min_idx + BaseVertexLocation),
+				  (UINT)range);
 
-	const uint8_t *vb_data = (const uint8_t *)vb->data;
-	const uint8_t *ib_data = (const uint8_t *)ib->data;
+	for (UINT inst = 0; inst < InstanceCount; inst++) {
+		vs_stage_set_instance(vs, inst, StartInstanceLocation);
+		/* 인스턴스마다 VS 결과가 다르므로 캐시는 인스턴스 단위 */
+		uint32_t stamp = vcache_next_stamp();
 
-#ifdef CITC_VULKAN_ENABLED
-	/* GPU 경로 */
-	{
-		int ib_r16 = (c->ib_format == DXGI_FORMAT_R16_UINT);
-		vk_gpu_draw(c, (const uint8_t *)vb->data, (UINT)vb->size,
-			    stride, 0, 0,
-			    (const uint8_t *)ib->data, (UINT)ib->size,
-			    IndexCount, ib_r16,
-			    rt->width, rt->height);
-	}
-#endif
-
-	/* VS DXBC VM 사용 여부 확인 */
-	int use_vs_vm = 0;
-	struct dxbc_info *vs_dxbc = NULL;
-	if (c->vs_idx >= 0 && shader_table[c->vs_idx].dxbc.valid) {
-		vs_dxbc = &shader_table[c->vs_idx].dxbc;
-		use_vs_vm = 1;
-	}
-
-	if (c->topology == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {
-		for (UINT i = StartIndexLocation; i + 2 < StartIndexLocation + IndexCount; i += 3) {
+		for (UINT i = StartIndexLocation; i < tri_end; i += 3) {
 			struct sw_vertex tri[3];
 
 			for (int j = 0; j < 3; j++) {
-				UINT idx;
-				if (c->ib_format == DXGI_FORMAT_R16_UINT) {
-					idx = ((const uint16_t *)ib_data)[i + j];
-				} else {
-					idx = ((const uint32_t *)ib_data)[i + j];
+				UINT idx = ib_r16 ?
+					((const uint16_t *)ib_data)[i + j] :
+					((const uint32_t *)ib_data)[i + j];
+				struct vcache_entry *e = direct ?
+					&g_vcache.entries[idx - min_idx] :
+					&g_vcache.entries[idx & (VCACHE_SMALL_SIZE - 1)];
+
+				if (e->stamp != stamp || e->index != idx) {
+					if (pre)
+						vs_stage_shade(vs, &pre[idx - min_idx],
+							       &e->v);
+					else
+						vs_stage_run(vs,
+							(UINT)((int)idx + BaseVertexLocation),
+							&e->v);
+					e->stamp = stamp;
+					e->index = idx;
 				}
-				idx = (UINT)((int)idx + BaseVertexLocation);
-
-				const uint8_t *v = vb_data + idx * stride;
-
-				if (use_vs_vm) {
-					/* === VS VM 경로 === */
-					struct shader_vm vm;
-					memset(&vm, 0, sizeof(vm));
-
-					read_float3(v + pos_off, pos_fmt,
-						    vm.inputs[0]);
-					vm.inputs[0][3] = 1.0f;
-
-					if (col_off >= 0)
-						read_float4(v + col_off,
-							    col_fmt,
-							    vm.inputs[1]);
-					else {
-						vm.inputs[1][0] = 1.0f;
-						vm.inputs[1][1] = 1.0f;
-						vm.inputs[1][2] = 1.0f;
-						vm.inputs[1][3] = 1.0f;
-					}
+				tri[j] = e->v;
+			}
 
-					if (tc_off >= 0) {
-						read_float2(v + tc_off,
-							    tc_fmt,
-							    vm.inputs[2]);
-					}
+			bin_triangle(tri);
+		}
+	}
+}
 
-					for (int ci = 0; ci < 4; ci++) {
-						if (c->vs_cb_idx[ci] >= 0) {
-							struct d3d_resource *cb2 =
-								&resource_table[c->vs_cb_idx[ci]];
-							if (cb2->data) {
-								vm.cb[ci] = (const float *)cb2->data;
-								vm.cb_size[ci] = (int)cb2->size;
-							}
-						}
-					}
+/* ============================================================
+ * 쿼리 / 프레디케이션 (위 쿼리 테이블 절)
+ * ============================================================ */
 
-					shader_vm_execute(&vm, vs_dxbc);
+static uint64_t query_now_ns(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
 
-					float *clip = vm.outputs[0];
-					if (fabsf(clip[3]) > 1e-6f) {
-						tri[j].pos[0] = clip[0] / clip[3];
-						tri[j].pos[1] = clip[1] / clip[3];
-						tri[j].pos[2] = clip[2] / clip[3];
-						tri[j].pos[3] = clip[3];
-					} else {
-						memcpy(tri[j].pos, clip, 16);
-					}
+static void __attribute__((ms_abi))
+ctx_Begin(void *This, void *pAsync)
+{
+	struct d3d11_context *c = This;
+	int idx = handle_to_query_idx(pAsync);
+	if (idx < 0) return;
+	struct d3d_query *q = query_at(idx);
+	/* EVENT/TIMESTAMP는 End만 있음 */
+	if (q->type == D3D11_QUERY_EVENT || q->type == D3D11_QUERY_TIMESTAMP)
+		return;
 
-					memcpy(tri[j].color, vm.outputs[1], 16);
+	/* 이전 End의 Draw가 bin에 남아 있으면 먼저 끝내야 samples를 비울 수 있음 */
+	if (q->pending)
+		bin_flush(0);
+	q->samples = 0;
+	q->overflow = 0;
+	__atomic_store_n(&q->done, 0, __ATOMIC_RELAXED);
+	q->building = 1;
+	if (q->type != D3D11_QUERY_OCCLUSION &&
+	    q->type != D3D11_QUERY_OCCLUSION_PREDICATE)
+		return;
 
-					if (tc_off >= 0) {
-						tri[j].texcoord[0] = vm.outputs[2][0];
-						tri[j].texcoord[1] = vm.outputs[2][1];
-						tri[j].has_texcoord = 1;
-					} else {
-						tri[j].texcoord[0] = 0;
-						tri[j].texcoord[1] = 0;
-						tri[j].has_texcoord = 0;
-					}
-				} else {
-					/* === 고정 함수 경로 === */
-					float raw_pos[4];
-					read_float3(v + pos_off, pos_fmt, raw_pos);
-					raw_pos[3] = 1.0f;
-
-					if (c->vs_cb_idx[0] >= 0) {
-						struct d3d_resource *cb =
-							&resource_table[c->vs_cb_idx[0]];
-						if (cb->data && cb->size >= 64) {
-							float transformed[4];
-							mat4_mul_vec4(
-								(const float *)cb->data,
-								raw_pos, transformed);
-							if (fabsf(transformed[3]) > 1e-6f) {
-								tri[j].pos[0] = transformed[0] / transformed[3];
-								tri[j].pos[1] = transformed[1] / transformed[3];
-								tri[j].pos[2] = transformed[2] / transformed[3];
-								tri[j].pos[3] = transformed[3];
-							} else {
-								memcpy(tri[j].pos, transformed, 16);
-							}
-						} else {
-							memcpy(tri[j].pos, raw_pos, 16);
-						}
-					} else {
-						memcpy(tri[j].pos, raw_pos, 16);
-					}
+	/* 이미 진행 중이면 (End 없이 다시 Begin) 0부터 다시 셈 */
+	for (int i = 0; i < c->occ_query_count; i++)
+		if (c->occ_queries[i] == q)
+			return;
+	if (c->occ_query_count == QUERY_MAX_OCC) {
+		q->overflow = 1;
+		return;
+	}
+	c->occ_queries[c->occ_query_count++] = q;
+}
 
-					if (col_off >= 0)
-						read_float4(v + col_off, col_fmt, tri[j].color);
-					else {
-						tri[j].color[0] = 1.0f;
-						tri[j].color[1] = 1.0f;
-						tri[j].color[2] = 1.0f;
-						tri[j].color[3] = 1.0f;
-					}
+static void __attribute__((ms_abi))
+ctx_End(void *This, void *pAsync)
+{
+	struct d3d11_context *c = This;
+	int idx = handle_to_query_idx(pAsync);
+	if (idx < 0) return;
+	struct d3d_query *q = query_at(idx);
 
-					if (tc_off >= 0) {
-						read_float2(v + tc_off, tc_fmt, tri[j].texcoord);
-						tri[j].has_texcoord = 1;
-					} else {
-						tri[j].texcoord[0] = tri[j].texcoord[1] = 0.0f;
-						tri[j].has_texcoord = 0;
-					}
-				}
-			}
+	if (q->type != D3D11_QUERY_EVENT && q->type != D3D11_QUERY_TIMESTAMP) {
+		if (!q->building) return;   /* Begin 없는 End */
+		q->building = 0;
+	}
+	for (int i = 0; i < c->occ_query_count; i++) {
+		if (c->occ_queries[i] == q) {
+			c->occ_queries[i] = c->occ_queries[--c->occ_query_count];
+			break;
+		}
+	}
+
+	if (q->type == D3D11_QUERY_TIMESTAMP) {
+		/* 앞의 Draw를 래스터라이징한 뒤의 시각 */
+		bin_flush(0);
+		q->timestamp = query_now_ns();
+		__atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+		return;
+	}
 
-			rasterize_triangle(&rp, tri);
+	/* 래스터라이징할 Draw가 없으면 바로 완료 */
+	if (g_bin.draw_count == 0 && !q->pending) {
+		__atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+		return;
+	}
+	if (!q->pending) {
+		if (g_query_pending_count == g_query_pending_cap) {
+			int cap = g_query_pending_cap ? g_query_pending_cap * 2 : 16;
+			int *np = realloc(g_query_pending, sizeof(*np) * cap);
+			if (!np) {
+				/* 목록에 못 넣으면 지금 래스터라이징해서 완료 */
+				bin_flush(0);
+				__atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+				return;
+			}
+			g_query_pending = np;
+			g_query_pending_cap = cap;
 		}
+		q->pending = 1;
+		g_query_pending[g_query_pending_count++] = idx;
+	}
+	__atomic_store_n(&q->done, 0, __ATOMIC_RELAXED);
+}
+
+/*
+ * GetData — 결과가 아직이면 쌓인 Draw를 실행해 기다림
+ * (DONOTFLUSH면 S_FALSE). Begin만 하고 End하지 않은 쿼리도 S_FALSE.
+ */
+static HRESULT __attribute__((ms_abi))
+ctx_GetData(void *This, void *pAsync, void *pData, UINT DataSize,
+	    UINT GetDataFlags)
+{
+	(void)This;
+	int idx = handle_to_query_idx(pAsync);
+	if (idx < 0) return E_INVALIDARG;
+	struct d3d_query *q = query_at(idx);
+
+	if (!__atomic_load_n(&q->done, __ATOMIC_ACQUIRE)) {
+		if (GetDataFlags & D3D11_ASYNC_GETDATA_DONOTFLUSH)
+			return S_FALSE;
+		/* 비동기 모드면 렌더 스레드가 End까지 실행한 뒤 bin을 비움 */
+		async_sync();
+		bin_flush(0);
+		if (!__atomic_load_n(&q->done, __ATOMIC_ACQUIRE))
+			return S_FALSE;
+	}
+	if (q->overflow)
+		return E_FAIL;
+	if (!pData)
+		return S_OK;
+
+	switch (q->type) {
+	case D3D11_QUERY_EVENT:
+	case D3D11_QUERY_OCCLUSION_PREDICATE: {
+		if (DataSize < sizeof(BOOL)) return E_INVALIDARG;
+		BOOL v = q->type == D3D11_QUERY_EVENT ||
+			 __atomic_load_n(&q->samples, __ATOMIC_RELAXED) != 0;
+		memcpy(pData, &v, sizeof(v));
+		break;
+	}
+	case D3D11_QUERY_OCCLUSION:
+	case D3D11_QUERY_TIMESTAMP: {
+		if (DataSize < sizeof(uint64_t)) return E_INVALIDARG;
+		uint64_t v = q->type == D3D11_QUERY_TIMESTAMP ? q->timestamp :
+			     __atomic_load_n(&q->samples, __ATOMIC_RELAXED);
+		memcpy(pData, &v, sizeof(v));
+		break;
+	}
+	case D3D11_QUERY_TIMESTAMP_DISJOINT: {
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT d = { 1000000000ull, FALSE };
+		if (DataSize < sizeof(d)) return E_INVALIDARG;
+		memcpy(pData, &d, sizeof(d));
+		break;
+	}
+	default:
+		return E_INVALIDARG;
 	}
+	return S_OK;
+}
+
+static void __attribute__((ms_abi))
+ctx_SetPredication(void *This, void *pPredicate, BOOL PredicateValue)
+{
+	struct d3d11_context *c = This;
+	int idx = pPredicate ? handle_to_query_idx(pPredicate) : -1;
+	c->pred = idx >= 0 ? query_at(idx) : NULL;
+	c->pred_handle = idx >= 0 ? pPredicate : NULL;
+	c->pred_value = PredicateValue;
+}
+
+static void __attribute__((ms_abi))
+ctx_GetPredication(void *This, void **ppPredicate, BOOL *pPredicateValue)
+{
+	struct d3d11_context *c = This;
+	if (ppPredicate)
+		*ppPredicate = c->pred_handle;
+	if (pPredicateValue)
+		*pPredicateValue = c->pred_value;
+}
+
+/*
+ * Draw/Dispatch 직전: 프레디케이트 결과가 pred_value와 같으면 생략.
+ * 결과가 아직이면 bin을 비워 정함 (PREDICATEHINT면 기다리지 않고 그림).
+ * Clear/Copy는 프레디케이션을 따르지 않음.
+ */
+static int predicated_skip(struct d3d11_context *c)
+{
+	struct d3d_query *q = c->pred;
+	if (!q || q->type != D3D11_QUERY_OCCLUSION_PREDICATE)
+		return 0;
+	if (!__atomic_load_n(&q->done, __ATOMIC_ACQUIRE)) {
+		if (q->hint || !q->pending)
+			return 0;
+		bin_flush(0);
+	}
+	/* 세지 못한 쿼리는 보이는 것으로 (그리는 쪽이 안전) */
+	BOOL visible = q->overflow ||
+		       __atomic_load_n(&q->samples, __ATOMIC_RELAXED) != 0;
+	return visible == (c->pred_value != FALSE);
+}
+
+/*
+ * Draw — 소프트웨어 렌더링 파이프라인 실행
+ *
+ * 현재 바인딩된 VB, InputLayout, RTV를 사용하여
+ * 삼각형 단위로 래스터라이징.
+ */
+static void __attribute__((ms_abi))
+ctx_Draw(void *This, UINT VertexCount, UINT StartVertexLocation)
+{
+	struct d3d11_context *c = This;
+	if (predicated_skip(c))
+		return;
+
+	/* 파이프라인 스냅샷 (바뀐 상태만 재구성) */
+	const struct raster_params *rp = pipeline_update(c);
+	if (!rp) return;
+
+#ifdef CITC_VULKAN_ENABLED
+	/* GPU 경로 (SW와 병렬 실행 — Present에서 readback) */
+	{
+		struct vs_stage *vs = &c->vs;
+		struct d3d_resource *rt = rp->rt;
+		struct d3d_resource *vb =
+			resource_at(c->vb_resource_idx[vs->plan->slot]);
+		vk_gpu_draw(c, (const uint8_t *)vb->data, (UINT)vb->size,
+			    vs->stride, VertexCount, StartVertexLocation,
+			    NULL, 0, 0, 0, rt->width, rt->height);
+	}
+#endif
+
+	draw_vertices(c, rp, VertexCount, StartVertexLocation, 1, 0);
+}
+
+/* DrawIndexed */
+static void __attribute__((ms_abi))
+ctx_DrawIndexed(void *This, UINT IndexCount,
+		UINT StartIndexLocation, int BaseVertexLocation)
+{
+	struct d3d11_context *c = This;
+	if (predicated_skip(c))
+		return;
+
+	const struct raster_params *rp = pipeline_update(c);
+	if (!rp) return;
+
+#ifdef CITC_VULKAN_ENABLED
+	/* GPU 경로 */
+	if (c->ib_resource_idx >= 0) {
+		struct vs_stage *vs = &c->vs;
+		struct d3d_resource *rt = rp->rt;
+		struct d3d_resource *ib = resource_at(c->ib_resource_idx);
+		struct d3d_resource *vb =
+			resource_at(c->vb_resource_idx[vs->plan->slot]);
+		if (ib->data)
+			vk_gpu_draw(c, (const uint8_t *)vb->data,
+				    (UINT)vb->size, vs->stride, 0, 0,
+				    (const uint8_t *)ib->data, (UINT)ib->size,
+				    IndexCount,
+				    c->ib_format == DXGI_FORMAT_R16_UINT,
+				    rt->width, rt->height);
+	}
+#endif
+
+	draw_indexed(c, rp, IndexCount, StartIndexLocation,
+		     BaseVertexLocation, 1, 0);
+}
+
+/*
+ * DrawInstanced / DrawIndexedInstanced — SW 경로만
+ * (Vulkan 경로는 인스턴스 입력을 아직 지원하지 않음)
+ */
+static void __attribute__((ms_abi))
+ctx_DrawInstanced(void *This, UINT VertexCountPerInstance,
+		  UINT InstanceCount, UINT StartVertexLocation,
+		  UINT StartInstanceLocation)
+{
+	struct d3d11_context *c = This;
+	if (predicated_skip(c))
+		return;
+	const struct raster_params *rp = pipeline_update(c);
+	if (!rp) return;
+	draw_vertices(c, rp, VertexCountPerInstance, StartVertexLocation,
+		      InstanceCount, StartInstanceLocation);
+}
+
+static void __attribute__((ms_abi))
+ctx_DrawIndexedInstanced(void *This, UINT IndexCountPerInstance,
+			 UINT InstanceCount, UINT StartIndexLocation,
+			 int BaseVertexLocation, UINT StartInstanceLocation)
+{
+	struct d3d11_context *c = This;
+	if (predicated_skip(c))
+		return;
+	const struct raster_params *rp = pipeline_update(c);
+	if (!rp) return;
+	draw_indexed(c, rp, IndexCountPerInstance, StartIndexLocation,
+		     BaseVertexLocation, InstanceCount, StartInstanceLocation);
 }
 
 /* PSSetConstantBuffers */
@@ -2075,6 +5125,7 @@ ctx_PSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
 			 void *const *ppConstantBuffers)
 {
 	struct d3d11_context *c = This;
+	c->pipe_dirty |= PIPE_DIRTY_PS;
 	for (UINT i = 0; i < NumBuffers && (StartSlot + i) < 8; i++) {
 		if (ppConstantBuffers && ppConstantBuffers[i])
 			c->ps_cb_idx[StartSlot + i] =
@@ -2084,6 +5135,332 @@ ctx_PSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
 	}
 }
 
+/* ============================================================
+ * Compute 셰이더 (CSSet*, Dispatch)
+ * ============================================================
+ *
+ * thread group 하나가 thread_pool 작업 하나. 그룹 안의 스레드는
+ * SHADER_SOA_WIDTH개씩 SoA VM 배치로 묶여 레인 하나씩을 맡는다.
+ *
+ *   sync_g_t 없음 → 배치를 하나씩 끝까지 실행 (VM 하나 재사용)
+ *   sync_g_t 있음 → 배치마다 VM을 두고 모든 배치를 배리어까지
+ *                    돌린 뒤 다음 구간으로 (라운드 로빈)
+ *
+ * 그룹 공유 메모리(g#)는 작업 스레드별 버퍼를 그룹마다 0으로 채워 쓴다.
+ * UAV는 Dispatch 시점의 버퍼 data를 직접 가리키고, 다른 그룹(다른
+ * 워커)과 겹치는 atomic은 VM이 __atomic 연산으로 처리한다.
+ * bin에 쌓인 Draw가 같은 버퍼를 VB/CB로 읽을 수 있으므로 Dispatch 전에
+ * bin을 비운다. Dispatch는 반환 전에 끝나므로 뒤이은 Draw/Map은
+ * 결과를 그대로 본다.
+ */
+#define CS_MAX_GROUP_THREADS 1024
+#define CS_MAX_BATCHES (CS_MAX_GROUP_THREADS / SHADER_SOA_WIDTH)
+
+struct cs_dispatch {
+	const struct dxbc_info *dxbc;
+	UINT groups[3];
+	uint64_t base;              /* 이번 thread_pool_run의 첫 그룹 번호 */
+	int nthreads, nbatches;
+
+	/* 모든 그룹 공통 바인딩 */
+	const float *cb[4];
+	int cb_size[4];
+	struct shader_vm_buffer uav[DXBC_MAX_UAVS];
+	struct shader_vm_buffer buffer[DXBC_MAX_BUFFERS];
+};
+
+/*
+ * 작업 스레드별 VM 배열과 공유 메모리 (thread_pool_self()로 고름).
+ * Dispatch가 시작 전에 모두 잡아 두므로 그룹 작업은 할당하지 않는다 —
+ * 일부 그룹만 건너뛴 반쪽짜리 결과가 나오지 않게, 잡지 못하면
+ * Dispatch 전체를 버린다. 크기는 줄이지 않고 다음 Dispatch에 재사용.
+ */
+struct cs_scratch {
+	struct shader_vm_soa *vms;
+	int vm_count;
+	uint8_t *tgsm;          /* DXBC_MAX_TGSM_BYTES */
+};
+
+static struct cs_scratch *cs_scratch;
+static int cs_scratch_count;
+
+/* 스레드마다 VM nvm개 (+ tgsm이면 공유 메모리). 실패하면 -1 */
+static int cs_scratch_reserve(int nvm, int tgsm)
+{
+	int n = thread_pool_size();
+	if (cs_scratch_count < n) {
+		struct cs_scratch *s = realloc(cs_scratch, sizeof(*s) * (size_t)n);
+		if (!s)
+			return -1;
+		memset(s + cs_scratch_count, 0,
+		       sizeof(*s) * (size_t)(n - cs_scratch_count));
+		cs_scratch = s;
+		cs_scratch_count = n;
+	}
+	for (int i = 0; i < n; i++) {
+		struct cs_scratch *s = &cs_scratch[i];
+		if (s->vm_count < nvm) {
+			free(s->vms);
+			s->vms = aligned_alloc(32, sizeof(*s->vms) * (size_t)nvm);
+			s->vm_count = s->vms ? nvm : 0;
+			if (!s->vms)
+				return -1;
+			memset(s->vms, 0, sizeof(*s->vms) * (size_t)nvm);
+		}
+		if (tgsm && !s->tgsm &&
+		    !(s->tgsm = malloc(DXBC_MAX_TGSM_BYTES)))
+			return -1;
+	}
+	return 0;
+}
+
+static inline void cs_lane_set(float *lanes, int k, uint32_t v)
+{
+	memcpy(&lanes[k], &v, 4);
+}
+
+/* 배치 b의 바인딩과 스레드 ID 입력을 채움. 반환: 레인 마스크 */
+static unsigned cs_batch_init(const struct cs_dispatch *d,
+			      struct shader_vm_soa *vm, uint8_t *tgsm,
+			      const uint32_t gid[3], int b)
+{
+	const int *size = d->dxbc->ir->group_size;
+	unsigned lanes = 0;
+
+	memcpy(vm->cb, d->cb, sizeof(vm->cb));
+	memcpy(vm->cb_size, d->cb_size, sizeof(vm->cb_size));
+	memcpy(vm->uav, d->uav, sizeof(vm->uav));
+	memcpy(vm->buffer, d->buffer, sizeof(vm->buffer));
+	vm->tgsm = tgsm;
+
+	for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+		int t = b * SHADER_SOA_WIDTH + k;
+		if (t >= d->nthreads)
+			break;
+		lanes |= 1u << k;
+
+		uint32_t tid[4] = {
+			(uint32_t)(t % size[0]),
+			(uint32_t)(t / size[0] % size[1]),
+			(uint32_t)(t / (size[0] * size[1])),
+			0,
+		};
+		for (int i = 0; i < 4; i++) {
+			uint32_t g = i < 3 ? gid[i] : 0;
+			uint32_t sz = i < 3 ? (uint32_t)size[i] : 0;
+			cs_lane_set(vm->inputs[DXBC_CS_INPUT_THREAD_ID][i], k,
+				    g * sz + tid[i]);
+			cs_lane_set(vm->inputs[DXBC_CS_INPUT_GROUP_ID][i], k, g);
+			cs_lane_set(vm->inputs[DXBC_CS_INPUT_THREAD_IN_GROUP][i],
+				    k, tid[i]);
+			cs_lane_set(vm->inputs[DXBC_CS_INPUT_GROUP_INDEX][i], k,
+				    i == 0 ? (uint32_t)t : 0);
+		}
+	}
+	return lanes;
+}
+
+static void cs_group_job(void *arg, int job)
+{
+	const struct cs_dispatch *d = arg;
+	const struct dxbc_info *info = d->dxbc;
+	const struct dxbc_ir *ir = info->ir;
+
+	uint64_t g = d->base + (uint64_t)job;
+	uint32_t gid[3] = {
+		(uint32_t)(g % d->groups[0]),
+		(uint32_t)(g / d->groups[0] % d->groups[1]),
+		(uint32_t)(g / ((uint64_t)d->groups[0] * d->groups[1])),
+	};
+
+	int sync = ir->has_sync;
+	struct cs_scratch *s = &cs_scratch[thread_pool_self()];
+	struct shader_vm_soa *vms = s->vms;
+	if (ir->tgsm_bytes)
+		memset(s->tgsm, 0, ir->tgsm_bytes);
+
+	for (int b = 0; b < d->nbatches; b++) {
+		struct shader_vm_soa *vm = &vms[sync ? b : 0];
+		unsigned lanes = cs_batch_init(d, vm, s->tgsm, gid, b);
+		if (shader_vm_soa_begin(vm, info, lanes) < 0)
+			return;
+		if (!sync)
+			shader_vm_soa_run(vm, info);
+	}
+	if (!sync)
+		return;
+
+	/* 배리어 사이 구간을 배치마다 차례로 */
+	uint8_t running[CS_MAX_BATCHES];
+	int left = d->nbatches;
+	memset(running, 1, sizeof(running));
+	while (left > 0) {
+		for (int b = 0; b < d->nbatches; b++) {
+			if (running[b] && shader_vm_soa_run(&vms[b], info) != 1) {
+				running[b] = 0;
+				left--;
+			}
+		}
+	}
+}
+
+/* view → 버퍼 바인딩 (버퍼가 아니면 비움) */
+static void cs_bind_view(struct shader_vm_buffer *out, int vidx)
+{
+	out->data = NULL;
+	out->size = 0;
+	if (vidx < 0 || !view_at(vidx)->active)
+		return;
+	struct d3d_view *v = view_at(vidx);
+	struct d3d_resource *r = resource_at(v->resource_idx);
+	if (r->type != D3D_RES_BUFFER || !r->data)
+		return;
+	out->data = (uint8_t *)r->data + v->buf_offset;
+	out->size = v->buf_size;
+}
+
+static void __attribute__((ms_abi))
+ctx_Dispatch(void *This, UINT X, UINT Y, UINT Z)
+{
+	struct d3d11_context *c = This;
+	if (c->cs_idx < 0 || X == 0 || Y == 0 || Z == 0 ||
+	    predicated_skip(c))
+		return;
+
+	struct d3d_shader *sh = shader_at(c->cs_idx);
+	if (!sh->active || sh->type != D3D_SHADER_COMPUTE || !sh->dxbc.ir)
+		return;
+	const struct dxbc_ir *ir = sh->dxbc.ir;
+	const int *size = ir->group_size;
+	if (size[0] <= 0 || size[1] <= 0 || size[2] <= 0 ||
+	    size[0] * size[1] * size[2] > CS_MAX_GROUP_THREADS)
+		return;
+
+	struct cs_dispatch d;
+	memset(&d, 0, sizeof(d));
+	d.dxbc = &sh->dxbc;
+	d.groups[0] = X;
+	d.groups[1] = Y;
+	d.groups[2] = Z;
+	d.nthreads = size[0] * size[1] * size[2];
+	d.nbatches = (d.nthreads + SHADER_SOA_WIDTH - 1) / SHADER_SOA_WIDTH;
+
+	for (int i = 0; i < 4; i++) {
+		if (c->cs_cb_idx[i] < 0) continue;
+		struct d3d_resource *r = resource_at(c->cs_cb_idx[i]);
+		d.cb[i] = (const float *)r->data;
+		d.cb_size[i] = r->data ? (int)r->size : 0;
+	}
+	for (int i = 0; i < DXBC_MAX_UAVS; i++)
+		cs_bind_view(&d.uav[i], c->cs_uav_idx[i]);
+	for (int i = 0; i < DXBC_MAX_BUFFERS; i++)
+		cs_bind_view(&d.buffer[i], c->cs_srv_idx[i]);
+
+	if (cs_scratch_reserve(ir->has_sync ? d.nbatches : 1,
+			       ir->tgsm_bytes > 0) < 0)
+		return;
+
+	bin_flush(0);
+
+	/* 그룹 수가 int를 넘을 수 있으므로 나눠서 실행 */
+	uint64_t total = (uint64_t)X * Y * Z;
+	for (d.base = 0; d.base < total; ) {
+		uint64_t n = total - d.base;
+		if (n > (1u << 30))
+			n = 1u << 30;
+		thread_pool_run(cs_group_job, &d, (int)n);
+		d.base += n;
+	}
+}
+
+static void __attribute__((ms_abi))
+ctx_CSSetShader(void *This, void *pCS, void *const *ppCI, UINT nCI)
+{
+	struct d3d11_context *c = This;
+	(void)ppCI; (void)nCI;
+	c->cs_idx = handle_to_shader_idx(pCS);
+}
+
+static void __attribute__((ms_abi))
+ctx_CSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
+			 void *const *ppConstantBuffers)
+{
+	struct d3d11_context *c = This;
+	for (UINT i = 0; i < NumBuffers && (StartSlot + i) < 8; i++) {
+		if (ppConstantBuffers && ppConstantBuffers[i])
+			c->cs_cb_idx[StartSlot + i] =
+				handle_to_resource_idx(ppConstantBuffers[i]);
+		else
+			c->cs_cb_idx[StartSlot + i] = -1;
+	}
+}
+
+static void __attribute__((ms_abi))
+ctx_CSSetShaderResources(void *This, UINT StartSlot, UINT NumViews,
+			 void *const *ppSRViews)
+{
+	struct d3d11_context *c = This;
+	for (UINT i = 0; i < NumViews && (StartSlot + i) < 8; i++) {
+		if (ppSRViews && ppSRViews[i])
+			c->cs_srv_idx[StartSlot + i] =
+				handle_to_view_idx(ppSRViews[i]);
+		else
+			c->cs_srv_idx[StartSlot + i] = -1;
+	}
+}
+
+/* UAV 카운터(append/consume)는 미지원 → pUAVInitialCounts 무시 */
+static void __attribute__((ms_abi))
+ctx_CSSetUnorderedAccessViews(void *This, UINT StartSlot, UINT NumUAVs,
+			      void *const *ppUAViews,
+			      const UINT *pUAVInitialCounts)
+{
+	struct d3d11_context *c = This;
+	(void)pUAVInitialCounts;
+	for (UINT i = 0; i < NumUAVs && (StartSlot + i) < 8; i++) {
+		if (ppUAViews && ppUAViews[i])
+			c->cs_uav_idx[StartSlot + i] =
+				handle_to_view_idx(ppUAViews[i]);
+		else
+			c->cs_uav_idx[StartSlot + i] = -1;
+	}
+}
+
+/*
+ * CopyResource — 같은 종류/크기의 리소스 전체 복사.
+ * UpdateSubresource 경로를 타므로 버퍼 이름 바꾸기, HiZ, 밉 재생성이
+ * 그대로 적용된다. 원본은 bin에 쌓인 Draw의 렌더 타깃일 수 있으므로
+ * 먼저 그린다.
+ */
+static void __attribute__((ms_abi))
+ctx_CopyResource(void *This, void *pDstResource, void *pSrcResource)
+{
+	int di = handle_to_resource_idx(pDstResource);
+	int si = handle_to_resource_idx(pSrcResource);
+	if (di < 0 || si < 0 || di == si)
+		return;
+
+	struct d3d_resource *dst = resource_at(di);
+	struct d3d_resource *src = resource_at(si);
+	if (dst->type != src->type || dst->size != src->size ||
+	    dst->bc != src->bc || !dst->data || !src->data)
+		return;
+
+	if (src->type != D3D_RES_BUFFER) {
+		bin_flush(0);
+		fast_clear_resolve(src);
+	}
+	ctx_UpdateSubresource(This, pDstResource, 0, NULL, src->data, 0, 0);
+}
+
+/* Flush — bin에 쌓인 Draw를 모두 래스터라이징 */
+static void __attribute__((ms_abi))
+ctx_Flush(void *This)
+{
+	(void)This;
+	d3d11_flush();
+}
+
 /* 나머지 Context 스텁 */
 static void __attribute__((ms_abi)) ctx_stub(void *T, ...)
 { (void)T; }
@@ -2094,27 +5471,56 @@ static void __attribute__((ms_abi))
 ctx_ClearState(void *This)
 {
 	struct d3d11_context *c = This;
-	c->vb_resource_idx = -1;
+	c->pipe_dirty |= PIPE_DIRTY_ALL;
+	for (int i = 0; i < MAX_VB_SLOTS; i++) {
+		c->vb_resource_idx[i] = -1;
+		c->vb_stride[i] = c->vb_offset[i] = 0;
+	}
 	c->ib_resource_idx = -1;
 	c->input_layout_idx = -1;
 	c->vs_idx = -1;
 	c->ps_idx = -1;
+	c->cs_idx = -1;
 	c->rtv_idx = -1;
 	c->dsv_idx = -1;
 	c->topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
 	memset(&c->viewport, 0, sizeof(c->viewport));
+	memset(&c->scissor, 0, sizeof(c->scissor));
+	c->num_scissors = 0;
 	for (int i = 0; i < 8; i++) {
 		c->vs_cb_idx[i] = -1;
 		c->ps_cb_idx[i] = -1;
 		c->ps_srv_idx[i] = -1;
 		c->ps_sampler_idx[i] = -1;
+		c->cs_cb_idx[i] = -1;
+		c->cs_srv_idx[i] = -1;
+		c->cs_uav_idx[i] = -1;
 	}
 	c->ds_state_idx = -1;
 	c->blend_state_idx = -1;
 	c->rs_state_idx = -1;
 	c->stencil_ref = 0;
+	for (int i = 0; i < 4; i++)
+		c->blend_factor[i] = 1.0f;
+	c->pred = NULL;
+	c->pred_handle = NULL;
+	c->pred_value = FALSE;
+}
+
+static UINT __attribute__((ms_abi))
+ctx_GetType(void *This)
+{
+	struct d3d11_context *c = This;
+	/* 비동기 모드의 immediate context도 rec를 갖지만 여전히 immediate */
+	return (c->rec && c != g_context) ? D3D11_DEVICE_CONTEXT_DEFERRED
+					  : D3D11_DEVICE_CONTEXT_IMMEDIATE;
 }
 
+/* Command list 재생 (아래 Deferred Context 절) */
+static void __attribute__((ms_abi))
+ctx_ExecuteCommandList(void *This, void *pCommandList,
+		       BOOL RestoreContextState);
+
 static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.QueryInterface           = ctx_QueryInterface,
 	.AddRef                   = ctx_AddRef,
@@ -2140,17 +5546,17 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.IASetVertexBuffers       = ctx_IASetVertexBuffers,
 	.IASetIndexBuffer         = ctx_IASetIndexBuffer,
 	/* instancing */
-	.DrawIndexedInstanced     = (void *)ctx_stub,
-	.DrawInstanced            = (void *)ctx_stub,
+	.DrawIndexedInstanced     = ctx_DrawIndexedInstanced,
+	.DrawInstanced            = ctx_DrawInstanced,
 	.GSSetConstantBuffers     = (void *)ctx_stub,
 	.GSSetShader              = (void *)ctx_stub,
 	.IASetPrimitiveTopology   = ctx_IASetPrimitiveTopology,
 	.VSSetShaderResources     = (void *)ctx_stub,
 	.VSSetSamplers            = (void *)ctx_stub,
-	.Begin                    = (void *)ctx_stub,
-	.End                      = (void *)ctx_stub,
-	.GetData                  = (void *)ctx_stub_hr,
-	.SetPredication           = (void *)ctx_stub,
+	.Begin                    = ctx_Begin,
+	.End                      = ctx_End,
+	.GetData                  = ctx_GetData,
+	.SetPredication           = ctx_SetPredication,
 	.GSSetShaderResources     = (void *)ctx_stub,
 	.GSSetSamplers            = (void *)ctx_stub,
 	/* OM */
@@ -2162,14 +5568,14 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.DrawAuto                 = (void *)ctx_stub,
 	.DrawIndexedInstancedIndirect = (void *)ctx_stub,
 	.DrawInstancedIndirect    = (void *)ctx_stub,
-	.Dispatch                 = (void *)ctx_stub,
+	.Dispatch                 = ctx_Dispatch,
 	.DispatchIndirect         = (void *)ctx_stub,
 	.RSSetState               = ctx_RSSetState,
 	.RSSetViewports           = ctx_RSSetViewports,
-	.RSSetScissorRects        = (void *)ctx_stub,
+	.RSSetScissorRects        = ctx_RSSetScissorRects,
 	/* Copy/Update */
 	.CopySubresourceRegion    = (void *)ctx_stub,
-	.CopyResource             = (void *)ctx_stub,
+	.CopyResource             = ctx_CopyResource,
 	.UpdateSubresource        = ctx_UpdateSubresource,
 	.CopyStructureCount       = (void *)ctx_stub,
 	/* Clear */
@@ -2177,11 +5583,11 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.ClearUnorderedAccessViewUint  = (void *)ctx_stub,
 	.ClearUnorderedAccessViewFloat = (void *)ctx_stub,
 	.ClearDepthStencilView    = ctx_ClearDepthStencilView,
-	.GenerateMips             = (void *)ctx_stub,
+	.GenerateMips             = ctx_GenerateMips,
 	.SetResourceMinLOD        = (void *)ctx_stub,
 	.GetResourceMinLOD        = (void *)ctx_stub,
 	.ResolveSubresource       = (void *)ctx_stub,
-	.ExecuteCommandList       = (void *)ctx_stub,
+	.ExecuteCommandList       = ctx_ExecuteCommandList,
 	/* HS/DS/CS */
 	.HSSetShaderResources     = (void *)ctx_stub,
 	.HSSetShader              = (void *)ctx_stub,
@@ -2191,11 +5597,11 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.DSSetShader              = (void *)ctx_stub,
 	.DSSetSamplers            = (void *)ctx_stub,
 	.DSSetConstantBuffers     = (void *)ctx_stub,
-	.CSSetShaderResources     = (void *)ctx_stub,
-	.CSSetUnorderedAccessViews = (void *)ctx_stub,
-	.CSSetShader              = (void *)ctx_stub,
+	.CSSetShaderResources     = ctx_CSSetShaderResources,
+	.CSSetUnorderedAccessViews = ctx_CSSetUnorderedAccessViews,
+	.CSSetShader              = ctx_CSSetShader,
 	.CSSetSamplers            = (void *)ctx_stub,
-	.CSSetConstantBuffers     = (void *)ctx_stub,
+	.CSSetConstantBuffers     = ctx_CSSetConstantBuffers,
 	/* Get methods */
 	.VSGetConstantBuffers     = (void *)ctx_stub,
 	.PSGetShaderResources     = (void *)ctx_stub,
@@ -2211,7 +5617,7 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.IAGetPrimitiveTopology   = (void *)ctx_stub,
 	.VSGetShaderResources     = (void *)ctx_stub,
 	.VSGetSamplers            = (void *)ctx_stub,
-	.GetPredication           = (void *)ctx_stub,
+	.GetPredication           = ctx_GetPredication,
 	.GSGetShaderResources     = (void *)ctx_stub,
 	.GSGetSamplers            = (void *)ctx_stub,
 	.OMGetRenderTargets       = (void *)ctx_stub,
@@ -2220,8 +5626,8 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.OMGetDepthStencilState   = (void *)ctx_stub,
 	.SOGetTargets             = (void *)ctx_stub,
 	.RSGetState               = (void *)ctx_stub,
-	.RSGetViewports           = (void *)ctx_stub,
-	.RSGetScissorRects        = (void *)ctx_stub,
+	.RSGetViewports           = ctx_RSGetViewports,
+	.RSGetScissorRects        = ctx_RSGetScissorRects,
 	.HSGetShaderResources     = (void *)ctx_stub,
 	.HSGetShader              = (void *)ctx_stub,
 	.HSGetSamplers            = (void *)ctx_stub,
@@ -2236,16 +5642,1432 @@ static ID3D11DeviceContextVtbl g_context_vtbl = {
 	.CSGetSamplers            = (void *)ctx_stub,
 	.CSGetConstantBuffers     = (void *)ctx_stub,
 	.ClearState               = ctx_ClearState,
-	.Flush                    = (void *)ctx_stub,
-	.GetType                  = (void *)ctx_stub,
+	.Flush                    = ctx_Flush,
+	.GetType                  = ctx_GetType,
 	.GetContextFlags          = (void *)ctx_stub,
 	.FinishCommandList        = (void *)ctx_stub_hr,
 };
 
 /* ============================================================
- * GetImmediateContext (Device vtable에서 참조)
- * ============================================================ */
-
+ * Deferred Context / Command List
+ * ============================================================
+ *
+ * CreateDeferredContext가 만드는 context는 아무것도 실행하지 않고
+ * 호출을 명령 버퍼에 기록만 한다. 기록은 자기 context의 버퍼와
+ * 상태만 건드리므로, 앱이 context마다 스레드를 따로 두고 동시에
+ * 기록할 수 있다.
+ *
+ *   deferred: IASet*, Draw, Clear, Map/Unmap ... → d3d_cmd 배열
+ *   FinishCommandList → 버퍼를 command list 객체로 넘김
+ *   ExecuteCommandList(immediate) → 같은 ctx_* 함수로 재생
+ *
+ * 재생은 immediate 호출과 같은 경로를 타므로 Draw는 그대로 타일 bin에
+ * 쌓인다. 슬롯 배열, 뷰포트, Map/UpdateSubresource 내용 같은 가변 길이
+ * 인자는 명령과 별도인 data 영역에 복사해 둔다.
+ *
+ * D3D11 규칙대로 command list는 기본 상태에서 시작하고, 실행 후
+ * immediate context 상태는 RestoreContextState에 따라 복원되거나
+ * 초기화된다.
+ */
+
+enum d3d_cmd_type {
+	CMD_VS_SET_CB,
+	CMD_PS_SET_CB,
+	CMD_PS_SET_SRV,
+	CMD_PS_SET_SAMPLER,
+	CMD_VS_SET_SHADER,
+	CMD_PS_SET_SHADER,
+	CMD_IA_SET_LAYOUT,
+	CMD_IA_SET_VB,
+	CMD_IA_SET_IB,
+	CMD_IA_SET_TOPOLOGY,
+	CMD_OM_SET_RT,
+	CMD_OM_SET_DS_STATE,
+	CMD_OM_SET_BLEND,
+	CMD_RS_SET_STATE,
+	CMD_RS_SET_VIEWPORT,
+	CMD_RS_SET_SCISSOR,
+	CMD_CLEAR_RTV,
+	CMD_CLEAR_DSV,
+	CMD_GENERATE_MIPS,
+	CMD_CS_SET_CB,
+	CMD_CS_SET_SRV,
+	CMD_CS_SET_UAV,
+	CMD_CS_SET_SHADER,
+	CMD_DISPATCH,
+	CMD_COPY_RESOURCE,
+	CMD_QUERY_BEGIN,
+	CMD_QUERY_END,
+	CMD_SET_PREDICATION,
+	CMD_DRAW,
+	CMD_DRAW_INDEXED,
+	CMD_DRAW_INSTANCED,
+	CMD_DRAW_INDEXED_INSTANCED,
+	CMD_UPDATE,         /* Map/Unmap, UpdateSubresource → 리소스 내용 (상자) */
+	CMD_MAP_WRITE,      /* 버퍼 Map/Unmap → 바뀐 바이트 범위만 */
+	CMD_CLEAR_STATE,
+	CMD_SET_STATE,      /* context 상태 스냅샷 (FinishCommandList 복원용) */
+	CMD_EXECUTE,        /* 중첩 ExecuteCommandList */
+};
+
+struct d3d_cmd {
+	uint32_t type;      /* enum d3d_cmd_type */
+	uint32_t u[4];      /* 정수 인자 (슬롯, 개수, 포맷, 플래그) */
+	int32_t i;          /* 부호 있는 인자 (BaseVertexLocation) */
+	uint32_t data;      /* data 영역 오프셋 */
+	void *h[2];         /* 핸들 인자 */
+	float f[4];         /* 색, 깊이, blend factor */
+};
+
+#define CMD_MAX_MAPS 16       /* 비동기 기록기가 남겨 두는 Map 스테이징 수 */
+#define ASYNC_BATCH_DRAWS 32  /* 비동기 모드 제출 단위 (Draw 수) */
+
+struct cmd_recorder {
+	struct d3d_cmd *cmds;
+	int count, cap;
+	uint8_t *data;
+	size_t data_size, data_cap;
+	int failed;         /* 메모리 부족 → FinishCommandList 실패 */
+	int async;          /* 비동기 immediate context의 기록기 */
+	int draws;          /* 마지막 제출 이후 기록한 Draw 수 (async) */
+
+	/* Map 스테이징 — Unmap 때 내용을 기록, 다음 Map에 다시 씀 */
+	struct cmd_staging {
+		void *resource;     /* NULL = 빈 자리 */
+		uint8_t *mem;       /* 앱이 쓰는 메모리 */
+		uint8_t *base;      /* 마지막으로 기록한 내용 (버퍼만) */
+		size_t size;
+		int mapped;         /* Map 중이면 D3D11_MAP, 아니면 0 */
+		unsigned used;      /* 마지막 Map 순번 (오래된 것부터 내보냄) */
+	} *staging;
+	int staging_count, staging_cap;
+	unsigned map_clock;
+};
+
+struct d3d11_command_list {
+	ID3D11CommandListVtbl *lpVtbl;
+	ULONG ref_count;
+	struct d3d_cmd *cmds;
+	int count;
+	uint8_t *data;
+};
+
+static struct d3d_cmd *cmd_push(struct cmd_recorder *rec, uint32_t type)
+{
+	if (rec->count == rec->cap) {
+		int cap = rec->cap ? rec->cap * 2 : 256;
+		struct d3d_cmd *nc = realloc(rec->cmds, sizeof(*nc) * cap);
+		if (!nc) { rec->failed = 1; return NULL; }
+		rec->cmds = nc;
+		rec->cap = cap;
+	}
+	struct d3d_cmd *cmd = &rec->cmds[rec->count++];
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->type = type;
+	return cmd;
+}
+
+/* data 영역에 복사 (16바이트 정렬). 반환: 오프셋, 실패 시 UINT32_MAX */
+static uint32_t cmd_push_data(struct cmd_recorder *rec,
+			      const void *src, size_t size)
+{
+	size_t off = (rec->data_size + 15) & ~(size_t)15;
+	if (off + size > UINT32_MAX) { rec->failed = 1; return UINT32_MAX; }
+	if (off + size > rec->data_cap) {
+		size_t cap = rec->data_cap ? rec->data_cap : 4096;
+		while (cap < off + size) cap *= 2;
+		uint8_t *nd = realloc(rec->data, cap);
+		if (!nd) { rec->failed = 1; return UINT32_MAX; }
+		rec->data = nd;
+		rec->data_cap = cap;
+	}
+	if (src)
+		memcpy(rec->data + off, src, size);
+	else
+		memset(rec->data + off, 0, size);
+	rec->data_size = off + size;
+	return (uint32_t)off;
+}
+
+static ULONG __attribute__((ms_abi)) cl_Release(void *This);
+
+static void cmd_free_list(struct d3d_cmd *cmds, int count, uint8_t *data)
+{
+	for (int i = 0; i < count; i++)
+		if (cmds[i].type == CMD_EXECUTE)
+			cl_Release(cmds[i].h[0]);
+	free(cmds);
+	free(data);
+}
+
+static void cmd_recorder_free(struct cmd_recorder *rec)
+{
+	cmd_free_list(rec->cmds, rec->count, rec->data);
+	for (int i = 0; i < rec->staging_count; i++) {
+		free(rec->staging[i].mem);
+		free(rec->staging[i].base);
+	}
+	free(rec->staging);
+	free(rec);
+}
+
+/* context 상태만 복사 (vtable, 참조 카운트, 기록기는 유지) */
+static void context_copy_state(struct d3d11_context *dst,
+			       const struct d3d11_context *src)
+{
+	ID3D11DeviceContextVtbl *vtbl = dst->lpVtbl;
+	ULONG ref = dst->ref_count;
+	struct cmd_recorder *rec = dst->rec;
+	/* 쿼리는 상태가 아님 */
+	struct d3d_query *occ[QUERY_MAX_OCC];
+	int nocc = dst->occ_query_count;
+	memcpy(occ, dst->occ_queries, sizeof(occ));
+	*dst = *src;
+	dst->lpVtbl = vtbl;
+	dst->ref_count = ref;
+	dst->rec = rec;
+	memcpy(dst->occ_queries, occ, sizeof(occ));
+	dst->occ_query_count = nocc;
+	dst->pipe_dirty = PIPE_DIRTY_ALL;
+}
+
+/* ---- command list 객체 ---- */
+
+static HRESULT __attribute__((ms_abi))
+cl_QueryInterface(void *This, REFIID riid, void **ppv)
+{ (void)riid; if (!ppv) return E_POINTER; *ppv = This; return S_OK; }
+/* 앱 스레드와 렌더 스레드(비동기 모드)가 함께 참조하므로 atomic */
+static ULONG __attribute__((ms_abi))
+cl_AddRef(void *This)
+{
+	struct d3d11_command_list *l = This;
+	return __atomic_add_fetch(&l->ref_count, 1, __ATOMIC_RELAXED);
+}
+static ULONG __attribute__((ms_abi))
+cl_Release(void *This)
+{
+	struct d3d11_command_list *l = This;
+	ULONG r = __atomic_sub_fetch(&l->ref_count, 1, __ATOMIC_ACQ_REL);
+	if (r == 0) {
+		cmd_free_list(l->cmds, l->count, l->data);
+		free(l);
+	}
+	return r;
+}
+static UINT __attribute__((ms_abi))
+cl_GetContextFlags(void *This) { (void)This; return 0; }
+
+static ID3D11CommandListVtbl g_command_list_vtbl = {
+	.QueryInterface          = cl_QueryInterface,
+	.AddRef                  = cl_AddRef,
+	.Release                 = cl_Release,
+	.GetDevice               = ctx_GetDevice,
+	.GetPrivateData          = ctx_GetPrivateData,
+	.SetPrivateData          = ctx_SetPrivateData,
+	.SetPrivateDataInterface = ctx_SetPrivateDataInterface,
+	.GetContextFlags         = cl_GetContextFlags,
+};
+
+/* ---- 재생 (immediate context) ---- */
+
+static void cmd_replay(struct d3d11_context *c,
+		       const struct d3d11_command_list *l)
+{
+	for (int n = 0; n < l->count; n++) {
+		const struct d3d_cmd *cmd = &l->cmds[n];
+		const uint8_t *data = l->data ? l->data + cmd->data : NULL;
+		void *const *slots = (void *const *)data;
+
+		switch (cmd->type) {
+		case CMD_VS_SET_CB:
+			ctx_VSSetConstantBuffers(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_PS_SET_CB:
+			ctx_PSSetConstantBuffers(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_PS_SET_SRV:
+			ctx_PSSetShaderResources(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_PS_SET_SAMPLER:
+			ctx_PSSetSamplers(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_VS_SET_SHADER:
+			ctx_VSSetShader(c, cmd->h[0], NULL, 0);
+			break;
+		case CMD_PS_SET_SHADER:
+			ctx_PSSetShader(c, cmd->h[0], NULL, 0);
+			break;
+		case CMD_IA_SET_LAYOUT:
+			ctx_IASetInputLayout(c, cmd->h[0]);
+			break;
+		case CMD_IA_SET_VB:
+			ctx_IASetVertexBuffers(c, cmd->u[2], 1, &cmd->h[0],
+					       &cmd->u[0], &cmd->u[1]);
+			break;
+		case CMD_IA_SET_IB:
+			ctx_IASetIndexBuffer(c, cmd->h[0],
+					     (DXGI_FORMAT)cmd->u[0], cmd->u[1]);
+			break;
+		case CMD_IA_SET_TOPOLOGY:
+			ctx_IASetPrimitiveTopology(c,
+				(D3D11_PRIMITIVE_TOPOLOGY)cmd->u[0]);
+			break;
+		case CMD_OM_SET_RT:
+			ctx_OMSetRenderTargets(c, cmd->u[0], &cmd->h[0], cmd->h[1]);
+			break;
+		case CMD_OM_SET_DS_STATE:
+			ctx_OMSetDepthStencilState(c, cmd->h[0], cmd->u[0]);
+			break;
+		case CMD_OM_SET_BLEND:
+			ctx_OMSetBlendState(c, cmd->h[0], cmd->f, cmd->u[0]);
+			break;
+		case CMD_RS_SET_STATE:
+			ctx_RSSetState(c, cmd->h[0]);
+			break;
+		case CMD_RS_SET_VIEWPORT:
+			ctx_RSSetViewports(c, cmd->u[0],
+				(const D3D11_VIEWPORT *)data);
+			break;
+		case CMD_RS_SET_SCISSOR:
+			ctx_RSSetScissorRects(c, cmd->u[0],
+				cmd->u[0] ? (const D3D11_RECT *)data : NULL);
+			break;
+		case CMD_CLEAR_RTV:
+			ctx_ClearRenderTargetView(c, cmd->h[0], cmd->f);
+			break;
+		case CMD_CLEAR_DSV:
+			ctx_ClearDepthStencilView(c, cmd->h[0], cmd->u[0],
+						  cmd->f[0], (uint8_t)cmd->u[1]);
+			break;
+		case CMD_GENERATE_MIPS:
+			ctx_GenerateMips(c, cmd->h[0]);
+			break;
+		case CMD_CS_SET_CB:
+			ctx_CSSetConstantBuffers(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_CS_SET_SRV:
+			ctx_CSSetShaderResources(c, cmd->u[0], cmd->u[1], slots);
+			break;
+		case CMD_CS_SET_UAV:
+			ctx_CSSetUnorderedAccessViews(c, cmd->u[0], cmd->u[1],
+						      slots, NULL);
+			break;
+		case CMD_CS_SET_SHADER:
+			ctx_CSSetShader(c, cmd->h[0], NULL, 0);
+			break;
+		case CMD_DISPATCH:
+			ctx_Dispatch(c, cmd->u[0], cmd->u[1], cmd->u[2]);
+			break;
+		case CMD_COPY_RESOURCE:
+			ctx_CopyResource(c, cmd->h[0], cmd->h[1]);
+			break;
+		case CMD_QUERY_BEGIN:
+			ctx_Begin(c, cmd->h[0]);
+			break;
+		case CMD_QUERY_END:
+			ctx_End(c, cmd->h[0]);
+			break;
+		case CMD_SET_PREDICATION:
+			ctx_SetPredication(c, cmd->h[0], (BOOL)cmd->u[0]);
+			break;
+		case CMD_DRAW:
+			ctx_Draw(c, cmd->u[0], cmd->u[1]);
+			break;
+		case CMD_DRAW_INDEXED:
+			ctx_DrawIndexed(c, cmd->u[0], cmd->u[1], cmd->i);
+			break;
+		case CMD_DRAW_INSTANCED:
+			ctx_DrawInstanced(c, cmd->u[0], cmd->u[1], cmd->u[2],
+					  cmd->u[3]);
+			break;
+		case CMD_DRAW_INDEXED_INSTANCED:
+			ctx_DrawIndexedInstanced(c, cmd->u[0], cmd->u[1],
+						 cmd->u[2], cmd->i, cmd->u[3]);
+			break;
+		case CMD_UPDATE: {
+			/* i = 1이면 u[] = 상자, data는 행 간격 없이 기록됨 */
+			D3D11_BOX box = { cmd->u[0], cmd->u[1], 0,
+					  cmd->u[2], cmd->u[3], 1 };
+			ctx_UpdateSubresource(c, cmd->h[0], 0,
+					      cmd->i ? &box : NULL, data, 0, 0);
+			break;
+		}
+		case CMD_MAP_WRITE: {
+			/* u[0] = D3D11_MAP, data = 바이트 u[1]부터 u[2]개 */
+			D3D11_MAPPED_SUBRESOURCE m;
+			if (ctx_Map(c, cmd->h[0], 0, cmd->u[0], 0, &m) == S_OK)
+				memcpy((uint8_t *)m.pData + cmd->u[1], data,
+				       cmd->u[2]);
+			break;
+		}
+		case CMD_CLEAR_STATE:
+			ctx_ClearState(c);
+			break;
+		case CMD_SET_STATE:
+			context_copy_state(c,
+				(const struct d3d11_context *)data);
+			break;
+		case CMD_EXECUTE:
+			ctx_ExecuteCommandList(c, cmd->h[0], (BOOL)cmd->u[0]);
+			break;
+		}
+	}
+}
+
+static void __attribute__((ms_abi))
+ctx_ExecuteCommandList(void *This, void *pCommandList,
+		       BOOL RestoreContextState)
+{
+	struct d3d11_context *c = This;
+	const struct d3d11_command_list *l = pCommandList;
+	if (!l) return;
+
+	/* command list는 항상 기본 상태에서 시작 */
+	struct d3d11_context saved = *c;
+	ctx_ClearState(c);
+
+	cmd_replay(c, l);
+
+	if (RestoreContextState)
+		context_copy_state(c, &saved);
+	else
+		ctx_ClearState(c);
+}
+
+/* ---- 기록 (deferred context) ---- */
+
+/* 슬롯 배열 setter 공통: 자기 상태 갱신 + 핸들 배열 복사 */
+static void dctx_record_slots(struct d3d11_context *c, uint32_t type,
+			      UINT StartSlot, UINT Num, void *const *pp)
+{
+	if (StartSlot >= 8) return;
+	if (Num > 8 - StartSlot) Num = 8 - StartSlot;
+
+	void *handles[8] = {0};
+	for (UINT i = 0; i < Num; i++)
+		handles[i] = pp ? pp[i] : NULL;
+
+	uint32_t off = cmd_push_data(c->rec, handles, sizeof(void *) * Num);
+	if (off == UINT32_MAX) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, type);
+	if (!cmd) return;
+	cmd->u[0] = StartSlot;
+	cmd->u[1] = Num;
+	cmd->data = off;
+}
+
+static void __attribute__((ms_abi))
+dctx_VSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
+			  void *const *ppConstantBuffers)
+{
+	ctx_VSSetConstantBuffers(This, StartSlot, NumBuffers, ppConstantBuffers);
+	dctx_record_slots(This, CMD_VS_SET_CB, StartSlot, NumBuffers,
+			  ppConstantBuffers);
+}
+
+static void __attribute__((ms_abi))
+dctx_PSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
+			  void *const *ppConstantBuffers)
+{
+	ctx_PSSetConstantBuffers(This, StartSlot, NumBuffers, ppConstantBuffers);
+	dctx_record_slots(This, CMD_PS_SET_CB, StartSlot, NumBuffers,
+			  ppConstantBuffers);
+}
+
+static void __attribute__((ms_abi))
+dctx_PSSetShaderResources(void *This, UINT StartSlot, UINT NumViews,
+			  void *const *ppSRViews)
+{
+	ctx_PSSetShaderResources(This, StartSlot, NumViews, ppSRViews);
+	dctx_record_slots(This, CMD_PS_SET_SRV, StartSlot, NumViews, ppSRViews);
+}
+
+static void __attribute__((ms_abi))
+dctx_PSSetSamplers(void *This, UINT StartSlot, UINT NumSamplers,
+		   void *const *ppSamplers)
+{
+	ctx_PSSetSamplers(This, StartSlot, NumSamplers, ppSamplers);
+	dctx_record_slots(This, CMD_PS_SET_SAMPLER, StartSlot, NumSamplers,
+			  ppSamplers);
+}
+
+/* 핸들 하나짜리 명령 */
+static void dctx_record_handle(struct d3d11_context *c, uint32_t type,
+			       void *handle)
+{
+	struct d3d_cmd *cmd = cmd_push(c->rec, type);
+	if (cmd) cmd->h[0] = handle;
+}
+
+static void __attribute__((ms_abi))
+dctx_VSSetShader(void *This, void *pVS, void *const *ppCI, UINT nCI)
+{
+	ctx_VSSetShader(This, pVS, ppCI, nCI);
+	dctx_record_handle(This, CMD_VS_SET_SHADER, pVS);
+}
+
+static void __attribute__((ms_abi))
+dctx_PSSetShader(void *This, void *pPS, void *const *ppCI, UINT nCI)
+{
+	ctx_PSSetShader(This, pPS, ppCI, nCI);
+	dctx_record_handle(This, CMD_PS_SET_SHADER, pPS);
+}
+
+static void __attribute__((ms_abi))
+dctx_IASetInputLayout(void *This, void *pInputLayout)
+{
+	ctx_IASetInputLayout(This, pInputLayout);
+	dctx_record_handle(This, CMD_IA_SET_LAYOUT, pInputLayout);
+}
+
+static void __attribute__((ms_abi))
+dctx_RSSetState(void *This, void *pState)
+{
+	ctx_RSSetState(This, pState);
+	dctx_record_handle(This, CMD_RS_SET_STATE, pState);
+}
+
+static void __attribute__((ms_abi))
+dctx_IASetVertexBuffers(void *This, UINT StartSlot, UINT NumBuffers,
+			void *const *ppVertexBuffers,
+			const UINT *pStrides, const UINT *pOffsets)
+{
+	struct d3d11_context *c = This;
+	ctx_IASetVertexBuffers(c, StartSlot, NumBuffers, ppVertexBuffers,
+			       pStrides, pOffsets);
+	/* 슬롯마다 명령 하나 */
+	for (UINT i = 0; i < NumBuffers && StartSlot + i < MAX_VB_SLOTS; i++) {
+		UINT slot = StartSlot + i;
+		struct d3d_cmd *cmd = cmd_push(c->rec, CMD_IA_SET_VB);
+		if (!cmd) return;
+		cmd->h[0] = ppVertexBuffers ? ppVertexBuffers[i] : NULL;
+		cmd->u[0] = c->vb_stride[slot];
+		cmd->u[1] = c->vb_offset[slot];
+		cmd->u[2] = slot;
+	}
+}
+
+static void __attribute__((ms_abi))
+dctx_IASetIndexBuffer(void *This, void *pIndexBuffer,
+		      DXGI_FORMAT Format, UINT Offset)
+{
+	struct d3d11_context *c = This;
+	ctx_IASetIndexBuffer(c, pIndexBuffer, Format, Offset);
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_IA_SET_IB);
+	if (!cmd) return;
+	cmd->h[0] = pIndexBuffer;
+	cmd->u[0] = (uint32_t)Format;
+	cmd->u[1] = Offset;
+}
+
+static void __attribute__((ms_abi))
+dctx_IASetPrimitiveTopology(void *This, D3D11_PRIMITIVE_TOPOLOGY Topology)
+{
+	struct d3d11_context *c = This;
+	ctx_IASetPrimitiveTopology(c, Topology);
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_IA_SET_TOPOLOGY);
+	if (cmd) cmd->u[0] = (uint32_t)Topology;
+}
+
+static void __attribute__((ms_abi))
+dctx_OMSetRenderTargets(void *This, UINT NumViews,
+			void *const *ppRenderTargetViews,
+			void *pDepthStencilView)
+{
+	struct d3d11_context *c = This;
+	ctx_OMSetRenderTargets(c, NumViews, ppRenderTargetViews,
+			       pDepthStencilView);
+	/* RTV는 슬롯 0만 사용 */
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_OM_SET_RT);
+	if (!cmd) return;
+	cmd->u[0] = (ppRenderTargetViews && NumViews > 0) ? 1 : 0;
+	cmd->h[0] = cmd->u[0] ? ppRenderTargetViews[0] : NULL;
+	cmd->h[1] = pDepthStencilView;
+}
+
+static void __attribute__((ms_abi))
+dctx_OMSetDepthStencilState(void *This, void *pState, UINT StencilRef)
+{
+	struct d3d11_context *c = This;
+	ctx_OMSetDepthStencilState(c, pState, StencilRef);
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_OM_SET_DS_STATE);
+	if (!cmd) return;
+	cmd->h[0] = pState;
+	cmd->u[0] = StencilRef;
+}
+
+static void __attribute__((ms_abi))
+dctx_OMSetBlendState(void *This, void *pState,
+		     const float BlendFactor[4], UINT SampleMask)
+{
+	struct d3d11_context *c = This;
+	ctx_OMSetBlendState(c, pState, BlendFactor, SampleMask);
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_OM_SET_BLEND);
+	if (!cmd) return;
+	cmd->h[0] = pState;
+	cmd->u[0] = SampleMask;
+	if (BlendFactor)
+		memcpy(cmd->f, BlendFactor, sizeof(cmd->f));
+	else
+		cmd->f[0] = cmd->f[1] = cmd->f[2] = cmd->f[3] = 1.0f;
+}
+
+static void __attribute__((ms_abi))
+dctx_RSSetViewports(void *This, UINT NumViewports,
+		    const D3D11_VIEWPORT *pViewports)
+{
+	struct d3d11_context *c = This;
+	ctx_RSSetViewports(c, NumViewports, pViewports);
+	if (!pViewports || NumViewports == 0) return;
+	/* 뷰포트는 0번만 사용 */
+	uint32_t off = cmd_push_data(c->rec, pViewports, sizeof(*pViewports));
+	if (off == UINT32_MAX) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_RS_SET_VIEWPORT);
+	if (!cmd) return;
+	cmd->u[0] = 1;
+	cmd->data = off;
+}
+
+static void __attribute__((ms_abi))
+dctx_RSSetScissorRects(void *This, UINT NumRects, const D3D11_RECT *pRects)
+{
+	struct d3d11_context *c = This;
+	ctx_RSSetScissorRects(c, NumRects, pRects);
+	/* 시저도 0번만 사용. 개수 0 = 해제 */
+	uint32_t off = 0;
+	if (c->num_scissors > 0) {
+		off = cmd_push_data(c->rec, pRects, sizeof(*pRects));
+		if (off == UINT32_MAX) return;
+	}
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_RS_SET_SCISSOR);
+	if (!cmd) return;
+	cmd->u[0] = c->num_scissors > 0;
+	cmd->data = off;
+}
+
+static void __attribute__((ms_abi))
+dctx_ClearRenderTargetView(void *This, void *pRenderTargetView,
+			   const float ColorRGBA[4])
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_CLEAR_RTV);
+	if (!cmd) return;
+	cmd->h[0] = pRenderTargetView;
+	memcpy(cmd->f, ColorRGBA, sizeof(cmd->f));
+}
+
+static void __attribute__((ms_abi))
+dctx_GenerateMips(void *This, void *pShaderResourceView)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_GENERATE_MIPS);
+	if (!cmd) return;
+	cmd->h[0] = pShaderResourceView;
+}
+
+static void __attribute__((ms_abi))
+dctx_ClearDepthStencilView(void *This, void *pDSView,
+			   UINT ClearFlags, float Depth, uint8_t Stencil)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_CLEAR_DSV);
+	if (!cmd) return;
+	cmd->h[0] = pDSView;
+	cmd->u[0] = ClearFlags;
+	cmd->u[1] = Stencil;
+	cmd->f[0] = Depth;
+}
+
+static void async_submit(struct d3d11_context *c);
+
+/* 비동기 immediate context는 Draw가 일정 수 쌓이면 렌더 스레드로 넘김 */
+static void dctx_draw_recorded(struct d3d11_context *c)
+{
+	if (c->rec->async && ++c->rec->draws >= ASYNC_BATCH_DRAWS)
+		async_submit(c);
+}
+
+static void __attribute__((ms_abi))
+dctx_Draw(void *This, UINT VertexCount, UINT StartVertexLocation)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_DRAW);
+	if (!cmd) return;
+	cmd->u[0] = VertexCount;
+	cmd->u[1] = StartVertexLocation;
+	dctx_draw_recorded(c);
+}
+
+static void __attribute__((ms_abi))
+dctx_DrawIndexed(void *This, UINT IndexCount,
+		 UINT StartIndexLocation, int BaseVertexLocation)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_DRAW_INDEXED);
+	if (!cmd) return;
+	cmd->u[0] = IndexCount;
+	cmd->u[1] = StartIndexLocation;
+	cmd->i = BaseVertexLocation;
+	dctx_draw_recorded(c);
+}
+
+static void __attribute__((ms_abi))
+dctx_DrawInstanced(void *This, UINT VertexCountPerInstance,
+		   UINT InstanceCount, UINT StartVertexLocation,
+		   UINT StartInstanceLocation)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_DRAW_INSTANCED);
+	if (!cmd) return;
+	cmd->u[0] = VertexCountPerInstance;
+	cmd->u[1] = InstanceCount;
+	cmd->u[2] = StartVertexLocation;
+	cmd->u[3] = StartInstanceLocation;
+	dctx_draw_recorded(c);
+}
+
+static void __attribute__((ms_abi))
+dctx_DrawIndexedInstanced(void *This, UINT IndexCountPerInstance,
+			  UINT InstanceCount, UINT StartIndexLocation,
+			  int BaseVertexLocation, UINT StartInstanceLocation)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_DRAW_INDEXED_INSTANCED);
+	if (!cmd) return;
+	cmd->u[0] = IndexCountPerInstance;
+	cmd->u[1] = InstanceCount;
+	cmd->u[2] = StartIndexLocation;
+	cmd->u[3] = StartInstanceLocation;
+	cmd->i = BaseVertexLocation;
+	dctx_draw_recorded(c);
+}
+
+static void __attribute__((ms_abi))
+dctx_CSSetShader(void *This, void *pCS, void *const *ppCI, UINT nCI)
+{
+	ctx_CSSetShader(This, pCS, ppCI, nCI);
+	dctx_record_handle(This, CMD_CS_SET_SHADER, pCS);
+}
+
+static void __attribute__((ms_abi))
+dctx_CSSetConstantBuffers(void *This, UINT StartSlot, UINT NumBuffers,
+			  void *const *ppConstantBuffers)
+{
+	ctx_CSSetConstantBuffers(This, StartSlot, NumBuffers, ppConstantBuffers);
+	dctx_record_slots(This, CMD_CS_SET_CB, StartSlot, NumBuffers,
+			  ppConstantBuffers);
+}
+
+static void __attribute__((ms_abi))
+dctx_CSSetShaderResources(void *This, UINT StartSlot, UINT NumViews,
+			  void *const *ppSRViews)
+{
+	ctx_CSSetShaderResources(This, StartSlot, NumViews, ppSRViews);
+	dctx_record_slots(This, CMD_CS_SET_SRV, StartSlot, NumViews, ppSRViews);
+}
+
+static void __attribute__((ms_abi))
+dctx_CSSetUnorderedAccessViews(void *This, UINT StartSlot, UINT NumUAVs,
+			       void *const *ppUAViews,
+			       const UINT *pUAVInitialCounts)
+{
+	ctx_CSSetUnorderedAccessViews(This, StartSlot, NumUAVs, ppUAViews,
+				      pUAVInitialCounts);
+	dctx_record_slots(This, CMD_CS_SET_UAV, StartSlot, NumUAVs, ppUAViews);
+}
+
+/* Dispatch도 비동기 모드 제출 단위에 Draw처럼 센다 */
+static void __attribute__((ms_abi))
+dctx_Dispatch(void *This, UINT X, UINT Y, UINT Z)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_DISPATCH);
+	if (!cmd) return;
+	cmd->u[0] = X;
+	cmd->u[1] = Y;
+	cmd->u[2] = Z;
+	dctx_draw_recorded(c);
+}
+
+/*
+ * 쿼리는 실행될 때 결과가 정해짐. 비동기 모드에서는 렌더 스레드가
+ * 아직 실행하지 않은 쿼리를 GetData가 이전 결과로 읽지 않도록
+ * 기록 시점에 done을 내림.
+ */
+static void dctx_record_query(struct d3d11_context *c, uint32_t type,
+			      void *pAsync)
+{
+	int idx = handle_to_query_idx(pAsync);
+	if (idx < 0) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, type);
+	if (!cmd) return;
+	cmd->h[0] = pAsync;
+	if (c->rec->async)
+		__atomic_store_n(&query_at(idx)->done, 0, __ATOMIC_RELAXED);
+}
+
+static void __attribute__((ms_abi))
+dctx_Begin(void *This, void *pAsync)
+{
+	struct d3d11_context *c = This;
+	int idx = handle_to_query_idx(pAsync);
+	/* End만 있는 쿼리의 Begin은 기록하지 않음 (ctx_Begin과 같음) */
+	if (idx < 0 || query_at(idx)->type == D3D11_QUERY_EVENT ||
+	    query_at(idx)->type == D3D11_QUERY_TIMESTAMP)
+		return;
+	dctx_record_query(c, CMD_QUERY_BEGIN, pAsync);
+}
+
+static void __attribute__((ms_abi))
+dctx_End(void *This, void *pAsync)
+{
+	dctx_record_query(This, CMD_QUERY_END, pAsync);
+}
+
+static void __attribute__((ms_abi))
+dctx_SetPredication(void *This, void *pPredicate, BOOL PredicateValue)
+{
+	struct d3d11_context *c = This;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_SET_PREDICATION);
+	if (!cmd) return;
+	cmd->h[0] = pPredicate;
+	cmd->u[0] = (uint32_t)PredicateValue;
+	/* GetPredication용 */
+	ctx_SetPredication(c, pPredicate, PredicateValue);
+}
+
+/*
+ * Map 스테이징
+ * ============
+ *
+ * 리소스마다 임시 메모리를 Unmap 뒤에도 남겨 두고 다음 Map에 다시 준다.
+ * 버퍼는 base에 마지막으로 기록한 내용을 두고, NO_OVERWRITE Unmap 때
+ * base와 다른 바이트 범위만 기록한다 — 큰 동적 VB에 정점 몇 개를
+ * 덧붙일 때 버퍼 전체를 명령 버퍼로 복사하지 않도록.
+ *
+ * base는 재생 시점의 내용과 같아야 한다. deferred context에서는 D3D11
+ * 규칙상 command list마다 DISCARD가 먼저이므로 스테이징을 list 동안
+ * 모두 유지하고 FinishCommandList에서 버린다. 비동기 기록기는
+ * CMD_MAX_MAPS개만 남기고, 내보낸 리소스의 NO_OVERWRITE는 렌더 스레드와
+ * 동기화한 뒤 현재 내용으로 다시 만든다 (async_Map).
+ * 기록기 밖에서 내용이 바뀌면 (UpdateSubresource, CopyResource,
+ * 동기 Map) 스테이징을 버린다.
+ */
+static struct cmd_staging *cmd_staging_find(struct cmd_recorder *rec,
+					    void *resource)
+{
+	for (int i = 0; i < rec->staging_count; i++)
+		if (rec->staging[i].resource == resource)
+			return &rec->staging[i];
+	return NULL;
+}
+
+static void cmd_staging_clear(struct cmd_staging *s)
+{
+	free(s->mem);
+	free(s->base);
+	memset(s, 0, sizeof(*s));
+}
+
+static void cmd_staging_drop(struct cmd_recorder *rec, void *resource)
+{
+	struct cmd_staging *s = cmd_staging_find(rec, resource);
+	if (s && !s->mapped)
+		cmd_staging_clear(s);
+}
+
+/* Map 중이 아닌 스테이징을 모두 버림 */
+static void cmd_staging_drop_all(struct cmd_recorder *rec)
+{
+	for (int i = 0; i < rec->staging_count; i++)
+		if (!rec->staging[i].mapped)
+			cmd_staging_clear(&rec->staging[i]);
+}
+
+/* 새 스테이징 자리: 빈 자리, 늘린 자리, (비동기) 가장 오래된 자리 순 */
+static struct cmd_staging *cmd_staging_slot(struct cmd_recorder *rec)
+{
+	struct cmd_staging *s = NULL;
+	for (int i = 0; i < rec->staging_count; i++) {
+		struct cmd_staging *t = &rec->staging[i];
+		if (!t->resource)
+			return t;
+		if (!t->mapped && (!s || t->used < s->used))
+			s = t;
+	}
+	if (s && rec->async && rec->staging_count >= CMD_MAX_MAPS) {
+		cmd_staging_clear(s);
+		return s;
+	}
+	if (rec->staging_count == rec->staging_cap) {
+		int cap = rec->staging_cap ? rec->staging_cap * 2 : 8;
+		struct cmd_staging *ns =
+			realloc(rec->staging, sizeof(*ns) * cap);
+		if (!ns) return NULL;
+		rec->staging = ns;
+		rec->staging_cap = cap;
+	}
+	s = &rec->staging[rec->staging_count++];
+	memset(s, 0, sizeof(*s));
+	return s;
+}
+
+/* resource의 스테이징. 없으면 만듦, Map 중이거나 메모리 부족이면 NULL */
+static struct cmd_staging *cmd_staging_get(struct cmd_recorder *rec,
+					   void *resource,
+					   const struct d3d_resource *r,
+					   D3D11_MAP type)
+{
+	struct cmd_staging *s = cmd_staging_find(rec, resource);
+	if (s) return s->mapped ? NULL : s;
+
+	s = cmd_staging_slot(rec);
+	if (!s) return NULL;
+	s->mem = malloc(r->size);
+	if (r->type == D3D_RES_BUFFER)
+		s->base = malloc(r->size);
+	if (!s->mem || (r->type == D3D_RES_BUFFER && !s->base)) {
+		cmd_staging_clear(s);
+		return NULL;
+	}
+	/* NO_OVERWRITE는 기존 내용 위에 일부만 쓰므로 현재 내용으로 시작 */
+	if (type == D3D11_MAP_WRITE_NO_OVERWRITE) {
+		memcpy(s->mem, r->data, r->size);
+		if (s->base)
+			memcpy(s->base, r->data, r->size);
+	}
+	s->resource = resource;
+	s->size = r->size;
+	return s;
+}
+
+/* mem과 base가 다른 바이트 범위 [*lo, *hi). 같으면 *lo == *hi */
+static void cmd_staging_diff(const struct cmd_staging *s,
+			     size_t *lo, size_t *hi)
+{
+	enum { STEP = 256 };
+	size_t a = 0, b = s->size;
+	while (b - a >= STEP && !memcmp(s->mem + a, s->base + a, STEP))
+		a += STEP;
+	while (a < b && s->mem[a] == s->base[a])
+		a++;
+	while (b - a >= STEP &&
+	       !memcmp(s->mem + b - STEP, s->base + b - STEP, STEP))
+		b -= STEP;
+	while (b > a && s->mem[b - 1] == s->base[b - 1])
+		b--;
+	*lo = a;
+	*hi = b;
+}
+
+static void __attribute__((ms_abi))
+dctx_CopyResource(void *This, void *pDstResource, void *pSrcResource)
+{
+	struct d3d11_context *c = This;
+	cmd_staging_drop(c->rec, pDstResource);
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_COPY_RESOURCE);
+	if (!cmd) return;
+	cmd->h[0] = pDstResource;
+	cmd->h[1] = pSrcResource;
+}
+
+/* 텍스처 전체 내용을 CMD_UPDATE로 기록 */
+static void dctx_record_update(struct d3d11_context *c, void *resource,
+			       const void *src, size_t size)
+{
+	uint32_t off = cmd_push_data(c->rec, src, size);
+	if (off == UINT32_MAX) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_UPDATE);
+	if (!cmd) return;
+	cmd->h[0] = resource;
+	cmd->data = off;
+}
+
+static void __attribute__((ms_abi))
+dctx_UpdateSubresource(void *This, void *pDstResource, UINT DstSubresource,
+		       void *pDstBox, const void *pSrcData,
+		       UINT SrcRowPitch, UINT SrcDepthPitch)
+{
+	struct d3d11_context *c = This;
+	const D3D11_BOX *box = pDstBox;
+	(void)DstSubresource; (void)SrcDepthPitch;
+	if (!pSrcData) return;
+
+	int idx = handle_to_resource_idx(pDstResource);
+	if (idx < 0) return;
+	struct d3d_resource *r = resource_at(idx);
+	struct update_region u;
+	if (!r->data || update_region_of(r, box, &u) < 0) return;
+	cmd_staging_drop(c->rec, pDstResource);
+
+	/* 앱 메모리에서는 상자 영역만 읽어 행 간격 없이 기록 */
+	size_t src_pitch = SrcRowPitch ? SrcRowPitch : u.row_bytes;
+	uint32_t off = cmd_push_data(c->rec, NULL, u.row_bytes * u.rows);
+	if (off == UINT32_MAX) return;
+	for (UINT y = 0; y < u.rows; y++)
+		memcpy(c->rec->data + off + y * u.row_bytes,
+		       (const uint8_t *)pSrcData + y * src_pitch, u.row_bytes);
+
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_UPDATE);
+	if (!cmd) return;
+	cmd->h[0] = pDstResource;
+	cmd->data = off;
+	if (box) {
+		cmd->i = 1;
+		cmd->u[0] = box->left;
+		cmd->u[1] = box->top;
+		cmd->u[2] = box->right;
+		cmd->u[3] = box->bottom;
+	}
+}
+
+/*
+ * Deferred Map — WRITE_DISCARD / WRITE_NO_OVERWRITE만 허용 (D3D11 규칙).
+ * 앱에는 스테이징 메모리를 주고 Unmap 때 그 내용을 기록한다:
+ * 텍스처는 CMD_UPDATE로 전체, 버퍼는 CMD_MAP_WRITE로 같은 MapType을
+ * 재생 (DISCARD는 전체, NO_OVERWRITE는 바뀐 범위만).
+ */
+static HRESULT __attribute__((ms_abi))
+dctx_Map(void *This, void *pResource, UINT Subresource,
+	 D3D11_MAP MapType, UINT MapFlags,
+	 D3D11_MAPPED_SUBRESOURCE *pMapped)
+{
+	struct d3d11_context *c = This;
+	(void)Subresource; (void)MapFlags;
+	if (!pMapped) return E_POINTER;
+	if (MapType != D3D11_MAP_WRITE_DISCARD &&
+	    MapType != D3D11_MAP_WRITE_NO_OVERWRITE)
+		return E_INVALIDARG;
+
+	int idx = handle_to_resource_idx(pResource);
+	if (idx < 0) return E_INVALIDARG;
+	struct d3d_resource *r = resource_at(idx);
+	if (!r->data) return E_INVALIDARG;
+
+	struct cmd_staging *s = cmd_staging_get(c->rec, pResource, r, MapType);
+	if (!s) return E_OUTOFMEMORY;
+	s->mapped = MapType;
+	s->used = ++c->rec->map_clock;
+
+	pMapped->pData = s->mem;
+	pMapped->RowPitch = resource_row_pitch(r);
+	pMapped->DepthPitch = 0;
+	return S_OK;
+}
+
+static void __attribute__((ms_abi))
+dctx_Unmap(void *This, void *pResource, UINT Subresource)
+{
+	struct d3d11_context *c = This;
+	(void)Subresource;
+
+	struct cmd_staging *s = cmd_staging_find(c->rec, pResource);
+	if (!s || !s->mapped) return;
+	D3D11_MAP type = s->mapped;
+	s->mapped = 0;
+
+	if (!s->base) {
+		dctx_record_update(c, pResource, s->mem, s->size);
+		return;
+	}
+
+	size_t lo = 0, hi = s->size;
+	if (type == D3D11_MAP_WRITE_NO_OVERWRITE)
+		cmd_staging_diff(s, &lo, &hi);
+	if (lo == hi) return;
+
+	uint32_t off = cmd_push_data(c->rec, s->mem + lo, hi - lo);
+	if (off == UINT32_MAX) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_MAP_WRITE);
+	if (!cmd) return;
+	cmd->h[0] = pResource;
+	cmd->u[0] = (uint32_t)type;
+	cmd->u[1] = (uint32_t)lo;
+	cmd->u[2] = (uint32_t)(hi - lo);
+	cmd->data = off;
+	memcpy(s->base + lo, s->mem + lo, hi - lo);
+}
+
+static void __attribute__((ms_abi))
+dctx_ClearState(void *This)
+{
+	struct d3d11_context *c = This;
+	ctx_ClearState(c);
+	cmd_push(c->rec, CMD_CLEAR_STATE);
+}
+
+static void __attribute__((ms_abi))
+dctx_Flush(void *This)
+{ (void)This; }
+
+static void __attribute__((ms_abi))
+dctx_ExecuteCommandList(void *This, void *pCommandList,
+			BOOL RestoreContextState)
+{
+	struct d3d11_context *c = This;
+	if (!pCommandList) return;
+	struct d3d_cmd *cmd = cmd_push(c->rec, CMD_EXECUTE);
+	if (!cmd) return;
+	cl_AddRef(pCommandList);
+	cmd->h[0] = pCommandList;
+	cmd->u[0] = (uint32_t)RestoreContextState;
+	/* 재생 후 상태와 맞춤 — 복원하지 않으면 기본 상태 */
+	if (!RestoreContextState)
+		ctx_ClearState(c);
+}
+
+/* 기록 버퍼 비우기 (메모리는 넘겨졌거나 해제된 상태) */
+static void cmd_recorder_reset(struct cmd_recorder *rec)
+{
+	rec->cmds = NULL;
+	rec->data = NULL;
+	rec->count = rec->cap = 0;
+	rec->data_size = rec->data_cap = 0;
+	rec->draws = 0;
+}
+
+/* 기록한 명령을 새 command list로 넘김. 메모리 부족이면 NULL (기록 유지) */
+static struct d3d11_command_list *cmd_recorder_take(struct cmd_recorder *rec)
+{
+	struct d3d11_command_list *l = calloc(1, sizeof(*l));
+	if (!l) return NULL;
+	l->lpVtbl = &g_command_list_vtbl;
+	l->ref_count = 1;
+	l->cmds = rec->cmds;
+	l->count = rec->count;
+	l->data = rec->data;
+	cmd_recorder_reset(rec);
+	return l;
+}
+
+/*
+ * FinishCommandList — 지금까지 기록한 명령을 command list로 넘김.
+ * RestoreDeferredContextState면 현재 상태를 다음 command list의
+ * 시작에 CMD_SET_STATE로 넣어 이어서 기록할 수 있게 한다.
+ */
+static HRESULT __attribute__((ms_abi))
+dctx_FinishCommandList(void *This, BOOL RestoreDeferredContextState,
+		       void **ppCommandList)
+{
+	struct d3d11_context *c = This;
+	struct cmd_recorder *rec = c->rec;
+
+	if (rec->failed) {
+		rec->failed = 0;
+		cmd_free_list(rec->cmds, rec->count, rec->data);
+		cmd_recorder_reset(rec);
+		cmd_staging_drop_all(rec);
+		return E_OUTOFMEMORY;
+	}
+
+	if (ppCommandList) {
+		struct d3d11_command_list *l = cmd_recorder_take(rec);
+		if (!l) return E_OUTOFMEMORY;
+		*ppCommandList = l;
+	} else {
+		cmd_free_list(rec->cmds, rec->count, rec->data);
+		cmd_recorder_reset(rec);
+	}
+	/* 다음 command list는 DISCARD부터 다시 시작 */
+	cmd_staging_drop_all(rec);
+
+	if (RestoreDeferredContextState) {
+		uint32_t off = cmd_push_data(rec, c, sizeof(*c));
+		if (off != UINT32_MAX) {
+			struct d3d_cmd *cmd = cmd_push(rec, CMD_SET_STATE);
+			if (cmd) cmd->data = off;
+		}
+	} else {
+		ctx_ClearState(c);
+	}
+	return S_OK;
+}
+
+/* Deferred context vtable — immediate vtable에서 기록 메서드만 교체 */
+static ID3D11DeviceContextVtbl g_deferred_vtbl;
+
+static void deferred_vtbl_init(void)
+{
+	ID3D11DeviceContextVtbl *v = &g_deferred_vtbl;
+	if (v->QueryInterface) return;
+	*v = g_context_vtbl;
+	v->VSSetConstantBuffers   = dctx_VSSetConstantBuffers;
+	v->PSSetShaderResources   = dctx_PSSetShaderResources;
+	v->PSSetShader            = dctx_PSSetShader;
+	v->PSSetSamplers          = dctx_PSSetSamplers;
+	v->VSSetShader            = dctx_VSSetShader;
+	v->DrawIndexed            = dctx_DrawIndexed;
+	v->Draw                   = dctx_Draw;
+	v->DrawIndexedInstanced   = dctx_DrawIndexedInstanced;
+	v->DrawInstanced          = dctx_DrawInstanced;
+	v->Map                    = dctx_Map;
+	v->Unmap                  = dctx_Unmap;
+	v->PSSetConstantBuffers   = dctx_PSSetConstantBuffers;
+	v->IASetInputLayout       = dctx_IASetInputLayout;
+	v->IASetVertexBuffers     = dctx_IASetVertexBuffers;
+	v->IASetIndexBuffer       = dctx_IASetIndexBuffer;
+	v->IASetPrimitiveTopology = dctx_IASetPrimitiveTopology;
+	v->OMSetRenderTargets     = dctx_OMSetRenderTargets;
+	v->OMSetBlendState        = dctx_OMSetBlendState;
+	v->OMSetDepthStencilState = dctx_OMSetDepthStencilState;
+	v->RSSetState             = dctx_RSSetState;
+	v->RSSetViewports         = dctx_RSSetViewports;
+	v->RSSetScissorRects      = dctx_RSSetScissorRects;
+	v->UpdateSubresource      = dctx_UpdateSubresource;
+	v->ClearRenderTargetView  = dctx_ClearRenderTargetView;
+	v->ClearDepthStencilView  = dctx_ClearDepthStencilView;
+	v->GenerateMips           = dctx_GenerateMips;
+	v->CSSetShader            = dctx_CSSetShader;
+	v->CSSetConstantBuffers   = dctx_CSSetConstantBuffers;
+	v->CSSetShaderResources   = dctx_CSSetShaderResources;
+	v->CSSetUnorderedAccessViews = dctx_CSSetUnorderedAccessViews;
+	v->Dispatch               = dctx_Dispatch;
+	v->CopyResource           = dctx_CopyResource;
+	v->Begin                  = dctx_Begin;
+	v->End                    = dctx_End;
+	v->SetPredication         = dctx_SetPredication;
+	v->ExecuteCommandList     = dctx_ExecuteCommandList;
+	v->ClearState             = dctx_ClearState;
+	v->Flush                  = dctx_Flush;
+	v->FinishCommandList      = dctx_FinishCommandList;
+}
+
+static HRESULT __attribute__((ms_abi))
+dev_CreateDeferredContext(void *This, UINT ContextFlags, void **ppContext)
+{
+	(void)This; (void)ContextFlags;
+	if (!ppContext) return E_INVALIDARG;
+
+	deferred_vtbl_init();
+
+	struct d3d11_context *c = calloc(1, sizeof(*c));
+	if (!c) return E_OUTOFMEMORY;
+	c->rec = calloc(1, sizeof(*c->rec));
+	if (!c->rec) { free(c); return E_OUTOFMEMORY; }
+	c->lpVtbl = &g_deferred_vtbl;
+	c->ref_count = 1;
+	ctx_ClearState(c);
+
+	*ppContext = c;
+	return S_OK;
+}
+
+/* ============================================================
+ * 비동기 렌더 스레드 (immediate context)
+ * ============================================================
+ *
+ * CITC_D3D11_ASYNC=1 이면 immediate context도 deferred context처럼
+ * 호출을 기록만 하고, ASYNC_BATCH_DRAWS개 Draw마다 (또는 Flush 때)
+ * command list로 묶어 렌더 스레드 큐에 넣는다. 렌더 스레드는 자기
+ * context(g_async.ctx)에 상태를 이어 가며 재생하므로 VS, 비닝,
+ * 래스터라이징이 모두 앱 스레드의 게임 로직과 겹쳐 실행된다.
+ *
+ * 데이터는 기록 시점에 복사된다:
+ *   - Set* 인자는 핸들 값 그대로 (뷰/상태/셰이더 객체는 생성 후 불변)
+ *   - Map(WRITE_DISCARD / 버퍼 NO_OVERWRITE)/UpdateSubresource 내용은
+ *     명령 버퍼로 복사 (NO_OVERWRITE는 바뀐 범위만)
+ *     → 앱이 다음 프레임에 CB를 다시 써도 큐에 남은 Draw는 예전 내용을 봄
+ *
+ * 동기화 지점 (큐가 빌 때까지 대기):
+ *   d3d11_flush (Present 등), 읽기 Map (readback, 렌더 타깃 읽기),
+ *   그 밖의 텍스처 Map, SwapChain 버퍼 재할당.
+ *
+ * 큐는 단일 생산자(앱)/단일 소비자(렌더 스레드) 링 버퍼.
+ * 인덱스는 atomic이라 평소에는 락이 없고, 큐가 비었거나 가득 차서
+ * 한쪽이 잠들어야 할 때만 mutex/cond를 쓴다.
+ */
+#define ASYNC_QUEUE_SIZE 64   /* 2의 거듭제곱 */
+
+static struct {
+	int enabled;
+	pthread_t thread;
+	struct d3d11_context *ctx;    /* 렌더 스레드 전용 context */
+
+	struct d3d11_command_list *ring[ASYNC_QUEUE_SIZE];
+	unsigned head;                /* 다음에 실행할 항목 (렌더 스레드가 증가) */
+	unsigned tail;                /* 다음에 넣을 자리 (앱 스레드가 증가) */
+
+	int waiting;                  /* cond에서 잠든 스레드 수 */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} g_async = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int async_has_work(void)
+{
+	return __atomic_load_n(&g_async.head, __ATOMIC_SEQ_CST) !=
+	       __atomic_load_n(&g_async.tail, __ATOMIC_SEQ_CST);
+}
+
+static int async_has_room(void)
+{
+	return __atomic_load_n(&g_async.tail, __ATOMIC_SEQ_CST) -
+	       __atomic_load_n(&g_async.head, __ATOMIC_SEQ_CST) <
+	       ASYNC_QUEUE_SIZE;
+}
+
+static int async_idle(void)
+{
+	return !async_has_work();
+}
+
+/* ready()가 참이 될 때까지 잠듦 */
+static void async_wait(int (*ready)(void))
+{
+	if (ready()) return;
+	pthread_mutex_lock(&g_async.lock);
+	__atomic_add_fetch(&g_async.waiting, 1, __ATOMIC_SEQ_CST);
+	while (!ready())
+		pthread_cond_wait(&g_async.cond, &g_async.lock);
+	__atomic_sub_fetch(&g_async.waiting, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&g_async.lock);
+}
+
+/* 인덱스를 바꾼 뒤 호출 — 잠든 쪽이 있을 때만 락을 잡음 */
+static void async_wake(void)
+{
+	if (__atomic_load_n(&g_async.waiting, __ATOMIC_SEQ_CST) == 0)
+		return;
+	pthread_mutex_lock(&g_async.lock);
+	pthread_cond_broadcast(&g_async.cond);
+	pthread_mutex_unlock(&g_async.lock);
+}
+
+static void *async_render_main(void *unused)
+{
+	(void)unused;
+	for (;;) {
+		async_wait(async_has_work);
+
+		unsigned head = __atomic_load_n(&g_async.head, __ATOMIC_SEQ_CST);
+		struct d3d11_command_list *l =
+			g_async.ring[head & (ASYNC_QUEUE_SIZE - 1)];
+
+		/* 상태를 이어 가며 재생 (ExecuteCommandList와 달리 초기화 없음) */
+		cmd_replay(g_async.ctx, l);
+		cl_Release(l);
+
+		/* 실행이 끝난 뒤에 head를 올려야 async_idle()이 완료를 뜻함 */
+		__atomic_store_n(&g_async.head, head + 1, __ATOMIC_SEQ_CST);
+		async_wake();
+	}
+	return NULL;
+}
+
+/* 기록된 명령을 렌더 스레드 큐에 넣음 (앱 스레드) */
+static void async_submit(struct d3d11_context *c)
+{
+	struct cmd_recorder *rec = c->rec;
+	if (rec->count == 0) return;
+
+	/* 메모리 부족으로 빠진 명령이 있으면 동기 재생과 달라지므로 그대로 버림 */
+	if (rec->failed) {
+		rec->failed = 0;
+		cmd_free_list(rec->cmds, rec->count, rec->data);
+		cmd_recorder_reset(rec);
+		cmd_staging_drop_all(rec);
+		return;
+	}
+
+	struct d3d11_command_list *l = cmd_recorder_take(rec);
+	if (!l) return;   /* 기록은 유지, 다음 제출 때 재시도 */
+
+	async_wait(async_has_room);
+	unsigned tail = __atomic_load_n(&g_async.tail, __ATOMIC_SEQ_CST);
+	g_async.ring[tail & (ASYNC_QUEUE_SIZE - 1)] = l;
+	__atomic_store_n(&g_async.tail, tail + 1, __ATOMIC_SEQ_CST);
+	async_wake();
+}
+
+/* 남은 기록을 제출하고 렌더 스레드가 모두 실행할 때까지 대기 */
+static void async_sync(void)
+{
+	if (!g_async.enabled) return;
+	async_submit(g_context);
+	async_wait(async_idle);
+}
+
+static HRESULT __attribute__((ms_abi))
+async_Map(void *This, void *pResource, UINT Subresource,
+	  D3D11_MAP MapType, UINT MapFlags,
+	  D3D11_MAPPED_SUBRESOURCE *pMapped)
+{
+	struct d3d11_context *c = This;
+	int idx = handle_to_resource_idx(pResource);
+
+	/* WRITE_DISCARD, 버퍼 NO_OVERWRITE는 스테이징에 쓰고 Unmap 때
+	 * 명령으로 복사. NO_OVERWRITE는 기존 내용으로 시작하므로
+	 * 스테이징이 아직 없을 때만 한 번 동기화 */
+	if (idx >= 0 && (MapType == D3D11_MAP_WRITE_DISCARD ||
+			 (MapType == D3D11_MAP_WRITE_NO_OVERWRITE &&
+			  resource_at(idx)->type == D3D_RES_BUFFER))) {
+		if (MapType == D3D11_MAP_WRITE_NO_OVERWRITE &&
+		    !cmd_staging_find(c->rec, pResource))
+			d3d11_flush();
+		return dctx_Map(This, pResource, Subresource, MapType,
+				MapFlags, pMapped);
+	}
+
+	/* 그 외 (읽기, 텍스처 등)는 현재 내용이 필요 → 동기화.
+	 * 스테이징을 거치지 않고 바뀌므로 남은 스테이징은 버림 */
+	d3d11_flush();
+	if (MapType != D3D11_MAP_READ)
+		cmd_staging_drop(c->rec, pResource);
+	return ctx_Map(This, pResource, Subresource, MapType, MapFlags,
+		       pMapped);
+}
+
+static void __attribute__((ms_abi))
+async_Flush(void *This)
+{
+	async_submit(This);
+}
+
+static ID3D11DeviceContextVtbl g_async_vtbl;
+
+/* immediate context를 비동기 모드로 전환. 실패하면 동기 모드 유지 */
+static void async_start(struct d3d11_context *c)
+{
+	const char *env = getenv("CITC_D3D11_ASYNC");
+	if (!env || strcmp(env, "1") != 0 || g_async.enabled)
+		return;
+
+	struct cmd_recorder *rec = calloc(1, sizeof(*rec));
+	struct d3d11_context *rc = calloc(1, sizeof(*rc));
+	if (!rec || !rc) goto fail;
+	rec->async = 1;
+	rc->lpVtbl = &g_context_vtbl;
+	rc->ref_count = 1;
+	ctx_ClearState(rc);
+	g_async.ctx = rc;
+
+	if (pthread_create(&g_async.thread, NULL, async_render_main, NULL) != 0)
+		goto fail;
+	pthread_detach(g_async.thread);
+
+	deferred_vtbl_init();
+	g_async_vtbl = g_deferred_vtbl;
+	g_async_vtbl.Map = async_Map;
+	g_async_vtbl.Flush = async_Flush;
+	g_async_vtbl.FinishCommandList = g_context_vtbl.FinishCommandList;
+
+	c->rec = rec;
+	c->lpVtbl = &g_async_vtbl;
+	g_async.enabled = 1;
+	return;
+
+fail:
+	free(rec);
+	free(rc);
+	g_async.ctx = NULL;
+}
+
+/* ============================================================
+ * GetImmediateContext (Device vtable에서 참조)
+ * ============================================================ */
+
 static void __attribute__((ms_abi))
 dev_GetImmediateContext(void *This, void **ppContext)
 {
@@ -2268,7 +7090,7 @@ int d3d11_register_swapchain_texture(void *pSwapChain,
 	int idx = alloc_resource();
 	if (idx < 0) return -1;
 
-	struct d3d_resource *r = &resource_table[idx];
+	struct d3d_resource *r = resource_at(idx);
 	memset(r, 0, sizeof(*r));
 	r->active = 1;
 	r->type = D3D_RES_TEXTURE2D;
@@ -2283,6 +7105,121 @@ int d3d11_register_swapchain_texture(void *pSwapChain,
 	return idx;
 }
 
+void d3d11_release_swapchain_texture(int resource_idx)
+{
+	if (resource_idx < 0 || resource_idx >= ht_count(&g_resources))
+		return;
+	struct d3d_resource *r = ht_get(&g_resources, resource_idx);
+	if (!r || !r->active || !r->is_swapchain_buffer) return;
+
+	/* bin의 Draw가 아직 이 백버퍼에 그릴 수 있음 */
+	d3d11_flush();
+	/* 슬롯이 재사용되면 같은 포인터가 다른 크기의 RT가 됨 */
+	if (g_bin.rt == r) g_bin.rt = NULL;
+	free(r->clear_tiles);
+	free(r->mip_data);
+	free_resource(resource_idx);
+}
+
+/* 동적 해상도 업스케일: 출력 행 DYNRES_JOB_ROWS개씩 워커에 나눔 */
+#define DYNRES_JOB_ROWS 32
+
+struct dynres_blit {
+	raster_upscale_fn fn;
+	uint32_t *dst;
+	int dst_pitch, dst_w, dst_h;
+	const uint32_t *src;
+	int src_pitch;
+	int src_h;                 /* 그려진 행 수 */
+	int full_h;                /* 백버퍼 높이 (출력 좌표 기준) */
+	const int32_t *xs;
+	const uint16_t *wx;
+};
+
+/* 출력 좌표 i (0..full) → 원본 왼쪽/위 인덱스와 다음 것의 가중치 */
+static void dynres_tap(int i, int full, int src, int32_t *s0, int *w)
+{
+	double u = (i + 0.5) * src / full - 0.5;
+	int f = (int)floor(u);
+	int wt = (int)((u - f) * 256.0 + 0.5);
+	if (f < 0) {
+		f = 0;
+		wt = 0;
+	} else if (f >= src - 1) {
+		f = src - 2;
+		wt = 256;
+	}
+	*s0 = f;
+	*w = wt;
+}
+
+static void dynres_blit_job(void *arg, int job)
+{
+	const struct dynres_blit *b = arg;
+	int y0 = job * DYNRES_JOB_ROWS;
+	int y1 = y0 + DYNRES_JOB_ROWS;
+	if (y1 > b->dst_h) y1 = b->dst_h;
+	for (int y = y0; y < y1; y++) {
+		int32_t sy;
+		int wy;
+		dynres_tap(y, b->full_h, b->src_h, &sy, &wy);
+		const uint32_t *r0 = b->src + (size_t)sy * b->src_pitch;
+		b->fn(b->dst + (size_t)y * b->dst_pitch, b->dst_w,
+		      r0, r0 + b->src_pitch, wy, b->xs, b->wx);
+	}
+}
+
+int d3d11_dynres_present(int resource_idx, uint32_t *dst, int dst_pitch,
+			 int copy_w, int copy_h)
+{
+	static int32_t *xs;
+	static uint16_t *wx;
+	static int tap_cap;
+
+	if (!dynres_enabled() || resource_idx < 0 ||
+	    resource_idx >= ht_count(&g_resources))
+		return 0;
+	struct d3d_resource *r = ht_get(&g_resources, resource_idx);
+	if (!r) return 0;
+	int q = dynres_scale(r);
+	int done = 0;
+
+	if (r->active && r->pixels && q != DYNRES_STEPS &&
+	    copy_w > 0 && copy_h > 0) {
+		if (copy_w > tap_cap) {
+			int32_t *nx = realloc(xs, sizeof(*nx) * copy_w);
+			if (nx) xs = nx;
+			uint16_t *nw = realloc(wx, sizeof(*nw) * copy_w);
+			if (nw) wx = nw;
+			if (nx && nw) tap_cap = copy_w;
+		}
+		if (copy_w <= tap_cap) {
+			int src_w = dynres_extent(r->width, q);
+			for (int x = 0; x < copy_w; x++) {
+				int w;
+				dynres_tap(x, r->width, src_w, &xs[x], &w);
+				wx[x] = (uint16_t)w;
+			}
+			struct dynres_blit b = {
+				.fn = raster_upscale_select(),
+				.dst = dst, .dst_pitch = dst_pitch,
+				.dst_w = copy_w, .dst_h = copy_h,
+				.src = r->pixels, .src_pitch = r->width,
+				.src_h = dynres_extent(r->height, q),
+				.full_h = r->height,
+				.xs = xs, .wx = wx,
+			};
+			thread_pool_run(dynres_blit_job, &b,
+					(copy_h + DYNRES_JOB_ROWS - 1) /
+					DYNRES_JOB_ROWS);
+			done = 1;
+		}
+	}
+
+	dynres_update();
+	return done;
+}
+
 /* ============================================================
  * DLL 엔트리: D3D11CreateDevice, D3D11CreateDeviceAndSwapChain
  * ============================================================ */
@@ -2317,7 +7254,9 @@ d3d11_CreateDevice(void *pAdapter, D3D_DRIVER_TYPE DriverType,
 		if (!g_context) { free(dev); return E_OUTOFMEMORY; }
 		g_context->lpVtbl = &g_context_vtbl;
 		g_context->ref_count = 1;
-		g_context->vb_resource_idx = -1;
+		g_context->pipe_dirty = PIPE_DIRTY_ALL;
+		for (int i = 0; i < MAX_VB_SLOTS; i++)
+			g_context->vb_resource_idx[i] = -1;
 		g_context->ib_resource_idx = -1;
 		g_context->input_layout_idx = -1;
 		g_context->vs_idx = -1;
@@ -2326,6 +7265,8 @@ d3d11_CreateDevice(void *pAdapter, D3D_DRIVER_TYPE DriverType,
 		g_context->dsv_idx = -1;
 		g_context->ds_state_idx = -1;
 		g_context->blend_state_idx = -1;
+		for (int i = 0; i < 4; i++)
+			g_context->blend_factor[i] = 1.0f;
 		g_context->rs_state_idx = -1;
 		for (int i = 0; i < 8; i++) {
 			g_context->vs_cb_idx[i] = -1;
@@ -2333,6 +7274,7 @@ d3d11_CreateDevice(void *pAdapter, D3D_DRIVER_TYPE DriverType,
 			g_context->ps_srv_idx[i] = -1;
 			g_context->ps_sampler_idx[i] = -1;
 		}
+		async_start(g_context);
 	}
 
 	if (ppDevice) *ppDevice = dev;
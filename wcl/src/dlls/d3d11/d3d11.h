@@ -37,6 +37,12 @@ int d3d11_register_swapchain_texture(void *pSwapChain,
 				     uint32_t *pixels,
 				     int width, int height);
 
+/*
+ * ResizeBuffers 전: 등록된 백버퍼 리소스를 해제 (쌓인 Draw는 먼저 그림).
+ * 옛 핸들/뷰는 더 이상 조회되지 않는다. resource_idx < 0이면 무시.
+ */
+void d3d11_release_swapchain_texture(int resource_idx);
+
 /*
  * Vulkan 렌더 타깃 생성 (SwapChain 생성 시 호출)
  * Vulkan 비활성이면 아무것도 하지 않음.
@@ -49,4 +55,26 @@ void d3d11_vk_create_rt(int width, int height);
  */
 int d3d11_vk_readback(uint32_t *pixels, int width, int height);
 
+/*
+ * 타일 bin에 쌓인 Draw를 모두 래스터라이징 (워커 스레드 join).
+ * Present 직전 등 CPU가 렌더 결과를 읽기 전에 호출.
+ */
+void d3d11_flush(void);
+
+/*
+ * 리소스 하나에 미뤄 둔 clear를 채움. d3d11_flush 다음, CPU가 그
+ * 리소스(SwapChain 백버퍼 등)를 Map 없이 직접 읽기 전에 호출.
+ */
+void d3d11_resolve_resource(int resource_idx);
+
+/*
+ * 동적 해상도 Present (CITC_D3D11_DYNRES). d3d11_flush 다음에 호출.
+ *
+ * 백버퍼 리소스가 줄여 그려졌으면 창 픽셀 dst의 copy_w x copy_h
+ * 영역으로 bilinear 확대하고, 다음 프레임 배율을 정한다.
+ * 반환: 1이면 dst를 채움, 0이면 호출자가 그대로 복사
+ */
+int d3d11_dynres_present(int resource_idx, uint32_t *dst, int dst_pitch,
+			 int copy_w, int copy_h);
+
 #endif /* CITC_D3D11_H */
@@ -5,19 +5,34 @@
  * DXBC 컨테이너를 파싱하여 ISGN/OSGN/SHDR 청크를 추출하고,
  * SHDR의 SM4 명령어를 CPU에서 해석 실행하는 소프트웨어 셰이더 VM.
  *
+ * 실행 전 dxbc_lower()로 토큰 스트림을 IR 배열로 한 번 변환해 두고,
+ * shader_vm_execute()는 IR만 실행한다.
+ *
  * 지원 명령어:
- *   mov, add, mul, mad, dp3, dp4, ret,
- *   lt, ge, eq, ne, min, max, movc, rsq,
+ *   mov, add, mul, mad, div, dp2, dp3, dp4, ret,
+ *   lt, ge, eq, ne, min, max, movc, rsq, sqrt, frc, round_*,
+ *   정수: iadd, imul, imad, umul, umad, udiv, ineg, ishl, ishr, ushr,
+ *         and, or, xor, not, ieq, ine, ilt, ige, ult, uge,
+ *         imin, imax, umin, umax, itof, utof, ftoi, ftou
  *   if, else, endif, loop, endloop, break, breakc
+ *   compute (SoA만): ld_raw, store_raw, ld_structured, store_structured,
+ *         atomic_iadd, imm_atomic_iadd, sync
  *
  * 지원 오퍼랜드:
- *   temp(r#), input(v#), output(o#), immediate32, constant_buffer(cb#[#])
+ *   temp(r#), input(v#), output(o#), immediate32, constant_buffer(cb#[#]),
+ *   u#, g#, t#(버퍼), vThreadID, vThreadGroupID, vThreadIDInGroup(Flattened)
+ *
+ * dxbc_classify()는 VM과 별개로 토큰 스트림을 자주 쓰는 셰이더 모양
+ * (위치 변환, 색/텍스처 출력)과 맞춰 보고 네이티브 커널을 고른다.
  */
 
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include "dxbc.h"
+#include "dxbc_jit.h"
 
 /* ============================================================
  * DXBC 컨테이너 파서
@@ -167,7 +182,7 @@ int dxbc_parse(const void *bytecode, size_t size, struct dxbc_info *info)
 }
 
 /* ============================================================
- * SM4 명령어 인터프리터
+ * SM4 → IR 변환
  * ============================================================
  *
  * SM4 오퍼랜드 토큰 포맷:
@@ -182,11 +197,66 @@ int dxbc_parse(const void *bytecode, size_t size, struct dxbc_info *info)
  *   Bit [31]     = 확장 오퍼랜드
  */
 
-/* 소스 오퍼랜드 읽기 → float[4] 반환 */
-static int read_operand(const uint32_t **pp, const uint32_t *end,
-			const struct shader_vm *vm,
-			float out[4])
+/* 레지스터 파일 → shader_vm 내 바이트 오프셋 (범위 밖이면 -1) */
+static int reg_offset(int op_type, int idx)
+{
+	switch (op_type) {
+	case SM4_OPERAND_TEMP:
+		if (idx >= 0 && idx < DXBC_MAX_TEMPS)
+			return (int)(offsetof(struct shader_vm, temps) +
+				     (size_t)idx * 16);
+		break;
+	case SM4_OPERAND_INPUT:
+		if (idx >= 0 && idx < DXBC_MAX_INPUTS)
+			return (int)(offsetof(struct shader_vm, inputs) +
+				     (size_t)idx * 16);
+		break;
+	case SM4_OPERAND_OUTPUT:
+		if (idx >= 0 && idx < DXBC_MAX_OUTPUTS)
+			return (int)(offsetof(struct shader_vm, outputs) +
+				     (size_t)idx * 16);
+		break;
+	}
+	return -1;
+}
+
+/* compute 시스템 값 오퍼랜드 → 입력 레지스터 번호 */
+static int cs_input_reg(int op_type)
 {
+	switch (op_type) {
+	case SM5_OPERAND_THREAD_ID:          return DXBC_CS_INPUT_THREAD_ID;
+	case SM5_OPERAND_THREAD_GROUP_ID:    return DXBC_CS_INPUT_GROUP_ID;
+	case SM5_OPERAND_THREAD_ID_IN_GROUP: return DXBC_CS_INPUT_THREAD_IN_GROUP;
+	default:                             return DXBC_CS_INPUT_GROUP_INDEX;
+	}
+}
+
+/* u#/g#/t# 오퍼랜드 (범위 밖이면 NULL로 남김) */
+static void lower_mem_operand(int op_type, int idx, struct dxbc_ir_operand *o)
+{
+	int file = 0, limit = 0;
+
+	switch (op_type) {
+	case SM5_OPERAND_UAV:
+		file = DXBC_IR_UAV;    limit = DXBC_MAX_UAVS;    break;
+	case SM5_OPERAND_TGSM:
+		file = DXBC_IR_TGSM;   limit = DXBC_MAX_TGSM;    break;
+	case SM4_OPERAND_RESOURCE:
+		file = DXBC_IR_BUFFER; limit = DXBC_MAX_BUFFERS; break;
+	default:
+		return;
+	}
+	if (idx >= 0 && idx < limit) {
+		o->file = (uint8_t)file;
+		o->index = (uint16_t)idx;
+	}
+}
+
+/* 소스 오퍼랜드 디코딩 */
+static int lower_src(const uint32_t **pp, const uint32_t *end,
+		     struct dxbc_ir_operand *o)
+{
+	memset(o, 0, sizeof(*o));
 	if (*pp >= end) return -1;
 
 	uint32_t token = **pp; (*pp)++;
@@ -209,85 +279,82 @@ static int read_operand(const uint32_t **pp, const uint32_t *end,
 		idx[d] = (int)**pp; (*pp)++;
 	}
 
-	/* 소스 float4 가져오기 */
-	const float *src = NULL;
-	float imm[4] = {0, 0, 0, 0};
+	/* swizzle/select → 컴포넌트 선택 */
+	o->mask = 0xF;
+	for (int i = 0; i < 4; i++)
+		o->swizzle[i] = (uint8_t)i;
+	if (num_comp == 2 && sel_mode == 1) {         /* swizzle */
+		for (int i = 0; i < 4; i++)
+			o->swizzle[i] = (uint8_t)((token >> (4 + i * 2)) & 3);
+	} else if (num_comp == 2 && sel_mode == 2) {  /* select_1 */
+		uint8_t sel = (uint8_t)((token >> 4) & 3);
+		for (int i = 0; i < 4; i++)
+			o->swizzle[i] = sel;
+	} else if (num_comp == 1) {                   /* 스칼라: .x, 나머지 0 */
+		o->mask = 0x1;
+	}
 
 	switch (op_type) {
 	case SM4_OPERAND_TEMP:
-		if (idx[0] >= 0 && idx[0] < DXBC_MAX_TEMPS)
-			src = vm->temps[idx[0]];
-		break;
 	case SM4_OPERAND_INPUT:
-		if (idx[0] >= 0 && idx[0] < DXBC_MAX_INPUTS)
-			src = vm->inputs[idx[0]];
-		break;
-	case SM4_OPERAND_OUTPUT:
-		if (idx[0] >= 0 && idx[0] < DXBC_MAX_OUTPUTS)
-			src = vm->outputs[idx[0]];
+	case SM4_OPERAND_OUTPUT: {
+		int off = reg_offset(op_type, idx[0]);
+		if (off >= 0) {
+			o->file = DXBC_IR_REG;
+			o->reg_type = (uint8_t)op_type;
+			o->index = (uint16_t)idx[0];
+			o->offset = (uint16_t)off;
+		}
 		break;
+	}
 	case SM4_OPERAND_IMM32:
+		o->file = DXBC_IR_IMM;
 		if (num_comp == 2) { /* 4 컴포넌트 */
 			if (*pp + 4 > end) return -1;
-			memcpy(imm, *pp, 16);
+			memcpy(o->imm, *pp, 16);
 			*pp += 4;
-		} else if (num_comp == 1) { /* 1 컴포넌트 */
+		} else if (num_comp == 1) { /* 1 컴포넌트 → 복제 */
 			if (*pp >= end) return -1;
-			memcpy(&imm[0], *pp, 4);
-			imm[1] = imm[2] = imm[3] = imm[0];
+			memcpy(&o->imm[0], *pp, 4);
+			o->imm[1] = o->imm[2] = o->imm[3] = o->imm[0];
 			*pp += 1;
 		}
-		src = imm;
+		/* 즉치값은 swizzle 없이 그대로 사용 */
+		o->mask = 0xF;
+		for (int i = 0; i < 4; i++)
+			o->swizzle[i] = (uint8_t)i;
 		break;
 	case SM4_OPERAND_CB:
-		if (idx[0] >= 0 && idx[0] < 4 && vm->cb[idx[0]]) {
-			int float_offset = idx[1] * 4; /* float4 단위 */
-			int byte_size = vm->cb_size[idx[0]];
-			if ((float_offset + 4) * (int)sizeof(float)
-			    <= byte_size)
-				src = &vm->cb[idx[0]][float_offset];
+		if (idx[0] >= 0 && idx[0] < 4 && idx[1] >= 0 && idx[1] < 4096) {
+			o->file = DXBC_IR_CB;
+			o->cb_slot = (uint8_t)idx[0];
+			o->offset = (uint16_t)idx[1];
 		}
 		break;
-	default:
-		out[0] = out[1] = out[2] = out[3] = 0;
-		return 0;
-	}
-
-	if (!src) {
-		out[0] = out[1] = out[2] = out[3] = 0;
-		return 0;
+	case SM5_OPERAND_THREAD_ID:
+	case SM5_OPERAND_THREAD_GROUP_ID:
+	case SM5_OPERAND_THREAD_ID_IN_GROUP:
+	case SM5_OPERAND_THREAD_ID_IN_GROUP_FLAT: {
+		int in_reg = cs_input_reg(op_type);
+		o->file = DXBC_IR_REG;
+		o->reg_type = SM4_OPERAND_INPUT;
+		o->index = (uint16_t)in_reg;
+		o->offset = (uint16_t)reg_offset(SM4_OPERAND_INPUT, in_reg);
+		break;
 	}
-
-	/* swizzle/select 적용 */
-	if (num_comp == 2 && sel_mode == 1) { /* swizzle */
-		int sw[4];
-		sw[0] = (int)((token >> 4) & 3);
-		sw[1] = (int)((token >> 6) & 3);
-		sw[2] = (int)((token >> 8) & 3);
-		sw[3] = (int)((token >> 10) & 3);
-		out[0] = src[sw[0]];
-		out[1] = src[sw[1]];
-		out[2] = src[sw[2]];
-		out[3] = src[sw[3]];
-	} else if (num_comp == 2 && sel_mode == 2) { /* select_1 */
-		int sel = (int)((token >> 4) & 3);
-		out[0] = out[1] = out[2] = out[3] = src[sel];
-	} else if (num_comp == 1) { /* 스칼라 */
-		out[0] = src[0];
-		out[1] = out[2] = out[3] = 0;
-	} else {
-		memcpy(out, src, 16);
+	default:
+		lower_mem_operand(op_type, idx[0], o);
+		break;
 	}
-
 	return 0;
 }
 
-/* 대상 오퍼랜드 디코딩: 쓰기 타겟 포인터 + 마스크 반환 */
-static float *decode_dest(const uint32_t **pp, const uint32_t *end,
-			  struct shader_vm *vm,
-			  int *out_mask)
+/* 대상 오퍼랜드 디코딩: temp/output과 u#/g#만 쓰기 가능, 나머지는 NULL */
+static int lower_dst(const uint32_t **pp, const uint32_t *end,
+		     struct dxbc_ir_operand *o)
 {
-	if (*pp >= end) return NULL;
+	memset(o, 0, sizeof(*o));
+	if (*pp >= end) return -1;
 
 	uint32_t token = **pp; (*pp)++;
 
@@ -297,47 +364,36 @@ static float *decode_dest(const uint32_t **pp, const uint32_t *end,
 
 	/* 확장 오퍼랜드 스킵 */
 	if (token & 0x80000000) {
-		if (*pp >= end) return NULL;
+		if (*pp >= end) return -1;
 		(*pp)++;
 	}
 
 	int idx = 0;
 	for (int d = 0; d < idx_dim; d++) {
-		if (*pp >= end) return NULL;
+		if (*pp >= end) return -1;
 		if (d == 0) idx = (int)**pp;
 		(*pp)++;
 	}
 
-	*out_mask = mask;
-
-	switch (op_type) {
-	case SM4_OPERAND_TEMP:
-		if (idx >= 0 && idx < DXBC_MAX_TEMPS)
-			return vm->temps[idx];
-		break;
-	case SM4_OPERAND_OUTPUT:
-		if (idx >= 0 && idx < DXBC_MAX_OUTPUTS)
-			return vm->outputs[idx];
-		break;
+	o->mask = (uint8_t)mask;
+	if (op_type == SM4_OPERAND_TEMP || op_type == SM4_OPERAND_OUTPUT) {
+		int off = reg_offset(op_type, idx);
+		if (off >= 0) {
+			o->file = DXBC_IR_REG;
+			o->reg_type = (uint8_t)op_type;
+			o->index = (uint16_t)idx;
+			o->offset = (uint16_t)off;
+		}
+	} else if (op_type == SM5_OPERAND_UAV || op_type == SM5_OPERAND_TGSM) {
+		lower_mem_operand(op_type, idx, o);
 	}
-
-	return NULL;
-}
-
-/* 마스크 적용 쓰기 */
-static void write_masked(float *dst, int mask, const float val[4])
-{
-	if (!dst) return;
-	if (mask & 1) dst[0] = val[0];
-	if (mask & 2) dst[1] = val[1];
-	if (mask & 4) dst[2] = val[2];
-	if (mask & 8) dst[3] = val[3];
+	return 0;
 }
 
 /*
  * flow control을 위한 forward-scan: 매칭되는 ELSE/ENDIF/ENDLOOP까지 스킵.
  * target: 찾으려는 opcode (SM4_OP_ELSE, SM4_OP_ENDIF, SM4_OP_ENDLOOP)
- * returns: target 명령어 다음 토큰 위치, 실패 시 NULL
+ * returns: target 명령어 다음 토큰 위치, 실패 시 end
  */
 static const uint32_t *scan_to_matching(const uint32_t *tok,
 					const uint32_t *end,
@@ -355,12 +411,12 @@ static const uint32_t *scan_to_matching(const uint32_t *tok,
 			depth++;
 		} else if (depth == 0 && op == target) {
 			return tok + len;
-		} else if (op == SM4_OP_ENDIF || op == SM4_OP_ENDLOOP) {
-			if (depth > 0) depth--;
 		} else if (depth == 0 && target == SM4_OP_ELSE &&
 			   op == SM4_OP_ENDIF) {
 			/* ELSE 없이 ENDIF 도달 */
 			return tok + len;
+		} else if (op == SM4_OP_ENDIF || op == SM4_OP_ENDLOOP) {
+			if (depth > 0) depth--;
 		}
 
 		tok += len;
@@ -369,6 +425,580 @@ static const uint32_t *scan_to_matching(const uint32_t *tok,
 	return end;
 }
 
+/* IR로 옮기는 명령어 (소스 오퍼랜드 수, -1 = IR에서 제거) */
+static int ir_num_src(int op)
+{
+	switch (op) {
+	case SM4_OP_MOV: case SM4_OP_RSQ:
+	case SM4_OP_ITOF: case SM4_OP_UTOF:
+	case SM4_OP_FTOI: case SM4_OP_FTOU:
+	case SM4_OP_INEG: case SM4_OP_NOT: case SM4_OP_SQRT: case SM4_OP_FRC:
+	case SM4_OP_ROUND_NE: case SM4_OP_ROUND_NI:
+	case SM4_OP_ROUND_PI: case SM4_OP_ROUND_Z:
+		return 1;
+	case SM4_OP_ADD: case SM4_OP_MUL: case SM4_OP_DIV:
+	case SM4_OP_DP2: case SM4_OP_DP3: case SM4_OP_DP4:
+	case SM4_OP_LT: case SM4_OP_GE: case SM4_OP_EQ: case SM4_OP_NE:
+	case SM4_OP_MIN: case SM4_OP_MAX:
+	case SM4_OP_IADD: case SM4_OP_IMUL: case SM4_OP_UMUL: case SM4_OP_UDIV:
+	case SM4_OP_AND: case SM4_OP_OR: case SM4_OP_XOR:
+	case SM4_OP_ISHL: case SM4_OP_ISHR: case SM4_OP_USHR:
+	case SM4_OP_IEQ: case SM4_OP_INE: case SM4_OP_ILT: case SM4_OP_IGE:
+	case SM4_OP_ULT: case SM4_OP_UGE:
+	case SM4_OP_IMIN: case SM4_OP_IMAX: case SM4_OP_UMIN: case SM4_OP_UMAX:
+		return 2;
+	case SM4_OP_MAD: case SM4_OP_MOVC: case SM4_OP_IMAD: case SM4_OP_UMAD:
+		return 3;
+	case SM4_OP_IF: case SM4_OP_BREAKC:
+		return 1;  /* 조건만, dst 없음 */
+	case SM4_OP_RET: case SM4_OP_ELSE: case SM4_OP_ENDIF:
+	case SM4_OP_LOOP: case SM4_OP_ENDLOOP: case SM4_OP_BREAK:
+	case SM5_OP_SYNC:
+		return 0;
+	/* 메모리: 주소 오퍼랜드들 + (load는 원본, store/atomic은 값) */
+	case SM5_OP_LD_RAW: case SM5_OP_STORE_RAW:
+	case SM5_OP_ATOMIC_IADD: case SM5_OP_IMM_ATOMIC_IADD:
+		return 2;
+	case SM5_OP_LD_STRUCTURED: case SM5_OP_STORE_STRUCTURED:
+		return 3;
+	default:
+		return -1; /* dcl_*, 미지원 */
+	}
+}
+
+/* 대상 오퍼랜드 수 */
+static int ir_num_dst(int op)
+{
+	switch (op) {
+	case SM4_OP_IMUL: case SM4_OP_UMUL: case SM4_OP_UDIV:
+	case SM5_OP_IMM_ATOMIC_IADD:
+		return 2;
+	case SM4_OP_IF: case SM4_OP_BREAKC:
+		return 0;
+	default:
+		return ir_num_src(op) > 0;
+	}
+}
+
+/* dcl_* 오퍼랜드의 첫 인덱스 (레지스터 번호), 실패 시 -1 */
+static int decl_index(const uint32_t **pp, const uint32_t *end)
+{
+	if (*pp >= end) return -1;
+	uint32_t token = *(*pp)++;
+	int idx_dim = (int)((token >> 20) & 3);
+	int idx = -1;
+
+	if (token & 0x80000000)
+		(*pp)++;
+	for (int d = 0; d < idx_dim && *pp < end; d++) {
+		if (d == 0) idx = (int)**pp;
+		(*pp)++;
+	}
+	return idx;
+}
+
+/* compute 선언 → IR 메타데이터 */
+static void lower_decl(struct dxbc_ir *ir, int op,
+		       const uint32_t *p, const uint32_t *end)
+{
+	int idx;
+
+	switch (op) {
+	case SM5_OP_DCL_THREAD_GROUP:
+		if (end - p >= 3)
+			for (int i = 0; i < 3; i++)
+				ir->group_size[i] = (int)p[i];
+		break;
+	case SM5_OP_DCL_UAV_RAW:
+	case SM5_OP_DCL_UAV_STRUCTURED:
+		idx = decl_index(&p, end);
+		if (idx >= 0 && idx < DXBC_MAX_UAVS)
+			ir->uav_stride[idx] =
+				(op == SM5_OP_DCL_UAV_STRUCTURED && p < end) ?
+				*p : 0;
+		break;
+	case SM5_OP_DCL_RESOURCE_RAW:
+	case SM5_OP_DCL_RESOURCE_STRUCTURED:
+		idx = decl_index(&p, end);
+		if (idx >= 0 && idx < DXBC_MAX_BUFFERS)
+			ir->buffer_stride[idx] =
+				(op == SM5_OP_DCL_RESOURCE_STRUCTURED && p < end) ?
+				*p : 0;
+		break;
+	case SM5_OP_DCL_TGSM_RAW:
+	case SM5_OP_DCL_TGSM_STRUCTURED: {
+		idx = decl_index(&p, end);
+		if (idx < 0 || idx >= DXBC_MAX_TGSM)
+			break;
+		uint32_t stride = 0, size = 0;
+		if (op == SM5_OP_DCL_TGSM_RAW && p < end) {
+			size = p[0];
+		} else if (end - p >= 2) {
+			stride = p[0];
+			size = p[0] * p[1];
+		}
+		size = (size + 15) & ~15u;
+		if (size > DXBC_MAX_TGSM_BYTES - ir->tgsm_bytes)
+			break;
+		ir->tgsm[idx].offset = ir->tgsm_bytes;
+		ir->tgsm[idx].stride = stride;
+		ir->tgsm[idx].size = size;
+		ir->tgsm_bytes += size;
+		break;
+	}
+	}
+}
+
+#define MAX_FLOW_DEPTH 16
+
+int dxbc_lower(struct dxbc_info *info)
+{
+	if (!info->valid || !info->shader_tokens)
+		return -1;
+	if (info->ir)
+		return 0;
+
+	/* 명령어는 version + token_count (2 DWORD) 이후 시작 */
+	const uint32_t *base = info->shader_tokens;
+	const uint32_t *start = base + 2;
+	const uint32_t *end = base + info->shader_token_count;
+	int ntok = info->shader_token_count;
+
+	/*
+	 * 1단계: 토큰 위치 → IR 인덱스 매핑.
+	 * tok_to_ir[t] = 토큰 t 이후 처음으로 생성되는 IR 명령어 인덱스.
+	 * 점프 대상은 항상 명령어 경계이므로 이 표로 바로 변환된다.
+	 */
+	int *tok_to_ir = malloc(sizeof(int) * (size_t)(ntok + 1));
+	if (!tok_to_ir) return -1;
+	for (int i = 0; i <= ntok; i++)
+		tok_to_ir[i] = -1;
+
+	int count = 0;
+	const uint32_t *tok = start;
+	while (tok < end) {
+		int op = (int)(*tok & 0x7FF);
+		int len = (int)((*tok >> 24) & 0x7F);
+		if (len == 0) break;
+		tok_to_ir[tok - base] = count;
+		if (ir_num_src(op) >= 0)
+			count++;
+		tok += len;
+	}
+	/* 나머지 위치(끝 포함)는 IR 끝 */
+	for (int i = ntok; i >= 0; i--)
+		if (tok_to_ir[i] < 0)
+			tok_to_ir[i] = (i == ntok) ? count : tok_to_ir[i + 1];
+
+	struct dxbc_ir *ir = calloc(1, sizeof(*ir));
+	if (!ir) { free(tok_to_ir); return -1; }
+	ir->insts = calloc((size_t)(count > 0 ? count : 1),
+			   sizeof(struct dxbc_ir_inst));
+	if (!ir->insts) { free(ir); free(tok_to_ir); return -1; }
+
+	/* 2단계: 명령어 디코딩 */
+	int loop_stack[MAX_FLOW_DEPTH];
+	int loop_depth = 0;
+	int n = 0;
+
+	tok = start;
+	while (tok < end && n < count) {
+		uint32_t opcode_token = *tok;
+		int op = (int)(opcode_token & 0x7FF);
+		int len = (int)((opcode_token >> 24) & 0x7F);
+		if (len == 0) break;
+
+		const uint32_t *next = tok + len;
+		const uint32_t *p = tok + 1;
+		int nsrc = ir_num_src(op);
+		if (nsrc < 0) {
+			lower_decl(ir, op, p, next);
+			tok = next;
+			continue;
+		}
+
+		/* 확장 opcode 토큰 (SM5 리소스 차원/반환 타입 등) 스킵 */
+		if (opcode_token & 0x80000000)
+			while (p < next && (*p++ & 0x80000000))
+				;
+
+		struct dxbc_ir_inst *in = &ir->insts[n];
+		in->op = (uint16_t)op;
+		in->target = -1;
+		if ((opcode_token >> 18) & 1)
+			in->flags |= DXBC_IR_FLAG_NZ;
+		if (op == SM5_OP_SYNC && ((opcode_token >> 11) & 1)) {
+			in->flags |= DXBC_IR_FLAG_SYNC_GROUP;
+			ir->has_sync = 1;
+		}
+
+		int ndst = ir_num_dst(op);
+		if (ndst > 0)
+			lower_dst(&p, next, &in->dst);
+		if (ndst > 1)
+			lower_dst(&p, next, &in->dst2);
+		for (int i = 0; i < nsrc; i++)
+			lower_src(&p, next, &in->src[i]);
+		in->num_src = (uint8_t)nsrc;
+
+		/* 참조 temp/output 수 */
+		const struct dxbc_ir_operand *ops[5] = {
+			&in->dst, &in->dst2,
+			&in->src[0], &in->src[1], &in->src[2] };
+		for (int i = 0; i < 5; i++) {
+			if (ops[i]->file != DXBC_IR_REG)
+				continue;
+			if (ops[i]->reg_type == SM4_OPERAND_TEMP &&
+			    ops[i]->index + 1 > ir->num_temps)
+				ir->num_temps = ops[i]->index + 1;
+			if (ops[i]->reg_type == SM4_OPERAND_OUTPUT &&
+			    ops[i]->index + 1 > ir->num_outputs)
+				ir->num_outputs = ops[i]->index + 1;
+		}
+
+		/* 점프 대상 */
+		switch (op) {
+		case SM4_OP_IF:
+			in->target = tok_to_ir[scan_to_matching(next, end,
+						SM4_OP_ELSE) - base];
+			break;
+		case SM4_OP_ELSE:
+			in->target = tok_to_ir[scan_to_matching(next, end,
+						SM4_OP_ENDIF) - base];
+			break;
+		case SM4_OP_BREAK:
+		case SM4_OP_BREAKC:
+			in->target = tok_to_ir[scan_to_matching(next, end,
+						SM4_OP_ENDLOOP) - base];
+			break;
+		case SM4_OP_LOOP:
+			if (loop_depth < MAX_FLOW_DEPTH)
+				loop_stack[loop_depth++] = n + 1;
+			break;
+		case SM4_OP_ENDLOOP:
+			if (loop_depth > 0)
+				in->target = loop_stack[--loop_depth];
+			break;
+		}
+
+		n++;
+		tok = next;
+	}
+
+	ir->num_insts = n;
+	free(tok_to_ir);
+	info->ir = ir;
+	return 0;
+}
+
+void dxbc_free_ir(struct dxbc_info *info)
+{
+	if (!info->ir) return;
+	dxbc_jit_free(info->ir);
+	free(info->ir->insts);
+	free(info->ir);
+	info->ir = NULL;
+}
+
+/* ============================================================
+ * 네이티브 커널 분류 (dxbc_classify)
+ * ============================================================
+ *
+ * IR이 아니라 토큰 스트림을 직접 본다 — sample처럼 VM이 모르는
+ * 명령어도 관용구에 들어가기 때문. 오퍼랜드는 비교에 필요한 만큼만
+ * 풀고, 수정자(확장 오퍼랜드, _sat), 상대 인덱스, 즉치값, 샘플 오프셋이
+ * 보이면 바로 불일치로 본다.
+ */
+#define KERNEL_MAX_INSTS 8
+
+struct kernel_operand {
+	int type;
+	int index[2];
+	unsigned mask;       /* dst: 쓰기 마스크 */
+	uint8_t swizzle[4];  /* src: 컴포넌트 선택 */
+};
+
+struct kernel_inst {
+	int op;
+	int num_ops;
+	struct kernel_operand o[4];   /* o[0] = dst */
+};
+
+static int kernel_num_operands(int op)
+{
+	switch (op) {
+	case SM4_OP_RET:    return 0;
+	case SM4_OP_MOV:    return 2;
+	case SM4_OP_MUL:
+	case SM4_OP_DP4:    return 3;
+	case SM4_OP_MAD:
+	case SM4_OP_SAMPLE: return 4;
+	default:            return -1;
+	}
+}
+
+static int kernel_operand(const uint32_t **pp, const uint32_t *end,
+			  struct kernel_operand *o)
+{
+	if (*pp >= end) return -1;
+	uint32_t token = *(*pp)++;
+
+	int num_comp = (int)(token & 3);
+	int sel_mode = (int)((token >> 2) & 3);
+	int idx_dim  = (int)((token >> 20) & 3);
+
+	/* 확장 오퍼랜드, 즉치/상대 인덱스 표현 */
+	if ((token & 0x80000000) || ((token >> 22) & 0x1FF))
+		return -1;
+	o->type = (int)((token >> 12) & 0xFF);
+	if (o->type == SM4_OPERAND_IMM32 || idx_dim > 2 || end - *pp < idx_dim)
+		return -1;
+	o->index[0] = o->index[1] = 0;
+	for (int d = 0; d < idx_dim; d++)
+		o->index[d] = (int)*(*pp)++;
+
+	o->mask = 0xF;
+	for (int i = 0; i < 4; i++)
+		o->swizzle[i] = (uint8_t)i;
+	if (num_comp == 2) {
+		if (sel_mode == 0)
+			o->mask = (token >> 4) & 0xF;
+		else if (sel_mode == 1)
+			for (int i = 0; i < 4; i++)
+				o->swizzle[i] = (uint8_t)((token >> (4 + i * 2)) & 3);
+		else if (sel_mode == 2)
+			for (int i = 0; i < 4; i++)
+				o->swizzle[i] = (uint8_t)((token >> 4) & 3);
+		else
+			return -1;
+	} else if (num_comp == 1) {
+		o->mask = 0x1;
+		for (int i = 0; i < 4; i++)
+			o->swizzle[i] = 0;
+	} else if (num_comp == 3) {
+		return -1;
+	}
+	return 0;
+}
+
+/* type/index 레지스터를 swizzle 없이 (xyzw 그대로) 읽는지 */
+static int kop_is(const struct kernel_operand *o, int type, int i0, int i1)
+{
+	return o->type == type && o->index[0] == i0 && o->index[1] == i1 &&
+	       o->swizzle[0] == 0 && o->swizzle[1] == 1 &&
+	       o->swizzle[2] == 2 && o->swizzle[3] == 3;
+}
+
+/* v0의 한 성분 복제 (v0.xxxx 등) */
+static int kop_is_v0_splat(const struct kernel_operand *o, int c)
+{
+	return o->type == SM4_OPERAND_INPUT && o->index[0] == 0 &&
+	       o->swizzle[0] == c && o->swizzle[1] == c &&
+	       o->swizzle[2] == c && o->swizzle[3] == c;
+}
+
+static void classify_vs(const struct kernel_inst *in, int n,
+			struct dxbc_kernel *k)
+{
+	unsigned written = 0;  /* 채워진 출력 (o1, o2) */
+	unsigned dp4 = 0;      /* dp4로 채워진 o0 성분 */
+	int pos_mov = 0;
+	int chain = 0, chain_reg = -1;  /* mul/mad 사슬 단계와 누적 temp */
+
+	for (int i = 0; i < n; i++) {
+		const struct kernel_inst *p = &in[i];
+		const struct kernel_operand *d = &p->o[0];
+		const struct kernel_operand *a = &p->o[1], *b = &p->o[2];
+
+		switch (p->op) {
+		case SM4_OP_MOV: {
+			if (d->type != SM4_OPERAND_OUTPUT || d->index[0] > 2 ||
+			    !kop_is(a, SM4_OPERAND_INPUT, d->index[0], 0))
+				return;
+			int r = d->index[0];
+			unsigned need = r == 2 ? 0x3 : 0xF;  /* o2는 xy만 읽음 */
+			if ((d->mask & need) != need)
+				return;
+			if (r == 0) {
+				if (pos_mov || dp4 || chain) return;
+				pos_mov = 1;
+			} else {
+				if (written & (1u << r)) return;
+				written |= 1u << r;
+			}
+			break;
+		}
+		case SM4_OP_DP4: {
+			/* o0.c = dp4(v0, cb0[c]) */
+			int c = __builtin_ctz(d->mask | 0x10);
+			if (d->type != SM4_OPERAND_OUTPUT || d->index[0] != 0 ||
+			    c > 3 || d->mask != (1u << c) || (dp4 & d->mask) ||
+			    pos_mov || chain)
+				return;
+			if (!((kop_is(a, SM4_OPERAND_INPUT, 0, 0) &&
+			       kop_is(b, SM4_OPERAND_CB, 0, c)) ||
+			      (kop_is(b, SM4_OPERAND_INPUT, 0, 0) &&
+			       kop_is(a, SM4_OPERAND_CB, 0, c))))
+				return;
+			dp4 |= d->mask;
+			break;
+		}
+		case SM4_OP_MUL:
+		case SM4_OP_MAD: {
+			/* r = v0.xxxx * cb0[0]; r = v0.yyyy * cb0[1] + r; ...
+			 * 마지막 mad가 o0에 씀 */
+			int last = chain == 3;
+			if ((p->op == SM4_OP_MUL) != (chain == 0) || chain > 3 ||
+			    pos_mov || dp4 || d->mask != 0xF)
+				return;
+			if (!((kop_is_v0_splat(a, chain) &&
+			       kop_is(b, SM4_OPERAND_CB, 0, chain)) ||
+			      (kop_is_v0_splat(b, chain) &&
+			       kop_is(a, SM4_OPERAND_CB, 0, chain))))
+				return;
+			if (chain > 0 &&
+			    !kop_is(&p->o[3], SM4_OPERAND_TEMP, chain_reg, 0))
+				return;
+			if (last) {
+				if (d->type != SM4_OPERAND_OUTPUT || d->index[0] != 0)
+					return;
+			} else {
+				if (d->type != SM4_OPERAND_TEMP ||
+				    (chain > 0 && d->index[0] != chain_reg))
+					return;
+				chain_reg = d->index[0];
+			}
+			chain++;
+			break;
+		}
+		default:
+			return;
+		}
+	}
+
+	if (pos_mov) {
+		k->kind = DXBC_KERNEL_VS_PASS;
+	} else if (dp4 == 0xF) {
+		k->kind = DXBC_KERNEL_VS_XFORM;
+		k->transposed = 1;
+	} else if (chain == 4) {
+		k->kind = DXBC_KERNEL_VS_XFORM;
+		k->transposed = 0;
+	} else {
+		return;
+	}
+	k->pass_mask = written;
+}
+
+static void classify_ps(const struct kernel_inst *in, int n,
+			struct dxbc_kernel *k)
+{
+	const struct kernel_operand *d = &in[0].o[0];
+
+	/* mov o0, v1 */
+	if (n == 1 && in[0].op == SM4_OP_MOV) {
+		if (kop_is(d, SM4_OPERAND_OUTPUT, 0, 0) && d->mask == 0xF &&
+		    kop_is(&in[0].o[1], SM4_OPERAND_INPUT, 1, 0))
+			k->kind = DXBC_KERNEL_PS_COLOR;
+		return;
+	}
+
+	/* sample dst, v2.xy, t0, s0 [; mul o0, dst, v1] */
+	if (in[0].op != SM4_OP_SAMPLE || d->mask != 0xF || n > 2)
+		return;
+	const struct kernel_operand *uv = &in[0].o[1];
+	if (uv->type != SM4_OPERAND_INPUT || uv->index[0] != 2 ||
+	    uv->swizzle[0] != 0 || uv->swizzle[1] != 1 ||
+	    !kop_is(&in[0].o[2], SM4_OPERAND_RESOURCE, 0, 0) ||
+	    in[0].o[3].type != SM4_OPERAND_SAMPLER || in[0].o[3].index[0] != 0)
+		return;
+
+	if (n == 1) {
+		if (d->type == SM4_OPERAND_OUTPUT && d->index[0] == 0)
+			k->kind = DXBC_KERNEL_PS_TEX;
+		return;
+	}
+
+	const struct kernel_operand *m = &in[1].o[0];
+	const struct kernel_operand *a = &in[1].o[1], *b = &in[1].o[2];
+	if (d->type != SM4_OPERAND_TEMP || in[1].op != SM4_OP_MUL ||
+	    m->type != SM4_OPERAND_OUTPUT || m->index[0] != 0 || m->mask != 0xF)
+		return;
+	if ((kop_is(a, SM4_OPERAND_TEMP, d->index[0], 0) &&
+	     kop_is(b, SM4_OPERAND_INPUT, 1, 0)) ||
+	    (kop_is(b, SM4_OPERAND_TEMP, d->index[0], 0) &&
+	     kop_is(a, SM4_OPERAND_INPUT, 1, 0)))
+		k->kind = DXBC_KERNEL_PS_TEX_COLOR;
+}
+
+void dxbc_classify(const struct dxbc_info *info, struct dxbc_kernel *out)
+{
+	memset(out, 0, sizeof(*out));
+	if (!info->valid || !info->shader_tokens)
+		return;
+
+	struct kernel_inst insts[KERNEL_MAX_INSTS];
+	int n = 0, ret = 0;
+	const uint32_t *tok = info->shader_tokens + 2;
+	const uint32_t *end = info->shader_tokens + info->shader_token_count;
+
+	while (tok < end && !ret) {
+		uint32_t opcode_token = *tok;
+		int op = (int)(opcode_token & 0x7FF);
+		int len = (int)((opcode_token >> 24) & 0x7F);
+		if (len == 0 || len > end - tok)
+			return;
+		const uint32_t *next = tok + len;
+		const uint32_t *p = tok + 1;
+		tok = next;
+
+		if (op >= SM4_OP_DCL_RESOURCE && op <= SM4_OP_DCL_GLOBAL_FLAGS)
+			continue;
+
+		int num_ops = kernel_num_operands(op);
+		if (num_ops < 0 || n >= KERNEL_MAX_INSTS)
+			return;
+		/* 제어 비트 (_sat, 테스트 조건 등) */
+		if ((opcode_token >> 11) & 0x1FFF)
+			return;
+		/* 확장 opcode: 리소스 차원/반환 타입만 허용, 샘플 오프셋은 불일치 */
+		if (opcode_token & 0x80000000) {
+			uint32_t ext;
+			do {
+				if (p >= next) return;
+				ext = *p++;
+				if ((ext & 0x3F) == 1 && (ext >> 9) & 0xFFF)
+					return;
+			} while (ext & 0x80000000);
+		}
+
+		struct kernel_inst *in = &insts[n++];
+		in->op = op;
+		in->num_ops = num_ops;
+		for (int i = 0; i < num_ops; i++)
+			if (kernel_operand(&p, next, &in->o[i]) < 0)
+				return;
+		if (p != next)
+			return;
+		if (op == SM4_OP_RET) {
+			ret = 1;
+			n--;
+		}
+	}
+	/* ret 뒤에 명령어가 더 있으면 (서브루틴 등) 불일치 */
+	if (!ret || tok != end || n == 0)
+		return;
+
+	if (info->shader_type == 1)
+		classify_vs(insts, n, out);
+	else if (info->shader_type == 0)
+		classify_ps(insts, n, out);
+}
+
+/* ============================================================
+ * IR 인터프리터
+ * ============================================================ */
+
 /* SM4 비교 결과: 0.0 또는 0xFFFFFFFF (as float bits) */
 static float cmp_true(void)
 {
@@ -389,304 +1019,1010 @@ static int test_condition(float val)
 	return bits != 0;
 }
 
-#define MAX_FLOW_DEPTH 16
+static inline uint32_t f2u(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, 4);
+	return u;
+}
+
+static inline float u2f(uint32_t u)
+{
+	float f;
+	memcpy(&f, &u, 4);
+	return f;
+}
+
+/* float → int/uint 변환: NaN은 0, 범위 밖은 clamp (D3D 규칙) */
+static uint32_t ftoi_bits(float f)
+{
+	if (f != f) return 0;
+	if (f >= 2147483648.0f) return 0x7FFFFFFFu;
+	if (f <= -2147483648.0f) return 0x80000000u;
+	return (uint32_t)(int32_t)f;
+}
+
+static uint32_t ftou_bits(float f)
+{
+	if (!(f > 0.0f)) return 0;
+	if (f >= 4294967296.0f) return 0xFFFFFFFFu;
+	return (uint32_t)f;
+}
+
+/*
+ * 정수·변환·기타 ALU 한 컴포넌트 (비트 패턴 입출력).
+ * 스칼라 VM과 SoA VM의 레인별 경로가 같이 쓴다.
+ * second: imul/umul의 하위 32비트, udiv의 나머지.
+ */
+static uint32_t alu_bits(int op, uint32_t a, uint32_t b, uint32_t c,
+			 uint32_t *second)
+{
+	switch (op) {
+	case SM4_OP_IADD: return a + b;
+	case SM4_OP_INEG: return 0u - a;
+	case SM4_OP_AND:  return a & b;
+	case SM4_OP_OR:   return a | b;
+	case SM4_OP_XOR:  return a ^ b;
+	case SM4_OP_NOT:  return ~a;
+	case SM4_OP_ISHL: return a << (b & 31);
+	case SM4_OP_USHR: return a >> (b & 31);
+	case SM4_OP_ISHR: return (uint32_t)((int32_t)a >> (b & 31));
+	case SM4_OP_IEQ:  return a == b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_INE:  return a != b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_ILT:  return (int32_t)a < (int32_t)b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_IGE:  return (int32_t)a >= (int32_t)b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_ULT:  return a < b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_UGE:  return a >= b ? 0xFFFFFFFFu : 0;
+	case SM4_OP_IMIN: return (int32_t)a < (int32_t)b ? a : b;
+	case SM4_OP_IMAX: return (int32_t)a > (int32_t)b ? a : b;
+	case SM4_OP_UMIN: return a < b ? a : b;
+	case SM4_OP_UMAX: return a > b ? a : b;
+	case SM4_OP_IMAD:
+	case SM4_OP_UMAD: return a * b + c;
+	case SM4_OP_IMUL: {
+		int64_t m = (int64_t)(int32_t)a * (int32_t)b;
+		*second = (uint32_t)m;
+		return (uint32_t)((uint64_t)m >> 32);
+	}
+	case SM4_OP_UMUL: {
+		uint64_t m = (uint64_t)a * b;
+		*second = (uint32_t)m;
+		return (uint32_t)(m >> 32);
+	}
+	case SM4_OP_UDIV:
+		if (b == 0) {
+			*second = 0xFFFFFFFFu;
+			return 0xFFFFFFFFu;
+		}
+		*second = a % b;
+		return a / b;
+	case SM4_OP_FTOI: return ftoi_bits(u2f(a));
+	case SM4_OP_FTOU: return ftou_bits(u2f(a));
+	case SM4_OP_DIV:  return f2u(u2f(a) / u2f(b));
+	case SM4_OP_SQRT: return f2u(sqrtf(u2f(a)));
+	case SM4_OP_FRC:  return f2u(u2f(a) - floorf(u2f(a)));
+	case SM4_OP_ROUND_NE: return f2u(rintf(u2f(a)));
+	case SM4_OP_ROUND_NI: return f2u(floorf(u2f(a)));
+	case SM4_OP_ROUND_PI: return f2u(ceilf(u2f(a)));
+	case SM4_OP_ROUND_Z:  return f2u(truncf(u2f(a)));
+	default:          return 0;
+	}
+}
+
+/* alu_bits로 처리하는 명령어 */
+#define ALU_BITS_CASES \
+	case SM4_OP_IADD: case SM4_OP_INEG: case SM4_OP_AND: case SM4_OP_OR: \
+	case SM4_OP_XOR: case SM4_OP_NOT: case SM4_OP_ISHL: case SM4_OP_USHR: \
+	case SM4_OP_ISHR: case SM4_OP_IEQ: case SM4_OP_INE: case SM4_OP_ILT: \
+	case SM4_OP_IGE: case SM4_OP_ULT: case SM4_OP_UGE: case SM4_OP_IMIN: \
+	case SM4_OP_IMAX: case SM4_OP_UMIN: case SM4_OP_UMAX: case SM4_OP_IMAD: \
+	case SM4_OP_UMAD: case SM4_OP_IMUL: case SM4_OP_UMUL: case SM4_OP_UDIV: \
+	case SM4_OP_FTOI: case SM4_OP_FTOU: case SM4_OP_DIV: case SM4_OP_SQRT: \
+	case SM4_OP_FRC: case SM4_OP_ROUND_NE: case SM4_OP_ROUND_NI: \
+	case SM4_OP_ROUND_PI: case SM4_OP_ROUND_Z
+
+/* 소스 오퍼랜드 읽기 → float[4] */
+static inline void ir_read(const struct shader_vm *vm,
+			   const struct dxbc_ir_operand *o, float out[4])
+{
+	const float *src;
+
+	switch (o->file) {
+	case DXBC_IR_REG:
+		src = (const float *)((const uint8_t *)vm + o->offset);
+		break;
+	case DXBC_IR_IMM:
+		memcpy(out, o->imm, 16);
+		return;
+	case DXBC_IR_CB:
+		src = NULL;
+		if (vm->cb[o->cb_slot] &&
+		    ((int)o->offset * 4 + 4) * (int)sizeof(float) <=
+		    vm->cb_size[o->cb_slot])
+			src = &vm->cb[o->cb_slot][o->offset * 4];
+		if (src)
+			break;
+		/* fall through */
+	default:
+		out[0] = out[1] = out[2] = out[3] = 0;
+		return;
+	}
+
+	out[0] = src[o->swizzle[0]];
+	if (o->mask == 0xF) {
+		out[1] = src[o->swizzle[1]];
+		out[2] = src[o->swizzle[2]];
+		out[3] = src[o->swizzle[3]];
+	} else {
+		out[1] = out[2] = out[3] = 0;
+	}
+}
+
+/* 마스크 적용 쓰기 */
+static inline void ir_write(struct shader_vm *vm,
+			    const struct dxbc_ir_operand *o,
+			    const float val[4])
+{
+	if (o->file != DXBC_IR_REG) return;
+	float *dst = (float *)((uint8_t *)vm + o->offset);
+	if (o->mask & 1) dst[0] = val[0];
+	if (o->mask & 2) dst[1] = val[1];
+	if (o->mask & 4) dst[2] = val[2];
+	if (o->mask & 8) dst[3] = val[3];
+}
 
 int shader_vm_execute(struct shader_vm *vm, const struct dxbc_info *info)
 {
-	if (!info->valid || !info->shader_tokens)
-		return -1;
+	const struct dxbc_ir *ir = info->ir;
 
-	/* 명령어는 version + token_count (2 DWORD) 이후 시작 */
-	const uint32_t *tok = info->shader_tokens + 2;
-	const uint32_t *end = info->shader_tokens +
-			      info->shader_token_count;
+	/* JIT 코드는 outputs/temps 초기화까지 포함 */
+	if (ir && ir->jit) {
+		ir->jit(vm);
+		return 0;
+	}
 
-	/* 루프 지원: loop start 스택 */
-	const uint32_t *loop_stack[MAX_FLOW_DEPTH];
-	int loop_depth = 0;
-	int loop_iter = 0;
+	memset(vm->outputs, 0, sizeof(vm->outputs));
+	if (!info->valid || !ir)
+		return -1;
 
-	while (tok < end) {
-		uint32_t opcode_token = *tok;
-		int op = (int)(opcode_token & 0x7FF);
-		int len = (int)((opcode_token >> 24) & 0x7F);
+	memset(vm->temps, 0, (size_t)ir->num_temps * sizeof(vm->temps[0]));
 
-		if (len == 0) break;
+	/* 루프 반복 횟수 (무한 루프 방지) */
+	int loop_iter[MAX_FLOW_DEPTH];
+	int loop_depth = 0;
 
-		const uint32_t *next = tok + len;
-		const uint32_t *p = tok + 1; /* opcode 토큰 스킵 */
+	const struct dxbc_ir_inst *insts = ir->insts;
+	int pc = 0;
 
-		/* 선언문 스킵 (opcode >= 88은 DCL 계열) */
-		if (op >= SM4_OP_DCL_RESOURCE) {
-			tok = next;
-			continue;
-		}
+	while (pc < ir->num_insts) {
+		const struct dxbc_ir_inst *in = &insts[pc++];
+		float a[4], b[4], c[4], r[4];
 
-		switch (op) {
+		switch (in->op) {
 		case SM4_OP_RET:
 			return 0;
 
 		/* === 기존 ALU === */
 
-		case SM4_OP_MOV: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float src[4];
-			read_operand(&p, end, vm, src);
-			write_masked(dst, mask, src);
+		case SM4_OP_MOV:
+			ir_read(vm, &in->src[0], r);
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_ADD: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_ADD:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = a[i] + b[i];
-			write_masked(dst, mask, result);
+				r[i] = a[i] + b[i];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_MUL: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_MUL:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = a[i] * b[i];
-			write_masked(dst, mask, result);
+				r[i] = a[i] * b[i];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_MAD: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], c[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
-			read_operand(&p, end, vm, c);
+		case SM4_OP_MAD:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
+			ir_read(vm, &in->src[2], c);
 			for (int i = 0; i < 4; i++)
-				result[i] = a[i] * b[i] + c[i];
-			write_masked(dst, mask, result);
+				r[i] = a[i] * b[i] + c[i];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_DP3: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
-			float dot = a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
-			float result[4] = { dot, dot, dot, dot };
-			write_masked(dst, mask, result);
+		case SM4_OP_DP2:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
+			r[0] = a[0]*b[0] + a[1]*b[1];
+			r[1] = r[2] = r[3] = r[0];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_DP4: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
-			float dot = a[0]*b[0] + a[1]*b[1] +
-				    a[2]*b[2] + a[3]*b[3];
-			float result[4] = { dot, dot, dot, dot };
-			write_masked(dst, mask, result);
+		case SM4_OP_DP3:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
+			r[0] = a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+			r[1] = r[2] = r[3] = r[0];
+			ir_write(vm, &in->dst, r);
+			break;
+
+		case SM4_OP_DP4:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
+			r[0] = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+			r[1] = r[2] = r[3] = r[0];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
 		/* === Class 53: 비교 연산 === */
 
-		case SM4_OP_LT: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_LT:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] < b[i]) ?
-					SM4_CMP_TRUE : SM4_CMP_FALSE;
-			write_masked(dst, mask, result);
+				r[i] = (a[i] < b[i]) ? SM4_CMP_TRUE : SM4_CMP_FALSE;
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_GE: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_GE:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] >= b[i]) ?
-					SM4_CMP_TRUE : SM4_CMP_FALSE;
-			write_masked(dst, mask, result);
+				r[i] = (a[i] >= b[i]) ? SM4_CMP_TRUE : SM4_CMP_FALSE;
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_EQ: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_EQ:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] == b[i]) ?
-					SM4_CMP_TRUE : SM4_CMP_FALSE;
-			write_masked(dst, mask, result);
+				r[i] = (a[i] == b[i]) ? SM4_CMP_TRUE : SM4_CMP_FALSE;
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_NE: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_NE:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] != b[i]) ?
-					SM4_CMP_TRUE : SM4_CMP_FALSE;
-			write_masked(dst, mask, result);
+				r[i] = (a[i] != b[i]) ? SM4_CMP_TRUE : SM4_CMP_FALSE;
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_MIN: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_MIN:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] < b[i]) ? a[i] : b[i];
-			write_masked(dst, mask, result);
+				r[i] = (a[i] < b[i]) ? a[i] : b[i];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_MAX: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float a[4], b[4], result[4];
-			read_operand(&p, end, vm, a);
-			read_operand(&p, end, vm, b);
+		case SM4_OP_MAX:
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
 			for (int i = 0; i < 4; i++)
-				result[i] = (a[i] > b[i]) ? a[i] : b[i];
-			write_masked(dst, mask, result);
+				r[i] = (a[i] > b[i]) ? a[i] : b[i];
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_MOVC: {
+		case SM4_OP_MOVC:
 			/* movc dst, cond, true_val, false_val */
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float cond[4], t[4], f[4], result[4];
-			read_operand(&p, end, vm, cond);
-			read_operand(&p, end, vm, t);
-			read_operand(&p, end, vm, f);
+			ir_read(vm, &in->src[0], a);
+			ir_read(vm, &in->src[1], b);
+			ir_read(vm, &in->src[2], c);
 			for (int i = 0; i < 4; i++)
-				result[i] = test_condition(cond[i]) ?
-					t[i] : f[i];
-			write_masked(dst, mask, result);
+				r[i] = test_condition(a[i]) ? b[i] : c[i];
+			ir_write(vm, &in->dst, r);
+			break;
+
+		case SM4_OP_RSQ:
+			ir_read(vm, &in->src[0], a);
+			for (int i = 0; i < 4; i++)
+				r[i] = (a[i] > 0.0f) ? 1.0f / sqrtf(a[i]) : 0.0f;
+			ir_write(vm, &in->dst, r);
+			break;
+
+		/* 정수 → float (레지스터에는 비트 패턴 그대로, 예: SV_InstanceID) */
+		case SM4_OP_ITOF:
+		case SM4_OP_UTOF:
+			ir_read(vm, &in->src[0], a);
+			for (int i = 0; i < 4; i++) {
+				uint32_t bits;
+				memcpy(&bits, &a[i], 4);
+				r[i] = (in->op == SM4_OP_ITOF) ?
+				       (float)(int32_t)bits : (float)bits;
+			}
+			ir_write(vm, &in->dst, r);
 			break;
-		}
 
-		case SM4_OP_RSQ: {
-			int mask;
-			float *dst = decode_dest(&p, end, vm, &mask);
-			float src[4], result[4];
-			read_operand(&p, end, vm, src);
+		/* === 정수 / 변환 / 기타 === */
+
+		ALU_BITS_CASES: {
+			float r2[4];
+			uint32_t lo = 0;
+			a[0] = a[1] = a[2] = a[3] = 0;
+			b[0] = b[1] = b[2] = b[3] = 0;
+			c[0] = c[1] = c[2] = c[3] = 0;
+			ir_read(vm, &in->src[0], a);
+			if (in->num_src > 1) ir_read(vm, &in->src[1], b);
+			if (in->num_src > 2) ir_read(vm, &in->src[2], c);
 			for (int i = 0; i < 4; i++) {
-				if (src[i] > 0.0f)
-					result[i] = 1.0f / sqrtf(src[i]);
-				else
-					result[i] = 0.0f;
+				r[i] = u2f(alu_bits(in->op, f2u(a[i]), f2u(b[i]),
+						    f2u(c[i]), &lo));
+				r2[i] = u2f(lo);
 			}
-			write_masked(dst, mask, result);
+			ir_write(vm, &in->dst, r);
+			ir_write(vm, &in->dst2, r2);
 			break;
 		}
 
 		/* === Class 53: 흐름 제어 === */
 
 		case SM4_OP_IF: {
-			/* if_nz src0.x — 조건이 non-zero면 실행 */
-			float cond[4];
-			read_operand(&p, end, vm, cond);
-			int nz = (opcode_token >> 18) & 1; /* 0=if_z, 1=if_nz */
-			int val = test_condition(cond[0]);
-			int take = nz ? val : !val;
-
-			if (!take) {
-				/* ELSE 또는 ENDIF까지 스킵 */
-				next = scan_to_matching(next, end,
-							SM4_OP_ELSE);
-			}
+			/* if_nz/if_z src0.x — 거짓이면 ELSE 다음 또는 ENDIF 다음으로 */
+			ir_read(vm, &in->src[0], a);
+			int val = test_condition(a[0]);
+			int take = (in->flags & DXBC_IR_FLAG_NZ) ? val : !val;
+			if (!take)
+				pc = in->target;
 			break;
 		}
 
 		case SM4_OP_ELSE:
-			/* if 블록 실행 중이었으므로 ENDIF까지 스킵 */
-			next = scan_to_matching(next, end, SM4_OP_ENDIF);
-			break;
-
-		case SM4_OP_ENDIF:
-			/* no-op */
+			/* if 블록 실행 중이었으므로 ENDIF 다음으로 */
+			pc = in->target;
 			break;
 
 		case SM4_OP_LOOP:
-			/* 루프 시작 — body 시작 위치 기록 */
-			if (loop_depth < MAX_FLOW_DEPTH) {
-				loop_stack[loop_depth++] = next;
-				loop_iter = 0;
-			}
+			if (loop_depth < MAX_FLOW_DEPTH)
+				loop_iter[loop_depth++] = 0;
 			break;
 
 		case SM4_OP_ENDLOOP:
 			/* 루프 반복 — LOOP 다음으로 점프 */
 			if (loop_depth > 0) {
-				loop_iter++;
-				if (loop_iter > 1024) {
-					/* 무한 루프 방지 */
-					loop_depth--;
-				} else {
-					next = loop_stack[loop_depth - 1];
-				}
+				if (++loop_iter[loop_depth - 1] > 1024)
+					loop_depth--;   /* 무한 루프 방지 */
+				else if (in->target >= 0)
+					pc = in->target;
 			}
 			break;
 
 		case SM4_OP_BREAK:
-			/* 루프 탈출 — ENDLOOP까지 스킵 */
+			/* 루프 탈출 — ENDLOOP 다음으로 */
 			if (loop_depth > 0)
 				loop_depth--;
-			next = scan_to_matching(next, end,
-						SM4_OP_ENDLOOP);
+			pc = in->target;
 			break;
 
 		case SM4_OP_BREAKC: {
 			/* breakc_nz/breakc_z src0.x */
-			float cond[4];
-			read_operand(&p, end, vm, cond);
-			int nz = (opcode_token >> 18) & 1;
-			int val = test_condition(cond[0]);
-			int take = nz ? val : !val;
-
+			ir_read(vm, &in->src[0], a);
+			int val = test_condition(a[0]);
+			int take = (in->flags & DXBC_IR_FLAG_NZ) ? val : !val;
 			if (take) {
 				if (loop_depth > 0)
 					loop_depth--;
-				next = scan_to_matching(next, end,
-							SM4_OP_ENDLOOP);
+				pc = in->target;
 			}
 			break;
 		}
 
 		default:
-			/* 미지원 명령어 — 스킵 */
 			break;
 		}
+	}
 
-		tok = next;
+	return 0;
+}
+
+/* ============================================================
+ * SoA IR 인터프리터 (픽셀 SHADER_SOA_WIDTH개 동시 실행)
+ * ============================================================
+ *
+ * 레지스터 컴포넌트 하나 = 레인 8개짜리 벡터 (GCC vector extension).
+ * SSE2에서는 연산 하나가 128비트 명령어 두 개로 나뉜다.
+ *
+ * 제어 흐름은 레인 마스크로 처리:
+ *   exec        = 현재 명령어를 실행하는 레인
+ *   alive       = 아직 ret하지 않은 레인
+ *   loop_active = 가장 안쪽 루프에서 break하지 않은 레인
+ * if/else/endif와 loop/endloop은 스택에 진입 시 마스크를 저장하고,
+ * 모든 레인이 꺼지면 IR 점프 대상(ELSE/ENDIF/ENDLOOP 다음)으로 건너뛴다.
+ *
+ * 이 상태는 shader_vm_soa 안에 있어서, compute의 그룹 배리어(sync)에서
+ * 실행을 멈추고 같은 그룹의 다른 배치를 돌린 뒤 이어서 실행할 수 있다.
+ */
+
+typedef float soa_f __attribute__((vector_size(SHADER_SOA_WIDTH * 4)));
+typedef int32_t soa_i __attribute__((vector_size(SHADER_SOA_WIDTH * 4)));
+typedef uint32_t soa_u __attribute__((vector_size(SHADER_SOA_WIDTH * 4)));
+
+#define SOA_ALL_LANES  ((1u << SHADER_SOA_WIDTH) - 1)
+#define SOA_MAX_FLOW   SHADER_SOA_MAX_FLOW
+
+/*
+ * 헬퍼는 매크로로 둔다 — AVX 없이 빌드하면 256비트 벡터를 값으로
+ * 주고받는 함수는 ABI 경고(-Wpsabi) 대상이다.
+ */
+#define SOA_SPLAT(x) ({ float _s = (x); \
+	(soa_f){ _s, _s, _s, _s, _s, _s, _s, _s }; })
+
+#define SOA_SELECT(m, a, b) \
+	((soa_f)(((m) & (soa_i)(a)) | (~(m) & (soa_i)(b))))
+
+/* 레인 비트마스크 → 벡터 마스크 (-1/0) */
+#define SOA_LANE_MASK(lanes) ({ int32_t _l = (int32_t)(lanes); \
+	(soa_i){ 1, 2, 4, 8, 16, 32, 64, 128 } & \
+	(soa_i){ _l, _l, _l, _l, _l, _l, _l, _l }; })
+
+/* 조건 레인: 비트가 non-zero인 레인 */
+static inline unsigned soa_nonzero_lanes(const soa_f *v)
+{
+	soa_i nz = (soa_i)*v != 0;
+	unsigned lanes = 0;
+	for (int k = 0; k < SHADER_SOA_WIDTH; k++)
+		if (nz[k])
+			lanes |= 1u << k;
+	return lanes;
+}
+
+static inline soa_f *soa_reg(struct shader_vm_soa *vm,
+			     const struct dxbc_ir_operand *o)
+{
+	switch (o->reg_type) {
+	case SM4_OPERAND_TEMP:   return (soa_f *)vm->temps[o->index];
+	case SM4_OPERAND_INPUT:  return (soa_f *)vm->inputs[o->index];
+	case SM4_OPERAND_OUTPUT: return (soa_f *)vm->outputs[o->index];
+	}
+	return NULL;
+}
+
+/* 소스 오퍼랜드 읽기 (ir_read와 같은 의미) */
+static inline void soa_read(struct shader_vm_soa *vm,
+			    const struct dxbc_ir_operand *o, soa_f out[4])
+{
+	int n = (o->mask == 0xF) ? 4 : 1;
+
+	switch (o->file) {
+	case DXBC_IR_REG: {
+		const soa_f *src = soa_reg(vm, o);
+		for (int i = 0; i < n; i++)
+			out[i] = src[o->swizzle[i]];
+		break;
+	}
+	case DXBC_IR_IMM:
+		for (int i = 0; i < 4; i++)
+			out[i] = SOA_SPLAT(o->imm[i]);
+		return;
+	case DXBC_IR_CB:
+		if (vm->cb[o->cb_slot] &&
+		    ((int)o->offset * 4 + 4) * (int)sizeof(float) <=
+		    vm->cb_size[o->cb_slot]) {
+			const float *src = &vm->cb[o->cb_slot][o->offset * 4];
+			for (int i = 0; i < n; i++)
+				out[i] = SOA_SPLAT(src[o->swizzle[i]]);
+			break;
+		}
+		/* fall through */
+	default:
+		n = 0;
+		break;
+	}
+
+	for (int i = n; i < 4; i++)
+		out[i] = SOA_SPLAT(0.0f);
+}
+
+/* 마스크 적용 쓰기: 컴포넌트 마스크 + 레인 마스크 */
+static inline void soa_write(struct shader_vm_soa *vm,
+			     const struct dxbc_ir_operand *o,
+			     const soa_f val[4], unsigned exec)
+{
+	if (o->file != DXBC_IR_REG) return;
+	soa_f *dst = soa_reg(vm, o);
+
+	if (exec == SOA_ALL_LANES) {
+		for (int i = 0; i < 4; i++)
+			if (o->mask & (1 << i))
+				dst[i] = val[i];
+		return;
+	}
+
+	soa_i m = SOA_LANE_MASK(exec) != 0;
+	for (int i = 0; i < 4; i++)
+		if (o->mask & (1 << i))
+			dst[i] = SOA_SELECT(m, val[i], dst[i]);
+}
+
+/* ---- compute 메모리 (u#, g#, t#) ---- */
+
+/* 메모리 오퍼랜드 → 바이트 배열 (바인딩이 없으면 NULL) */
+static uint8_t *soa_mem(struct shader_vm_soa *vm, const struct dxbc_ir *ir,
+			const struct dxbc_ir_operand *o,
+			uint32_t *size, uint32_t *stride)
+{
+	switch (o->file) {
+	case DXBC_IR_UAV:
+		*size = vm->uav[o->index].size;
+		*stride = ir->uav_stride[o->index];
+		return vm->uav[o->index].data;
+	case DXBC_IR_BUFFER:
+		*size = vm->buffer[o->index].size;
+		*stride = ir->buffer_stride[o->index];
+		return vm->buffer[o->index].data;
+	case DXBC_IR_TGSM:
+		if (!vm->tgsm)
+			return NULL;
+		*size = ir->tgsm[o->index].size;
+		*stride = ir->tgsm[o->index].stride;
+		return vm->tgsm + ir->tgsm[o->index].offset;
 	}
+	return NULL;
+}
+
+/* 범위 밖 읽기는 0 (D3D 규칙) */
+static inline float mem_load(const uint8_t *mem, uint32_t size, uint64_t at)
+{
+	uint32_t v = 0;
+	if (mem && at + 4 <= size)
+		memcpy(&v, mem + at, 4);
+	return u2f(v);
+}
+
+/* 레인 k의 바이트 주소 (4바이트 정렬): structured는 index*stride + offset */
+static inline uint64_t mem_addr(uint32_t index, uint32_t offset,
+				uint32_t stride)
+{
+	return ((uint64_t)index * stride + offset) & ~(uint64_t)3;
+}
+
+static int soa_run(struct shader_vm_soa *vm, const struct dxbc_ir *ir)
+{
+	struct shader_vm_flow *stack = vm->flow;
+	int sp = vm->sp;
+	unsigned exec = vm->exec;
+	unsigned alive = vm->alive;
+	unsigned loop_active = vm->loop_active;
+
+	const struct dxbc_ir_inst *insts = ir->insts;
+	int pc = vm->pc;
+
+	while (pc < ir->num_insts) {
+		const struct dxbc_ir_inst *in = &insts[pc++];
+		soa_f a[4], b[4], c[4], r[4];
+
+		switch (in->op) {
+
+		/* === ALU: exec 레인이 없으면 건너뜀 === */
+
+		case SM4_OP_MOV:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], r);
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_ADD:
+		case SM4_OP_MUL:
+		case SM4_OP_DIV:
+		case SM4_OP_LT:
+		case SM4_OP_GE:
+		case SM4_OP_EQ:
+		case SM4_OP_NE:
+		case SM4_OP_MIN:
+		case SM4_OP_MAX:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			for (int i = 0; i < 4; i++) {
+				switch (in->op) {
+				case SM4_OP_ADD: r[i] = a[i] + b[i]; break;
+				case SM4_OP_MUL: r[i] = a[i] * b[i]; break;
+				case SM4_OP_DIV: r[i] = a[i] / b[i]; break;
+				case SM4_OP_LT:  r[i] = (soa_f)(a[i] < b[i]); break;
+				case SM4_OP_GE:  r[i] = (soa_f)(a[i] >= b[i]); break;
+				case SM4_OP_EQ:  r[i] = (soa_f)(a[i] == b[i]); break;
+				case SM4_OP_NE:  r[i] = (soa_f)(a[i] != b[i]); break;
+				case SM4_OP_MIN:
+					r[i] = SOA_SELECT(a[i] < b[i], a[i], b[i]);
+					break;
+				default: /* MAX */
+					r[i] = SOA_SELECT(a[i] > b[i], a[i], b[i]);
+					break;
+				}
+			}
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_MAD:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			soa_read(vm, &in->src[2], c);
+			for (int i = 0; i < 4; i++)
+				r[i] = a[i] * b[i] + c[i];
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_DP2:
+		case SM4_OP_DP3:
+		case SM4_OP_DP4:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			r[0] = a[0]*b[0] + a[1]*b[1];
+			if (in->op != SM4_OP_DP2)
+				r[0] = r[0] + a[2]*b[2];
+			if (in->op == SM4_OP_DP4)
+				r[0] = r[0] + a[3]*b[3];
+			r[1] = r[2] = r[3] = r[0];
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_MOVC:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			soa_read(vm, &in->src[2], c);
+			for (int i = 0; i < 4; i++)
+				r[i] = SOA_SELECT((soa_i)a[i] != 0, b[i], c[i]);
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_RSQ:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			for (int i = 0; i < 4; i++)
+				for (int k = 0; k < SHADER_SOA_WIDTH; k++)
+					r[i][k] = (a[i][k] > 0.0f) ?
+						  1.0f / sqrtf(a[i][k]) : 0.0f;
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_ITOF:
+		case SM4_OP_UTOF:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			for (int i = 0; i < 4; i++)
+				r[i] = (in->op == SM4_OP_ITOF) ?
+				       __builtin_convertvector((soa_i)a[i], soa_f) :
+				       __builtin_convertvector((soa_u)a[i], soa_f);
+			soa_write(vm, &in->dst, r, exec);
+			break;
 
+		/* === 정수: 비트 패턴 그대로 레인 벡터 연산 === */
+
+		case SM4_OP_IADD: case SM4_OP_AND: case SM4_OP_OR: case SM4_OP_XOR:
+		case SM4_OP_ISHL: case SM4_OP_USHR: case SM4_OP_ISHR:
+		case SM4_OP_IEQ: case SM4_OP_INE: case SM4_OP_ILT: case SM4_OP_IGE:
+		case SM4_OP_ULT: case SM4_OP_UGE:
+		case SM4_OP_IMIN: case SM4_OP_IMAX: case SM4_OP_UMIN: case SM4_OP_UMAX:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			for (int i = 0; i < 4; i++) {
+				soa_u x = (soa_u)a[i], y = (soa_u)b[i], z;
+				soa_u lt;
+				switch (in->op) {
+				case SM4_OP_IADD: z = x + y; break;
+				case SM4_OP_AND:  z = x & y; break;
+				case SM4_OP_OR:   z = x | y; break;
+				case SM4_OP_XOR:  z = x ^ y; break;
+				case SM4_OP_ISHL: z = x << (y & 31); break;
+				case SM4_OP_USHR: z = x >> (y & 31); break;
+				case SM4_OP_ISHR:
+					z = (soa_u)((soa_i)x >> (soa_i)(y & 31));
+					break;
+				case SM4_OP_IEQ: z = (soa_u)(x == y); break;
+				case SM4_OP_INE: z = (soa_u)(x != y); break;
+				case SM4_OP_ILT: z = (soa_u)((soa_i)x < (soa_i)y); break;
+				case SM4_OP_IGE: z = (soa_u)((soa_i)x >= (soa_i)y); break;
+				case SM4_OP_ULT: z = (soa_u)(x < y); break;
+				case SM4_OP_UGE: z = (soa_u)(x >= y); break;
+				default:
+					if (in->op == SM4_OP_IMIN || in->op == SM4_OP_IMAX)
+						lt = (soa_u)((soa_i)x < (soa_i)y);
+					else
+						lt = (soa_u)(x < y);
+					if (in->op == SM4_OP_IMAX || in->op == SM4_OP_UMAX)
+						lt = ~lt;
+					z = (lt & x) | (~lt & y);
+					break;
+				}
+				r[i] = (soa_f)z;
+			}
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_INEG:
+		case SM4_OP_NOT:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			for (int i = 0; i < 4; i++)
+				r[i] = (soa_f)(in->op == SM4_OP_INEG ?
+					       -(soa_u)a[i] : ~(soa_u)a[i]);
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		case SM4_OP_IMAD:
+		case SM4_OP_UMAD:
+			if (!exec) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			soa_read(vm, &in->src[2], c);
+			for (int i = 0; i < 4; i++)
+				r[i] = (soa_f)((soa_u)a[i] * (soa_u)b[i] +
+					       (soa_u)c[i]);
+			soa_write(vm, &in->dst, r, exec);
+			break;
+
+		/* 레인별 스칼라 경로 (64비트 곱, 나눗셈, 변환, 반올림) */
+		case SM4_OP_IMUL: case SM4_OP_UMUL: case SM4_OP_UDIV:
+		case SM4_OP_FTOI: case SM4_OP_FTOU:
+		case SM4_OP_SQRT: case SM4_OP_FRC:
+		case SM4_OP_ROUND_NE: case SM4_OP_ROUND_NI:
+		case SM4_OP_ROUND_PI: case SM4_OP_ROUND_Z: {
+			if (!exec) break;
+			soa_f r2[4];
+			soa_read(vm, &in->src[0], a);
+			if (in->num_src > 1)
+				soa_read(vm, &in->src[1], b);
+			else
+				for (int i = 0; i < 4; i++)
+					b[i] = SOA_SPLAT(0.0f);
+			for (int i = 0; i < 4; i++)
+				for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+					uint32_t lo = 0;
+					r[i][k] = u2f(alu_bits(in->op, f2u(a[i][k]),
+							       f2u(b[i][k]), 0, &lo));
+					r2[i][k] = u2f(lo);
+				}
+			soa_write(vm, &in->dst, r, exec);
+			soa_write(vm, &in->dst2, r2, exec);
+			break;
+		}
+
+		/* === compute 메모리 === */
+
+		case SM5_OP_LD_RAW:
+		case SM5_OP_LD_STRUCTURED: {
+			if (!exec) break;
+			int structured = in->op == SM5_OP_LD_STRUCTURED;
+			const struct dxbc_ir_operand *mo = &in->src[structured ? 2 : 1];
+			uint32_t size = 0, stride = 0;
+			const uint8_t *mem = soa_mem(vm, ir, mo, &size, &stride);
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			soa_u ua = (soa_u)a[0], ub = (soa_u)b[0];
+			for (int i = 0; i < 4; i++)
+				r[i] = SOA_SPLAT(0.0f);
+			for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+				if (!(exec >> k & 1))
+					continue;
+				uint64_t at = structured ?
+					mem_addr(ua[k], ub[k], stride) :
+					mem_addr(0, ua[k], 0);
+				for (int i = 0; i < 4; i++)
+					r[i][k] = mem_load(mem, size,
+							   at + mo->swizzle[i] * 4u);
+			}
+			soa_write(vm, &in->dst, r, exec);
+			break;
+		}
+
+		case SM5_OP_STORE_RAW:
+		case SM5_OP_STORE_STRUCTURED: {
+			if (!exec) break;
+			int structured = in->op == SM5_OP_STORE_STRUCTURED;
+			uint32_t size = 0, stride = 0;
+			uint8_t *mem = soa_mem(vm, ir, &in->dst, &size, &stride);
+			if (!mem) break;
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			if (structured)
+				soa_read(vm, &in->src[2], c);
+			else
+				memcpy(c, b, sizeof(c));
+			soa_u ua = (soa_u)a[0], ub = (soa_u)b[0];
+			for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+				if (!(exec >> k & 1))
+					continue;
+				uint64_t at = structured ?
+					mem_addr(ua[k], ub[k], stride) :
+					mem_addr(0, ua[k], 0);
+				for (int i = 0; i < 4; i++) {
+					uint32_t v = f2u(c[i][k]);
+					if ((in->dst.mask & (1 << i)) &&
+					    at + i * 4u + 4 <= size)
+						memcpy(mem + at + i * 4u, &v, 4);
+				}
+			}
+			break;
+		}
+
+		case SM5_OP_ATOMIC_IADD:
+		case SM5_OP_IMM_ATOMIC_IADD: {
+			if (!exec) break;
+			int imm = in->op == SM5_OP_IMM_ATOMIC_IADD;
+			const struct dxbc_ir_operand *mo = imm ? &in->dst2 : &in->dst;
+			uint32_t size = 0, stride = 0;
+			uint8_t *mem = soa_mem(vm, ir, mo, &size, &stride);
+			/* 주소: structured는 .x = index, .y = offset, raw는 .x */
+			soa_read(vm, &in->src[0], a);
+			soa_read(vm, &in->src[1], b);
+			soa_u ua = (soa_u)a[0], ua1 = (soa_u)a[1], ub = (soa_u)b[0];
+			r[0] = SOA_SPLAT(0.0f);
+			for (int k = 0; k < SHADER_SOA_WIDTH; k++) {
+				if (!(exec >> k & 1))
+					continue;
+				uint64_t at = stride ?
+					mem_addr(ua[k], ua1[k], stride) :
+					mem_addr(0, ua[k], 0);
+				uint32_t old = 0;
+				/* 다른 그룹(다른 워커 스레드)과 경쟁하므로 atomic */
+				if (mem && at + 4 <= size)
+					old = __atomic_fetch_add(
+						(uint32_t *)(mem + at), ub[k],
+						__ATOMIC_RELAXED);
+				r[0][k] = u2f(old);
+			}
+			if (imm) {
+				r[1] = r[2] = r[3] = r[0];
+				soa_write(vm, &in->dst, r, exec);
+			}
+			break;
+		}
+
+		case SM5_OP_SYNC:
+			if (!(in->flags & DXBC_IR_FLAG_SYNC_GROUP))
+				break;   /* 메모리 펜스만: 그룹을 순서대로 돌리므로 할 일 없음 */
+			/* 그룹 배리어: 상태를 저장하고 호출자에게 양보 */
+			vm->pc = pc;
+			vm->sp = sp;
+			vm->exec = exec;
+			vm->alive = alive;
+			vm->loop_active = loop_active;
+			return 1;
+
+		/* === 흐름 제어 === */
+
+		case SM4_OP_IF: {
+			if (sp >= SOA_MAX_FLOW)
+				return -1;
+			soa_read(vm, &in->src[0], a);
+			unsigned nz = soa_nonzero_lanes(&a[0]);
+			unsigned take = (in->flags & DXBC_IR_FLAG_NZ) ? nz : ~nz;
+			stack[sp].is_loop = 0;
+			stack[sp].saved = exec;
+			stack[sp].else_lanes = exec & ~take;
+			sp++;
+			exec &= take;
+			/* 실행할 레인이 없으면 ELSE 또는 ENDIF로 */
+			if (!exec && in->target > 0)
+				pc = in->target - 1;
+			break;
+		}
+
+		case SM4_OP_ELSE:
+			if (sp > 0 && !stack[sp - 1].is_loop) {
+				exec = stack[sp - 1].else_lanes & alive & loop_active;
+				if (!exec && in->target > 0)
+					pc = in->target - 1;  /* → ENDIF */
+			}
+			break;
+
+		case SM4_OP_ENDIF:
+			if (sp > 0 && !stack[sp - 1].is_loop) {
+				sp--;
+				exec = stack[sp].saved & alive & loop_active;
+			}
+			break;
+
+		case SM4_OP_LOOP:
+			if (sp >= SOA_MAX_FLOW)
+				return -1;
+			stack[sp].is_loop = 1;
+			stack[sp].saved = exec;
+			stack[sp].outer_active = loop_active;
+			stack[sp].iter = 0;
+			sp++;
+			loop_active = exec;
+			break;
+
+		case SM4_OP_ENDLOOP: {
+			if (sp == 0 || !stack[sp - 1].is_loop)
+				break;
+			struct shader_vm_flow *f = &stack[sp - 1];
+			exec = loop_active & alive;
+			if (exec && ++f->iter <= 1024 && in->target >= 0) {
+				loop_active = exec;
+				pc = in->target;
+			} else {
+				/* 모든 레인 탈출 (또는 무한 루프 방지) */
+				loop_active = f->outer_active;
+				exec = f->saved & alive & loop_active;
+				sp--;
+			}
+			break;
+		}
+
+		case SM4_OP_BREAK:
+		case SM4_OP_BREAKC: {
+			unsigned brk = exec;
+			if (in->op == SM4_OP_BREAKC) {
+				soa_read(vm, &in->src[0], a);
+				unsigned nz = soa_nonzero_lanes(&a[0]);
+				brk &= (in->flags & DXBC_IR_FLAG_NZ) ? nz : ~nz;
+			}
+			loop_active &= ~brk;
+			exec &= ~brk;
+			if (loop_active)
+				break;
+
+			/* 루프 안에 남은 레인이 없음 → ENDLOOP 다음으로 */
+			while (sp > 0 && !stack[sp - 1].is_loop)
+				sp--;
+			if (sp > 0) {
+				sp--;
+				loop_active = stack[sp].outer_active;
+				exec = stack[sp].saved & alive & loop_active;
+			}
+			pc = in->target;
+			break;
+		}
+
+		case SM4_OP_RET:
+			alive &= ~exec;
+			exec = 0;
+			if (!alive)
+				return 0;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int shader_vm_soa_begin(struct shader_vm_soa *vm,
+			const struct dxbc_info *info, unsigned lanes)
+{
+	const struct dxbc_ir *ir = info->ir;
+	if (!info->valid || !ir)
+		return -1;
+
+	/* 레지스터가 크므로(1KB/8개) 참조되는 것만 초기화 */
+	memset(vm->temps, 0, (size_t)ir->num_temps * sizeof(vm->temps[0]));
+	memset(vm->outputs, 0, (size_t)ir->num_outputs * sizeof(vm->outputs[0]));
+
+	vm->pc = 0;
+	vm->sp = 0;
+	vm->exec = vm->alive = vm->loop_active = lanes & SOA_ALL_LANES;
 	return 0;
 }
+
+int shader_vm_soa_run(struct shader_vm_soa *vm, const struct dxbc_info *info)
+{
+	if (!info->valid || !info->ir)
+		return -1;
+	return soa_run(vm, info->ir);
+}
+
+int shader_vm_execute_soa(struct shader_vm_soa *vm,
+			  const struct dxbc_info *info, unsigned lanes)
+{
+	if (shader_vm_soa_begin(vm, info, lanes) < 0)
+		return -1;
+
+	/* 배치 하나뿐이므로 배리어는 그냥 통과 */
+	int ret;
+	do
+		ret = soa_run(vm, info->ir);
+	while (ret == 1);
+	return ret;
+}
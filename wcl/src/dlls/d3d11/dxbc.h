@@ -10,6 +10,10 @@
  *   ├─ ISGN: 입력 시맨틱 (POSITION, COLOR, TEXCOORD)
  *   ├─ OSGN: 출력 시맨틱 (SV_Position, COLOR)
  *   └─ SHDR: SM4 바이트코드 (실제 명령어)
+ *
+ * Compute 셰이더(SM5 cs_5_0)는 SoA VM으로 thread group의 스레드를
+ * 레인에 나눠 실행한다. UAV(u#)/TGSM(g#)/버퍼 SRV(t#)는 raw·structured
+ * 버퍼만 지원 (typed UAV load/store는 미지원).
  */
 
 #ifndef CITC_DXBC_H
@@ -21,19 +25,42 @@
 #define DXBC_MAX_INPUTS  8
 #define DXBC_MAX_OUTPUTS 8
 #define DXBC_MAX_TEMPS   32
+#define DXBC_MAX_UAVS    8
+#define DXBC_MAX_BUFFERS 8   /* t# 버퍼 SRV */
+#define DXBC_MAX_TGSM    8
+#define DXBC_MAX_TGSM_BYTES 32768  /* D3D11 그룹당 공유 메모리 한도 */
 
 /* SM4 opcodes */
 #define SM4_OP_ADD              0
+#define SM4_OP_AND              1
 #define SM4_OP_BREAK            2
 #define SM4_OP_BREAKC           3
+#define SM4_OP_DIV             14
+#define SM4_OP_DP2             15
 #define SM4_OP_DP3             16
 #define SM4_OP_DP4             17
 #define SM4_OP_ELSE            18
 #define SM4_OP_ENDIF           21
 #define SM4_OP_ENDLOOP         22
 #define SM4_OP_EQ              24
+#define SM4_OP_FRC             26
+#define SM4_OP_FTOI            27
+#define SM4_OP_FTOU            28
 #define SM4_OP_GE              29
+#define SM4_OP_IADD            30
 #define SM4_OP_IF              31
+#define SM4_OP_IEQ             32
+#define SM4_OP_IGE             33
+#define SM4_OP_ILT             34
+#define SM4_OP_IMAD            35
+#define SM4_OP_IMAX            36
+#define SM4_OP_IMIN            37
+#define SM4_OP_IMUL            38
+#define SM4_OP_INE             39
+#define SM4_OP_INEG            40
+#define SM4_OP_ISHL            41
+#define SM4_OP_ISHR            42
+#define SM4_OP_ITOF            43
 #define SM4_OP_LOOP            48
 #define SM4_OP_LT              49
 #define SM4_OP_MAD             50
@@ -43,11 +70,45 @@
 #define SM4_OP_MOVC            55
 #define SM4_OP_MUL             56
 #define SM4_OP_NE              57
+#define SM4_OP_NOT             59
+#define SM4_OP_OR              60
 #define SM4_OP_RET             62
+#define SM4_OP_ROUND_NE        64
+#define SM4_OP_ROUND_NI        65
+#define SM4_OP_ROUND_PI        66
+#define SM4_OP_ROUND_Z         67
 #define SM4_OP_RSQ             68
 #define SM4_OP_SAMPLE          69
 #define SM4_OP_SAMPLE_L        72
+#define SM4_OP_SQRT            75
+#define SM4_OP_UDIV            78
+#define SM4_OP_ULT             79
+#define SM4_OP_UGE             80
+#define SM4_OP_UMUL            81
+#define SM4_OP_UMAD            82
+#define SM4_OP_UMAX            83
+#define SM4_OP_UMIN            84
+#define SM4_OP_USHR            85
+#define SM4_OP_UTOF            86
+#define SM4_OP_XOR             87
 #define SM4_OP_DCL_RESOURCE    88
+#define SM4_OP_DCL_GLOBAL_FLAGS 106
+
+/* SM5 compute */
+#define SM5_OP_DCL_THREAD_GROUP        155
+#define SM5_OP_DCL_UAV_RAW             157
+#define SM5_OP_DCL_UAV_STRUCTURED      158
+#define SM5_OP_DCL_TGSM_RAW            159
+#define SM5_OP_DCL_TGSM_STRUCTURED     160
+#define SM5_OP_DCL_RESOURCE_RAW        161
+#define SM5_OP_DCL_RESOURCE_STRUCTURED 162
+#define SM5_OP_LD_RAW                  165
+#define SM5_OP_STORE_RAW               166
+#define SM5_OP_LD_STRUCTURED           167
+#define SM5_OP_STORE_STRUCTURED        168
+#define SM5_OP_ATOMIC_IADD             173
+#define SM5_OP_IMM_ATOMIC_IADD         180
+#define SM5_OP_SYNC                    190
 
 /* SM4 operand types */
 #define SM4_OPERAND_TEMP     0
@@ -57,6 +118,22 @@
 #define SM4_OPERAND_SAMPLER  6
 #define SM4_OPERAND_RESOURCE 7
 #define SM4_OPERAND_CB       8
+#define SM5_OPERAND_UAV      30
+#define SM5_OPERAND_TGSM     31
+#define SM5_OPERAND_THREAD_ID              32  /* SV_DispatchThreadID */
+#define SM5_OPERAND_THREAD_GROUP_ID        33  /* SV_GroupID */
+#define SM5_OPERAND_THREAD_ID_IN_GROUP     34  /* SV_GroupThreadID */
+#define SM5_OPERAND_THREAD_ID_IN_GROUP_FLAT 36 /* SV_GroupIndex */
+
+/*
+ * compute 셰이더의 시스템 값 입력은 v#와 겹치지 않으므로
+ * (CS에는 입력 시그니처가 없음) 입력 레지스터 0..3에 둔다.
+ * 값은 uint 비트 패턴.
+ */
+#define DXBC_CS_INPUT_THREAD_ID       0
+#define DXBC_CS_INPUT_GROUP_ID        1
+#define DXBC_CS_INPUT_THREAD_IN_GROUP 2
+#define DXBC_CS_INPUT_GROUP_INDEX     3
 
 /* 시그니처 엘리먼트 */
 struct dxbc_sig_element {
@@ -67,6 +144,9 @@ struct dxbc_sig_element {
 	int mask;           /* xyzw bitmask */
 };
 
+struct dxbc_ir;
+struct shader_vm;
+
 /* 파싱된 DXBC 정보 */
 struct dxbc_info {
 	int valid;
@@ -81,6 +161,84 @@ struct dxbc_info {
 	const uint32_t *shader_tokens;  /* SHDR 데이터 시작 포인터 */
 	int shader_token_count;         /* SHDR 데이터 DWORD 수 */
 	int num_temps;
+
+	struct dxbc_ir *ir;             /* dxbc_lower() 결과, NULL = 미생성 */
+};
+
+/* ============================================================
+ * 사전 디코딩된 IR (Intermediate Representation)
+ * ============================================================
+ *
+ * SM4 토큰 스트림은 셰이더 생성 시 한 번만 디코딩해서
+ * 명령어 배열로 바꿔 둔다. VM은 이 배열만 실행하므로 정점/픽셀마다
+ * 오퍼랜드 비트 해석, swizzle 추출, 제어 흐름 스캔을 반복하지 않는다.
+ *
+ *   - 레지스터 오퍼랜드: struct shader_vm 안의 바이트 오프셋으로 해석
+ *   - 즉치값: 오퍼랜드 안에 float4로 보관
+ *   - if/else/loop/break: 점프 대상 IR 인덱스를 미리 계산
+ *   - dcl_* 및 미지원 명령어: IR에서 제거
+ */
+
+enum dxbc_ir_file {
+	DXBC_IR_NULL = 0,   /* 읽으면 0, 쓰기는 무시 */
+	DXBC_IR_REG,        /* temp/input/output — shader_vm 내 오프셋 */
+	DXBC_IR_IMM,        /* 즉치값 */
+	DXBC_IR_CB,         /* constant buffer (실행 시 크기 검사) */
+	DXBC_IR_UAV,        /* u# — index = 슬롯 */
+	DXBC_IR_TGSM,       /* g# — index = 선언 번호 */
+	DXBC_IR_BUFFER,     /* t# 버퍼 SRV — index = 슬롯 */
+};
+
+struct dxbc_ir_operand {
+	uint8_t file;       /* enum dxbc_ir_file */
+	uint8_t mask;       /* dst: 쓰기 마스크 / src: 유효 컴포넌트 (나머지 0) */
+	uint8_t swizzle[4]; /* src: 컴포넌트 선택 */
+	uint8_t cb_slot;    /* CB: 슬롯 번호 */
+	uint8_t reg_type;   /* REG: SM4_OPERAND_TEMP/INPUT/OUTPUT */
+	uint16_t offset;    /* REG: shader_vm 내 바이트 오프셋 / CB: float4 인덱스 */
+	uint16_t index;     /* REG: 레지스터 번호 */
+	float imm[4];       /* IMM: 값 */
+};
+
+#define DXBC_IR_FLAG_NZ          1  /* if_nz / breakc_nz */
+#define DXBC_IR_FLAG_SYNC_GROUP  2  /* sync_g_t: 그룹 내 스레드 배리어 */
+
+struct dxbc_ir_inst {
+	uint16_t op;        /* SM4 opcode */
+	uint8_t num_src;
+	uint8_t flags;
+	int32_t target;     /* if/else/break(c)/endloop 점프 대상 IR 인덱스 */
+	struct dxbc_ir_operand dst;
+	struct dxbc_ir_operand dst2;  /* imul/umul/udiv의 두 번째 결과,
+					 imm_atomic의 메모리 대상 */
+	struct dxbc_ir_operand src[3];
+};
+
+/* g# 선언: 그룹 공유 메모리 안의 위치 */
+struct dxbc_ir_tgsm {
+	uint32_t offset;    /* 바이트 */
+	uint32_t stride;    /* structured: 원소 크기, raw: 0 */
+	uint32_t size;      /* 바이트 */
+};
+
+struct dxbc_ir {
+	struct dxbc_ir_inst *insts;
+	int num_insts;
+	int num_temps;      /* 참조되는 temp 수 (max index + 1) */
+	int num_outputs;    /* 참조되는 output 수 (max index + 1) */
+
+	/* compute 선언 */
+	int group_size[3];                      /* dcl_thread_group */
+	uint32_t uav_stride[DXBC_MAX_UAVS];     /* 0 = raw */
+	uint32_t buffer_stride[DXBC_MAX_BUFFERS];
+	struct dxbc_ir_tgsm tgsm[DXBC_MAX_TGSM];
+	uint32_t tgsm_bytes;                    /* 그룹당 공유 메모리 합계 */
+	int has_sync;                           /* sync_g_t 사용 여부 */
+
+	/* 네이티브 코드 (dxbc_jit.c), NULL = VM으로 실행 */
+	void (*jit)(struct shader_vm *vm);
+	void *jit_mem;
+	size_t jit_size;
 };
 
 /* 셰이더 VM 상태 */
@@ -94,10 +252,136 @@ struct shader_vm {
 	int cb_size[4];     /* 바이트 단위 */
 };
 
+/*
+ * SoA 셰이더 VM 상태 — 픽셀 SHADER_SOA_WIDTH개를 한 번에 실행
+ *
+ * 레지스터 하나가 [컴포넌트][레인] 배열이라 ADD/MUL/MAD/DP4 같은
+ * ALU 명령어가 레인 방향 벡터 연산이 된다. 레인 순서는 래스터라이저의
+ * 4x2 블록(2x2 쿼드 두 개)과 같다. compute에서는 thread group의
+ * 스레드 8개가 레인 하나씩을 맡는다.
+ */
+#define SHADER_SOA_WIDTH 8
+#define SHADER_SOA_MAX_FLOW 32
+
+/* UAV / 버퍼 SRV 바인딩 */
+struct shader_vm_buffer {
+	uint8_t *data;
+	uint32_t size;      /* 바이트 */
+};
+
+/* if/loop 스택 항목 (dxbc.c 내부용) */
+struct shader_vm_flow {
+	int is_loop;
+	unsigned saved;        /* 진입 시 exec */
+	unsigned else_lanes;   /* IF: else 블록 레인 */
+	unsigned outer_active; /* LOOP: 바깥 루프의 loop_active */
+	int iter;              /* LOOP: 반복 횟수 */
+};
+
+struct shader_vm_soa {
+	float temps[DXBC_MAX_TEMPS][4][SHADER_SOA_WIDTH];
+	float inputs[DXBC_MAX_INPUTS][4][SHADER_SOA_WIDTH];
+	float outputs[DXBC_MAX_OUTPUTS][4][SHADER_SOA_WIDTH];
+
+	/* Constant buffers (모든 레인 공통) */
+	const float *cb[4];
+	int cb_size[4];     /* 바이트 단위 */
+
+	/* compute 메모리 (모든 레인 공통) */
+	struct shader_vm_buffer uav[DXBC_MAX_UAVS];
+	struct shader_vm_buffer buffer[DXBC_MAX_BUFFERS];
+	uint8_t *tgsm;      /* 그룹 공유 메모리, ir->tgsm_bytes 크기 */
+
+	/* sync에서 멈췄다 재개하기 위한 실행 상태 */
+	int pc, sp;
+	unsigned exec, alive, loop_active;
+	struct shader_vm_flow flow[SHADER_SOA_MAX_FLOW];
+} __attribute__((aligned(32)));
+
 /* DXBC 컨테이너 파싱 */
 int dxbc_parse(const void *bytecode, size_t size, struct dxbc_info *info);
 
-/* 셰이더 VM 실행 — 성공 시 0 반환 */
+/*
+ * SM4 토큰 → IR 변환 (셰이더 생성 시 1회).
+ * 결과는 info->ir에 저장. 성공 시 0 반환.
+ */
+int dxbc_lower(struct dxbc_info *info);
+
+/* IR 해제 */
+void dxbc_free_ir(struct dxbc_info *info);
+
+/*
+ * 네이티브 커널 분류
+ *
+ * 2D/UI 셰이더는 대부분 몇 가지 모양뿐이다. 셰이더 생성 시 토큰
+ * 스트림을 아래 관용구와 맞춰 보고, 맞으면 래스터라이저가 VM 대신
+ * 전용 코드로 실행한다 (d3d11.c). 결과는 VM과 비트 단위로 같다.
+ *
+ *   VS_PASS      o0 = v0
+ *   VS_XFORM     o0 = mul(v0, cb0[0..3])  — dp4 행 4개 또는 mul+mad×3
+ *   PS_COLOR     o0 = v1
+ *   PS_TEX       o0 = t0.Sample(s0, v2.xy)
+ *   PS_TEX_COLOR o0 = t0.Sample(s0, v2.xy) * v1
+ *
+ * VS는 o1 = v1, o2 = v2 복사가 있어도 된다 (pass_mask).
+ * 다른 명령어가 하나라도 섞이면 NONE (VM/JIT 사용).
+ */
+enum dxbc_kernel_kind {
+	DXBC_KERNEL_NONE = 0,
+	DXBC_KERNEL_VS_PASS,
+	DXBC_KERNEL_VS_XFORM,
+	DXBC_KERNEL_PS_COLOR,
+	DXBC_KERNEL_PS_TEX,
+	DXBC_KERNEL_PS_TEX_COLOR,
+};
+
+struct dxbc_kernel {
+	enum dxbc_kernel_kind kind;
+	/*
+	 * VS_XFORM: 1이면 dp4 형태 (o0.c = dot(v0, cb0[c]), 행렬이 전치됨),
+	 * 0이면 mul/mad 형태 (o0 = Σ v0[r] * cb0[r])
+	 */
+	int transposed;
+	unsigned pass_mask; /* VS: bit r = o# r에 v# r 복사 (r = 1, 2) */
+};
+
+/* SHDR 토큰 스트림을 분류. 맞는 관용구가 없으면 kind = NONE */
+void dxbc_classify(const struct dxbc_info *info, struct dxbc_kernel *out);
+
+/*
+ * 셰이더 VM 실행 — 성공 시 0 반환
+ *
+ * JIT 코드가 있으면 그것을 호출하고, 없으면 IR을 해석한다.
+ * 호출자는 inputs/cb만 채우면 된다. 실행 시작 시 사용되는 temp와
+ * outputs만 0으로 초기화하므로 shader_vm 전체를 memset할 필요가 없다.
+ * (같은 vm을 여러 번 재사용 가능 — 픽셀/정점마다 inputs만 갱신)
+ */
 int shader_vm_execute(struct shader_vm *vm, const struct dxbc_info *info);
 
+/*
+ * SoA 셰이더 VM 실행 — 성공 시 0 반환
+ *
+ * lanes: 실행할 레인 마스크 (bit k = 레인 k). 꺼진 레인의 출력은 정의되지 않음.
+ * 셰이더가 참조하는 temp/output만 0으로 초기화하므로, 호출자는 vm을
+ * 처음 한 번 0으로 채워 두고 이후에는 inputs만 갱신하면 된다.
+ * 제어 흐름은 레인별 실행 마스크로 처리하므로 각 레인의 결과는
+ * shader_vm_execute()로 한 픽셀씩 실행한 결과와 같다.
+ */
+int shader_vm_execute_soa(struct shader_vm_soa *vm,
+			  const struct dxbc_info *info, unsigned lanes);
+
+/*
+ * compute용 재개 가능한 SoA 실행
+ *
+ * begin()은 temp를 초기화하고 실행 상태를 처음으로 돌린다.
+ * run()은 끝까지 실행하면 0, 그룹 배리어(sync_g_t)에 도달하면 1,
+ * 오류면 -1을 반환한다. 1을 받은 호출자는 같은 그룹의 다른 배치도
+ * 배리어까지 실행시킨 뒤 다시 run()을 호출한다.
+ * (배리어는 HLSL 규칙상 균일한 제어 흐름에만 올 수 있으므로
+ *  모든 배치가 같은 sync 명령어에서 멈춘다.)
+ */
+int shader_vm_soa_begin(struct shader_vm_soa *vm,
+			const struct dxbc_info *info, unsigned lanes);
+int shader_vm_soa_run(struct shader_vm_soa *vm, const struct dxbc_info *info);
+
 #endif /* CITC_DXBC_H */
@@ -0,0 +1,649 @@
+/*
+ * dxbc_jit.c — DXBC IR → x86-64 SSE 네이티브 코드 JIT
+ * ====================================================
+ *
+ * IR 명령어 하나를 SSE 명령어 몇 개로 번역한다.
+ *
+ * 레지스터 사용:
+ *   rdi        = struct shader_vm *
+ *   xmm0..2    = 소스 오퍼랜드 0..2 → 결과는 xmm0
+ *   xmm3..7    = 임시
+ *   eax        = 조건 검사 / CB 포인터 (rax)
+ *   ecx, edx, r8d, r9d = 루프 깊이 0..3의 반복 카운터
+ *
+ * 즉치값과 마스크 상수는 코드 뒤의 상수 풀에 두고 RIP 상대 주소로 읽는다.
+ * 점프 대상(IR 인덱스)은 명령어별 코드 오프셋을 기록한 뒤 한 번에 패치.
+ *
+ * 인터프리터(dxbc.c)와 같은 결과를 내도록:
+ *   - MAD는 mulps + addps (FMA 미사용)
+ *   - DP3/DP4는 x, y, z(, w) 순서로 스칼라 덧셈
+ *   - GE는 cmpleps(b, a) — NaN이면 false
+ *   - CB 범위 검사는 실행 시 cb_size와 비교
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dxbc_jit.h"
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#define DXBC_JIT_X86 1
+#endif
+
+static int g_jit_enabled = -1;
+
+int dxbc_jit_enabled(void)
+{
+	int en = __atomic_load_n(&g_jit_enabled, __ATOMIC_RELAXED);
+	if (en < 0) {
+		const char *env = getenv("CITC_D3D11_JIT");
+		en = (env && env[0] == '1') ? 1 : 0;
+		__atomic_store_n(&g_jit_enabled, en, __ATOMIC_RELAXED);
+	}
+	return en;
+}
+
+#ifdef DXBC_JIT_X86
+
+#define JIT_MAX_LOOP_DEPTH 4   /* 카운터 레지스터 수 */
+#define JIT_LOOP_LIMIT     1024
+
+/* ---- 코드 버퍼 ---- */
+
+struct jit_fixup {
+	int pos;     /* rel32/disp32 위치 */
+	int target;  /* 점프: IR 인덱스 / 상수: 풀 인덱스 */
+};
+
+struct jit_buf {
+	uint8_t *code;
+	int len, cap;
+	int failed;
+
+	float (*pool)[4];            /* 상수 풀 (16바이트 단위) */
+	int pool_len, pool_cap;
+
+	struct jit_fixup *jumps;     /* IR 인덱스 점프 */
+	int num_jumps, cap_jumps;
+	struct jit_fixup *consts;    /* RIP 상대 상수 참조 */
+	int num_consts, cap_consts;
+};
+
+static void *grow(void *p, int *cap, int need, size_t elem)
+{
+	if (need <= *cap) return p;
+	int ncap = *cap ? *cap * 2 : 64;
+	while (ncap < need) ncap *= 2;
+	void *np = realloc(p, (size_t)ncap * elem);
+	if (np) *cap = ncap;
+	return np;
+}
+
+static void emit(struct jit_buf *b, const uint8_t *bytes, int n)
+{
+	if (b->failed) return;
+	uint8_t *np = grow(b->code, &b->cap, b->len + n, 1);
+	if (!np) { b->failed = 1; return; }
+	b->code = np;
+	memcpy(b->code + b->len, bytes, (size_t)n);
+	b->len += n;
+}
+
+static void emit1(struct jit_buf *b, uint8_t x) { emit(b, &x, 1); }
+
+static void emit32(struct jit_buf *b, int32_t v)
+{
+	uint8_t x[4] = { (uint8_t)v, (uint8_t)(v >> 8),
+			 (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+	emit(b, x, 4);
+}
+
+static void add_fixup(struct jit_buf *b, struct jit_fixup **arr, int *num,
+		      int *cap, int target)
+{
+	if (b->failed) return;
+	struct jit_fixup *np = grow(*arr, cap, *num + 1, sizeof(**arr));
+	if (!np) { b->failed = 1; return; }
+	*arr = np;
+	(*arr)[*num].pos = b->len;
+	(*arr)[*num].target = target;
+	(*num)++;
+}
+
+/* 상수 풀에 float4 추가 → 인덱스 */
+static int pool_add(struct jit_buf *b, const float v[4])
+{
+	for (int i = 0; i < b->pool_len; i++)
+		if (memcmp(b->pool[i], v, 16) == 0)
+			return i;
+	float (*np)[4] = grow(b->pool, &b->pool_cap, b->pool_len + 1, 16);
+	if (!np) { b->failed = 1; return 0; }
+	b->pool = np;
+	memcpy(b->pool[b->pool_len], v, 16);
+	return b->pool_len++;
+}
+
+static int pool_add_bits(struct jit_buf *b, uint32_t x, uint32_t y,
+			 uint32_t z, uint32_t w)
+{
+	uint32_t bits[4] = { x, y, z, w };
+	float v[4];
+	memcpy(v, bits, 16);
+	return pool_add(b, v);
+}
+
+/* ---- SSE 인코딩 (xmm0..7만 사용하므로 REX 불필요) ---- */
+
+#define RDI 7
+#define RAX 0
+
+/* [prefix] 0F op  xmm, xmm */
+static void sse_rr(struct jit_buf *b, uint8_t prefix, uint8_t op,
+		   int dst, int src)
+{
+	if (prefix) emit1(b, prefix);
+	uint8_t x[3] = { 0x0F, op, (uint8_t)(0xC0 | (dst << 3) | src) };
+	emit(b, x, 3);
+}
+
+/* [prefix] 0F op  xmm, [base + disp32] */
+static void sse_rm(struct jit_buf *b, uint8_t prefix, uint8_t op,
+		   int reg, int base, int32_t disp)
+{
+	if (prefix) emit1(b, prefix);
+	uint8_t x[3] = { 0x0F, op, (uint8_t)(0x80 | (reg << 3) | base) };
+	emit(b, x, 3);
+	emit32(b, disp);
+}
+
+/* [prefix] 0F op  xmm, [rip + 상수 풀] */
+static void sse_rc(struct jit_buf *b, uint8_t prefix, uint8_t op,
+		   int reg, int pool_idx)
+{
+	if (prefix) emit1(b, prefix);
+	uint8_t x[3] = { 0x0F, op, (uint8_t)(0x05 | (reg << 3)) };
+	emit(b, x, 3);
+	add_fixup(b, &b->consts, &b->num_consts, &b->cap_consts, pool_idx);
+	emit32(b, 0);
+}
+
+#define OP_MOVUPS_LD 0x10
+#define OP_MOVUPS_ST 0x11
+#define OP_MOVAPS    0x28
+#define OP_SQRTPS    0x51
+#define OP_ANDPS     0x54
+#define OP_ANDNPS    0x55
+#define OP_ORPS      0x56
+#define OP_XORPS     0x57
+#define OP_ADDPS     0x58
+#define OP_MULPS     0x59
+#define OP_MINPS     0x5D
+#define OP_DIVPS     0x5E
+#define OP_MAXPS     0x5F
+#define OP_CVTDQ2PS  0x5B
+#define OP_PSHUFD    0x70   /* 66 */
+#define OP_PSHIFTD   0x72   /* 66: psrld/psrad/pslld xmm, imm8 (/2 /4 /6) */
+#define OP_PCMPEQD   0x76   /* 66 */
+#define OP_MOVD_ST   0x7E   /* 66: movd r32, xmm */
+#define OP_CMPPS     0xC2
+#define OP_SHUFPS    0xC6
+
+#define CMP_EQ  0
+#define CMP_LT  1
+#define CMP_LE  2
+#define CMP_NEQ 4
+
+static void sse_rr_imm(struct jit_buf *b, uint8_t prefix, uint8_t op,
+		       int dst, int src, uint8_t imm)
+{
+	sse_rr(b, prefix, op, dst, src);
+	emit1(b, imm);
+}
+
+static void load_vm(struct jit_buf *b, int reg, int off)
+{
+	sse_rm(b, 0, OP_MOVUPS_LD, reg, RDI, off);
+}
+
+static void store_vm(struct jit_buf *b, int reg, int off)
+{
+	sse_rm(b, 0, OP_MOVUPS_ST, reg, RDI, off);
+}
+
+/* ---- 분기 ---- */
+
+#define JCC_Z  0x84
+#define JCC_NZ 0x85
+#define JCC_LE 0x8E
+#define JCC_L  0x8C
+
+/* 분기 대상이 IR 인덱스인 jmp/jcc (target == num_insts → 함수 끝) */
+static void jmp_ir(struct jit_buf *b, int jcc, int target)
+{
+	if (jcc) {
+		uint8_t x[2] = { 0x0F, (uint8_t)jcc };
+		emit(b, x, 2);
+	} else {
+		emit1(b, 0xE9);
+	}
+	add_fixup(b, &b->jumps, &b->num_jumps, &b->cap_jumps, target);
+	emit32(b, 0);
+}
+
+/* 코드 내부 전방 분기: 위치 반환 후 patch_local로 해결 */
+static int jcc_local(struct jit_buf *b, int jcc)
+{
+	if (jcc) {
+		uint8_t x[2] = { 0x0F, (uint8_t)jcc };
+		emit(b, x, 2);
+	} else {
+		emit1(b, 0xE9);
+	}
+	int pos = b->len;
+	emit32(b, 0);
+	return pos;
+}
+
+static void patch_local(struct jit_buf *b, int pos)
+{
+	if (b->failed) return;
+	int32_t rel = b->len - (pos + 4);
+	memcpy(b->code + pos, &rel, 4);
+}
+
+/* 루프 카운터: 깊이 0..3 → ecx, edx, r8d, r9d */
+static void loop_counter_op(struct jit_buf *b, int depth, int op)
+{
+	static const uint8_t reg[JIT_MAX_LOOP_DEPTH] = { 1, 2, 0, 1 };
+	int rex = depth >= 2;
+	int r = reg[depth];
+
+	switch (op) {
+	case 0: /* xor r, r */
+		if (rex) emit1(b, 0x45);
+		emit1(b, 0x31);
+		emit1(b, (uint8_t)(0xC0 | (r << 3) | r));
+		break;
+	case 1: /* inc r */
+		if (rex) emit1(b, 0x41);
+		emit1(b, 0xFF);
+		emit1(b, (uint8_t)(0xC0 | r));
+		break;
+	case 2: /* cmp r, JIT_LOOP_LIMIT */
+		if (rex) emit1(b, 0x41);
+		emit1(b, 0x81);
+		emit1(b, (uint8_t)(0xF8 | r));
+		emit32(b, JIT_LOOP_LIMIT);
+		break;
+	}
+}
+
+/* ---- 오퍼랜드 ---- */
+
+static int is_identity(const uint8_t sw[4])
+{
+	return sw[0] == 0 && sw[1] == 1 && sw[2] == 2 && sw[3] == 3;
+}
+
+/* 소스 오퍼랜드 → xmm reg (ir_read와 같은 의미) */
+static void load_src(struct jit_buf *b, const struct dxbc_ir_operand *o,
+		     int reg)
+{
+	switch (o->file) {
+	case DXBC_IR_REG:
+		load_vm(b, reg, o->offset);
+		break;
+
+	case DXBC_IR_IMM:
+		sse_rc(b, 0, OP_MOVUPS_LD, reg, pool_add(b, o->imm));
+		return;
+
+	case DXBC_IR_CB: {
+		/*
+		 * mov rax, vm->cb[slot]
+		 * test rax, rax ; jz zero
+		 * cmp dword vm->cb_size[slot], need ; jl zero
+		 * movups reg, [rax + offset*16] ; jmp done
+		 * zero: xorps reg, reg
+		 */
+		int cb_off = (int)(offsetof(struct shader_vm, cb) +
+				   (size_t)o->cb_slot * sizeof(void *));
+		int sz_off = (int)(offsetof(struct shader_vm, cb_size) +
+				   (size_t)o->cb_slot * sizeof(int));
+		int need = ((int)o->offset * 4 + 4) * (int)sizeof(float);
+
+		uint8_t mov_rax[3] = { 0x48, 0x8B, 0x87 };
+		emit(b, mov_rax, 3);
+		emit32(b, cb_off);
+		uint8_t test_rax[3] = { 0x48, 0x85, 0xC0 };
+		emit(b, test_rax, 3);
+		int j0 = jcc_local(b, JCC_Z);
+		uint8_t cmp[2] = { 0x81, 0xBF };
+		emit(b, cmp, 2);
+		emit32(b, sz_off);
+		emit32(b, need);
+		int j1 = jcc_local(b, JCC_L);
+		sse_rm(b, 0, OP_MOVUPS_LD, reg, RAX, (int32_t)o->offset * 16);
+		int j2 = jcc_local(b, 0);
+		patch_local(b, j0);
+		patch_local(b, j1);
+		sse_rr(b, 0, OP_XORPS, reg, reg);
+		int j3 = jcc_local(b, 0);
+		patch_local(b, j2);
+		/* 로드 성공 경로만 swizzle/mask 적용 */
+		if (!is_identity(o->swizzle))
+			sse_rr_imm(b, 0x66, OP_PSHUFD, reg, reg,
+				   (uint8_t)(o->swizzle[0] | o->swizzle[1] << 2 |
+					     o->swizzle[2] << 4 | o->swizzle[3] << 6));
+		if (o->mask != 0xF)
+			sse_rc(b, 0, OP_ANDPS, reg,
+			       pool_add_bits(b, 0xFFFFFFFF, 0, 0, 0));
+		patch_local(b, j3);
+		return;
+	}
+
+	default:
+		sse_rr(b, 0, OP_XORPS, reg, reg);
+		return;
+	}
+
+	if (!is_identity(o->swizzle))
+		sse_rr_imm(b, 0x66, OP_PSHUFD, reg, reg,
+			   (uint8_t)(o->swizzle[0] | o->swizzle[1] << 2 |
+				     o->swizzle[2] << 4 | o->swizzle[3] << 6));
+	/* 스칼라 소스: x만 유효, 나머지 0 */
+	if (o->mask != 0xF)
+		sse_rc(b, 0, OP_ANDPS, reg, pool_add_bits(b, 0xFFFFFFFF, 0, 0, 0));
+}
+
+/* xmm0 → 대상 오퍼랜드 (쓰기 마스크 적용) */
+static void store_dst(struct jit_buf *b, const struct dxbc_ir_operand *o)
+{
+	if (o->file != DXBC_IR_REG || o->mask == 0)
+		return;
+	if (o->mask == 0xF) {
+		store_vm(b, 0, o->offset);
+		return;
+	}
+
+	/*
+	 * 부분 쓰기: (res & M) | (old & ~M)
+	 * shader_vm은 16바이트 정렬이 보장되지 않으므로 vm 메모리는
+	 * movups로만 접근한다 (상수 풀은 정렬되어 있어 직접 피연산자로 사용).
+	 */
+	uint32_t m[4];
+	for (int i = 0; i < 4; i++)
+		m[i] = (o->mask >> i) & 1 ? 0xFFFFFFFF : 0;
+	int mi = pool_add_bits(b, m[0], m[1], m[2], m[3]);
+	load_vm(b, 7, o->offset);
+	sse_rc(b, 0, OP_MOVUPS_LD, 6, mi);
+	sse_rr(b, 0, OP_ANDNPS, 6, 7);
+	sse_rc(b, 0, OP_ANDPS, 0, mi);
+	sse_rr(b, 0, OP_ORPS, 0, 6);
+	store_vm(b, 0, o->offset);
+}
+
+/* xmm0.x의 비트가 0인지 검사 → ZF */
+static void test_cond(struct jit_buf *b)
+{
+	sse_rr(b, 0x66, OP_MOVD_ST, 0, RAX);  /* movd eax, xmm0 */
+	uint8_t test_eax[2] = { 0x85, 0xC0 };
+	emit(b, test_eax, 2);
+}
+
+/* 수평 덧셈: xmm0 = broadcast(x0 + x1 + x2 [+ x3]) */
+static void horizontal_add(struct jit_buf *b, int n)
+{
+	static const uint8_t lane_sel[4] = { 0x00, 0x55, 0xAA, 0xFF };
+	sse_rr(b, 0, OP_MOVAPS, 3, 0);
+	for (int i = 1; i < n; i++) {
+		sse_rr(b, 0, OP_MOVAPS, 4, 3);
+		sse_rr_imm(b, 0, OP_SHUFPS, 4, 4, lane_sel[i]);
+		sse_rr(b, 0xF3, OP_ADDPS, 0, 4);  /* addss */
+	}
+	sse_rr_imm(b, 0, OP_SHUFPS, 0, 0, 0x00);
+}
+
+/* ---- 명령어 번역 ---- */
+
+static int compile_inst(struct jit_buf *b, const struct dxbc_ir_inst *in,
+			int *loop_depth)
+{
+	for (int i = 0; i < in->num_src && in->op != SM4_OP_IF &&
+			in->op != SM4_OP_BREAKC; i++)
+		load_src(b, &in->src[i], i);
+
+	switch (in->op) {
+	case SM4_OP_MOV:
+		break;
+	case SM4_OP_ADD:
+		sse_rr(b, 0, OP_ADDPS, 0, 1);
+		break;
+	case SM4_OP_MUL:
+		sse_rr(b, 0, OP_MULPS, 0, 1);
+		break;
+	case SM4_OP_MAD:
+		sse_rr(b, 0, OP_MULPS, 0, 1);
+		sse_rr(b, 0, OP_ADDPS, 0, 2);
+		break;
+	case SM4_OP_DP3:
+		sse_rr(b, 0, OP_MULPS, 0, 1);
+		horizontal_add(b, 3);
+		break;
+	case SM4_OP_DP4:
+		sse_rr(b, 0, OP_MULPS, 0, 1);
+		horizontal_add(b, 4);
+		break;
+	case SM4_OP_LT:
+		sse_rr_imm(b, 0, OP_CMPPS, 0, 1, CMP_LT);
+		break;
+	case SM4_OP_GE:
+		/* a >= b ⇔ b <= a */
+		sse_rr_imm(b, 0, OP_CMPPS, 1, 0, CMP_LE);
+		sse_rr(b, 0, OP_MOVAPS, 0, 1);
+		break;
+	case SM4_OP_EQ:
+		sse_rr_imm(b, 0, OP_CMPPS, 0, 1, CMP_EQ);
+		break;
+	case SM4_OP_NE:
+		sse_rr_imm(b, 0, OP_CMPPS, 0, 1, CMP_NEQ);
+		break;
+	case SM4_OP_MIN:
+		sse_rr(b, 0, OP_MINPS, 0, 1);   /* (a < b) ? a : b */
+		break;
+	case SM4_OP_MAX:
+		sse_rr(b, 0, OP_MAXPS, 0, 1);   /* (a > b) ? a : b */
+		break;
+	case SM4_OP_MOVC:
+		/* 비트가 0인 레인 → c, 아니면 b */
+		sse_rr(b, 0, OP_XORPS, 3, 3);
+		sse_rr(b, 0x66, OP_PCMPEQD, 3, 0);
+		sse_rr(b, 0, OP_MOVAPS, 0, 3);
+		sse_rr(b, 0, OP_ANDPS, 0, 2);
+		sse_rr(b, 0, OP_ANDNPS, 3, 1);
+		sse_rr(b, 0, OP_ORPS, 0, 3);
+		break;
+	case SM4_OP_RSQ: {
+		/* (a > 0) ? 1 / sqrt(a) : 0 */
+		float one[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		sse_rr(b, 0, OP_XORPS, 3, 3);
+		sse_rr_imm(b, 0, OP_CMPPS, 3, 0, CMP_LT);
+		sse_rr(b, 0, OP_SQRTPS, 1, 0);
+		sse_rc(b, 0, OP_MOVUPS_LD, 0, pool_add(b, one));
+		sse_rr(b, 0, OP_DIVPS, 0, 1);
+		sse_rr(b, 0, OP_ANDPS, 0, 3);
+		break;
+	}
+
+	case SM4_OP_ITOF:
+		sse_rr(b, 0, OP_CVTDQ2PS, 0, 0);
+		break;
+	case SM4_OP_UTOF: {
+		/* cvtdq2ps는 부호 있는 변환 → 상/하위 16비트로 나눠 변환 후 합산
+		 * (각 부분은 정확히 표현되므로 반올림은 마지막 덧셈 한 번) */
+		float k65536[4] = { 65536.0f, 65536.0f, 65536.0f, 65536.0f };
+		sse_rr(b, 0, OP_MOVAPS, 1, 0);
+		sse_rr_imm(b, 0x66, OP_PSHIFTD, 2, 1, 16);   /* psrld xmm1, 16 */
+		sse_rc(b, 0, OP_ANDPS, 0,
+		       pool_add_bits(b, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF));
+		sse_rr(b, 0, OP_CVTDQ2PS, 1, 1);
+		sse_rr(b, 0, OP_CVTDQ2PS, 0, 0);
+		sse_rc(b, 0, OP_MULPS, 1, pool_add(b, k65536));
+		sse_rr(b, 0, OP_ADDPS, 0, 1);
+		break;
+	}
+
+	case SM4_OP_IF:
+		load_src(b, &in->src[0], 0);
+		test_cond(b);
+		/* 조건 불만족 → ELSE 다음 / ENDIF 다음 */
+		jmp_ir(b, (in->flags & DXBC_IR_FLAG_NZ) ? JCC_Z : JCC_NZ,
+		       in->target);
+		return 0;
+	case SM4_OP_ELSE:
+	case SM4_OP_BREAK:
+		jmp_ir(b, 0, in->target);
+		return 0;
+	case SM4_OP_BREAKC:
+		load_src(b, &in->src[0], 0);
+		test_cond(b);
+		jmp_ir(b, (in->flags & DXBC_IR_FLAG_NZ) ? JCC_NZ : JCC_Z,
+		       in->target);
+		return 0;
+	case SM4_OP_LOOP:
+		if (*loop_depth >= JIT_MAX_LOOP_DEPTH)
+			return -1;
+		loop_counter_op(b, (*loop_depth)++, 0);
+		return 0;
+	case SM4_OP_ENDLOOP:
+		/* ++iter > 1024 이면 탈출, 아니면 LOOP 다음으로 */
+		if (*loop_depth <= 0 || in->target < 0)
+			return -1;
+		(*loop_depth)--;
+		loop_counter_op(b, *loop_depth, 1);
+		loop_counter_op(b, *loop_depth, 2);
+		jmp_ir(b, JCC_LE, in->target);
+		return 0;
+	case SM4_OP_RET:
+		emit1(b, 0xC3);
+		return 0;
+	case SM4_OP_ENDIF:
+		return 0;
+
+	default:
+		return -1;  /* 미지원 → VM */
+	}
+
+	store_dst(b, &in->dst);
+	return 0;
+}
+
+int dxbc_jit_compile(struct dxbc_info *info)
+{
+	struct dxbc_ir *ir = info->ir;
+	if (!ir || !dxbc_jit_enabled())
+		return -1;
+	if (ir->jit)
+		return 0;
+
+	struct jit_buf b;
+	memset(&b, 0, sizeof(b));
+	int *inst_pos = malloc(sizeof(int) * (size_t)(ir->num_insts + 1));
+	if (!inst_pos)
+		return -1;
+
+	/* 프롤로그: outputs와 사용되는 temps를 0으로 */
+	sse_rr(&b, 0, OP_XORPS, 0, 0);
+	for (int i = 0; i < DXBC_MAX_OUTPUTS; i++)
+		store_vm(&b, 0, (int)(offsetof(struct shader_vm, outputs) +
+				      (size_t)i * 16));
+	for (int i = 0; i < ir->num_temps; i++)
+		store_vm(&b, 0, (int)(offsetof(struct shader_vm, temps) +
+				      (size_t)i * 16));
+
+	int loop_depth = 0;
+	int ok = 1;
+	for (int i = 0; i < ir->num_insts && ok; i++) {
+		inst_pos[i] = b.len;
+		if (compile_inst(&b, &ir->insts[i], &loop_depth) != 0)
+			ok = 0;
+	}
+	inst_pos[ir->num_insts] = b.len;
+	emit1(&b, 0xC3);
+
+	/* 상수 풀은 16바이트 정렬 */
+	while (b.len & 15)
+		emit1(&b, 0xCC);
+	int pool_base = b.len;
+	for (int i = 0; i < b.pool_len; i++)
+		emit(&b, (const uint8_t *)b.pool[i], 16);
+
+	void *mem = MAP_FAILED;
+	if (ok && !b.failed) {
+		/* 점프 / 상수 패치 */
+		for (int i = 0; i < b.num_jumps; i++) {
+			int t = b.jumps[i].target;
+			if (t < 0 || t > ir->num_insts) { ok = 0; break; }
+			int32_t rel = inst_pos[t] - (b.jumps[i].pos + 4);
+			memcpy(b.code + b.jumps[i].pos, &rel, 4);
+		}
+		for (int i = 0; i < b.num_consts; i++) {
+			int32_t rel = pool_base + b.consts[i].target * 16 -
+				      (b.consts[i].pos + 4);
+			memcpy(b.code + b.consts[i].pos, &rel, 4);
+		}
+	}
+	if (ok && !b.failed) {
+		mem = mmap(NULL, (size_t)b.len, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem != MAP_FAILED) {
+			memcpy(mem, b.code, (size_t)b.len);
+			if (mprotect(mem, (size_t)b.len,
+				     PROT_READ | PROT_EXEC) != 0) {
+				munmap(mem, (size_t)b.len);
+				mem = MAP_FAILED;
+			}
+		}
+	}
+
+	free(inst_pos);
+	free(b.code);
+	free(b.pool);
+	free(b.jumps);
+	free(b.consts);
+
+	if (mem == MAP_FAILED)
+		return -1;
+
+	ir->jit_mem = mem;
+	ir->jit_size = (size_t)b.len;
+	ir->jit = (void (*)(struct shader_vm *))mem;
+	return 0;
+}
+
+void dxbc_jit_free(struct dxbc_ir *ir)
+{
+	if (!ir || !ir->jit_mem) return;
+	munmap(ir->jit_mem, ir->jit_size);
+	ir->jit_mem = NULL;
+	ir->jit_size = 0;
+	ir->jit = NULL;
+}
+
+#else /* !DXBC_JIT_X86 */
+
+int dxbc_jit_compile(struct dxbc_info *info)
+{
+	(void)info;
+	return -1;
+}
+
+void dxbc_jit_free(struct dxbc_ir *ir)
+{
+	(void)ir;
+}
+
+#endif /* DXBC_JIT_X86 */
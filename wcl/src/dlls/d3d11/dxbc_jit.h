@@ -0,0 +1,39 @@
+/*
+ * dxbc_jit.h — DXBC IR → x86-64 SSE 네이티브 코드 JIT
+ * ====================================================
+ *
+ * dxbc_lower()가 만든 IR을 SSE 명령어로 직접 번역해
+ * 실행 가능 mmap 영역에 올려 둔다. 셰이더 객체(struct dxbc_ir)마다
+ * 한 번 컴파일해서 캐시하고, shader_vm_execute()가 있으면 호출한다.
+ *
+ * 생성 코드 규약 (SysV):
+ *   void fn(struct shader_vm *vm)   — rdi = vm
+ *   레지스터 파일은 vm 메모리에 그대로 두고 명령어마다 load/store.
+ *   명령어 디스패치와 오퍼랜드 해석 비용만 없앤다.
+ *
+ * 결과는 인터프리터와 비트 단위로 같다 (같은 연산 순서, FMA 미사용).
+ *
+ * 번역할 수 없는 셰이더(미지원 opcode, 너무 깊은 루프 중첩)는
+ * 컴파일하지 않고 인터프리터로 실행된다.
+ *
+ * 기본은 꺼져 있음 — 환경변수 CITC_D3D11_JIT=1 로 활성화.
+ */
+
+#ifndef CITC_DXBC_JIT_H
+#define CITC_DXBC_JIT_H
+
+#include "dxbc.h"
+
+/* JIT이 활성화되어 있는지 (환경변수, 첫 호출 시 캐시) */
+int dxbc_jit_enabled(void);
+
+/*
+ * info->ir을 네이티브 코드로 컴파일해 info->ir->jit에 저장.
+ * 성공 시 0, 비활성/미지원 시 -1 (VM 사용).
+ */
+int dxbc_jit_compile(struct dxbc_info *info);
+
+/* 컴파일된 코드 해제 (dxbc_free_ir에서 호출) */
+void dxbc_jit_free(struct dxbc_ir *ir);
+
+#endif /* CITC_DXBC_JIT_H */
@@ -0,0 +1,100 @@
+/*
+ * handle_table.c — D3D11 오브젝트 핸들 테이블
+ * =========================================================
+ *
+ * 구조:
+ *   - slabs[]: slab 포인터 배열. slab은 처음 필요할 때 만들어 CAS로
+ *     공개하고, 동시에 만든 쪽이 지면 자기 것을 버린다
+ *   - count: 새 슬롯 할당 커서 (CAS로 증가, HT_MAX_SLOTS에서 멈춤)
+ *   - free_head: 해제된 슬롯의 Treiber 스택. 상위 32비트는 pop마다
+ *     올리는 ABA 카운터라, 꺼내는 사이 같은 슬롯이 빠졌다 다시 들어와도
+ *     CAS가 실패하고 다시 시도한다
+ *
+ * 할당은 free list → 새 슬롯 순. 어느 쪽이든 O(1)이고 락이 없다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "handle_table.h"
+
+/* idx가 속한 slab을 반환, 없으면 만들어 공개 */
+static struct ht_slab *slab_ensure(struct handle_table *t, uint32_t idx)
+{
+	struct ht_slab **pp = &t->slabs[idx >> HT_SLAB_SHIFT];
+	struct ht_slab *s = __atomic_load_n(pp, __ATOMIC_ACQUIRE);
+	if (s) return s;
+
+	size_t size = sizeof(struct ht_slab) + HT_SLAB_SIZE * t->elem_size;
+	size = (size + 63) & ~(size_t)63;
+	struct ht_slab *fresh = aligned_alloc(64, size);
+	if (!fresh) return NULL;
+	memset(fresh, 0, size);
+
+	s = NULL;
+	if (__atomic_compare_exchange_n(pp, &s, fresh, 0, __ATOMIC_ACQ_REL,
+					__ATOMIC_ACQUIRE))
+		return fresh;
+	free(fresh);            /* 다른 스레드가 먼저 공개함 */
+	return s;
+}
+
+static int free_pop(struct handle_table *t)
+{
+	uint64_t head = __atomic_load_n(&t->free_head, __ATOMIC_ACQUIRE);
+	for (;;) {
+		uint32_t top = (uint32_t)head;
+		if (top == 0) return -1;
+		uint32_t idx = top - 1;
+		struct ht_slab *s = __atomic_load_n(
+			&t->slabs[idx >> HT_SLAB_SHIFT], __ATOMIC_ACQUIRE);
+		uint32_t next = __atomic_load_n(
+			&s->next[idx & (HT_SLAB_SIZE - 1)], __ATOMIC_RELAXED);
+		uint64_t want = ((head >> 32) + 1) << 32 | next;
+		if (__atomic_compare_exchange_n(&t->free_head, &head, want, 1,
+						__ATOMIC_ACQ_REL,
+						__ATOMIC_ACQUIRE))
+			return (int)idx;
+	}
+}
+
+int ht_alloc(struct handle_table *t)
+{
+	int idx = free_pop(t);
+	if (idx >= 0) {
+		memset(ht_slot(t, idx), 0, t->elem_size);
+		return idx;
+	}
+
+	uint32_t n = __atomic_load_n(&t->count, __ATOMIC_RELAXED);
+	do {
+		if (n >= HT_MAX_SLOTS) return -1;
+	} while (!__atomic_compare_exchange_n(&t->count, &n, n + 1, 1,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_RELAXED));
+
+	/*
+	 * slab을 못 만들면 (메모리 부족) 이 슬롯은 버린다. slab이 없으니
+	 * free list에 넣을 수도 없다. 같은 slab의 다음 슬롯이 다시 만들어
+	 * 보며, 버려진 슬롯은 세대 0 + 0으로 채워진 채 조회되지 않는다.
+	 */
+	if (!slab_ensure(t, n)) return -1;
+	return (int)n;
+}
+
+void ht_free(struct handle_table *t, int idx)
+{
+	struct ht_slab *s = ht_slab_of(t, idx);
+	uint32_t i = (uint32_t)idx & (HT_SLAB_SIZE - 1);
+
+	__atomic_add_fetch(&s->gen[i], 1, __ATOMIC_RELEASE);
+
+	uint64_t head = __atomic_load_n(&t->free_head, __ATOMIC_RELAXED);
+	uint64_t want;
+	do {
+		__atomic_store_n(&s->next[i], (uint32_t)head, __ATOMIC_RELAXED);
+		want = (head & ~(uint64_t)0xFFFFFFFFu) | ((uint32_t)idx + 1);
+	} while (!__atomic_compare_exchange_n(&t->free_head, &head, want, 1,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
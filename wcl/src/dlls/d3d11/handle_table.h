@@ -0,0 +1,117 @@
+/*
+ * handle_table.h — D3D11 오브젝트 핸들 테이블
+ * =========================================================
+ *
+ * 리소스/뷰/셰이더/... 오브젝트를 담는 늘어나는 테이블.
+ * 고정 배열 + 선형 탐색 대신:
+ *
+ *   - 슬롯은 HT_SLAB_SIZE개씩 slab으로 묶여 필요할 때 할당된다.
+ *     slab은 한 번 만들어지면 옮기거나 해제하지 않으므로, 슬롯 포인터는
+ *     테이블이 자라는 중에도 그대로 유효하다 (다른 스레드가 읽는 중이어도).
+ *   - 할당/해제는 O(1): 해제된 슬롯은 lock-free 스택(free list)에 쌓이고,
+ *     비어 있으면 count를 올려 새 슬롯을 쓴다. 뮤텍스 없음.
+ *   - 슬롯마다 세대(generation)를 두고 핸들에 함께 넣는다. 해제된 뒤
+ *     재사용된 슬롯을 옛 핸들로 가리키면 세대가 달라 조회가 실패한다.
+ *
+ * 핸들 (void *):
+ *   비트 48..55  종류 태그 (테이블마다 고정, 0이 아님)
+ *   비트 32..47  세대 (하위 16비트)
+ *   비트  0..31  슬롯 인덱스
+ * 상위 비트가 채워진 비정규(non-canonical) 주소라 실제 포인터
+ * (SwapChain 등)와 겹치지 않는다.
+ */
+
+#ifndef CITC_HANDLE_TABLE_H
+#define CITC_HANDLE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HT_SLAB_SHIFT  6
+#define HT_SLAB_SIZE   (1u << HT_SLAB_SHIFT)      /* slab당 슬롯 64개 */
+#define HT_MAX_SLOTS   (1u << 20)                 /* 테이블당 최대 슬롯 */
+#define HT_MAX_SLABS   (HT_MAX_SLOTS >> HT_SLAB_SHIFT)
+
+#define HT_TAG_SHIFT   48
+#define HT_GEN_SHIFT   32
+#define HT_GEN_MASK    0xFFFFu
+
+struct ht_slab {
+	uint32_t gen[HT_SLAB_SIZE];     /* 해제될 때마다 증가 */
+	uint32_t next[HT_SLAB_SIZE];    /* free list: 다음 슬롯 + 1, 0 = 끝 */
+	unsigned char data[] __attribute__((aligned(64)));
+};
+
+struct handle_table {
+	size_t elem_size;
+	uintptr_t tag;                  /* 핸들 종류 태그 (1..255) */
+	uint32_t count;                 /* 한 번이라도 쓰인 슬롯 수 (atomic) */
+	uint64_t free_head;             /* (ABA 카운터 << 32) | (슬롯 + 1) */
+	struct ht_slab *slabs[HT_MAX_SLABS];
+};
+
+#define HANDLE_TABLE_INIT(type, tag_) { sizeof(type), (tag_), 0, 0, { 0 } }
+
+/*
+ * 빈 슬롯 하나를 잡아 0으로 채우고 인덱스를 반환. 가득 찼거나
+ * 메모리가 없으면 -1. 여러 스레드에서 동시에 불러도 된다.
+ */
+int ht_alloc(struct handle_table *t);
+
+/* 슬롯을 돌려줌 — 세대가 바뀌어 기존 핸들은 더 이상 조회되지 않는다 */
+void ht_free(struct handle_table *t, int idx);
+
+static inline struct ht_slab *ht_slab_of(struct handle_table *t, int idx)
+{
+	return __atomic_load_n(&t->slabs[(uint32_t)idx >> HT_SLAB_SHIFT],
+			       __ATOMIC_ACQUIRE);
+}
+
+/* 할당된 슬롯 (idx는 ht_alloc/ht_lookup이 돌려준 유효한 값이어야 함) */
+static inline void *ht_slot(struct handle_table *t, int idx)
+{
+	return ht_slab_of(t, idx)->data +
+	       (size_t)(idx & (HT_SLAB_SIZE - 1)) * t->elem_size;
+}
+
+/* 지금까지 쓰인 슬롯 수 — 0 .. ht_count()-1 순회용 */
+static inline int ht_count(struct handle_table *t)
+{
+	return (int)__atomic_load_n(&t->count, __ATOMIC_ACQUIRE);
+}
+
+/* 순회용: slab이 아직 공개되지 않았으면 NULL */
+static inline void *ht_get(struct handle_table *t, int idx)
+{
+	struct ht_slab *s = ht_slab_of(t, idx);
+	return s ? s->data + (size_t)(idx & (HT_SLAB_SIZE - 1)) * t->elem_size
+		 : NULL;
+}
+
+static inline void *ht_handle(struct handle_table *t, int idx)
+{
+	uint32_t gen = __atomic_load_n(
+		&ht_slab_of(t, idx)->gen[idx & (HT_SLAB_SIZE - 1)],
+		__ATOMIC_RELAXED);
+	return (void *)((t->tag << HT_TAG_SHIFT) |
+			((uintptr_t)(gen & HT_GEN_MASK) << HT_GEN_SHIFT) |
+			(uint32_t)idx);
+}
+
+/* 핸들 → 슬롯 인덱스, 다른 종류/범위 밖/해제된 슬롯이면 -1 */
+static inline int ht_lookup(struct handle_table *t, const void *handle)
+{
+	uintptr_t val = (uintptr_t)handle;
+	if ((val >> HT_TAG_SHIFT) != t->tag) return -1;
+	uint32_t idx = (uint32_t)val;
+	if (idx >= (uint32_t)ht_count(t)) return -1;
+	struct ht_slab *s = ht_slab_of(t, (int)idx);
+	if (!s) return -1;
+	uint32_t gen = __atomic_load_n(&s->gen[idx & (HT_SLAB_SIZE - 1)],
+				       __ATOMIC_ACQUIRE);
+	if ((gen & HT_GEN_MASK) != ((val >> HT_GEN_SHIFT) & HT_GEN_MASK))
+		return -1;
+	return (int)idx;
+}
+
+#endif /* CITC_HANDLE_TABLE_H */
@@ -0,0 +1,497 @@
+/*
+ * raster_simd.c — 래스터라이저 span 커널 (SSE2/AVX2/스칼라)
+ * ===========================================================
+ *
+ * 세 구현 모두 정수 edge 검사와 같은 순서의 float 덧셈만 사용하므로
+ * 어느 경로를 타더라도 결과가 비트 단위로 동일하다 (blend 커널도 같음).
+ *
+ * SSE2는 x86-64 기본 명령어셋이므로 항상 사용 가능.
+ * AVX2 함수는 __attribute__((target("avx2")))로 컴파일하므로
+ * 빌드 플래그(-mavx2) 없이도 포함되며, CPU가 지원할 때만 호출된다.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "raster_simd.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define RASTER_HAVE_X86 1
+#endif
+
+/* ---- 스칼라 (기준 구현) ---- */
+
+static void span_scalar(const struct raster_tri *t, const int32_t w[3],
+			const float *attr, unsigned valid, struct raster_span *out)
+{
+	unsigned mask = 0;
+
+	for (int k = 0; k < RASTER_SPAN; k++) {
+		int32_t w0 = w[0] + t->edge_lane[0][k];
+		int32_t w1 = w[1] + t->edge_lane[1][k];
+		int32_t w2 = w[2] + t->edge_lane[2][k];
+		if ((w0 | w1 | w2) >= 0)
+			mask |= 1u << k;
+	}
+	mask &= valid;
+	out->mask = mask;
+	if (!mask)
+		return;
+
+	for (int a = 0; a < t->num_attrs; a++)
+		for (int k = 0; k < RASTER_SPAN; k++)
+			out->attr[a][k] = attr[a] + t->attr_lane[a][k];
+}
+
+#ifdef RASTER_HAVE_X86
+
+/*
+ * 세 edge 값을 OR하면 하나라도 음수일 때 부호 비트가 선다.
+ * → float로 재해석해 movemask로 부호 비트만 모으면 "바깥" 마스크.
+ */
+
+/* ---- SSE2: 4레인 x 2 ---- */
+
+static void span_sse2(const struct raster_tri *t, const int32_t w[3],
+		      const float *attr, unsigned valid, struct raster_span *out)
+{
+	unsigned outside = 0;
+
+	for (int h = 0; h < RASTER_SPAN; h += 4) {
+		__m128i w0 = _mm_add_epi32(_mm_set1_epi32(w[0]),
+			_mm_loadu_si128((const __m128i *)&t->edge_lane[0][h]));
+		__m128i w1 = _mm_add_epi32(_mm_set1_epi32(w[1]),
+			_mm_loadu_si128((const __m128i *)&t->edge_lane[1][h]));
+		__m128i w2 = _mm_add_epi32(_mm_set1_epi32(w[2]),
+			_mm_loadu_si128((const __m128i *)&t->edge_lane[2][h]));
+		__m128i any = _mm_or_si128(_mm_or_si128(w0, w1), w2);
+		outside |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(any)) << h;
+	}
+	out->mask = ~outside & valid;
+	if (!out->mask)
+		return;
+
+	for (int a = 0; a < t->num_attrs; a++) {
+		__m128 base = _mm_set1_ps(attr[a]);
+		_mm_storeu_ps(&out->attr[a][0],
+			      _mm_add_ps(base, _mm_loadu_ps(&t->attr_lane[a][0])));
+		_mm_storeu_ps(&out->attr[a][4],
+			      _mm_add_ps(base, _mm_loadu_ps(&t->attr_lane[a][4])));
+	}
+}
+
+/* ---- AVX2: 8레인 ---- */
+
+__attribute__((target("avx2")))
+static void span_avx2(const struct raster_tri *t, const int32_t w[3],
+		      const float *attr, unsigned valid, struct raster_span *out)
+{
+	__m256i w0 = _mm256_add_epi32(_mm256_set1_epi32(w[0]),
+		_mm256_loadu_si256((const __m256i *)t->edge_lane[0]));
+	__m256i w1 = _mm256_add_epi32(_mm256_set1_epi32(w[1]),
+		_mm256_loadu_si256((const __m256i *)t->edge_lane[1]));
+	__m256i w2 = _mm256_add_epi32(_mm256_set1_epi32(w[2]),
+		_mm256_loadu_si256((const __m256i *)t->edge_lane[2]));
+	__m256i any = _mm256_or_si256(_mm256_or_si256(w0, w1), w2);
+	unsigned outside = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(any));
+
+	out->mask = ~outside & valid;
+	if (!out->mask)
+		return;
+
+	for (int a = 0; a < t->num_attrs; a++)
+		_mm256_storeu_ps(out->attr[a],
+				 _mm256_add_ps(_mm256_set1_ps(attr[a]),
+					       _mm256_loadu_ps(t->attr_lane[a])));
+}
+
+#endif /* RASTER_HAVE_X86 */
+
+/* ============================================================
+ * 출력 병합 (blend) 커널
+ * ============================================================
+ *
+ * 소스 양자화는 float4_to_xrgb와 같은 식 (c * 255 + 0.5 후 버림)이라
+ * OPAQUE 결과가 기존 픽셀 쓰기와 같다. 양자화 뒤로는 정수 연산뿐이므로
+ * 스칼라/SSE2/AVX2가 비트 단위로 같은 결과를 낸다.
+ *
+ * 대상 픽셀은 블록 레인 순서의 임시 배열로 모아서 섞는다.
+ * 마스크가 꽉 찬 블록(대부분)은 두 행을 통째로 복사하고,
+ * 가장자리 블록만 레인별로 모으고 흩는다.
+ */
+
+static inline void blend_load(uint32_t d[RASTER_SPAN], const uint32_t *row0,
+			      const uint32_t *row1, unsigned mask)
+{
+	if (mask == 0xFF) {
+		memcpy(d, row0, 4 * sizeof(uint32_t));
+		memcpy(d + 4, row1, 4 * sizeof(uint32_t));
+		return;
+	}
+	for (int k = 0; k < RASTER_SPAN; k++)
+		d[k] = !(mask >> k & 1) ? 0 : k < 4 ? row0[k] : row1[k - 4];
+}
+
+static inline void blend_store(const uint32_t d[RASTER_SPAN], uint32_t *row0,
+			       uint32_t *row1, unsigned mask)
+{
+	if (mask == 0xFF) {
+		memcpy(row0, d, 4 * sizeof(uint32_t));
+		memcpy(row1, d + 4, 4 * sizeof(uint32_t));
+		return;
+	}
+	for (unsigned m = mask; m; m &= m - 1) {
+		int k = __builtin_ctz(m);
+		if (k < 4)
+			row0[k] = d[k];
+		else
+			row1[k - 4] = d[k];
+	}
+}
+
+/* ---- 스칼라 (기준 구현) ---- */
+
+static inline int blend_quant(float c)
+{
+	c = c > 0.0f ? c : 0.0f;   /* NaN → 0 */
+	c = c < 1.0f ? c : 1.0f;
+	return (int)(c * 255.0f + 0.5f);
+}
+
+static inline int blend_div255(int x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline __attribute__((always_inline))
+void blend_scalar(uint32_t *row0, uint32_t *row1, const float *const src[4],
+		  unsigned mask, enum raster_blend_mode mode)
+{
+	uint32_t d[RASTER_SPAN];
+	if (mode != RASTER_BLEND_OPAQUE)
+		blend_load(d, row0, row1, mask);
+
+	for (int k = 0; k < RASTER_SPAN; k++) {
+		int a = mode == RASTER_BLEND_OPAQUE ? 255 : blend_quant(src[3][k]);
+		uint32_t px = 0;
+		for (int ch = 0; ch < 3; ch++) {
+			int sh = 16 - ch * 8;
+			int sc = blend_quant(src[ch][k]);
+			int dc = mode == RASTER_BLEND_OPAQUE ? 0 :
+				 (int)(d[k] >> sh & 0xFF);
+			int o;
+			switch (mode) {
+			case RASTER_BLEND_ALPHA:
+				o = blend_div255(sc * a + dc * (255 - a));
+				break;
+			case RASTER_BLEND_ADD:
+				o = sc + dc;
+				break;
+			case RASTER_BLEND_PREMUL:
+				o = sc + blend_div255(dc * (255 - a));
+				break;
+			default:
+				o = sc;
+				break;
+			}
+			px |= (uint32_t)(o < 255 ? o : 255) << sh;
+		}
+		d[k] = px;
+	}
+	blend_store(d, row0, row1, mask);
+}
+
+#ifdef RASTER_HAVE_X86
+
+/*
+ * 채널 값은 32비트 레인의 하위 8비트에만 있으므로 곱은 16비트 곱
+ * (mullo_epi16)으로 충분하고 (최대 255*255 < 2^16, 상위 절반은 0*0),
+ * min도 16비트 min으로 된다 (SSE2에는 32비트 min이 없음).
+ */
+
+/* ---- SSE2: 4레인 x 2 ---- */
+
+static inline __m128i blend_quant_sse2(const float *c)
+{
+	__m128 v = _mm_max_ps(_mm_loadu_ps(c), _mm_setzero_ps());  /* NaN → 0 */
+	v = _mm_min_ps(v, _mm_set1_ps(1.0f));
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)),
+					   _mm_set1_ps(0.5f)));
+}
+
+static inline __m128i blend_div255_sse2(__m128i x)
+{
+	x = _mm_add_epi32(x, _mm_set1_epi32(128));
+	return _mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 8)), 8);
+}
+
+static inline __attribute__((always_inline))
+void blend_sse2(uint32_t *row0, uint32_t *row1, const float *const src[4],
+		unsigned mask, enum raster_blend_mode mode)
+{
+	uint32_t d[RASTER_SPAN];
+	if (mode != RASTER_BLEND_OPAQUE)
+		blend_load(d, row0, row1, mask);
+
+	const __m128i ff = _mm_set1_epi32(0xFF);
+	for (int h = 0; h < RASTER_SPAN; h += 4) {
+		__m128i dst = _mm_setzero_si128();
+		__m128i a = ff, ia = _mm_setzero_si128();
+		if (mode != RASTER_BLEND_OPAQUE) {
+			dst = _mm_loadu_si128((const __m128i *)&d[h]);
+			a = blend_quant_sse2(&src[3][h]);
+			ia = _mm_sub_epi32(ff, a);
+		}
+		__m128i px = _mm_setzero_si128();
+		for (int ch = 0; ch < 3; ch++) {
+			int sh = 16 - ch * 8;
+			__m128i sc = blend_quant_sse2(&src[ch][h]);
+			__m128i dc = _mm_and_si128(_mm_srli_epi32(dst, sh), ff);
+			__m128i o;
+			switch (mode) {
+			case RASTER_BLEND_ALPHA:
+				o = blend_div255_sse2(_mm_add_epi32(
+					_mm_mullo_epi16(sc, a),
+					_mm_mullo_epi16(dc, ia)));
+				break;
+			case RASTER_BLEND_ADD:
+				o = _mm_min_epi16(_mm_add_epi32(sc, dc), ff);
+				break;
+			case RASTER_BLEND_PREMUL:
+				o = _mm_min_epi16(_mm_add_epi32(sc,
+					blend_div255_sse2(_mm_mullo_epi16(dc, ia))), ff);
+				break;
+			default:
+				o = sc;
+				break;
+			}
+			px = _mm_or_si128(px, _mm_slli_epi32(o, sh));
+		}
+		_mm_storeu_si128((__m128i *)&d[h], px);
+	}
+	blend_store(d, row0, row1, mask);
+}
+
+/* ---- AVX2: 8레인 ---- */
+
+__attribute__((target("avx2")))
+static inline __m256i blend_quant_avx2(const float *c)
+{
+	__m256 v = _mm256_max_ps(_mm256_loadu_ps(c), _mm256_setzero_ps());
+	v = _mm256_min_ps(v, _mm256_set1_ps(1.0f));
+	return _mm256_cvttps_epi32(_mm256_add_ps(
+		_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_div255_avx2(__m256i x)
+{
+	x = _mm256_add_epi32(x, _mm256_set1_epi32(128));
+	return _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_srli_epi32(x, 8)), 8);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void blend_avx2(uint32_t *row0, uint32_t *row1,
+			      const float *const src[4], unsigned mask,
+			      enum raster_blend_mode mode)
+{
+	uint32_t d[RASTER_SPAN];
+	if (mode != RASTER_BLEND_OPAQUE)
+		blend_load(d, row0, row1, mask);
+
+	const __m256i ff = _mm256_set1_epi32(0xFF);
+	__m256i dst = _mm256_setzero_si256();
+	__m256i a = ff, ia = _mm256_setzero_si256();
+	if (mode != RASTER_BLEND_OPAQUE) {
+		dst = _mm256_loadu_si256((const __m256i *)d);
+		a = blend_quant_avx2(src[3]);
+		ia = _mm256_sub_epi32(ff, a);
+	}
+	__m256i px = _mm256_setzero_si256();
+	for (int ch = 0; ch < 3; ch++) {
+		int sh = 16 - ch * 8;
+		__m256i sc = blend_quant_avx2(src[ch]);
+		__m256i dc = _mm256_and_si256(_mm256_srli_epi32(dst, sh), ff);
+		__m256i o;
+		switch (mode) {
+		case RASTER_BLEND_ALPHA:
+			o = blend_div255_avx2(_mm256_add_epi32(
+				_mm256_mullo_epi16(sc, a),
+				_mm256_mullo_epi16(dc, ia)));
+			break;
+		case RASTER_BLEND_ADD:
+			o = _mm256_min_epi16(_mm256_add_epi32(sc, dc), ff);
+			break;
+		case RASTER_BLEND_PREMUL:
+			o = _mm256_min_epi16(_mm256_add_epi32(sc,
+				blend_div255_avx2(_mm256_mullo_epi16(dc, ia))), ff);
+			break;
+		default:
+			o = sc;
+			break;
+		}
+		px = _mm256_or_si256(px, _mm256_slli_epi32(o, sh));
+	}
+	_mm256_storeu_si256((__m256i *)d, px);
+	blend_store(d, row0, row1, mask);
+}
+
+#endif /* RASTER_HAVE_X86 */
+
+/* 모드별 진입점 — 모드를 상수로 넘겨 분기를 컴파일 시점에 없앤다 */
+#define BLEND_ENTRY(isa, name, mode, ...)				\
+	__VA_ARGS__ static void blend_##name##_##isa(uint32_t *row0,	\
+		uint32_t *row1, const float *const src[4], unsigned mask) \
+	{								\
+		blend_##isa(row0, row1, src, mask, mode);		\
+	}
+#define BLEND_ENTRIES(isa, ...)						\
+	BLEND_ENTRY(isa, opaque, RASTER_BLEND_OPAQUE, __VA_ARGS__)	\
+	BLEND_ENTRY(isa, alpha, RASTER_BLEND_ALPHA, __VA_ARGS__)	\
+	BLEND_ENTRY(isa, add, RASTER_BLEND_ADD, __VA_ARGS__)		\
+	BLEND_ENTRY(isa, premul, RASTER_BLEND_PREMUL, __VA_ARGS__)	\
+	static const raster_blend_fn blend_table_##isa[RASTER_BLEND_COUNT] = { \
+		blend_opaque_##isa, blend_alpha_##isa,			\
+		blend_add_##isa, blend_premul_##isa,			\
+	};
+
+BLEND_ENTRIES(scalar)
+#ifdef RASTER_HAVE_X86
+BLEND_ENTRIES(sse2)
+BLEND_ENTRIES(avx2, __attribute__((target("avx2"))))
+#endif
+
+/* ---- upscale (bilinear, 0..256 고정소수점) ---- */
+
+static inline uint32_t upscale_lerp(uint32_t a, uint32_t b, int w)
+{
+	uint32_t px = 0;
+	for (int sh = 0; sh < 32; sh += 8) {
+		int ca = (int)(a >> sh & 0xFF), cb = (int)(b >> sh & 0xFF);
+		px |= (uint32_t)((ca * (256 - w) + cb * w + 128) >> 8) << sh;
+	}
+	return px;
+}
+
+static void upscale_scalar(uint32_t *dst, int n,
+			   const uint32_t *src0, const uint32_t *src1,
+			   int wy, const int32_t *xs, const uint16_t *wx)
+{
+	for (int x = 0; x < n; x++) {
+		int sx = xs[x];
+		uint32_t h0 = upscale_lerp(src0[sx], src0[sx + 1], wx[x]);
+		uint32_t h1 = upscale_lerp(src1[sx], src1[sx + 1], wx[x]);
+		dst[x] = upscale_lerp(h0, h1, wy);
+	}
+}
+
+#ifdef RASTER_HAVE_X86
+
+/*
+ * 출력 픽셀 2개씩: 채널을 16비트 레인 8개로 펼쳐 곱셈.
+ * a*(256-w) + b*w + 128 <= 65408 이라 mullo_epi16/부호 없는 시프트로 정확.
+ */
+static void upscale_sse2(uint32_t *dst, int n,
+			 const uint32_t *src0, const uint32_t *src1,
+			 int wy, const int32_t *xs, const uint16_t *wx)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w256 = _mm_set1_epi16(256);
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i vwy = _mm_set1_epi16((short)wy);
+	const __m128i vwy1 = _mm_sub_epi16(w256, vwy);
+	int x = 0;
+
+	for (; x + 2 <= n; x += 2) {
+		int s0 = xs[x], s1 = xs[x + 1];
+		__m128i a0 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0,
+			(int)src0[s1], (int)src0[s0]), zero);
+		__m128i b0 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0,
+			(int)src0[s1 + 1], (int)src0[s0 + 1]), zero);
+		__m128i a1 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0,
+			(int)src1[s1], (int)src1[s0]), zero);
+		__m128i b1 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0,
+			(int)src1[s1 + 1], (int)src1[s0 + 1]), zero);
+
+		short w0 = (short)wx[x], w1 = (short)wx[x + 1];
+		__m128i w = _mm_set_epi16(w1, w1, w1, w1, w0, w0, w0, w0);
+		__m128i wi = _mm_sub_epi16(w256, w);
+
+		__m128i h0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(a0, wi), _mm_mullo_epi16(b0, w)), round), 8);
+		__m128i h1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(a1, wi), _mm_mullo_epi16(b1, w)), round), 8);
+		__m128i o = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(h0, vwy1), _mm_mullo_epi16(h1, vwy)), round), 8);
+		_mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(o, zero));
+	}
+	if (x < n)
+		upscale_scalar(dst + x, n - x, src0, src1, wy, xs + x, wx + x);
+}
+
+#endif /* RASTER_HAVE_X86 */
+
+/* ---- 런타임 선택 ---- */
+
+static raster_span_fn g_span_fn;
+static const raster_blend_fn *g_blend_table;
+static raster_upscale_fn g_upscale_fn;
+
+raster_span_fn raster_span_select(void)
+{
+	raster_span_fn fn = __atomic_load_n(&g_span_fn, __ATOMIC_ACQUIRE);
+	if (fn)
+		return fn;
+
+	const char *force = getenv("CITC_D3D11_SIMD");
+	const raster_blend_fn *blend = blend_table_scalar;
+	raster_upscale_fn upscale = upscale_scalar;
+	fn = span_scalar;
+#ifdef RASTER_HAVE_X86
+	__builtin_cpu_init();
+	int has_sse2 = __builtin_cpu_supports("sse2");
+	int has_avx2 = __builtin_cpu_supports("avx2");
+
+	if (force && strcmp(force, "scalar") == 0) {
+		fn = span_scalar;
+	} else if (has_avx2 && !(force && strcmp(force, "sse2") == 0)) {
+		fn = span_avx2;
+		blend = blend_table_avx2;
+		upscale = upscale_sse2;   /* 모으기(gather)가 대부분이라 AVX2 이득 없음 */
+	} else if (has_sse2) {
+		fn = span_sse2;
+		blend = blend_table_sse2;
+		upscale = upscale_sse2;
+	}
+#else
+	(void)force;
+#endif
+
+	__atomic_store_n(&g_blend_table, blend, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_upscale_fn, upscale, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_span_fn, fn, __ATOMIC_RELEASE);
+	return fn;
+}
+
+raster_blend_fn raster_blend_select(enum raster_blend_mode mode)
+{
+	const raster_blend_fn *table =
+		__atomic_load_n(&g_blend_table, __ATOMIC_ACQUIRE);
+	if (!table) {
+		raster_span_select();
+		table = __atomic_load_n(&g_blend_table, __ATOMIC_ACQUIRE);
+	}
+	return table[mode];
+}
+
+raster_upscale_fn raster_upscale_select(void)
+{
+	raster_upscale_fn fn = __atomic_load_n(&g_upscale_fn, __ATOMIC_ACQUIRE);
+	if (!fn) {
+		raster_span_select();
+		fn = __atomic_load_n(&g_upscale_fn, __ATOMIC_ACQUIRE);
+	}
+	return fn;
+}
@@ -0,0 +1,134 @@
+/*
+ * raster_simd.h — 래스터라이저 span 커널 (SSE2/AVX2/스칼라)
+ * ===========================================================
+ *
+ * 삼각형 내부 판정(edge function)과 속성 보간을 한 번에
+ * RASTER_SPAN 픽셀씩 처리하는 커널.
+ *
+ * 한 번에 처리하는 픽셀은 4x2 블록 (2x2 쿼드 두 개):
+ *
+ *   레인 0 1 2 3     ← y
+ *   레인 4 5 6 7     ← y + 1
+ *
+ * 레인 배치는 setup이 넣어 주는 레인별 오프셋(edge_lane/attr_lane)에만
+ * 들어 있으므로 커널 자체는 블록 모양을 모른다.
+ * 쿼드 단위로 모여 있어 PS의 SoA 실행과 미분(ddx/ddy)에 바로 쓸 수 있다.
+ *
+ * 삼각형 setup(d3d11.c)은 28.4 고정소수점으로 edge 평면을 구하고,
+ * 커널은 블록 원점의 정수 edge 값에 레인별 오프셋(a*dx + b*dy)을 더해
+ * 부호만 검사한다 — 내부 = 세 edge 모두 >= 0 (top-left bias는 setup에서 반영).
+ *
+ * 속성(z, 색상, UV)도 삼각형당 한 번 구한 평면식(기울기)을 쓰므로
+ * 픽셀당 연산은 덧셈뿐이다:  attr[k] = attr(블록 원점) + dadx*dx[k] + dady*dy[k]
+ *
+ * CPU 기능은 런타임에 선택:
+ *   AVX2 (8-wide) → SSE2 (4-wide x2) → 스칼라
+ * 환경변수 CITC_D3D11_SIMD=scalar|sse2|avx2 로 강제 가능 (디버깅용).
+ *
+ * 같은 선택을 따르는 blend 커널(출력 병합)과 upscale 커널(동적 해상도
+ * Present)도 여기 둔다.
+ */
+
+#ifndef CITC_RASTER_SIMD_H
+#define CITC_RASTER_SIMD_H
+
+#include <stdint.h>
+
+#define RASTER_SPAN       8   /* 블록당 픽셀(레인) 수 */
+#define RASTER_BLOCK_W    4   /* 블록 폭 */
+#define RASTER_BLOCK_H    2   /* 블록 높이 */
+#define RASTER_MAX_ATTRS  8   /* 보간 속성 수 (z, r, g, b, u, v, ...) */
+
+/*
+ * 삼각형별 레인 오프셋 (setup에서 한 번 계산)
+ *
+ * 레인 k의 블록 내 위치 (dx, dy) = (k % 4, k / 4)
+ * edge_lane[i][k] = edge i의 x 증분 * dx + y 증분 * dy   (정수, 24.8)
+ * attr_lane[a][k] = 속성 a의 x 기울기 * dx + y 기울기 * dy
+ */
+struct raster_tri {
+	int32_t edge_lane[3][RASTER_SPAN];
+	int num_attrs;
+	float attr_lane[RASTER_MAX_ATTRS][RASTER_SPAN];
+};
+
+/* 블록 결과 */
+struct raster_span {
+	unsigned mask;                              /* bit k = 레인 k 커버 */
+	float attr[RASTER_MAX_ATTRS][RASTER_SPAN];  /* 레인별 보간 속성 */
+};
+
+/*
+ * 블록 커널
+ * w:     블록 원점(레인 0 픽셀 중심)에서의 edge 값 3개
+ *        (|w| < 2^30 으로 클램프된 값)
+ * attr:  블록 원점에서의 속성 값 num_attrs개
+ * valid: 유효 레인 마스크 (bbox/타일 밖 레인 제외)
+ */
+typedef void (*raster_span_fn)(const struct raster_tri *t, const int32_t w[3],
+			       const float *attr, unsigned valid,
+			       struct raster_span *out);
+
+/* 현재 CPU에 맞는 커널 반환 (첫 호출 시 선택 후 캐시) */
+raster_span_fn raster_span_select(void);
+
+/*
+ * 출력 병합 (blend) 커널 — 자주 쓰는 블렌드 상태 전용
+ *
+ * 렌더 타깃은 XRGB8888이므로 소스를 [0, 1]로 clamp해 8비트로 바꾼 뒤
+ * 정수로 섞는다 (s = 소스, d = 대상, a = 소스 알파, 모두 0..255):
+ *
+ *   OPAQUE  블렌드 끔          s
+ *   ALPHA   SRC_ALPHA, INV_SRC_ALPHA   (s*a + d*(255-a)) / 255
+ *   ADD     ONE, ONE                   min(s + d, 255)
+ *   PREMUL  ONE, INV_SRC_ALPHA         min(s + d*(255-a) / 255, 255)
+ *
+ * 나눗셈은 반올림 (x + 128 + ((x + 128) >> 8)) >> 8 — 0..65025에서 정확.
+ * 그 밖의 팩터/연산/쓰기 마스크는 d3d11.c의 일반(float) 경로가 처리.
+ */
+enum raster_blend_mode {
+	RASTER_BLEND_OPAQUE,
+	RASTER_BLEND_ALPHA,
+	RASTER_BLEND_ADD,
+	RASTER_BLEND_PREMUL,
+	RASTER_BLEND_COUNT
+};
+
+/*
+ * 블렌드 커널
+ * row0:  블록 윗 행(레인 0..3)의 렌더 타깃 픽셀
+ * row1:  아랫 행(레인 4..7), 마스크에 아랫 행 레인이 없으면 읽지 않음
+ * src:   채널별(r, g, b, a) 레인 배열 [RASTER_SPAN]
+ * mask:  쓸 레인 (bit k = 레인 k)
+ */
+typedef void (*raster_blend_fn)(uint32_t *row0, uint32_t *row1,
+				const float *const src[4], unsigned mask);
+
+/* 모드별 커널 (span 커널과 같은 CPU 기능 선택을 따름) */
+raster_blend_fn raster_blend_select(enum raster_blend_mode mode);
+
+/*
+ * 업스케일 커널 — 동적 해상도의 Present (줄여 그린 백버퍼 → 창)
+ *
+ * 출력 한 행을 bilinear로 채운다. 가중치는 0..256 고정소수점이고
+ * 가로 보간 결과를 한 번 반올림한 뒤 세로로 보간한다:
+ *
+ *   h   = (a * (256 - wx) + b * wx + 128) >> 8     (위/아래 행 각각)
+ *   out = (h0 * (256 - wy) + h1 * wy + 128) >> 8
+ *
+ * 모든 중간값이 16비트 안이라 SSE2/스칼라 결과가 같다.
+ *
+ * dst:   출력 행 (n 픽셀)
+ * src0:  위 원본 행, src1: 아래 원본 행
+ * wy:    아래 행 가중치 (0..256)
+ * xs:    출력 x마다 왼쪽 원본 열 (xs[x] + 1도 원본 안이어야 함)
+ * wx:    출력 x마다 오른쪽 열 가중치 (0..256)
+ */
+typedef void (*raster_upscale_fn)(uint32_t *dst, int n,
+				  const uint32_t *src0, const uint32_t *src1,
+				  int wy, const int32_t *xs, const uint16_t *wx);
+
+/* span 커널과 같은 CPU 기능 선택을 따름 */
+raster_upscale_fn raster_upscale_select(void);
+
+#endif /* CITC_RASTER_SIMD_H */
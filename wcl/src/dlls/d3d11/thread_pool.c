@@ -0,0 +1,170 @@
+/*
+ * thread_pool.c — 소프트웨어 래스터라이저용 워커 스레드 풀
+ * =========================================================
+ *
+ * 구조:
+ *   - 워커 (N-1)개가 tp_wake 조건변수에서 대기
+ *   - thread_pool_run()이 작업 정보를 기록하고 generation을 올려 깨움
+ *   - 작업 범위를 스레드 수만큼 연속 구간으로 나눠 각 스레드에 배정
+ *   - 스레드는 자기 구간의 카운터(fetch-add)로 작업을 하나씩 가져가고,
+ *     자기 구간이 바닥나면 다른 스레드의 구간에서 훔쳐 온다
+ *   - 마지막 워커가 끝나면 tp_done으로 호출 스레드에 알림
+ *
+ * 평소에는 각 스레드가 자기 카운터만 건드리므로 카운터 하나를
+ * 모두가 두드리는 경합이 없고, 이웃한 작업(인접 타일, 연속된
+ * thread group)이 같은 스레드에 몰려 캐시 지역성도 좋다.
+ * 비용이 제각각인 작업은 훔쳐 오기로 부하 분산된다.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+#define THREAD_POOL_MAX 64
+
+static pthread_once_t tp_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t tp_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tp_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tp_done = PTHREAD_COND_INITIALIZER;
+
+static int tp_nthreads = 1;     /* 호출 스레드 포함 */
+static __thread int tp_self;    /* 워커 번호, 호출 스레드는 0 */
+static unsigned tp_generation;  /* run 호출마다 증가 */
+static int tp_active;           /* 현재 작업 중인 워커 수 */
+
+/* 스레드별 작업 구간 [next, end) — 캐시 라인 하나씩 차지 */
+struct tp_range {
+	int next;                   /* 다음 작업 인덱스 (atomic) */
+	int end;
+} __attribute__((aligned(64)));
+
+/* 현재 작업 (tp_lock 보호 하에 기록, generation 증가로 공개) */
+static thread_pool_fn tp_fn;
+static void *tp_arg;
+static struct tp_range tp_ranges[THREAD_POOL_MAX];
+
+/* 구간 r에서 작업 하나를 가져옴, 없으면 -1 */
+static int range_take(struct tp_range *r)
+{
+	if (__atomic_load_n(&r->next, __ATOMIC_RELAXED) >= r->end)
+		return -1;
+	int j = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED);
+	return j < r->end ? j : -1;
+}
+
+/* self: 0 = 호출 스레드, 1..N-1 = 워커 */
+static void drain_jobs(thread_pool_fn fn, void *arg, int self)
+{
+	int j;
+
+	while ((j = range_take(&tp_ranges[self])) >= 0)
+		fn(arg, j);
+
+	/* 자기 구간 소진 → 이웃부터 차례로 훔침 */
+	for (int k = 1; k < tp_nthreads; k++) {
+		struct tp_range *victim = &tp_ranges[(self + k) % tp_nthreads];
+		while ((j = range_take(victim)) >= 0)
+			fn(arg, j);
+	}
+}
+
+static void *worker_main(void *param)
+{
+	int self = (int)(intptr_t)param;
+	unsigned seen = 0;
+
+	tp_self = self;
+
+	pthread_mutex_lock(&tp_lock);
+	for (;;) {
+		while (tp_generation == seen)
+			pthread_cond_wait(&tp_wake, &tp_lock);
+		seen = tp_generation;
+
+		thread_pool_fn fn = tp_fn;
+		void *arg = tp_arg;
+		pthread_mutex_unlock(&tp_lock);
+
+		drain_jobs(fn, arg, self);
+
+		pthread_mutex_lock(&tp_lock);
+		if (--tp_active == 0)
+			pthread_cond_signal(&tp_done);
+	}
+	return NULL;
+}
+
+static void pool_init(void)
+{
+	long n = 0;
+	const char *env = getenv("CITC_D3D11_THREADS");
+	if (env && *env)
+		n = strtol(env, NULL, 10);
+	if (n <= 0)
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		n = 1;
+	if (n > THREAD_POOL_MAX)
+		n = THREAD_POOL_MAX;
+
+	/* 워커 생성 — 실패하면 만들어진 만큼만 사용 */
+	int created = 0;
+	for (long i = 1; i < n; i++) {
+		pthread_t t;
+		if (pthread_create(&t, NULL, worker_main,
+				   (void *)(intptr_t)i) != 0)
+			break;
+		pthread_detach(t);
+		created++;
+	}
+	tp_nthreads = created + 1;
+}
+
+int thread_pool_size(void)
+{
+	pthread_once(&tp_once, pool_init);
+	return tp_nthreads;
+}
+
+int thread_pool_self(void)
+{
+	return tp_self;
+}
+
+void thread_pool_run(thread_pool_fn fn, void *arg, int njobs)
+{
+	if (njobs <= 0)
+		return;
+
+	pthread_once(&tp_once, pool_init);
+
+	/* 단일 스레드이거나 작업이 하나뿐이면 직접 실행 */
+	if (tp_nthreads == 1 || njobs == 1) {
+		for (int j = 0; j < njobs; j++)
+			fn(arg, j);
+		return;
+	}
+
+	pthread_mutex_lock(&tp_lock);
+	tp_fn = fn;
+	tp_arg = arg;
+	for (int i = 0; i < tp_nthreads; i++) {
+		tp_ranges[i].next = (int)((long long)njobs * i / tp_nthreads);
+		tp_ranges[i].end = (int)((long long)njobs * (i + 1) / tp_nthreads);
+	}
+	tp_active = tp_nthreads - 1;
+	tp_generation++;
+	pthread_cond_broadcast(&tp_wake);
+	pthread_mutex_unlock(&tp_lock);
+
+	/* 호출 스레드도 작업에 참여 */
+	drain_jobs(fn, arg, 0);
+
+	pthread_mutex_lock(&tp_lock);
+	while (tp_active > 0)
+		pthread_cond_wait(&tp_done, &tp_lock);
+	pthread_mutex_unlock(&tp_lock);
+}
@@ -0,0 +1,39 @@
+/*
+ * thread_pool.h — 소프트웨어 래스터라이저용 워커 스레드 풀
+ * =========================================================
+ *
+ * "N개의 작업을 병렬로 처리하고 모두 끝날 때까지 대기"하는
+ * parallel-for 형태의 단순한 풀.
+ *
+ * 타일 래스터라이징, compute thread group처럼 작업 단위가 서로
+ * 독립적인 경우에 사용. 작업은 스레드별 연속 구간으로 나눠 주고
+ * 먼저 끝난 스레드가 남의 구간에서 훔쳐 온다 (work stealing).
+ * 호출 스레드도 작업을 나눠 가지므로, 스레드 수가 1이면
+ * 별도 스레드 없이 호출 스레드에서 그대로 실행된다.
+ *
+ * 스레드 수: 환경변수 CITC_D3D11_THREADS (기본: 온라인 CPU 수)
+ */
+
+#ifndef CITC_THREAD_POOL_H
+#define CITC_THREAD_POOL_H
+
+/* 작업 함수: job은 0 .. njobs-1 */
+typedef void (*thread_pool_fn)(void *arg, int job);
+
+/*
+ * njobs개의 작업을 풀에서 실행하고 모두 완료되면 반환.
+ * 풀은 첫 호출 시 lazily 생성된다.
+ * 한 번에 하나의 호출 스레드만 사용해야 한다 (재진입 불가).
+ */
+void thread_pool_run(thread_pool_fn fn, void *arg, int njobs);
+
+/* 작업을 처리하는 총 스레드 수 (호출 스레드 포함, 최소 1) */
+int thread_pool_size(void);
+
+/*
+ * 지금 스레드의 번호: 워커는 1 .. size-1, 그 밖의 스레드(호출 스레드)는 0.
+ * 작업 함수가 스레드별 버퍼를 size개 배열에서 고를 때 쓴다.
+ */
+int thread_pool_self(void);
+
+#endif /* CITC_THREAD_POOL_H */
@@ -206,14 +206,21 @@ sc_Present(void *This, UINT SyncInterval, UINT Flags)
 				     &wnd_w, &wnd_h) < 0)
 		return E_FAIL;
 
-	/* 백버퍼 → 윈도우 픽셀 버퍼 복사 */
+	/* 대기 중인 D3D11 래스터라이징 완료, 백버퍼의 남은 clear 채움 */
+	d3d11_flush();
+	d3d11_resolve_resource(sc->resource_idx);
+
+	/* 백버퍼 → 윈도우 픽셀 버퍼 복사 (동적 해상도면 확대) */
 	int copy_w = (int)sc->width < wnd_w ? (int)sc->width : wnd_w;
 	int copy_h = (int)sc->height < wnd_h ? (int)sc->height : wnd_h;
 
-	for (int y = 0; y < copy_h; y++) {
-		memcpy(&wnd_pixels[y * wnd_w],
-		       &sc->backbuffer[y * sc->width],
-		       (size_t)copy_w * 4);
+	if (!d3d11_dynres_present(sc->resource_idx, wnd_pixels, wnd_w,
+				  copy_w, copy_h)) {
+		for (int y = 0; y < copy_h; y++) {
+			memcpy(&wnd_pixels[y * wnd_w],
+			       &sc->backbuffer[y * sc->width],
+			       (size_t)copy_w * 4);
+		}
 	}
 
 	/* CDP commit (컴포지터에 프레임 전달) */
@@ -277,6 +284,10 @@ sc_ResizeBuffers(void *This, UINT BufferCount, UINT Width, UINT Height,
 	if (Width == 0 || Height == 0)
 		return E_INVALIDARG;
 
+	/* 옛 백버퍼를 가리키는 D3D11 리소스는 해제, GetBuffer 때 다시 등록 */
+	d3d11_release_swapchain_texture(sc->resource_idx);
+	sc->resource_idx = -1;
+
 	free(sc->backbuffer);
 	sc->width = Width;
 	sc->height = Height;
@@ -0,0 +1,3260 @@
+/*
+ * d3d11_raster_test.c — D3D11 소프트웨어 래스터라이저 렌더링 테스트
+ * =================================================================
+ *
+ * 다른 테스트와 달리 MinGW .exe가 아니라 호스트에서 바로 실행하는
+ * 네이티브 프로그램. d3d11 소스를 직접 링크하고, D3D11CreateDevice를
+ * 스텁 테이블에서 꺼내 COM vtable을 그대로 호출한다 (dxgi는 아래 스텁).
+ *
+ * 각 테스트는 그린 뒤 렌더 타깃을 Map(READ)로 읽어 픽셀을 확인하고,
+ * image()로 결과 이미지의 해시를 남긴다.
+ *
+ * 래스터라이저 경로(SIMD 폭, 스레드 수, JIT, 비동기 렌더 스레드, TBDR, ...)는
+ * 환경변수로 고르고 프로세스당 한 번 정해지므로, 모드마다 fork한 자식에서
+ * 전체 테스트를 돌린다. exact 모드는 기본 모드와 이미지가 비트 단위로
+ * 같아야 한다.
+ * deferred 모드는 같은 테스트를 deferred context에 기록하고, 읽기 전에
+ * FinishCommandList + ExecuteCommandList로 즉시 컨텍스트에서 실행한다.
+ *
+ * 빌드 + 실행: make -C wcl/tests check-host
+ *
+ * 테스트 항목:
+ *   [1]  bin: 타일 경계를 걸친 사각형 — 구멍/배경 없음
+ *   [2]  bin: BIN_MAX_TRIS를 넘는 Draw (중간 flush) == Draw 여러 번
+ *   [3]  edge: 사방 기울기의 삼각형 팬 — 구멍 없음 (스칼라/SSE2/AVX2 동일)
+ *   [4]  fill: 공유 에지 메시를 정순/역순으로 — 모든 픽셀이 정확히 한 번 (top-left)
+ *   [5]  fill: 속성 평면 — 가로 그라디언트가 픽셀 중심 값과 일치
+ *   [6]  vcache: DrawIndexed (R16/R32, Base/Start 오프셋, 희소 인덱스, 넓은 범위의 작은 Draw) == Draw
+ *   [7]  vm: dp4 MVP (cb0) + mul/mad 셰이더 — 위치/색이 CPU 계산과 일치
+ *   [8]  soa: 레인마다 다른 loop/breakc/if 분기 — 부분 블록에서도 픽셀별 결과
+ *   [9]  hiz: 앞/뒤 순서, 가려진 Draw, Map(READ) 후 / Map(WRITE)로 바꾼 깊이
+ *   [10] clear: 빠른 clear 후 읽기/부분 타일/일부만 그리기/깊이 clear 값/복사/덮어쓰기
+ *   [11] update: UpdateSubresource 상자 (텍스처 + SrcRowPitch, 버퍼 바이트 범위)
+ *        (모든 테스트는 deferred context 모드로도 실행)
+ *   [12] fetch: 포맷/순서/APPEND_ALIGNED가 다른 레이아웃 — 같은 이미지
+ *   [13] pipe: Draw 사이 상태 변경 (CB 내용, PS, 컬링, 뷰포트, RT 전환)이 모두 반영
+ *   [14] dynamic: Map(WRITE_DISCARD)/NO_OVERWRITE 사이의 Draw가 각자 자기 내용을 봄 (VB, PS CB)
+ *        버퍼 20개에 DISCARD 뒤 NO_OVERWRITE로 덧붙이기 (빈 Map, 같은 값 다시 쓰기 포함)
+ *   [15] inst: DrawInstanced (인스턴스 VB 슬롯) / DrawIndexedInstanced (SV_InstanceID)
+ *   [16] blend: 블렌드 상태 7종 — 값이 식과 일치, 그라디언트 이미지는 SIMD 커널 간 동일
+ *   [17] mip: 타일 배치 텍스처 1:1 point 샘플, 축소 시 밉/trilinear, RT 샘플링, GenerateMips
+ *   [18] bc: BC1/BC3 블록 1:1 디코드, 앱이 준 밉 레벨, MipLevels=0 전체 체인
+ *   [19] clip: near 평면/w = 0 절단, 가드 밴드 밖 삼각형, 뷰포트와 시저 경계
+ *   [20] tbdr: 깊이 겹침 + 중간 블렌드 Draw == CPU 순서대로 계산, 텍스처 LOD 겹침 이미지
+ *   [21] cs: structured UAV + atomic, TGSM + 배리어, CopyResource — 여러 워커에 걸친 그룹
+ *   [22] kernel: VS_XFORM/PS_COLOR 커널 == 같은 식의 VM 셰이더 (비트 단위), PS_TEX == PS_TEX_COLOR(흰색)
+ *        (kernels=0 모드는 모든 셰이더를 VM으로 — 텍스처 테스트는 건너뜀)
+ *   [23] dynres: 예산 초과로 배율 0.5 → 백버퍼 왼쪽 위에만 그림, Present 확대 (스칼라/SSE2 커널 동일)
+ *   [24] query: 겹친 오클루전 쿼리가 모두 셈, 프레디케이션 (가려짐/보임), 타임스탬프, 이벤트, 활성 한도 초과
+ *   [25] handle: 해제된 슬롯의 옛 핸들 조회 실패, 옛 고정 한도(256)를 넘는 오브젝트로 그리기, 백버퍼 해제 후 재등록
+ *        스레드 8개가 동시에 할당/조회/해제 — 중복 슬롯, 옛 핸들 조회, free list 누락 없음
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/d3d11_types.h"
+#include "../include/stub_entry.h"
+#include "../src/dlls/d3d11/d3d11.h"
+#include "../src/dlls/d3d11/handle_table.h"
+
+/*
+ * === dxgi 스텁 (d3d11.c가 참조) ===
+ * SwapChain은 g_sc 하나뿐: 백버퍼 픽셀만 들고 있고, GetBuffer가
+ * 돌려주는 포인터 대신 &g_sc를 리소스로 넘긴다.
+ */
+static struct {
+	uint32_t *pixels;
+	int w, h;
+	int res_idx;            /* d3d11이 등록한 백버퍼 리소스, -1 = 없음 */
+} g_sc = { NULL, 0, 0, -1 };
+
+int dxgi_get_swapchain_backbuffer(void *sc, uint32_t **pixels, int *w, int *h)
+{
+	if (sc != &g_sc || !g_sc.pixels) return -1;
+	*pixels = g_sc.pixels;
+	*w = g_sc.w;
+	*h = g_sc.h;
+	return 0;
+}
+
+void dxgi_set_swapchain_resource(void *sc, int idx)
+{
+	if (sc == &g_sc) g_sc.res_idx = idx;
+}
+
+int dxgi_get_swapchain_resource_idx(void *sc)
+{
+	return sc == &g_sc ? g_sc.res_idx : -1;
+}
+
+HRESULT dxgi_create_swapchain_for_d3d11(void *dev, DXGI_SWAP_CHAIN_DESC *desc,
+					void **pp)
+{
+	(void)dev; (void)desc; (void)pp;
+	return E_FAIL;
+}
+
+/* === 모드 === */
+
+struct mode {
+	const char *name;
+	const char *env;        /* 환경변수 이름, NULL = 기본 */
+	const char *value;
+	int exact;              /* 이미지가 기본 모드와 같아야 함 */
+	int deferred;           /* deferred context에 기록해 즉시 컨텍스트에서 실행 */
+	int no_sample;          /* PS VM만 — sample이 없어 텍스처 테스트는 건너뜀 */
+};
+
+static const struct mode modes[] = {
+	{ "default",   NULL,                 NULL,     1, 0, 0 },
+	{ "threads=1", "CITC_D3D11_THREADS", "1",      1, 0, 0 },
+	{ "scalar",    "CITC_D3D11_SIMD",    "scalar", 1, 0, 0 },
+	{ "sse2",      "CITC_D3D11_SIMD",    "sse2",   1, 0, 0 },
+	{ "jit",       "CITC_D3D11_JIT",     "1",      1, 0, 0 },
+	{ "deferred",  NULL,                 NULL,     1, 1, 0 },
+	{ "async",     "CITC_D3D11_ASYNC",   "1",      1, 0, 0 },
+	{ "tbdr",      "CITC_D3D11_TBDR",    "1",      1, 0, 0 },
+	{ "kernels=0", "CITC_D3D11_KERNELS", "0",      1, 0, 1 },
+};
+
+#define N_MODES    (int)(sizeof(modes) / sizeof(modes[0]))
+#define MAX_IMAGES 64
+
+/* 자식 프로세스들과 공유 (mmap) */
+struct results {
+	int nimages[N_MODES];
+	uint64_t hash[N_MODES][MAX_IMAGES];
+	char name[N_MODES][MAX_IMAGES][32];
+};
+
+static struct results *g_res;
+static int g_mode;
+static int g_fail;              /* 현재 테스트의 실패 수 */
+
+static void expect(int cond, const char *fmt, ...)
+{
+	if (cond) return;
+	if (g_fail++ < 4) {
+		va_list ap;
+		va_start(ap, fmt);
+		printf("      ");
+		vprintf(fmt, ap);
+		printf("\n");
+		va_end(ap);
+	}
+}
+
+/* === 디바이스 / 렌더 타깃 === */
+
+typedef HRESULT (__attribute__((ms_abi)) *create_device_fn)(
+	void *, int, void *, UINT, const D3D_FEATURE_LEVEL *, UINT, UINT,
+	void **, D3D_FEATURE_LEVEL *, void **);
+
+static ID3D11DeviceVtbl **dev;
+static ID3D11DeviceContextVtbl **ctx;   /* 테스트가 그리는 컨텍스트 */
+static ID3D11DeviceContextVtbl **imm;   /* 즉시 컨텍스트 (읽기용) */
+
+#define D(m, ...) (*dev)->m((void *)dev, __VA_ARGS__)
+#define C(m, ...) (*ctx)->m((void *)ctx, __VA_ARGS__)
+#define I(m, ...) (*imm)->m((void *)imm, __VA_ARGS__)
+
+static int W, H;
+static void *rt_tex, *rtv, *ds_tex, *dsv;
+
+static void *mkbuf(const void *data, UINT size, UINT bind)
+{
+	D3D11_BUFFER_DESC bd = {0};
+	bd.ByteWidth = size;
+	bd.BindFlags = bind;
+	D3D11_SUBRESOURCE_DATA sd = { data, 0, 0 };
+	void *b = NULL;
+	D(CreateBuffer, &bd, data ? &sd : NULL, &b);
+	return b;
+}
+
+static void bind_target(void)
+{
+	void *rtvs[1] = { rtv };
+	D3D11_VIEWPORT vp = { 0, 0, (float)W, (float)H, 0, 1 };
+	C(OMSetRenderTargets, 1, rtvs, dsv);
+	C(RSSetViewports, 1, &vp);
+	C(IASetPrimitiveTopology, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+/* w x h 렌더 타깃 + D32 깊이 버퍼를 만들고 바인딩 */
+static void target(int w, int h)
+{
+	W = w;
+	H = h;
+	D3D11_TEXTURE2D_DESC td = {0};
+	td.Width = w;
+	td.Height = h;
+	td.MipLevels = 1;
+	td.ArraySize = 1;
+	td.SampleDesc.Count = 1;
+	td.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	td.BindFlags = D3D11_BIND_RENDER_TARGET;
+	D(CreateTexture2D, &td, NULL, &rt_tex);
+	D(CreateRenderTargetView, rt_tex, NULL, &rtv);
+	td.Format = DXGI_FORMAT_D32_FLOAT;
+	td.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	D(CreateTexture2D, &td, NULL, &ds_tex);
+	D(CreateDepthStencilView, ds_tex, NULL, &dsv);
+	bind_target();
+}
+
+/* 테스트 사이: 상태를 기본값으로 되돌림 */
+static void reset(void)
+{
+	(*ctx)->ClearState((void *)ctx);
+	bind_target();
+}
+
+static void clear(float r, float g, float b)
+{
+	float c[4] = { r, g, b, 1 };
+	C(ClearRenderTargetView, rtv, c);
+	C(ClearDepthStencilView, dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
+
+/* deferred 모드: 지금까지 기록한 명령을 즉시 컨텍스트에서 실행 */
+static void submit(void)
+{
+	if (ctx == imm) return;
+	void *cl = NULL;
+	if (C(FinishCommandList, 1, &cl) != S_OK) {
+		expect(0, "FinishCommandList failed");
+		return;
+	}
+	I(ExecuteCommandList, cl, 0);
+	(*(ID3D11CommandListVtbl **)cl)->Release(cl);
+}
+
+/* 그린 결과를 읽음 (XRGB8888, W x H, 다음 그리기 전까지 유효) */
+static uint32_t *readback(void)
+{
+	static uint32_t *px;
+	static size_t cap;
+	D3D11_MAPPED_SUBRESOURCE m;
+
+	submit();
+
+	if ((size_t)W * H > cap) {
+		cap = (size_t)W * H;
+		px = realloc(px, cap * 4);
+	}
+	if (I(Map, rt_tex, 0, D3D11_MAP_READ, 0, &m) != S_OK) {
+		expect(0, "Map(READ) failed");
+		memset(px, 0, (size_t)W * H * 4);
+		return px;
+	}
+	for (int y = 0; y < H; y++)
+		memcpy(px + (size_t)y * W, (uint8_t *)m.pData + (size_t)y * m.RowPitch,
+		       (size_t)W * 4);
+	I(Unmap, rt_tex, 0);
+	return px;
+}
+
+static uint32_t pixel(const uint32_t *px, int x, int y)
+{
+	return px[y * W + x] & 0xFFFFFF;
+}
+
+/* 이미지 해시를 남김 — 모드 사이 비교용 */
+static void image(const char *name, const uint32_t *px)
+{
+	uint64_t h = 1469598103934665603ULL;
+	for (int i = 0; i < W * H; i++) {
+		h ^= px[i] & 0xFFFFFF;
+		h *= 1099511628211ULL;
+	}
+	int n = g_res->nimages[g_mode];
+	if (n >= MAX_IMAGES) return;
+	g_res->hash[g_mode][n] = h;
+	snprintf(g_res->name[g_mode][n], sizeof(g_res->name[0][0]), "%s", name);
+	g_res->nimages[g_mode] = n + 1;
+}
+
+/* === 셰이더 === */
+
+/* SHDR 토큰을 DXBC 컨테이너로 감쌈 (시그니처 청크 없음, 길이 토큰은 여기서) */
+static void *dxbc_wrap(const unsigned *shdr, int ntok, size_t *size)
+{
+	unsigned *b = calloc(11 + ntok, 4);
+	b[0] = 0x43425844;          /* "DXBC" */
+	b[5] = 1;
+	b[6] = (11 + ntok) * 4;     /* 전체 크기 */
+	b[7] = 1;                   /* 청크 수 */
+	b[8] = 36;                  /* 청크 오프셋 */
+	b[9] = 0x52444853;          /* "SHDR" */
+	b[10] = ntok * 4;
+	memcpy(b + 11, shdr, ntok * 4);
+	b[12] = ntok;
+	*size = b[6];
+	return b;
+}
+
+static void *create_vs(const unsigned *tok, int n)
+{
+	size_t size;
+	void *blob = dxbc_wrap(tok, n, &size), *vs = NULL;
+	D(CreateVertexShader, blob, size, NULL, &vs);
+	free(blob);
+	return vs;
+}
+
+static void *create_ps(const unsigned *tok, int n)
+{
+	size_t size;
+	void *blob = dxbc_wrap(tok, n, &size), *ps = NULL;
+	D(CreatePixelShader, blob, size, NULL, &ps);
+	free(blob);
+	return ps;
+}
+
+#define VS(tok) create_vs(tok, (int)(sizeof(tok) / 4))
+#define PS(tok) create_ps(tok, (int)(sizeof(tok) / 4))
+
+/* vs_4_0: o0 = v0 (SV_Position), o1 = v1 */
+static const unsigned vs_pass[] = {
+	0x00010040, 0,
+	0x0300005F, 0x001010F2, 0,
+	0x0300005F, 0x001010F2, 1,
+	0x04000067, 0x001020F2, 0, 1,
+	0x03000065, 0x001020F2, 1,
+	0x05000036, 0x001020F2, 0, 0x00101E46, 0,
+	0x05000036, 0x001020F2, 1, 0x00101E46, 1,
+	0x0100003E,
+};
+
+/* ps_4_0: o0 = v1 (정점 색) */
+static const unsigned ps_color[] = {
+	0x00000040, 0,
+	0x03000065, 0x001020F2, 0,
+	0x05000036, 0x001020F2, 0, 0x00101E46, 1,
+	0x0100003E,
+};
+
+/* === 정점 === */
+
+struct vtx {
+	float pos[3];
+	float color[4];
+};
+
+static void *layout_pc;         /* POSITION + COLOR */
+static void *vs_pc, *ps_pc;
+
+static void use_vb(void *vb, UINT stride)
+{
+	UINT off = 0;
+	C(IASetVertexBuffers, 0, 1, &vb, &stride, &off);
+}
+
+static void use_shaders(void)
+{
+	C(IASetInputLayout, layout_pc);
+	C(VSSetShader, vs_pc, NULL, 0);
+	C(PSSetShader, ps_pc, NULL, 0);
+}
+
+/* 축 정렬 사각형 = 삼각형 2개 (NDC, 시계 방향) */
+static void quad(struct vtx *v, float x0, float y0, float x1, float y1,
+		 float z, float r, float g, float b)
+{
+	struct vtx q[6] = {
+		{ { x0, y1, z }, { r, g, b, 1 } }, { { x1, y1, z }, { r, g, b, 1 } },
+		{ { x0, y0, z }, { r, g, b, 1 } }, { { x1, y1, z }, { r, g, b, 1 } },
+		{ { x1, y0, z }, { r, g, b, 1 } }, { { x0, y0, z }, { r, g, b, 1 } },
+	};
+	memcpy(v, q, sizeof(q));
+}
+
+static unsigned g_seed;
+
+static float rnd(void)
+{
+	g_seed = g_seed * 1103515245u + 12345u;
+	return ((g_seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+/* ============================================================
+ * [1] [2] 타일 binning
+ * ============================================================ */
+
+static void test_bin_coverage(void)
+{
+	/* 64x64 타일 경계와 어긋난 크기 — 가장자리 타일이 잘림 */
+	target(200, 150);
+	use_shaders();
+
+	/* 대각선을 공유하는 두 삼각형: 모든 픽셀이 둘 중 하나 */
+	struct vtx v[6];
+	quad(v, -1, -1, 1, 1, 0.5f, 0, 0, 0);
+	for (int i = 0; i < 3; i++) v[i].color[0] = 1;
+	for (int i = 3; i < 6; i++) v[i].color[1] = 1;
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	clear(0, 0, 1);
+	C(Draw, 6, 0);
+	uint32_t *px = readback();
+	int red = 0, green = 0, other = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			uint32_t c = pixel(px, x, y);
+			if (c == 0xFF0000) red++;
+			else if (c == 0x00FF00) green++;
+			else other++;
+		}
+	expect(other == 0, "%d pixels not covered", other);
+	expect(red > 0 && green > 0, "red %d green %d", red, green);
+	image("bin_coverage", px);
+}
+
+static void test_bin_flush(void)
+{
+	target(320, 240);
+	use_shaders();
+
+	/* BIN_MAX_TRIS (65536)보다 많은 작은 삼각형 */
+	enum { NTRI = 70000 };
+	struct vtx *v = malloc(sizeof(*v) * NTRI * 3);
+	g_seed = 1;
+	for (int i = 0; i < NTRI; i++) {
+		float cx = rnd() * 2 - 1, cy = rnd() * 2 - 1, sz = 0.02f + rnd() * 0.1f;
+		float r = rnd(), g = rnd(), b = rnd();
+		for (int j = 0; j < 3; j++) {
+			struct vtx *p = &v[i * 3 + j];
+			p->pos[0] = cx + (rnd() * 2 - 1) * sz;
+			p->pos[1] = cy + (rnd() * 2 - 1) * sz;
+			p->pos[2] = 0.5f;
+			p->color[0] = r;
+			p->color[1] = g;
+			p->color[2] = b;
+			p->color[3] = 1;
+		}
+	}
+	void *vb = mkbuf(v, sizeof(*v) * NTRI * 3, D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	/* 한 번의 Draw (중간 flush 발생) */
+	clear(0, 0, 0);
+	C(Draw, NTRI * 3, 0);
+	uint32_t *px = readback();
+	uint32_t *one = malloc((size_t)W * H * 4);
+	memcpy(one, px, (size_t)W * H * 4);
+	image("bin_flush", px);
+
+	/* 같은 삼각형을 1000개씩 나눠 그림 — 결과가 같아야 함 */
+	clear(0, 0, 0);
+	for (int i = 0; i < NTRI; i += 1000)
+		C(Draw, 1000 * 3, i * 3);
+	px = readback();
+	int diff = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) != (one[i] & 0xFFFFFF)) diff++;
+	expect(diff == 0, "%d pixels differ from the split draws", diff);
+
+	free(one);
+	free(v);
+}
+
+/* ============================================================
+ * [3] SIMD 에지 함수
+ * ============================================================ */
+
+/*
+ * 화면 밖까지 뻗은 삼각형 팬: 모든 기울기의 에지가 한 번씩 나오고,
+ * 이웃 삼각형이 에지를 공유하므로 모든 픽셀이 덮여야 한다.
+ * 폭이 8의 배수가 아니라 span 끝의 부분 블록도 지난다.
+ */
+static void test_edge_fan(void)
+{
+	target(203, 151);
+	use_shaders();
+
+	enum { NFAN = 61 };
+	struct vtx v[NFAN * 3];
+	float cx = 0.13f, cy = -0.07f;
+	for (int i = 0; i < NFAN; i++) {
+		float a0 = 6.2831853f * i / NFAN, a1 = 6.2831853f * (i + 1) / NFAN;
+		struct vtx t[3] = {
+			{ { cx, cy, 0.5f }, { 0, 0, 0, 1 } },
+			{ { cx + 3 * cosf(a1), cy + 3 * sinf(a1), 0.5f }, { 0, 0, 0, 1 } },
+			{ { cx + 3 * cosf(a0), cy + 3 * sinf(a0), 0.5f }, { 0, 0, 0, 1 } },
+		};
+		for (int j = 0; j < 3; j++) {
+			t[j].color[0] = (i & 1) ? 1.0f : 0.25f;
+			t[j].color[1] = (float)i / NFAN;
+		}
+		memcpy(&v[i * 3], t, sizeof(t));
+	}
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	clear(0, 0, 1);
+	C(Draw, NFAN * 3, 0);
+	uint32_t *px = readback();
+	int holes = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFF) == 0xFF) holes++;
+	expect(holes == 0, "%d pixels not covered", holes);
+	image("edge_fan", px);
+}
+
+/* ============================================================
+ * [4] [5] 28.4 고정소수점 setup
+ * ============================================================ */
+
+/* 픽셀 좌표 → NDC */
+static float ndc_x(float x) { return x / W * 2 - 1; }
+static float ndc_y(float y) { return 1 - y / H * 2; }
+
+/*
+ * 정점이 픽셀 중심/모서리에 놓인 어긋난 격자를 삼각형으로 나누고
+ * 삼각형마다 다른 빨강으로 정순/역순 두 번 그린다: 에지 위 픽셀이
+ * 두 삼각형에 모두 들어가면 순서에 따라 색이 달라지고, 빠지면 0.
+ * 바깥 정점은 화면 밖이라 메시 경계가 없다.
+ */
+static void test_fill_rule(void)
+{
+	target(160, 120);
+	use_shaders();
+
+	enum { GX = 9, GY = 7 };
+	float gx[GY][GX], gy[GY][GX];
+	g_seed = 3;
+	for (int j = 0; j < GY; j++)
+		for (int i = 0; i < GX; i++) {
+			/* 내부 정점은 픽셀 중심(.5) 또는 모서리(.0)에 스냅 */
+			float x = -20 + i * 25.0f, y = -20 + j * 26.0f;
+			if (i > 0 && i < GX - 1) x = (int)(x + rnd() * 12 - 6) + ((i + j) & 1 ? 0.5f : 0);
+			if (j > 0 && j < GY - 1) y = (int)(y + rnd() * 12 - 6) + ((i + j) & 1 ? 0.5f : 0);
+			gx[j][i] = ndc_x(x);
+			gy[j][i] = ndc_y(y);
+		}
+
+	struct vtx v[(GX - 1) * (GY - 1) * 6];
+	int n = 0;
+	for (int j = 0; j < GY - 1; j++)
+		for (int i = 0; i < GX - 1; i++) {
+			/* 사각형 하나 = 삼각형 2개, 대각선 방향은 번갈아 */
+			int q[4][2] = { { i, j }, { i + 1, j }, { i + 1, j + 1 }, { i, j + 1 } };
+			int tri[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+			if ((i + j) & 1) {
+				int alt[2][3] = { { 0, 1, 3 }, { 1, 2, 3 } };
+				memcpy(tri, alt, sizeof(tri));
+			}
+			for (int t = 0; t < 2; t++)
+				for (int k = 0; k < 3; k++) {
+					int *p = q[tri[t][k]];
+					struct vtx *o = &v[n++];
+					o->pos[0] = gx[p[1]][p[0]];
+					o->pos[1] = gy[p[1]][p[0]];
+					o->pos[2] = 0.5f;
+					o->color[0] = (n / 3 + 1) * 2 / 255.0f;
+					o->color[1] = 0;
+					o->color[2] = 0;
+					o->color[3] = 1;
+				}
+		}
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	D3D11_RASTERIZER_DESC rd = {0};
+	rd.FillMode = D3D11_FILL_SOLID;
+	rd.CullMode = D3D11_CULL_NONE;
+	rd.DepthClipEnable = 1;
+	void *rs;
+	D(CreateRasterizerState, &rd, &rs);
+	C(RSSetState, rs);
+
+	clear(0, 0, 0);
+	C(Draw, n, 0);
+	uint32_t *fwd = malloc((size_t)W * H * 4);
+	memcpy(fwd, readback(), (size_t)W * H * 4);
+
+	/* 삼각형 순서만 뒤집은 같은 메시 */
+	struct vtx rv[(GX - 1) * (GY - 1) * 6];
+	for (int t = 0; t < n / 3; t++)
+		memcpy(&rv[t * 3], &v[n - 3 - t * 3], sizeof(struct vtx) * 3);
+	void *rvb = mkbuf(rv, sizeof(rv), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(rvb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, n, 0);
+	uint32_t *px = readback();
+
+	int twice = 0, holes = 0;
+	for (int i = 0; i < W * H; i++) {
+		if (((fwd[i] >> 16) & 0xFF) == 0) holes++;
+		else if (px[i] != fwd[i]) twice++;
+	}
+	expect(holes == 0, "%d pixels not covered", holes);
+	expect(twice == 0, "%d pixels covered more than once", twice);
+	image("fill_rule", fwd);
+	free(fwd);
+}
+
+/* 왼쪽 빨강 0 → 오른쪽 1: 픽셀 중심에서 보간한 값 */
+static void test_attr_plane(void)
+{
+	target(256, 64);
+	use_shaders();
+
+	struct vtx v[6];
+	quad(v, -1, -1, 1, 1, 0.5f, 0, 0, 0);
+	for (int i = 0; i < 6; i++)
+		v[i].color[0] = v[i].pos[0] > 0 ? 1.0f : 0.0f;
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+	uint32_t *px = readback();
+	int worst = 0;
+	for (int y = 0; y < H; y += 7)
+		for (int x = 0; x < W; x++) {
+			int want = (int)((x + 0.5f) / W * 255 + 0.5f);
+			int got = (int)(pixel(px, x, y) >> 16);
+			if (abs(got - want) > worst) worst = abs(got - want);
+		}
+	expect(worst <= 1, "gradient off by %d", worst);
+	image("attr_plane", px);
+}
+
+/* ============================================================
+ * [6] post-transform 정점 캐시
+ * ============================================================ */
+
+/*
+ * 정점을 공유하는 격자 메시를 DrawIndexed로 그린 결과가, 인덱스를
+ * 펼쳐 Draw로 그린 결과와 같아야 한다. 인덱스 범위가 direct-mapped
+ * 한도를 넘는 희소 인덱스는 64-entry 캐시 경로를 지난다.
+ */
+static void test_vcache(void)
+{
+	target(192, 144);
+	use_shaders();
+
+	enum { GX = 17, GY = 13, NV = GX * GY, NI = (GX - 1) * (GY - 1) * 6 };
+	enum { BASE = 5, START = 9, FAR = (1 << 20) + 100 };
+	struct vtx grid[NV];
+	g_seed = 4;
+	for (int j = 0; j < GY; j++)
+		for (int i = 0; i < GX; i++) {
+			struct vtx *p = &grid[j * GX + i];
+			p->pos[0] = ndc_x(-10 + i * 13.0f + rnd() * 6);
+			p->pos[1] = ndc_y(-10 + j * 14.0f + rnd() * 6);
+			p->pos[2] = 0.5f;
+			p->color[0] = rnd();
+			p->color[1] = rnd();
+			p->color[2] = rnd();
+			p->color[3] = 1;
+		}
+	uint32_t idx[NI];
+	int n = 0;
+	for (int j = 0; j < GY - 1; j++)
+		for (int i = 0; i < GX - 1; i++) {
+			uint32_t a = j * GX + i, b = a + 1, c = a + GX, d = c + 1;
+			uint32_t t[6] = { a, b, c, b, d, c };
+			memcpy(&idx[n], t, sizeof(t));
+			n += 6;
+		}
+
+	/* 기준: 인덱스를 펼친 Draw */
+	struct vtx flat[NI];
+	for (int i = 0; i < NI; i++) flat[i] = grid[idx[i]];
+	void *vb = mkbuf(flat, sizeof(flat), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, NI, 0);
+	uint32_t *px = readback();
+	uint32_t *ref = malloc((size_t)W * H * 4);
+	memcpy(ref, px, (size_t)W * H * 4);
+	image("vcache", px);
+
+	/* R16, BaseVertexLocation + StartIndexLocation */
+	struct vtx vbase[BASE + NV];
+	memset(vbase, 0, sizeof(vbase));
+	memcpy(vbase + BASE, grid, sizeof(grid));
+	uint16_t i16[START + NI];
+	memset(i16, 0, sizeof(i16));
+	for (int i = 0; i < NI; i++) i16[START + i] = (uint16_t)idx[i];
+	vb = mkbuf(vbase, sizeof(vbase), D3D11_BIND_VERTEX_BUFFER);
+	void *ib = mkbuf(i16, sizeof(i16), D3D11_BIND_INDEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	C(IASetIndexBuffer, ib, DXGI_FORMAT_R16_UINT, 0);
+	clear(0, 0, 0);
+	C(DrawIndexed, NI, START, BASE);
+	px = readback();
+	int diff = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) != (ref[i] & 0xFFFFFF)) diff++;
+	expect(diff == 0, "R16: %d pixels differ from Draw", diff);
+
+	/* R32, 아래쪽 절반의 정점을 FAR만큼 떨어뜨린 희소 인덱스 */
+	struct vtx *sparse = calloc((size_t)FAR + NV, sizeof(struct vtx));
+	uint32_t i32[NI];
+	for (int i = 0; i < NV; i++)
+		sparse[i < NV / 2 ? i : FAR + i] = grid[i];
+	for (int i = 0; i < NI; i++)
+		i32[i] = idx[i] < NV / 2 ? idx[i] : FAR + idx[i];
+	vb = mkbuf(sparse, (UINT)(sizeof(struct vtx) * ((size_t)FAR + NV)),
+		   D3D11_BIND_VERTEX_BUFFER);
+	ib = mkbuf(i32, sizeof(i32), D3D11_BIND_INDEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	C(IASetIndexBuffer, ib, DXGI_FORMAT_R32_UINT, 0);
+	clear(0, 0, 0);
+	C(DrawIndexed, NI, 0, 0);
+	px = readback();
+	diff = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) != (ref[i] & 0xFFFFFF)) diff++;
+	expect(diff == 0, "sparse R32: %d pixels differ from Draw", diff);
+
+	/* 인덱스 6개가 넓은 범위를 걸침: 범위 배열 대신 64-entry 캐시 */
+	enum { MID = 500000 };
+	struct vtx *wide = calloc((size_t)MID + NV, sizeof(struct vtx));
+	memcpy(wide, grid, sizeof(grid));
+	memcpy(wide + MID, grid, sizeof(grid));
+	uint32_t i6[6];
+	struct vtx flat6[6];
+	for (int i = 0; i < 6; i++) {
+		uint32_t g = i < 3 ? idx[i] : idx[NI - 6 + i];
+		i6[i] = i < 3 ? g : MID + g;
+		flat6[i] = grid[g];
+	}
+	vb = mkbuf(flat6, sizeof(flat6), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+	px = readback();
+	memcpy(ref, px, (size_t)W * H * 4);
+	vb = mkbuf(wide, (UINT)(sizeof(struct vtx) * ((size_t)MID + NV)),
+		   D3D11_BIND_VERTEX_BUFFER);
+	ib = mkbuf(i6, sizeof(i6), D3D11_BIND_INDEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	C(IASetIndexBuffer, ib, DXGI_FORMAT_R32_UINT, 0);
+	clear(0, 0, 0);
+	C(DrawIndexed, 6, 0, 0);
+	px = readback();
+	diff = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) != (ref[i] & 0xFFFFFF)) diff++;
+	expect(diff == 0, "wide 6-index draw: %d pixels differ from Draw", diff);
+	free(wide);
+
+	free(sparse);
+	free(ref);
+}
+
+/* ============================================================
+ * [7] 셰이더 IR VM
+ * ============================================================ */
+
+/* vs_4_0: o0 = mul(v0, cb0[0..3]) (dp4 행), o1 = v1 * cb0[4] */
+static const unsigned vs_mvp_mul[] = {
+	0x00010040, 0,
+	0x0300005F, 0x001010F2, 0,
+	0x0300005F, 0x001010F2, 1,
+	0x04000067, 0x001020F2, 0, 1,
+	0x03000065, 0x001020F2, 1,
+	0x08000011, 0x00102012, 0, 0x00101E46, 0, 0x00208E46, 0, 0,
+	0x08000011, 0x00102022, 0, 0x00101E46, 0, 0x00208E46, 0, 1,
+	0x08000011, 0x00102042, 0, 0x00101E46, 0, 0x00208E46, 0, 2,
+	0x08000011, 0x00102082, 0, 0x00101E46, 0, 0x00208E46, 0, 3,
+	0x08000038, 0x001020F2, 1, 0x00101E46, 1, 0x00208E46, 0, 4,
+	0x0100003E,
+};
+
+/* ps_4_0: o0 = mad(v1, (0.5, 1, 2, 1), (0.25, 0.1, 0, 0)) */
+static const unsigned ps_mad[] = {
+	0x00000040, 0,
+	0x03000065, 0x001020F2, 0,
+	0x0F000032, 0x001020F2, 0, 0x00101E46, 1,
+	0x00004E46, 0x3F000000, 0x3F800000, 0x40000000, 0x3F800000,
+	0x00004E46, 0x3E800000, 0x3DCCCCCD, 0x00000000, 0x00000000,
+	0x0100003E,
+};
+
+/*
+ * 화면 전체 사각형을 cb0의 행렬로 축소/이동: 덮인 영역이 정확히
+ * [48, 112) x [48, 112)이고, 색은 v1 * cb0[4]에 mad를 한 값.
+ * 두 셰이더 모두 네이티브 커널 모양이 아니라 VM이 돈다.
+ */
+static void test_vm_alu(void)
+{
+	target(128, 128);
+	void *vs = VS(vs_mvp_mul), *ps = PS(ps_mad);
+	C(IASetInputLayout, layout_pc);
+	C(VSSetShader, vs, NULL, 0);
+	C(PSSetShader, ps, NULL, 0);
+
+	float cb[5][4] = {
+		{ 0.5f, 0, 0, 0.25f },
+		{ 0, 0.5f, 0, -0.25f },
+		{ 0, 0, 1, 0 },
+		{ 0, 0, 0, 1 },
+		{ 1, 0.5f, 0.25f, 1 },
+	};
+	void *cbuf = mkbuf(cb, sizeof(cb), D3D11_BIND_CONSTANT_BUFFER);
+	C(VSSetConstantBuffers, 0, 1, &cbuf);
+
+	struct vtx v[6];
+	quad(v, -1, -1, 1, 1, 0.5f, 0.8f, 0.6f, 1.0f);
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+	uint32_t *px = readback();
+
+	/* (0.8, 0.3, 0.25) → mad → (0.65, 0.4, 0.5) */
+	int want[3] = { 166, 102, 128 }, bad = 0, worst = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			uint32_t c = pixel(px, x, y);
+			int in = x >= 48 && x < 112 && y >= 48 && y < 112;
+			if (!in) {
+				if (c) bad++;
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				int d = abs((int)((c >> (16 - 8 * k)) & 0xFF) - want[k]);
+				if (d > worst) worst = d;
+			}
+		}
+	expect(bad == 0, "%d pixels outside the transformed quad", bad);
+	expect(worst <= 1, "colour off by %d", worst);
+	image("vm_alu", px);
+}
+
+/* ============================================================
+ * [8] SoA 픽셀 셰이더 (4x2 블록)
+ * ============================================================ */
+
+/*
+ * ps_4_0: 레인마다 반복 횟수와 분기가 다름
+ *   r0.x = 0; r0.y = v1.x * 4
+ *   loop { if (r0.x >= r0.y) break; r0.x += 1 }
+ *   o0.x = r0.x * 0.25
+ *   o0.yzw = v1.x < 0.5 ? (1, 0, 1) : (0, 1, 1)
+ */
+static const unsigned ps_branch[] = {
+	0x00000040, 0,
+	0x03000065, 0x001020F2, 0,
+	0x02000068, 1,
+	0x05000036, 0x00100012, 0, 0x00004001, 0,
+	0x07000038, 0x00100022, 0, 0x0010100A, 1, 0x00004001, 0x40800000,
+	0x01000030,
+	0x0700001D, 0x00100042, 0, 0x0010000A, 0, 0x0010001A, 0,
+	0x03040003, 0x0010002A, 0,
+	0x07000000, 0x00100012, 0, 0x0010000A, 0, 0x00004001, 0x3F800000,
+	0x01000016,
+	0x07000031, 0x00100082, 0, 0x0010100A, 1, 0x00004001, 0x3F000000,
+	0x07000038, 0x00102012, 0, 0x0010000A, 0, 0x00004001, 0x3E800000,
+	0x0304001F, 0x0010003A, 0,
+	0x08000036, 0x001020E2, 0, 0x00004E46, 0, 0x3F800000, 0, 0x3F800000,
+	0x01000012,
+	0x08000036, 0x001020E2, 0, 0x00004E46, 0, 0, 0x3F800000, 0x3F800000,
+	0x01000015,
+	0x0100003E,
+};
+
+/*
+ * 빨강 = 화면 x 그라디언트인 삼각형: 기울어진 에지라 블록 대부분이
+ * 부분 커버. 빨강은 ceil(4x) / 4 계단, 녹/청은 화면 절반에서 바뀜.
+ */
+static void test_soa_branch(void)
+{
+	target(256, 96);
+	void *ps = PS(ps_branch);
+	use_shaders();
+	C(PSSetShader, ps, NULL, 0);
+
+	struct vtx v[3] = {
+		{ { -1, -1, 0.5f }, { 0, 0, 0, 1 } },
+		{ { -0.2f, 1, 0.5f }, { 0, 0, 0, 1 } },
+		{ { 1, -0.6f, 0.5f }, { 0, 0, 0, 1 } },
+	};
+	for (int i = 0; i < 3; i++)
+		v[i].color[0] = (v[i].pos[0] + 1) / 2;
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	clear(0, 0, 0);
+	C(Draw, 3, 0);
+	uint32_t *px = readback();
+	int covered = 0, bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			uint32_t c = pixel(px, x, y);
+			if (!c) continue;
+			covered++;
+			int n = (int)ceilf((x + 0.5f) / 64);
+			int r = (int)(c >> 16), want = (int)(n * 0.25f * 255 + 0.5f);
+			uint32_t gb = c & 0xFFFF, want_gb = x < W / 2 ? 0xFF00 : 0x00FF;
+			if (abs(r - want) > 1 || gb != want_gb) {
+				if (bad++ < 2)
+					expect(0, "(%d,%d) = %06x", x, y, c);
+			}
+		}
+	expect(covered > W * H / 4, "only %d pixels covered", covered);
+	expect(bad == 0, "%d pixels wrong", bad);
+	image("soa_branch", px);
+}
+
+/* ============================================================
+ * [9] Hierarchical-Z
+ * ============================================================ */
+
+static void *depth_less;
+
+static void use_depth_less(void)
+{
+	if (!depth_less) {
+		D3D11_DEPTH_STENCIL_DESC dd = {0};
+		dd.DepthEnable = 1;
+		dd.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		dd.DepthFunc = D3D11_COMPARISON_LESS;
+		D(CreateDepthStencilState, &dd, &depth_less);
+	}
+	C(OMSetDepthStencilState, depth_less, 0);
+}
+
+/* 깊이 버퍼를 Map해 (x, y)의 값을 읽음 */
+static float depth_at(int x, int y)
+{
+	D3D11_MAPPED_SUBRESOURCE m;
+	submit();
+	if (I(Map, ds_tex, 0, D3D11_MAP_READ, 0, &m) != S_OK) return -1;
+	float z = *(float *)((uint8_t *)m.pData + (size_t)y * m.RowPitch + x * 4);
+	I(Unmap, ds_tex, 0);
+	return z;
+}
+
+static void draw_quad(float x0, float y0, float x1, float y1, float z,
+		      float r, float g, float b)
+{
+	struct vtx v[6];
+	quad(v, x0, y0, x1, y1, z, r, g, b);
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	C(Draw, 6, 0);
+}
+
+/*
+ * HiZ 타일(8x8) 경계와 어긋난 사각형들을 앞에서 뒤로 그려 가려진
+ * 부분이 빠지는지 보고, Map(READ)는 HiZ를 그대로 두고
+ * Map(WRITE)로 바꾼 깊이는 다음 Draw에 반영되는지 확인.
+ */
+static void test_hiz_depth(void)
+{
+	target(160, 120);
+	use_shaders();
+	use_depth_less();
+
+	clear(0, 0, 0);
+	draw_quad(-1, -1, 0.5f, 1, 0.3f, 1, 0, 0);         /* 왼쪽 3/4, 빨강 */
+	draw_quad(-0.3f, -0.3f, 0.3f, 0.3f, 0.2f, 0, 0, 1); /* 가운데, 파랑 */
+	draw_quad(-1, -1, 1, 1, 0.6f, 0, 1, 0);             /* 뒤, 초록 */
+	uint32_t *px = readback();
+	expect(pixel(px, 10, 10) == 0xFF0000, "front quad %06x", pixel(px, 10, 10));
+	expect(pixel(px, 80, 60) == 0x0000FF, "nearest quad %06x", pixel(px, 80, 60));
+	expect(pixel(px, 150, 10) == 0x00FF00, "back quad %06x", pixel(px, 150, 10));
+	image("hiz_order", px);
+
+	/* Map(READ) 뒤에도 가려진 Draw는 여전히 가려짐 */
+	float z0 = depth_at(10, 10), z1 = depth_at(80, 60), z2 = depth_at(150, 10);
+	expect(fabsf(z0 - 0.3f) < 1e-6f && fabsf(z1 - 0.2f) < 1e-6f &&
+	       fabsf(z2 - 0.6f) < 1e-6f, "depth %g %g %g", z0, z1, z2);
+	draw_quad(-1, -1, 1, 1, 0.7f, 1, 1, 1);
+	px = readback();
+	int shown = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) == 0xFFFFFF) shown++;
+	expect(shown == 0, "%d pixels of an occluded quad drawn", shown);
+
+	/* Map(WRITE): 왼쪽 절반 깊이 0, 오른쪽 절반 1 */
+	D3D11_MAPPED_SUBRESOURCE m;
+	submit();
+	if (I(Map, ds_tex, 0, D3D11_MAP_WRITE, 0, &m) == S_OK) {
+		for (int y = 0; y < H; y++) {
+			float *row = (float *)((uint8_t *)m.pData + (size_t)y * m.RowPitch);
+			for (int x = 0; x < W; x++)
+				row[x] = x < W / 2 ? 0.0f : 1.0f;
+		}
+		I(Unmap, ds_tex, 0);
+	}
+	draw_quad(-1, -1, 1, 1, 0.5f, 1, 1, 0);
+	px = readback();
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if ((pixel(px, x, y) == 0xFFFF00) != (x >= W / 2)) bad++;
+	expect(bad == 0, "%d pixels ignore the mapped depth", bad);
+	image("hiz_map", px);
+}
+
+/* ============================================================
+ * [10] 빠른 clear
+ * ============================================================ */
+
+static int count_color(const uint32_t *px, uint32_t c)
+{
+	int n = 0;
+	for (int i = 0; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) == c) n++;
+	return n;
+}
+
+/*
+ * 타일(64x64)로 나눠지지 않는 크기: clear는 타일 플래그만 남기고
+ * 실제로는 읽기/그리기/복사 시점에 채워진다. 어느 경로로 보든
+ * clear 값이어야 하고, 전체를 덮어쓰면 남은 clear는 버려져야 한다.
+ */
+static void test_fast_clear(void)
+{
+	target(200, 150);
+	use_shaders();
+	use_depth_less();
+
+	/* clear만 하고 읽기 */
+	clear(0.2f, 0.4f, 0.6f);
+	uint32_t *px = readback();
+	expect(count_color(px, 0x336699) == W * H, "clear colour not read back");
+
+	/* 두 번째 clear가 이김 + 타일 하나에만 그리기 */
+	clear(0, 0, 1);
+	clear(1, 0, 0);
+	draw_quad(ndc_x(70), ndc_y(90), ndc_x(100), ndc_y(70), 0.5f, 0, 1, 0);
+	px = readback();
+	expect(count_color(px, 0x00FF00) == 30 * 20, "%d quad pixels",
+	       count_color(px, 0x00FF00));
+	expect(count_color(px, 0xFF0000) == W * H - 30 * 20, "%d clear pixels",
+	       count_color(px, 0xFF0000));
+	image("fast_clear", px);
+
+	/* 깊이 clear 값: 0.5보다 먼 것은 가려지고 가까운 것은 보임 */
+	float c[4] = { 0, 0, 0, 1 };
+	C(ClearRenderTargetView, rtv, c);
+	C(ClearDepthStencilView, dsv, D3D11_CLEAR_DEPTH, 0.5f, 0);
+	draw_quad(-1, -1, 1, 1, 0.6f, 0, 0, 1);
+	draw_quad(-1, -1, 0, 1, 0.4f, 1, 1, 1);
+	px = readback();
+	expect(count_color(px, 0x0000FF) == 0, "far quad passed the cleared depth");
+	expect(count_color(px, 0xFFFFFF) == W / 2 * H, "%d near pixels",
+	       count_color(px, 0xFFFFFF));
+
+	/* 복사 원본의 clear도 채워짐 */
+	clear(0.2f, 0.4f, 0.6f);
+	D3D11_TEXTURE2D_DESC td = {0};
+	td.Width = W;
+	td.Height = H;
+	td.MipLevels = 1;
+	td.ArraySize = 1;
+	td.SampleDesc.Count = 1;
+	td.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	void *copy = NULL;
+	D(CreateTexture2D, &td, NULL, &copy);
+	C(CopyResource, copy, rt_tex);
+	void *saved = rt_tex;
+	rt_tex = copy;
+	px = readback();
+	rt_tex = saved;
+	expect(count_color(px, 0x336699) == W * H, "copy of a cleared target");
+
+	/* clear 뒤 전체 덮어쓰기: 남은 clear가 데이터를 덮으면 안 됨 */
+	clear(1, 1, 1);
+	uint32_t *up = malloc((size_t)W * H * 4);
+	for (int i = 0; i < W * H; i++)
+		up[i] = 0xFF000000u | (uint32_t)(i * 2654435761u >> 8);
+	C(UpdateSubresource, rt_tex, 0, NULL, up, W * 4, 0);
+	draw_quad(ndc_x(0), ndc_y(1), ndc_x(1), ndc_y(0), 0.1f, 0, 0, 0);
+	px = readback();
+	int diff = 0;
+	for (int i = 1; i < W * H; i++)
+		if ((px[i] & 0xFFFFFF) != (up[i] & 0xFFFFFF)) diff++;
+	expect(diff == 0, "%d uploaded pixels lost to a stale clear", diff);
+	free(up);
+
+	/* 다른 리소스를 읽어도 손대지 않은 백버퍼의 clear는 미뤄 둠,
+	 * Present 경로(flush + resolve)에서야 채워짐 */
+	g_sc.w = W;
+	g_sc.h = H;
+	g_sc.pixels = calloc((size_t)W * H, 4);
+	void *rtv_sc = NULL;
+	D(CreateRenderTargetView, &g_sc, NULL, &rtv_sc);
+	float red[4] = { 1, 0, 0, 1 };
+	C(ClearRenderTargetView, rtv_sc, red);
+	readback();
+	expect(count_color(g_sc.pixels, 0xFF0000) == 0,
+	       "%d backbuffer pixels filled by a Map of another target",
+	       count_color(g_sc.pixels, 0xFF0000));
+	d3d11_flush();
+	d3d11_resolve_resource(g_sc.res_idx);
+	expect(count_color(g_sc.pixels, 0xFF0000) == W * H,
+	       "backbuffer clear not resolved at Present");
+	d3d11_release_swapchain_texture(g_sc.res_idx);
+	g_sc.res_idx = -1;
+	free(g_sc.pixels);
+	g_sc.pixels = NULL;
+}
+
+/* ============================================================
+ * [11] deferred context / UpdateSubresource 상자
+ * ============================================================ */
+
+/*
+ * 텍스처: 행 간격이 상자 폭보다 넓은 앱 메모리에서 상자 영역만 복사,
+ * 나머지는 clear 값 그대로. 버퍼: 바이트 범위만 바꾸고, 그 전에
+ * 기록한 Draw는 바뀌기 전 내용을 봐야 한다.
+ */
+static void test_update_box(void)
+{
+	target(64, 48);
+	use_shaders();
+
+	enum { BX = 13, BY = 5, BW = 10, BH = 7, PITCH = 64 };
+	/* 마지막 행은 상자 폭까지만 — 그 뒤를 읽으면 안 됨 */
+	size_t src_size = PITCH * (BH - 1) + BW * 4;
+	uint8_t *src = malloc(src_size);
+	memset(src, 0xFF, src_size);
+	for (int y = 0; y < BH; y++)
+		for (int x = 0; x < BW; x++)
+			((uint32_t *)(src + y * PITCH))[x] =
+				0xFF000000u | (uint32_t)(y * 32 << 8 | x * 24);
+	clear(0, 0, 1);
+	D3D11_BOX box = { BX, BY, 0, BX + BW, BY + BH, 1 };
+	C(UpdateSubresource, rt_tex, 0, &box, src, PITCH, 0);
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			int in = x >= BX && x < BX + BW && y >= BY && y < BY + BH;
+			uint32_t want = in ? (uint32_t)((y - BY) * 32 << 8 | (x - BX) * 24)
+					   : 0x0000FF;
+			if (pixel(px, x, y) != want) bad++;
+		}
+	expect(bad == 0, "%d pixels wrong after a boxed texture update", bad);
+	image("update_box", px);
+	free(src);
+
+	/* 버퍼: 왼쪽 사각형(빨강)을 그린 뒤 두 사각형의 정점을 바꿈 */
+	struct vtx v[12];
+	quad(v, -1, -1, 0, 1, 0.5f, 1, 0, 0);
+	quad(v + 6, 0, -1, 1, 1, 0.5f, 1, 0, 0);
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+
+	struct vtx nv[12];
+	quad(nv, -1, -1, 0, 1, 0.5f, 1, 1, 1);
+	quad(nv + 6, 0, -1, 1, 1, 0.5f, 0, 1, 0);
+	D3D11_BOX right = { 6 * sizeof(struct vtx), 0, 0, 12 * sizeof(struct vtx), 1, 1 };
+	D3D11_BOX left = { 0, 0, 0, 6 * sizeof(struct vtx), 1, 1 };
+	C(UpdateSubresource, vb, 0, &right, &nv[6], 0, 0);
+	C(Draw, 6, 6);
+	C(UpdateSubresource, vb, 0, &left, nv, 0, 0);
+	px = readback();
+	bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if (pixel(px, x, y) != (x < W / 2 ? 0xFF0000u : 0x00FF00u)) bad++;
+	expect(bad == 0, "%d pixels wrong after boxed buffer updates", bad);
+}
+
+/* ============================================================
+ * [12] 레이아웃별 정점 fetch 계획
+ * ============================================================ */
+
+/*
+ * 같은 삼각형들을 레이아웃만 바꿔 그림: 특수화 루틴(F3 색, U8 색)과
+ * 일반 루틴(R32G32 위치, B8G8R8A8 색) 모두 POSITION + COLOR(F4)와
+ * 같은 이미지여야 한다. 색은 k/255라 U8로도 정확히 표현된다.
+ */
+static void test_fetch_layouts(void)
+{
+	target(128, 96);
+	use_shaders();
+
+	enum { NT = 24, NV = NT * 3 };
+	struct vtx ref[NV];
+	uint8_t rgb[NV][3];
+	g_seed = 11;
+	for (int i = 0; i < NV; i++) {
+		ref[i].pos[0] = rnd() * 2 - 1;
+		ref[i].pos[1] = rnd() * 2 - 1;
+		ref[i].pos[2] = 0;
+		for (int k = 0; k < 3; k++) {
+			rgb[i][k] = (uint8_t)(rnd() * 255);
+			ref[i].color[k] = rgb[i][k] / 255.0f;
+		}
+		ref[i].color[3] = 1;
+	}
+	void *vb = mkbuf(ref, sizeof(ref), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, NV, 0);
+	uint32_t *px = readback();
+	uint32_t *want = malloc((size_t)W * H * 4);
+	memcpy(want, px, (size_t)W * H * 4);
+	image("fetch_layouts", px);
+
+	/* 정점 버퍼 하나에 네 가지 배치를 차례로 */
+	struct { float col[3]; float pos[3]; } f3[NV];          /* COLOR 먼저 */
+	struct { float pos[3]; uint8_t col[4]; } u8[NV];
+	struct { uint8_t col[4]; float pos[2]; } bgra[NV];      /* 일반 루틴 */
+	for (int i = 0; i < NV; i++) {
+		for (int k = 0; k < 3; k++) {
+			f3[i].col[k] = ref[i].color[k];
+			f3[i].pos[k] = ref[i].pos[k];
+			u8[i].pos[k] = ref[i].pos[k];
+			u8[i].col[k] = rgb[i][k];
+			bgra[i].col[2 - k] = rgb[i][k];
+		}
+		u8[i].col[3] = bgra[i].col[3] = 255;
+		bgra[i].pos[0] = ref[i].pos[0];
+		bgra[i].pos[1] = ref[i].pos[1];
+	}
+	const UINT A = D3D11_APPEND_ALIGNED_ELEMENT;
+	D3D11_INPUT_ELEMENT_DESC el_f3[2] = {
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, A, 0, 0 },
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, A, 0, 0 },
+	};
+	D3D11_INPUT_ELEMENT_DESC el_u8[2] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 0, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, A, 0, 0 },
+	};
+	D3D11_INPUT_ELEMENT_DESC el_bgra[2] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 4, 0, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_B8G8R8A8_UNORM, 0, 0, 0, 0 },
+	};
+	struct {
+		const char *name;
+		const D3D11_INPUT_ELEMENT_DESC *el;
+		const void *data;
+		UINT stride;
+	} cases[3] = {
+		{ "F3 colour", el_f3, f3, sizeof(f3[0]) },
+		{ "U8 colour", el_u8, u8, sizeof(u8[0]) },
+		{ "generic", el_bgra, bgra, sizeof(bgra[0]) },
+	};
+	for (int c = 0; c < 3; c++) {
+		void *layout = NULL;
+		D(CreateInputLayout, cases[c].el, 2, NULL, 0, &layout);
+		vb = mkbuf(cases[c].data, cases[c].stride * NV,
+			   D3D11_BIND_VERTEX_BUFFER);
+		C(IASetInputLayout, layout);
+		use_vb(vb, cases[c].stride);
+		clear(0, 0, 0);
+		C(Draw, NV, 0);
+		px = readback();
+		int diff = 0;
+		for (int i = 0; i < W * H; i++)
+			if ((px[i] & 0xFFFFFF) != (want[i] & 0xFFFFFF)) diff++;
+		expect(diff == 0, "%s: %d pixels differ", cases[c].name, diff);
+	}
+	free(want);
+}
+
+/* ============================================================
+ * [13] 파이프라인 스냅샷
+ * ============================================================ */
+
+/* ps_4_0: o0 = cb0[0] */
+static const unsigned ps_cb0[] = {
+	0x00000040, 0,
+	0x03000065, 0x001020F2, 0,
+	0x06000036, 0x001020F2, 0, 0x00208E46, 0, 0,
+	0x0100003E,
+};
+
+/*
+ * 스냅샷은 바뀐 상태 그룹만 다시 푼다: 그룹마다 하나씩 바꾸며
+ * 그려서 어느 것도 이전 Draw의 값을 쓰지 않는지 확인.
+ * CB는 다시 바인딩하지 않고 내용만 바꾼다.
+ */
+static void test_pipeline_state(void)
+{
+	target(96, 64);
+	use_shaders();
+	void *ps = PS(ps_cb0);
+	float red[4] = { 1, 0, 0, 1 }, green[4] = { 0, 1, 0, 1 };
+	void *cb = mkbuf(red, sizeof(red), D3D11_BIND_CONSTANT_BUFFER);
+	C(PSSetShader, ps, NULL, 0);
+	C(PSSetConstantBuffers, 0, 1, &cb);
+
+	clear(0, 0, 0);
+	draw_quad(ndc_x(0), -1, ndc_x(32), 1, 0.5f, 1, 1, 1);
+	C(UpdateSubresource, cb, 0, NULL, green, 0, 0);
+	draw_quad(ndc_x(32), -1, ndc_x(64), 1, 0.5f, 1, 1, 1);
+	C(PSSetShader, ps_pc, NULL, 0);
+	draw_quad(ndc_x(64), -1, ndc_x(96), 1, 0.5f, 0, 0, 1);
+	uint32_t *px = readback();
+	expect(pixel(px, 10, 30) == 0xFF0000, "cb red %06x", pixel(px, 10, 30));
+	expect(pixel(px, 40, 30) == 0x00FF00, "cb green %06x", pixel(px, 40, 30));
+	expect(pixel(px, 80, 30) == 0x0000FF, "vertex blue %06x", pixel(px, 80, 30));
+	image("pipeline_cb", px);
+
+	/* 반시계 사각형: CULL_BACK에서는 안 보이고, CULL_NONE이면 보임 */
+	D3D11_RASTERIZER_DESC rd = {0};
+	rd.FillMode = D3D11_FILL_SOLID;
+	rd.CullMode = D3D11_CULL_BACK;
+	rd.DepthClipEnable = 1;
+	void *rs_back, *rs_none;
+	D(CreateRasterizerState, &rd, &rs_back);
+	rd.CullMode = D3D11_CULL_NONE;
+	D(CreateRasterizerState, &rd, &rs_none);
+	C(RSSetState, rs_back);
+	struct vtx v[6];
+	quad(v, -1, -1, 1, 1, 0.5f, 1, 1, 0);
+	for (int i = 0; i < 6; i += 3) {
+		struct vtx t = v[i + 1];
+		v[i + 1] = v[i + 2];
+		v[i + 2] = t;
+	}
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+	px = readback();
+	expect(count_color(px, 0) == W * H, "back-facing quad was drawn");
+	C(RSSetState, rs_none);
+	/* 뷰포트도 왼쪽 위 사분면으로 */
+	D3D11_VIEWPORT vp = { 0, 0, W / 2.0f, H / 2.0f, 0, 1 };
+	C(RSSetViewports, 1, &vp);
+	C(Draw, 6, 0);
+	px = readback();
+	expect(count_color(px, 0xFFFF00) == W / 2 * H / 2, "%d pixels in the viewport",
+	       count_color(px, 0xFFFF00));
+
+	/* 다른 RT로 그렸다가 돌아옴 */
+	D3D11_TEXTURE2D_DESC td = {0};
+	td.Width = W;
+	td.Height = H;
+	td.MipLevels = 1;
+	td.ArraySize = 1;
+	td.SampleDesc.Count = 1;
+	td.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	td.BindFlags = D3D11_BIND_RENDER_TARGET;
+	void *tex2 = NULL, *rtv2 = NULL;
+	D(CreateTexture2D, &td, NULL, &tex2);
+	D(CreateRenderTargetView, tex2, NULL, &rtv2);
+	float black[4] = { 0, 0, 0, 1 };
+	C(ClearRenderTargetView, rtv2, black);
+	C(OMSetRenderTargets, 1, &rtv2, NULL);
+	D3D11_VIEWPORT full = { 0, 0, (float)W, (float)H, 0, 1 };
+	C(RSSetViewports, 1, &full);
+	C(Draw, 6, 0);
+	bind_target();
+	C(Draw, 3, 0);
+	px = readback();
+	expect(count_color(px, 0xFFFF00) > W / 2 * H / 2, "back on the first target");
+	void *saved = rt_tex;
+	rt_tex = tex2;
+	px = readback();
+	rt_tex = saved;
+	expect(count_color(px, 0xFFFF00) == W * H, "%d pixels on the second target",
+	       count_color(px, 0xFFFF00));
+}
+
+/* ============================================================
+ * [14] 동적 버퍼 Map (이름 바꾸기 / NO_OVERWRITE)
+ * ============================================================ */
+
+static void *mkdyn(UINT size, UINT bind)
+{
+	D3D11_BUFFER_DESC bd = {0};
+	bd.ByteWidth = size;
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.BindFlags = bind;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	void *b = NULL;
+	D(CreateBuffer, &bd, NULL, &b);
+	return b;
+}
+
+static void *map_write(void *res, D3D11_MAP type)
+{
+	D3D11_MAPPED_SUBRESOURCE m;
+	if (C(Map, res, 0, type, 0, &m) != S_OK) {
+		expect(0, "Map(%d) failed", type);
+		return NULL;
+	}
+	return m.pData;
+}
+
+/* 열 i (16픽셀 폭)가 want(i)인지 */
+static void expect_strips(const char *what, uint32_t (*want)(int))
+{
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if (pixel(px, x, y) != want(x / 16)) bad++;
+	expect(bad == 0, "%s: %d pixels wrong", what, bad);
+}
+
+static uint32_t strip_red(int i) { return (uint32_t)((i + 1) * 30) << 16; }
+static uint32_t strip_green(int i) { return (uint32_t)((i + 1) * 30) << 8; }
+static uint32_t strip_blue(int i) { return (uint32_t)((i + 1) * 30); }
+
+/*
+ * Draw는 bin에 쌓였다가 나중에 래스터라이징되므로, 그 사이 같은 버퍼를
+ * 다시 Map해도 앞선 Draw는 Map 전 내용으로 그려져야 한다.
+ */
+static void test_map_dynamic(void)
+{
+	target(128, 32);
+	use_shaders();
+	void *vb = mkdyn(8 * 6 * sizeof(struct vtx), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	/* WRITE_DISCARD마다 같은 위치(0)에 다른 사각형 */
+	clear(0, 0, 0);
+	for (int i = 0; i < 8; i++) {
+		struct vtx *v = map_write(vb, D3D11_MAP_WRITE_DISCARD);
+		if (!v) return;
+		quad(v, ndc_x(i * 16), -1, ndc_x(i * 16 + 16), 1, 0.5f,
+		     (i + 1) * 30 / 255.0f, 0, 0);
+		C(Unmap, vb, 0);
+		C(Draw, 6, 0);
+	}
+	expect_strips("WRITE_DISCARD", strip_red);
+
+	/* DISCARD 한 번 + NO_OVERWRITE로 뒤에 이어 쓰기 */
+	clear(0, 0, 0);
+	for (int i = 0; i < 8; i++) {
+		struct vtx *v = map_write(vb, i ? D3D11_MAP_WRITE_NO_OVERWRITE
+						: D3D11_MAP_WRITE_DISCARD);
+		if (!v) return;
+		quad(v + i * 6, ndc_x(i * 16), -1, ndc_x(i * 16 + 16), 1, 0.5f,
+		     0, (i + 1) * 30 / 255.0f, 0);
+		C(Unmap, vb, 0);
+		C(Draw, 6, i * 6);
+	}
+	expect_strips("NO_OVERWRITE", strip_green);
+
+	/* PS CB: 래스터라이징 때 읽으므로 Draw마다 다른 블록이어야 함 */
+	void *cb = mkdyn(16, D3D11_BIND_CONSTANT_BUFFER);
+	void *ps = PS(ps_cb0);
+	C(PSSetShader, ps, NULL, 0);
+	C(PSSetConstantBuffers, 0, 1, &cb);
+	clear(0, 0, 0);
+	for (int i = 0; i < 8; i++) {
+		float *c = map_write(cb, D3D11_MAP_WRITE_DISCARD);
+		if (!c) return;
+		c[0] = c[1] = 0;
+		c[2] = (i + 1) * 30 / 255.0f;
+		c[3] = 1;
+		C(Unmap, cb, 0);
+		draw_quad(ndc_x(i * 16), -1, ndc_x(i * 16 + 16), 1, 0.5f, 1, 1, 1);
+	}
+	expect_strips("constant buffer", strip_blue);
+}
+
+/*
+ * 여러 버퍼에 DISCARD 뒤 NO_OVERWRITE로 덧붙이기. 비동기/deferred
+ * 모드는 Map 스테이징을 버퍼마다 남겨 두고 바뀐 범위만 기록하며,
+ * 비동기 모드는 스테이징 16개를 넘으면 오래된 것부터 내보낸다.
+ * 아무것도 안 쓰거나 같은 값을 다시 쓴 Map도 내용을 망치면 안 된다.
+ */
+static void test_map_append(void)
+{
+	enum { NB = 20 };
+	target(160, 32);
+	use_shaders();
+	void *vb[NB];
+	for (int b = 0; b < NB; b++)
+		vb[b] = mkdyn(2 * 6 * sizeof(struct vtx), D3D11_BIND_VERTEX_BUFFER);
+
+	/* 버퍼 b: 칸 (b / 2, 위/아래)의 왼쪽 절반은 DISCARD, 오른쪽은 덧붙임 */
+	clear(0, 0, 0);
+	for (int b = 0; b < NB; b++) {
+		struct vtx *v = map_write(vb[b], D3D11_MAP_WRITE_DISCARD);
+		if (!v) return;
+		float x = b / 2 * 16, y = b % 2 * 16;
+		quad(v, ndc_x(x), ndc_y(y + 16), ndc_x(x + 8), ndc_y(y), 0.5f,
+		     (b + 1) * 12 / 255.0f, 0, 0);
+		C(Unmap, vb[b], 0);
+	}
+	for (int b = 0; b < NB; b++) {
+		struct vtx *v = map_write(vb[b], D3D11_MAP_WRITE_NO_OVERWRITE);
+		if (!v) return;
+		float x = b / 2 * 16, y = b % 2 * 16;
+		quad(v + 6, ndc_x(x + 8), ndc_y(y + 16), ndc_x(x + 16), ndc_y(y),
+		     0.5f, 0, (b + 1) * 12 / 255.0f, 0);
+		C(Unmap, vb[b], 0);
+		use_vb(vb[b], sizeof(struct vtx));
+		C(Draw, 12, 0);
+	}
+
+	/* 아무것도 안 쓴 Map, 같은 값을 다시 쓴 Map 뒤에 다시 그림 */
+	struct vtx *v = map_write(vb[NB - 1], D3D11_MAP_WRITE_NO_OVERWRITE);
+	if (!v) return;
+	C(Unmap, vb[NB - 1], 0);
+	use_vb(vb[NB - 1], sizeof(struct vtx));
+	C(Draw, 12, 0);
+	v = map_write(vb[NB - 2], D3D11_MAP_WRITE_NO_OVERWRITE);
+	if (!v) return;
+	float x = (NB - 2) / 2 * 16;
+	quad(v, ndc_x(x), ndc_y(16), ndc_x(x + 8), ndc_y(0), 0.5f,
+	     (NB - 1) * 12 / 255.0f, 0, 0);
+	C(Unmap, vb[NB - 2], 0);
+	use_vb(vb[NB - 2], sizeof(struct vtx));
+	C(Draw, 12, 0);
+
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			uint32_t c = (uint32_t)((x / 16 * 2 + y / 16 + 1) * 12);
+			if (pixel(px, x, y) != (x % 16 < 8 ? c << 16 : c << 8))
+				bad++;
+		}
+	expect(bad == 0, "%d pixels wrong after appending to %d buffers",
+	       bad, NB);
+}
+
+/* ============================================================
+ * [15] 인스턴싱
+ * ============================================================ */
+
+/* ISGN (입력 시그니처) + SHDR 컨테이너 */
+static void *dxbc_wrap_isgn(const unsigned *shdr, int ntok,
+			    const char *const *names, const int *sysval,
+			    const int *regs, int nsig, size_t *size)
+{
+	unsigned str = 8 + 24 * nsig, strs = 0;
+	for (int i = 0; i < nsig; i++) strs += strlen(names[i]) + 1;
+	unsigned isgn = (str + strs + 3) & ~3u;
+	unsigned total = 40 + 8 + isgn + 8 + ntok * 4;
+	uint8_t *b = calloc(1, total);
+	unsigned *h = (unsigned *)b;
+	h[0] = 0x43425844;              /* "DXBC" */
+	h[5] = 1;
+	h[6] = total;
+	h[7] = 2;                       /* 청크 수 */
+	h[8] = 40;
+	h[9] = 40 + 8 + isgn;
+
+	unsigned *c = (unsigned *)(b + 40);
+	c[0] = 0x4E475349;              /* "ISGN" */
+	c[1] = isgn;
+	c[2] = nsig;
+	c[3] = 8;
+	for (int i = 0; i < nsig; i++) {
+		unsigned *e = c + 4 + 6 * i;
+		e[0] = str;
+		e[2] = sysval[i];
+		e[3] = 3;                   /* float */
+		e[4] = regs[i];
+		e[5] = 0xF;
+		strcpy((char *)(c + 2) + str, names[i]);
+		str += strlen(names[i]) + 1;
+	}
+
+	c = (unsigned *)(b + h[9]);
+	c[0] = 0x52444853;              /* "SHDR" */
+	c[1] = ntok * 4;
+	memcpy(c + 2, shdr, ntok * 4);
+	c[3] = ntok;
+	*size = total;
+	return b;
+}
+
+/* vs_4_0 (시그니처 없음): o0.xy = v0.xy + v3.xy (인스턴스 위치), o1 = v1 */
+static const unsigned vs_inst[] = {
+	0x00010040, 0,
+	0x07000000, 0x00102032, 0, 0x00101046, 0, 0x00101046, 3,
+	0x05000036, 0x001020C2, 0, 0x00101EE6, 0,
+	0x05000036, 0x001020F2, 1, 0x00101E46, 1,
+	0x0100003E,
+};
+
+/* vs_4_0 (ISGN: SV_InstanceID = v4.x): 위치는 위와 같고
+ * o1 = (utof(v4.x) + 1) * 0.25 (알파 1) */
+static const unsigned vs_iid[] = {
+	0x00010040, 0,
+	0x02000068, 1,
+	0x04000060, 0x00101012, 4, 8,
+	0x07000000, 0x00102032, 0, 0x00101046, 0, 0x00101046, 3,
+	0x05000036, 0x001020C2, 0, 0x00101EE6, 0,
+	0x05000056, 0x00100012, 0, 0x00101006, 4,
+	0x0F000032, 0x001020F2, 1, 0x00100006, 0,
+	0x00004E46, 0x3E800000, 0x3E800000, 0x3E800000, 0,
+	0x00004E46, 0x3E800000, 0x3E800000, 0x3E800000, 0x3F800000,
+	0x0100003E,
+};
+
+/*
+ * 슬롯 1의 인스턴스 위치 5개 중 StartInstanceLocation = 1부터 4개:
+ * 첫 위치는 비어 있어야 하고, 나머지는 정점 색(초록) 또는
+ * SV_InstanceID에서 만든 회색 단계.
+ */
+static void test_instancing(void)
+{
+	target(160, 120);
+	void *vs_a = VS(vs_inst);
+	static const char *const names[] = {
+		"POSITION", "COLOR", "INSTPOS", "SV_InstanceID",
+	};
+	static const int sysv[] = { 0, 0, 0, 8 }, regs[] = { 0, 1, 3, 4 };
+	size_t size;
+	void *blob = dxbc_wrap_isgn(vs_iid, (int)(sizeof(vs_iid) / 4), names,
+				    sysv, regs, 4, &size);
+	void *vs_b = NULL;
+	D(CreateVertexShader, blob, size, NULL, &vs_b);
+
+	D3D11_INPUT_ELEMENT_DESC el[3] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 0, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0,
+		  D3D11_APPEND_ALIGNED_ELEMENT, 0, 0 },
+		{ "INSTPOS", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 0,
+		  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	void *lay_a = NULL, *lay_b = NULL;
+	D(CreateInputLayout, el, 3, NULL, 0, &lay_a);
+	D(CreateInputLayout, el, 3, blob, size, &lay_b);
+	free(blob);
+
+	struct vtx q[6];
+	quad(q, -0.1f, -0.1f, 0.1f, 0.1f, 0.5f, 0, 1, 0);
+	uint16_t qi[6] = { 0, 1, 2, 3, 4, 5 };
+	float offs[5][2] = {
+		{ -0.9f, 0 }, { -0.6f, 0 }, { -0.2f, 0.4f }, { 0.2f, -0.4f }, { 0.6f, 0 },
+	};
+	void *vbs[2] = {
+		mkbuf(q, sizeof(q), D3D11_BIND_VERTEX_BUFFER),
+		mkbuf(offs, sizeof(offs), D3D11_BIND_VERTEX_BUFFER),
+	};
+	UINT strides[2] = { sizeof(struct vtx), 8 }, offsets[2] = { 0, 0 };
+	C(IASetVertexBuffers, 0, 2, vbs, strides, offsets);
+	C(IASetIndexBuffer, mkbuf(qi, sizeof(qi), D3D11_BIND_INDEX_BUFFER),
+	  DXGI_FORMAT_R16_UINT, 0);
+	C(PSSetShader, ps_pc, NULL, 0);
+
+	for (int pass = 0; pass < 2; pass++) {
+		clear(0, 0, 0);
+		if (pass == 0) {
+			C(IASetInputLayout, lay_a);
+			C(VSSetShader, vs_a, NULL, 0);
+			C(DrawInstanced, 6, 4, 0, 1);
+		} else {
+			C(IASetInputLayout, lay_b);
+			C(VSSetShader, vs_b, NULL, 0);
+			C(DrawIndexedInstanced, 6, 4, 0, 0, 1);
+		}
+		uint32_t *px = readback();
+		for (int k = 0; k < 5; k++) {
+			uint32_t want = 0;
+			if (k > 0 && pass == 0) {
+				want = 0x00FF00;
+			} else if (k > 0) {
+				uint32_t g = (uint32_t)(k * 0.25f * 255 + 0.5f);
+				want = g << 16 | g << 8 | g;
+			}
+			int cx = (int)((offs[k][0] + 1) * 0.5f * W);
+			int cy = (int)((1 - offs[k][1]) * 0.5f * H);
+			int bad = 0;
+			for (int y = cy - 2; y <= cy + 2; y++)
+				for (int x = cx - 2; x <= cx + 2; x++)
+					if (pixel(px, x, y) != want) bad++;
+			expect(bad == 0, "pass %d instance %d: %06x != %06x", pass,
+			       k, pixel(px, cx, cy), want);
+		}
+		image(pass ? "instanced_iid" : "instanced", px);
+	}
+}
+
+/* ============================================================
+ * [16] 출력 병합 블렌드
+ * ============================================================ */
+
+/*
+ * 전용 커널(알파, 가산, premultiplied, 불투명)과 일반 경로
+ * (REV_SUBTRACT, BLEND_FACTOR/DEST_COLOR, 쓰기 마스크).
+ * 단색으로 식을 확인하고, 소스/대상이 픽셀마다 다른 그라디언트
+ * 이미지를 남겨 스칼라/SSE2/AVX2 커널을 비트 단위로 비교한다.
+ */
+static void test_blend_modes(void)
+{
+	static const struct {
+		D3D11_BLEND src, dst;
+		D3D11_BLEND_OP op;
+		int enable;
+		uint8_t mask;
+	} bm[] = {
+		{ D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_INV_SRC_ALPHA, D3D11_BLEND_OP_ADD, 1, 15 },
+		{ D3D11_BLEND_ONE, D3D11_BLEND_ONE, D3D11_BLEND_OP_ADD, 1, 15 },
+		{ D3D11_BLEND_ONE, D3D11_BLEND_INV_SRC_ALPHA, D3D11_BLEND_OP_ADD, 1, 15 },
+		{ D3D11_BLEND_ONE, D3D11_BLEND_ZERO, D3D11_BLEND_OP_ADD, 0, 15 },
+		{ D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_ONE, D3D11_BLEND_OP_REV_SUBTRACT, 1, 15 },
+		{ D3D11_BLEND_BLEND_FACTOR, D3D11_BLEND_DEST_COLOR, D3D11_BLEND_OP_ADD, 1, 15 },
+		{ D3D11_BLEND_ONE, D3D11_BLEND_ZERO, D3D11_BLEND_OP_ADD, 0, 1 | 4 },
+	};
+	float sc[4] = { 0.8f, 0.4f, 0.2f, 0.5f }, dc[3] = { 0.2f, 0.4f, 0.6f };
+	float bf[4] = { 0.5f, 0.25f, 1, 1 };
+
+	target(99, 37);
+	use_shaders();
+	struct vtx flat[6], grad[6], under[6];
+	quad(flat, -1, -1, 1, 1, 0.5f, sc[0], sc[1], sc[2]);
+	quad(grad, -1, -1, 1, 1, 0.5f, 0, 0, 0);
+	quad(under, -1, -1, 1, 1, 0.5f, 0, 0, 0);
+	for (int i = 0; i < 6; i++) {
+		flat[i].color[3] = sc[3];
+		float u = (grad[i].pos[0] + 1) / 2, v = (grad[i].pos[1] + 1) / 2;
+		grad[i].color[0] = u;
+		grad[i].color[1] = 1 - v;
+		grad[i].color[2] = u * v;
+		grad[i].color[3] = v;
+		under[i].color[0] = v;
+		under[i].color[1] = 0.5f;
+		under[i].color[2] = 1 - u;
+	}
+	void *vb_flat = mkbuf(flat, sizeof(flat), D3D11_BIND_VERTEX_BUFFER);
+	void *vb_grad = mkbuf(grad, sizeof(grad), D3D11_BIND_VERTEX_BUFFER);
+	void *vb_under = mkbuf(under, sizeof(under), D3D11_BIND_VERTEX_BUFFER);
+
+	for (int i = 0; i < (int)(sizeof(bm) / sizeof(bm[0])); i++) {
+		D3D11_BLEND_DESC bd = {0};
+		bd.RenderTarget[0].BlendEnable = bm[i].enable;
+		bd.RenderTarget[0].SrcBlend = bm[i].src;
+		bd.RenderTarget[0].DestBlend = bm[i].dst;
+		bd.RenderTarget[0].BlendOp = bm[i].op;
+		bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		bd.RenderTarget[0].RenderTargetWriteMask = bm[i].mask;
+		void *bs = NULL;
+		D(CreateBlendState, &bd, &bs);
+
+		/* 단색: 모든 픽셀이 같고 식과 ±1 */
+		clear(dc[0], dc[1], dc[2]);
+		use_vb(vb_flat, sizeof(struct vtx));
+		C(OMSetBlendState, bs, bf, 0xFFFFFFFF);
+		C(Draw, 6, 0);
+		uint32_t *px = readback();
+		uint32_t got = pixel(px, W / 2, H / 2);
+		expect(count_color(px, got) == W * H, "mode %d: pixels differ", i);
+		for (int ch = 0; ch < 3; ch++) {
+			float s = sc[ch], d = roundf(dc[ch] * 255) / 255, a = sc[3], o;
+			switch (i) {
+			case 0:  o = s * a + d * (1 - a); break;
+			case 1:  o = s + d; break;
+			case 2:  o = s + d * (1 - a); break;
+			case 3:  o = s; break;
+			case 4:  o = d - s * a; break;
+			case 5:  o = s * bf[ch] + d * d; break;
+			default: o = ch == 1 ? d : s; break;    /* R, B만 씀 */
+			}
+			int want = (int)(fminf(fmaxf(o, 0), 1) * 255 + 0.5f);
+			int have = (int)(got >> (16 - ch * 8) & 0xFF);
+			expect(abs(have - want) <= 1, "mode %d channel %d: %d != %d",
+			       i, ch, have, want);
+		}
+
+		/* 그라디언트 위에 그라디언트 */
+		C(OMSetBlendState, NULL, NULL, 0xFFFFFFFF);
+		use_vb(vb_under, sizeof(struct vtx));
+		C(Draw, 6, 0);
+		C(OMSetBlendState, bs, bf, 0xFFFFFFFF);
+		use_vb(vb_grad, sizeof(struct vtx));
+		C(Draw, 6, 0);
+		C(OMSetBlendState, NULL, NULL, 0xFFFFFFFF);
+		char name[32];
+		snprintf(name, sizeof(name), "blend_%d", i);
+		image(name, readback());
+	}
+}
+
+/* ============================================================
+ * [17] 밉 체인 / bilinear / trilinear
+ * ============================================================ */
+
+struct vtxt {
+	float pos[3];
+	float color[4];
+	float tc[2];
+};
+
+/* vs_4_0: o0 = v0, o1 = v1, o2.xy = v2.xy */
+static const unsigned vs_tc[] = {
+	0x00010040, 0,
+	0x05000036, 0x001020F2, 0, 0x00101E46, 0,
+	0x05000036, 0x001020F2, 1, 0x00101E46, 1,
+	0x05000036, 0x00102032, 2, 0x00101046, 2,
+	0x0100003E,
+};
+
+/* ps_4_0: o0 = sample(t0, s0, v2.xy) * v1 */
+static const unsigned ps_tex[] = {
+	0x00000040, 0,
+	0x0300005A, 0x00106000, 0,
+	0x04001858, 0x00107000, 0, 0x00005555,
+	0x03001062, 0x001010F2, 1,
+	0x03001062, 0x00101032, 2,
+	0x03000065, 0x001020F2, 0,
+	0x02000068, 1,
+	0x09000045, 0x001000F2, 0, 0x00101046, 2, 0x00107E46, 0, 0x00106000, 0,
+	0x07000038, 0x001020F2, 0, 0x00100E46, 0, 0x00101E46, 1,
+	0x0100003E,
+};
+
+static void *layout_pct;        /* POSITION + COLOR + TEXCOORD */
+
+static void use_tex_shaders(void)
+{
+	if (!layout_pct) {
+		D3D11_INPUT_ELEMENT_DESC el[3] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 0, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, 0, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 28, 0, 0 },
+		};
+		D(CreateInputLayout, el, 3, NULL, 0, &layout_pct);
+	}
+	C(IASetInputLayout, layout_pct);
+	C(VSSetShader, VS(vs_tc), NULL, 0);
+	C(PSSetShader, PS(ps_tex), NULL, 0);
+}
+
+/* 픽셀 사각형 [x, x + w) x [y, y + h), UV 0..1, 흰색 */
+static void draw_tex_quad(int x, int y, int w, int h)
+{
+	float x0 = ndc_x(x), x1 = ndc_x(x + w), y0 = ndc_y(y + h), y1 = ndc_y(y);
+	struct vtxt q[6] = {
+		{ { x0, y1, 0.5f }, { 1, 1, 1, 1 }, { 0, 0 } },
+		{ { x1, y1, 0.5f }, { 1, 1, 1, 1 }, { 1, 0 } },
+		{ { x0, y0, 0.5f }, { 1, 1, 1, 1 }, { 0, 1 } },
+		{ { x1, y1, 0.5f }, { 1, 1, 1, 1 }, { 1, 0 } },
+		{ { x1, y0, 0.5f }, { 1, 1, 1, 1 }, { 1, 1 } },
+		{ { x0, y0, 0.5f }, { 1, 1, 1, 1 }, { 0, 1 } },
+	};
+	void *vb = mkbuf(q, sizeof(q), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtxt));
+	C(Draw, 6, 0);
+}
+
+static void *mktex(int w, int h, int mips, DXGI_FORMAT fmt, UINT bind,
+		   const void *data, UINT pitch)
+{
+	D3D11_TEXTURE2D_DESC td = {0};
+	td.Width = w;
+	td.Height = h;
+	td.MipLevels = mips;
+	td.ArraySize = 1;
+	td.SampleDesc.Count = 1;
+	td.Format = fmt;
+	td.BindFlags = bind;
+	D3D11_SUBRESOURCE_DATA sd = { data, pitch, 0 };
+	void *t = NULL;
+	D(CreateTexture2D, &td, data ? &sd : NULL, &t);
+	return t;
+}
+
+static void *mksrv(void *tex)
+{
+	void *srv = NULL;
+	D(CreateShaderResourceView, tex, NULL, &srv);
+	return srv;
+}
+
+static void *sampler(D3D11_FILTER filter)
+{
+	D3D11_SAMPLER_DESC sd = {0};
+	sd.Filter = filter;
+	sd.AddressU = sd.AddressV = sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sd.MaxLOD = 1e30f;
+	void *s = NULL;
+	D(CreateSamplerState, &sd, &s);
+	return s;
+}
+
+/* (x0, y0)부터 n x n 픽셀의 초록 최소/최대 */
+static void green_range(const uint32_t *px, int x0, int y0, int n,
+			int *lo, int *hi)
+{
+	*lo = 255;
+	*hi = 0;
+	for (int y = y0; y < y0 + n; y++)
+		for (int x = x0; x < x0 + n; x++) {
+			int g = (int)(pixel(px, x, y) >> 8 & 0xFF);
+			if (g < *lo) *lo = g;
+			if (g > *hi) *hi = g;
+		}
+}
+
+static void test_mip_sampling(void)
+{
+	target(128, 96);
+	use_tex_shaders();
+
+	/* 1:1 point 샘플: 4x4 타일 배치를 거쳐도 텍셀 그대로 */
+	enum { TW = 37, TH = 29 };
+	static uint32_t noise[TW * TH];
+	g_seed = 17;
+	for (int i = 0; i < TW * TH; i++)
+		noise[i] = 0xFF000000u | (uint32_t)(rnd() * 0xFFFFFF);
+	void *tn = mktex(TW, TH, 1, DXGI_FORMAT_B8G8R8A8_UNORM,
+			 D3D11_BIND_SHADER_RESOURCE, noise, TW * 4);
+	void *srv = mksrv(tn), *point = sampler(D3D11_FILTER_MIN_MAG_MIP_POINT);
+	C(PSSetShaderResources, 0, 1, &srv);
+	C(PSSetSamplers, 0, 1, &point);
+	clear(0, 0, 0);
+	draw_tex_quad(5, 7, TW, TH);
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < TH; y++)
+		for (int x = 0; x < TW; x++)
+			if (pixel(px, 5 + x, 7 + y) != (noise[y * TW + x] & 0xFFFFFF)) bad++;
+	expect(bad == 0, "%d texels not copied 1:1", bad);
+	image("tex_point", px);
+
+	/* 64x64 체커를 16x16 픽셀로 (LOD 2): 밉이 있으면 회색 */
+	static uint32_t chk[64 * 64];
+	for (int i = 0; i < 64 * 64; i++)
+		chk[i] = ((i ^ (i >> 6)) & 1) ? 0xFFFFFFFF : 0xFF000000;
+	void *tfull = mktex(64, 64, 0, DXGI_FORMAT_R8G8B8A8_UNORM,
+			    D3D11_BIND_SHADER_RESOURCE, chk, 256);
+	void *tone = mktex(64, 64, 1, DXGI_FORMAT_R8G8B8A8_UNORM,
+			   D3D11_BIND_SHADER_RESOURCE, chk, 256);
+	void *srv_full = mksrv(tfull), *srv_one = mksrv(tone);
+	void *trilinear = sampler(D3D11_FILTER_MIN_MAG_MIP_LINEAR);
+	int lo, hi;
+
+	C(PSSetSamplers, 0, 1, &trilinear);
+	C(PSSetShaderResources, 0, 1, &srv_full);
+	clear(0, 0, 1);
+	draw_tex_quad(56, 40, 16, 16);
+	draw_tex_quad(8, 40, 23, 23);       /* LOD ~1.5: 두 레벨 사이 */
+	px = readback();
+	green_range(px, 58, 42, 12, &lo, &hi);
+	expect(lo >= 120 && hi <= 136, "LOD 2: green %d..%d", lo, hi);
+	green_range(px, 11, 43, 17, &lo, &hi);
+	expect(lo >= 100 && hi <= 156, "LOD 1.5: green %d..%d", lo, hi);
+	image("tex_trilinear", px);
+
+	/* 레벨이 하나뿐이고 point면 거른 값 없이 체커 텍셀이 그대로 나옴 */
+	C(PSSetSamplers, 0, 1, &point);
+	C(PSSetShaderResources, 0, 1, &srv_one);
+	clear(0, 0, 1);
+	draw_tex_quad(56, 40, 16, 16);
+	draw_tex_quad(8, 40, 23, 23);
+	px = readback();
+	bad = 0;
+	for (int y = 40; y < 63; y++)
+		for (int x = 8; x < 72; x++) {
+			uint32_t c = pixel(px, x, y);
+			if (c != 0 && c != 0xFFFFFF && c != 0x0000FF) bad++;
+		}
+	expect(bad == 0, "single level: %d filtered pixels", bad);
+	expect(count_color(px, 0) > 0 && count_color(px, 0xFFFFFF) > 0,
+	       "single level: checker lost");
+
+	/* clear만 한 렌더 타깃을 샘플 */
+	void *rt2 = mktex(32, 32, 0, DXGI_FORMAT_R8G8B8A8_UNORM,
+			  D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE,
+			  NULL, 0);
+	void *rtv2 = NULL, *srv_rt = mksrv(rt2);
+	D(CreateRenderTargetView, rt2, NULL, &rtv2);
+	float red[4] = { 1, 0, 0, 1 };
+	C(ClearRenderTargetView, rtv2, red);
+	C(PSSetSamplers, 0, 1, &trilinear);
+	C(PSSetShaderResources, 0, 1, &srv_rt);
+	clear(0, 0, 1);
+	draw_tex_quad(56, 40, 16, 16);
+	px = readback();
+	expect(pixel(px, 64, 48) == 0xFF0000, "render target sample %06x",
+	       pixel(px, 64, 48));
+
+	/* 레벨 0을 흰색으로 바꾸고 GenerateMips */
+	static uint32_t white[64 * 64];
+	for (int i = 0; i < 64 * 64; i++)
+		white[i] = 0xFFFFFFFF;
+	C(UpdateSubresource, tfull, 0, NULL, white, 256, 0);
+	C(GenerateMips, srv_full);
+	C(PSSetShaderResources, 0, 1, &srv_full);
+	clear(0, 0, 1);
+	draw_tex_quad(56, 40, 16, 16);
+	px = readback();
+	green_range(px, 58, 42, 12, &lo, &hi);
+	expect(lo == 255, "after GenerateMips: green %d..%d", lo, hi);
+}
+
+/* ============================================================
+ * [18] BC 압축 텍스처
+ * ============================================================ */
+
+static void test_bc_sampling(void)
+{
+	target(96, 64);
+	use_tex_shaders();
+	void *point = sampler(D3D11_FILTER_MIN_MAG_MIP_POINT);
+	C(PSSetSamplers, 0, 1, &point);
+
+	/*
+	 * 4x4 BC1 블록 하나: c0 = 흰색, c1 = 검정, 열마다 인덱스 0, 2, 3, 1
+	 * → 흰색, 2/3, 1/3, 검정. 1:1 point로 그리면 그대로 나와야 함.
+	 */
+	uint8_t b1[8] = { 0xFF, 0xFF, 0, 0, 0x78, 0x78, 0x78, 0x78 };
+	static const uint32_t col1[4] = { 0xFFFFFF, 0xAAAAAA, 0x555555, 0 };
+	/* BC3: 같은 색 블록, 알파는 끝값 255/0 */
+	uint8_t b3[16] = { 255, 0, 0, 0, 0, 0, 0, 0 };
+	memcpy(b3 + 8, b1, 8);
+
+	void *t1 = mktex(4, 4, 1, DXGI_FORMAT_BC1_UNORM,
+			 D3D11_BIND_SHADER_RESOURCE, b1, 8);
+	void *t3 = mktex(4, 4, 1, DXGI_FORMAT_BC3_UNORM,
+			 D3D11_BIND_SHADER_RESOURCE, b3, 16);
+	void *srv1 = mksrv(t1), *srv3 = mksrv(t3);
+	clear(0, 0, 1);
+	C(PSSetShaderResources, 0, 1, &srv1);
+	draw_tex_quad(10, 10, 4, 4);
+	C(PSSetShaderResources, 0, 1, &srv3);
+	draw_tex_quad(20, 10, 4, 4);
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++) {
+			if (pixel(px, 10 + x, 10 + y) != col1[x]) bad++;
+			if (pixel(px, 20 + x, 10 + y) != col1[x]) bad++;
+		}
+	expect(bad == 0, "%d BC texels decoded wrong", bad);
+
+	/* 8x8 BC1, 레벨 0 빨강 / 레벨 1 파랑 (앱이 둘 다 줌) */
+	uint8_t l0[4][8], l1[8] = { 0x1F, 0x00, 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 4; i++) {
+		static const uint8_t red[8] = { 0x00, 0xF8, 0, 0, 0, 0, 0, 0 };
+		memcpy(l0[i], red, 8);
+	}
+	D3D11_TEXTURE2D_DESC td = {0};
+	td.Width = td.Height = 8;
+	td.MipLevels = 2;
+	td.ArraySize = 1;
+	td.SampleDesc.Count = 1;
+	td.Format = DXGI_FORMAT_BC1_UNORM;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	D3D11_SUBRESOURCE_DATA sd[2] = { { l0, 16, 0 }, { l1, 8, 0 } };
+	void *tm = NULL;
+	D(CreateTexture2D, &td, sd, &tm);
+
+	/* MipLevels = 0: 전체 체인 (8, 4, 2, 1) — 빨강, 파랑, 초록, 흰색 */
+	uint8_t l2[8] = { 0xE0, 0x07, 0, 0, 0, 0, 0, 0 };
+	uint8_t l3[8] = { 0xFF, 0xFF, 0, 0, 0, 0, 0, 0 };
+	D3D11_SUBRESOURCE_DATA sz[4] = {
+		{ l0, 16, 0 }, { l1, 8, 0 }, { l2, 8, 0 }, { l3, 8, 0 }
+	};
+	void *tz = NULL;
+	td.MipLevels = 0;
+	D(CreateTexture2D, &td, sz, &tz);
+
+	void *srvm = mksrv(tm), *srvz = mksrv(tz);
+	void *trilinear = sampler(D3D11_FILTER_MIN_MAG_MIP_LINEAR);
+	C(PSSetSamplers, 0, 1, &trilinear);
+	clear(0, 0, 0);
+	C(PSSetShaderResources, 0, 1, &srvm);
+	draw_tex_quad(8, 8, 32, 32);        /* 확대: 레벨 0 */
+	draw_tex_quad(48, 8, 4, 4);         /* LOD 1 */
+	C(PSSetShaderResources, 0, 1, &srvz);
+	draw_tex_quad(48, 40, 4, 4);
+	draw_tex_quad(64, 40, 2, 2);
+	px = readback();
+	expect(pixel(px, 24, 24) == 0xFF0000, "level 0 %06x", pixel(px, 24, 24));
+	expect(pixel(px, 50, 10) == 0x0000FF, "level 1 %06x", pixel(px, 50, 10));
+	expect(pixel(px, 50, 42) == 0x0000FF, "MipLevels=0 LOD 1 %06x",
+	       pixel(px, 50, 42));
+	expect(pixel(px, 65, 41) == 0x00FF00, "MipLevels=0 LOD 2 %06x",
+	       pixel(px, 65, 41));
+	image("bc", px);
+}
+
+/* ============================================================
+ * [19] 클리핑 / 시저
+ * ============================================================ */
+
+/*
+ * IA는 POSITION의 w를 1로 채우므로, w가 필요한 경우는 vs_mvp_mul의
+ * 행렬로 만든다. 색은 cb0[4].
+ */
+static const float clip_identity[20] = {
+	1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1,  1, 1, 1, 1,
+};
+
+/* (x, y, z) → (x, y, z / 2, z): 입력 z가 클립 공간 w가 됨 */
+static const float clip_w_from_z[20] = {
+	1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 0.5f, 0,  0, 0, 1, 0,  1, 1, 1, 1,
+};
+
+static void *blend_add;         /* ONE + ONE */
+
+static void use_blend_add(void)
+{
+	if (!blend_add) {
+		D3D11_BLEND_DESC bd = {0};
+		bd.RenderTarget[0].BlendEnable = 1;
+		bd.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+		bd.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+		bd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		bd.RenderTarget[0].RenderTargetWriteMask = 0xF;
+		D(CreateBlendState, &bd, &blend_add);
+	}
+	C(OMSetBlendState, blend_add, NULL, 0xFFFFFFFF);
+}
+
+static void *raster_state(int depth_clip, int scissor)
+{
+	D3D11_RASTERIZER_DESC rd = {0};
+	rd.FillMode = D3D11_FILL_SOLID;
+	rd.CullMode = D3D11_CULL_NONE;
+	rd.DepthClipEnable = depth_clip;
+	rd.ScissorEnable = scissor;
+	void *rs = NULL;
+	D(CreateRasterizerState, &rd, &rs);
+	return rs;
+}
+
+static void draw_clip(const float (*pos)[3], int n, const float *mvp)
+{
+	struct vtx v[6];
+	for (int i = 0; i < n; i++) {
+		struct vtx t = { { pos[i][0], pos[i][1], pos[i][2] }, { 1, 1, 1, 1 } };
+		v[i] = t;
+	}
+	void *vb = mkbuf(v, (UINT)(sizeof(v[0]) * n), D3D11_BIND_VERTEX_BUFFER);
+	void *cb = mkbuf(mvp, 20 * sizeof(float), D3D11_BIND_CONSTANT_BUFFER);
+	use_vb(vb, sizeof(v[0]));
+	C(VSSetConstantBuffers, 0, 1, &cb);
+	C(Draw, n, 0);
+}
+
+static int count_lit(const uint32_t *px, int *outside, int x0, int y0,
+		     int x1, int y1)
+{
+	int n = 0;
+	*outside = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if (pixel(px, x, y)) {
+				n++;
+				if (x < x0 || x >= x1 || y < y0 || y >= y1)
+					(*outside)++;
+			}
+	return n;
+}
+
+static void test_clip_scissor(void)
+{
+	target(128, 96);
+	use_shaders();
+	C(VSSetShader, VS(vs_mvp_mul), NULL, 0);
+	void *rs_clip = raster_state(1, 0), *rs_noclip = raster_state(0, 0);
+	void *rs_sc = raster_state(1, 1);
+
+	/* 꼭짓점 C가 near 평면 뒤 (z < 0): 아래쪽 절반만 남음 */
+	static const float tn[3][3] = {
+		{ -1, -1, 0.5f }, { 1, -1, 0.5f }, { 0, 1, -0.5f },
+	};
+	C(RSSetState, rs_clip);
+	clear(0, 0, 0);
+	draw_clip(tn, 3, clip_identity);
+	uint32_t *px = readback();
+	expect(pixel(px, W / 2, H * 3 / 4) == 0xFFFFFF, "near: kept half missing");
+	expect(pixel(px, W / 2, H / 4) == 0, "near: clipped half drawn");
+
+	/*
+	 * C가 눈 뒤 (w = -1, depth clip 끔). 픽셀 광선이 (x, y, w) 공간의
+	 * 삼각형과 w > 0에서 만나는 곳만 덮여야 함 — 크래머 공식으로 계산,
+	 * 가장자리 1픽셀 차이는 허용.
+	 */
+	static const float tw[3][3] = {
+		{ -1, -0.5f, 1 }, { 1, -0.5f, 1 }, { 0, 1, -1 },
+	};
+	C(RSSetState, rs_noclip);
+	clear(0, 0, 0);
+	draw_clip(tw, 3, clip_w_from_z);
+	px = readback();
+	double m[3][3];         /* 열 = 꼭짓점 (x, y, w) */
+	for (int i = 0; i < 3; i++)
+		for (int k = 0; k < 3; k++)
+			m[i][k] = tw[k][i];
+	double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+		     m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+		     m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	int mism = 0, lit = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			double r[3] = { (x + 0.5) / W * 2 - 1,
+					1 - (y + 0.5) / H * 2, 1 };
+			int want = 1;
+			for (int k = 0; k < 3; k++) {
+				double a[3][3];
+				memcpy(a, m, sizeof(m));
+				for (int i = 0; i < 3; i++)
+					a[i][k] = r[i];
+				double q = (a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+					    a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+					    a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0])) / det;
+				if (q <= 0) want = 0;
+			}
+			int got = pixel(px, x, y) != 0;
+			lit += got;
+			mism += want != got;
+		}
+	expect(lit > 0 && mism <= W + H, "w < 0: %d lit, %d mismatches",
+	       lit, mism);
+	image("clip_w", px);
+
+	/* 가드 밴드를 훨씬 넘는 삼각형: 덧셈 블렌드로 화면 전체를 정확히 한 번 */
+	static const float tg[3][3] = {
+		{ -3000, -3000, 0.5f }, { 5000, -3000, 0.5f }, { -3000, 5000, 0.5f },
+	};
+	C(RSSetState, rs_clip);
+	clear(0, 0, 0);
+	use_blend_add();
+	draw_clip(tg, 3, clip_identity);
+	px = readback();
+	expect(count_color(px, 0xFFFFFF) == W * H, "guard band: %d of %d",
+	       count_color(px, 0xFFFFFF), W * H);
+	C(OMSetBlendState, NULL, NULL, 0xFFFFFFFF);
+
+	/* 전체 화면 사각형 — 시저/뷰포트 밖으로 나가면 안 됨 */
+	static const float full[6][3] = {
+		{ -1, 1, 0.5f }, { 1, 1, 0.5f }, { -1, -1, 0.5f },
+		{ 1, 1, 0.5f }, { 1, -1, 0.5f }, { -1, -1, 0.5f },
+	};
+	D3D11_RECT sr = { 100, 50, 140, 90 };       /* RT 오른쪽을 넘어감 */
+	C(RSSetScissorRects, 1, &sr);
+	int out;
+	clear(0, 0, 0);
+	C(RSSetState, rs_sc);
+	draw_clip(full, 6, clip_identity);
+	px = readback();
+	int n = count_lit(px, &out, 100, 50, 128, 90);
+	expect(n == 28 * 40 && out == 0, "scissor: %d px, %d outside", n, out);
+
+	/* ScissorEnable이 꺼져 있으면 시저 사각형은 무시 */
+	clear(0, 0, 0);
+	C(RSSetState, rs_clip);
+	draw_clip(full, 6, clip_identity);
+	px = readback();
+	expect(count_color(px, 0xFFFFFF) == W * H, "scissor off: %d px",
+	       count_color(px, 0xFFFFFF));
+
+	/* 작은 뷰포트: NDC 전체가 그 사각형으로만 */
+	D3D11_VIEWPORT vp = { 16, 8, 40, 24, 0, 1 };
+	C(RSSetViewports, 1, &vp);
+	clear(0, 0, 0);
+	draw_clip(full, 6, clip_identity);
+	draw_clip(tg, 3, clip_identity);
+	px = readback();
+	n = count_lit(px, &out, 16, 8, 56, 32);
+	expect(n == 40 * 24 && out == 0, "viewport: %d px, %d outside", n, out);
+	image("clip_viewport", px);
+}
+
+/* ============================================================
+ * [20] 타일 기반 지연 셰이딩 (TBDR)
+ * ============================================================ */
+
+struct zrect {
+	int x0, y0, x1, y1;
+	float z;
+	uint32_t rgb;           /* 0x33 단위 — unorm 변환이 정확함 */
+};
+
+static void zrect_random(struct zrect *q)
+{
+	q->x0 = (int)(rnd() * 100);
+	q->y0 = (int)(rnd() * 70);
+	q->x1 = q->x0 + 4 + (int)(rnd() * 60);
+	q->y1 = q->y0 + 4 + (int)(rnd() * 40);
+	if (q->x1 > W) q->x1 = W;
+	if (q->y1 > H) q->y1 = H;
+	q->z = 0.05f + rnd() * 0.9f;
+	q->rgb = 0;
+	for (int k = 0; k < 3; k++)
+		q->rgb = q->rgb << 8 | (uint32_t)(rnd() * 5.99f) * 0x33;
+}
+
+static void zrect_draw(const struct zrect *q)
+{
+	draw_quad(ndc_x(q->x0), ndc_y(q->y1), ndc_x(q->x1), ndc_y(q->y0), q->z,
+		  (q->rgb >> 16) / 255.0f, (q->rgb >> 8 & 0xFF) / 255.0f,
+		  (q->rgb & 0xFF) / 255.0f);
+}
+
+/* CPU 기준: 깊이 LESS + 쓰기, add면 포화 덧셈 */
+static void zrect_ref(uint32_t *ref, float *zb, const struct zrect *q, int add)
+{
+	for (int y = q->y0; y < q->y1; y++)
+		for (int x = q->x0; x < q->x1; x++) {
+			int i = y * W + x;
+			if (!(q->z < zb[i])) continue;
+			zb[i] = q->z;
+			if (!add) {
+				ref[i] = q->rgb;
+				continue;
+			}
+			uint32_t c = 0;
+			for (int sh = 16; sh >= 0; sh -= 8) {
+				uint32_t s = (ref[i] >> sh & 0xFF) + (q->rgb >> sh & 0xFF);
+				c |= (s > 255 ? 255 : s) << sh;
+			}
+			ref[i] = c;
+		}
+}
+
+/*
+ * 겹치는 불투명 사각형을 임의 깊이로 그리고, 중간에 덧셈 블렌드
+ * Draw를 끼워 run을 끊는다. TBDR 모드에서도 순서대로 그린 것과 같아야 함.
+ */
+static void test_tbdr_overdraw(void)
+{
+	target(128, 96);
+	use_shaders();
+	use_depth_less();
+
+	enum { NQ = 48 };
+	struct zrect q[NQ];
+	g_seed = 20;
+	for (int i = 0; i < NQ; i++)
+		zrect_random(&q[i]);
+
+	uint32_t *ref = malloc((size_t)W * H * 4);
+	float *zb = malloc((size_t)W * H * sizeof(float));
+	for (int i = 0; i < W * H; i++) {
+		ref[i] = 0;
+		zb[i] = 1.0f;
+	}
+
+	clear(0, 0, 0);
+	for (int i = 0; i < NQ; i++) {
+		int add = i == NQ / 2 || i == NQ / 2 + 1;
+		if (add)
+			use_blend_add();
+		zrect_draw(&q[i]);
+		zrect_ref(ref, zb, &q[i], add);
+		if (add)
+			C(OMSetBlendState, NULL, NULL, 0xFFFFFFFF);
+	}
+	uint32_t *px = readback();
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++)
+			if (pixel(px, x, y) != ref[y * W + x]) bad++;
+	expect(bad == 0, "%d pixels differ from in-order reference", bad);
+	image("tbdr_overdraw", px);
+	free(ref);
+	free(zb);
+}
+
+static void test_tbdr_lod(void)
+{
+	target(128, 96);
+
+	/*
+	 * 같은 체커 텍스처를 크기가 다른 사각형으로 겹쳐 그림 (깊이 끔,
+	 * 나중 것이 이김): shade pass가 다시 만든 2x2 UV 차이로 LOD를
+	 * 고르므로, 이미지가 다른 모드와 같아야 함. 마지막 16x16은 회색.
+	 */
+	static uint32_t chk[64 * 64];
+	for (int i = 0; i < 64 * 64; i++)
+		chk[i] = ((i ^ (i >> 6)) & 1) ? 0xFFFFFFFF : 0xFF000000;
+	void *tex = mktex(64, 64, 0, DXGI_FORMAT_R8G8B8A8_UNORM,
+			  D3D11_BIND_SHADER_RESOURCE, chk, 256);
+	void *srv = mksrv(tex), *smp = sampler(D3D11_FILTER_MIN_MAG_MIP_LINEAR);
+	use_tex_shaders();
+	C(PSSetShaderResources, 0, 1, &srv);
+	C(PSSetSamplers, 0, 1, &smp);
+	clear(0, 0, 1);
+	for (int i = 0; i < 6; i++)
+		draw_tex_quad(8 + i * 12, 8 + i * 6, 64 - i * 8, 64 - i * 8);
+	draw_tex_quad(40, 30, 16, 16);
+	uint32_t *px = readback();
+	int lo, hi;
+	green_range(px, 42, 32, 12, &lo, &hi);
+	expect(lo >= 120 && hi <= 136, "last quad: green %d..%d", lo, hi);
+	image("tbdr_lod", px);
+}
+
+/* ============================================================
+ * [21] Compute 셰이더
+ * ============================================================ */
+
+/* cs_5_0 [16,1,1]: u0[id] = id * 2, atomic_iadd u1[0], 1 */
+static const unsigned cs_store[] = {
+	0x00050050, 0,
+	0x0400009B, 16, 1, 1,
+	0x0400009E, 0x0011E000, 0, 4,
+	0x0300009D, 0x0011E000, 1,
+	0x02000068, 1,
+	0x06000029, 0x00100012, 0, 0x0002000A, 0x00004001, 1,
+	0x080000A8, 0x0011E012, 0, 0x0002000A, 0x00004001, 0, 0x0010000A, 0,
+	0x070000AD, 0x0011E012, 1, 0x00004001, 0, 0x00004001, 1,
+	0x0100003E,
+};
+
+/*
+ * cs_5_0 [64,1,1]: g0[tid] = id, 배리어, u0[id] = g0[(tid + 1) & 63]
+ * → u0[i] = i / 64 * 64 + (i + 1) % 64
+ */
+static const unsigned cs_tgsm[] = {
+	0x00050050, 0,
+	0x0400009B, 64, 1, 1,
+	0x0400009E, 0x0011E000, 0, 4,
+	0x0400009F, 0x0011F000, 0, 256,
+	0x02000068, 1,
+	0x06000029, 0x00100012, 0, 0x0002200A, 0x00004001, 2,
+	0x060000A6, 0x0011F012, 0, 0x0010000A, 0, 0x0002000A,
+	0x010008BE,
+	0x0600001E, 0x00100012, 0, 0x0002200A, 0x00004001, 1,
+	0x07000001, 0x00100012, 0, 0x0010000A, 0, 0x00004001, 63,
+	0x07000029, 0x00100012, 0, 0x0010000A, 0, 0x00004001, 2,
+	0x070000A5, 0x00100012, 0, 0x0010000A, 0, 0x0011F006, 0,
+	0x080000A8, 0x0011E012, 0, 0x0002000A, 0x00004001, 0, 0x0010000A, 0,
+	0x0100003E,
+};
+
+static void *create_cs(const unsigned *tok, int n)
+{
+	size_t size;
+	void *blob = dxbc_wrap(tok, n, &size), *cs = NULL;
+	D(CreateComputeShader, blob, size, NULL, &cs);
+	free(blob);
+	return cs;
+}
+
+/* 버퍼를 즉시 컨텍스트에서 Map(READ)해 n개 복사 */
+static void read_buffer(void *buf, uint32_t *out, int n)
+{
+	D3D11_MAPPED_SUBRESOURCE m;
+	submit();
+	if (I(Map, buf, 0, D3D11_MAP_READ, 0, &m) != S_OK) {
+		expect(0, "Map(READ) of buffer failed");
+		memset(out, 0, (size_t)n * 4);
+		return;
+	}
+	memcpy(out, m.pData, (size_t)n * 4);
+	I(Unmap, buf, 0);
+}
+
+static void test_compute(void)
+{
+	enum { N = 4096 };
+	void *c1 = create_cs(cs_store, (int)(sizeof(cs_store) / 4));
+	void *c2 = create_cs(cs_tgsm, (int)(sizeof(cs_tgsm) / 4));
+	expect(c1 && c2, "CreateComputeShader failed");
+
+	D3D11_BUFFER_DESC bd = {0};
+	bd.ByteWidth = N * 4;
+	bd.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bd.StructureByteStride = 4;
+	void *sb = NULL, *sb2 = NULL, *cnt = NULL;
+	D(CreateBuffer, &bd, NULL, &sb);
+	D(CreateBuffer, &bd, NULL, &sb2);
+	bd.ByteWidth = 16;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	bd.StructureByteStride = 0;
+	D(CreateBuffer, &bd, NULL, &cnt);
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC ud = {0};
+	ud.Format = DXGI_FORMAT_UNKNOWN;
+	ud.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	ud.Buffer.NumElements = N;
+	void *uav[2] = { NULL, NULL };
+	D(CreateUnorderedAccessView, sb, &ud, &uav[0]);
+	ud.Format = DXGI_FORMAT_R32_TYPELESS;
+	ud.Buffer.NumElements = 4;
+	ud.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	D(CreateUnorderedAccessView, cnt, &ud, &uav[1]);
+
+	/* 그룹 N / 16개 — 스레드 풀 전체에 나뉨 */
+	C(CSSetShader, c1, NULL, 0);
+	C(CSSetUnorderedAccessViews, 0, 2, uav, NULL);
+	C(Dispatch, N / 16, 1, 1);
+	C(CopyResource, sb2, sb);
+
+	/* 배리어가 있는 그룹: 워커마다 VM 배열 + 공유 메모리 */
+	C(CSSetShader, c2, NULL, 0);
+	C(Dispatch, N / 64, 1, 1);
+
+	static uint32_t v[N];
+	int bad = 0;
+	read_buffer(sb2, v, N);
+	for (int i = 0; i < N; i++)
+		if (v[i] != (uint32_t)i * 2) bad++;
+	expect(bad == 0, "structured store: %d wrong", bad);
+
+	read_buffer(cnt, v, 1);
+	expect(v[0] == N, "atomic counter %u", v[0]);
+
+	bad = 0;
+	read_buffer(sb, v, N);
+	for (int i = 0; i < N; i++)
+		if (v[i] != (uint32_t)(i / 64 * 64 + (i + 1) % 64)) bad++;
+	expect(bad == 0, "TGSM + barrier: %d wrong", bad);
+
+	void *none[2] = { NULL, NULL };
+	C(CSSetUnorderedAccessViews, 0, 2, none, NULL);
+}
+
+/* ============================================================
+ * [22] 네이티브 커널
+ * ============================================================ */
+
+/* vs_4_0: o0 = mul(v0, cb0[0..3]) (dp4 행), o1 = v1 — VS_XFORM 모양 */
+static const unsigned vs_xform[] = {
+	0x00010040, 0,
+	0x0300005F, 0x001010F2, 0,
+	0x0300005F, 0x001010F2, 1,
+	0x04000067, 0x001020F2, 0, 1,
+	0x03000065, 0x001020F2, 1,
+	0x08000011, 0x00102012, 0, 0x00101E46, 0, 0x00208E46, 0, 0,
+	0x08000011, 0x00102022, 0, 0x00101E46, 0, 0x00208E46, 0, 1,
+	0x08000011, 0x00102042, 0, 0x00101E46, 0, 0x00208E46, 0, 2,
+	0x08000011, 0x00102082, 0, 0x00101E46, 0, 0x00208E46, 0, 3,
+	0x05000036, 0x001020F2, 1, 0x00101E46, 1,
+	0x0100003E,
+};
+
+/* ps_4_0: o0 = v1 * (1, 1, 1, 1) — PS_COLOR와 같은 값, 커널 모양은 아님 */
+static const unsigned ps_color_mul1[] = {
+	0x00000040, 0,
+	0x03000065, 0x001020F2, 0,
+	0x0A000038, 0x001020F2, 0, 0x00101E46, 1,
+	0x00004E46, 0x3F800000, 0x3F800000, 0x3F800000, 0x3F800000,
+	0x0100003E,
+};
+
+/* ps_4_0: o0 = sample(t0, s0, v2.xy) — PS_TEX 모양 */
+static const unsigned ps_tex_only[] = {
+	0x00000040, 0,
+	0x0300005A, 0x00106000, 0,
+	0x04001858, 0x00107000, 0, 0x00005555,
+	0x03001062, 0x00101032, 2,
+	0x03000065, 0x001020F2, 0,
+	0x09000045, 0x001020F2, 0, 0x00101046, 2, 0x00107E46, 0, 0x00106000, 0,
+	0x0100003E,
+};
+
+/*
+ * 원근이 있는 행렬로 임의 삼각형들을 그려, 커널 모양 셰이더 쌍과
+ * 같은 식을 VM으로 도는 쌍(vs_mvp_mul + cb0[4] = 1, ps_color_mul1)의
+ * 결과가 비트 단위로 같아야 함.
+ */
+static void test_native_kernels(void)
+{
+	target(128, 96);
+	use_shaders();
+	use_depth_less();
+	static const float mvp[20] = {
+		0.9f, 0.3f, 0, 0.05f,
+		-0.2f, 0.8f, 0.1f, 0,
+		0, 0, 0.5f, 0.25f,
+		0.1f, -0.1f, 0.4f, 0.9f,
+		1, 1, 1, 1,
+	};
+	void *cb = mkbuf(mvp, sizeof(mvp), D3D11_BIND_CONSTANT_BUFFER);
+	C(VSSetConstantBuffers, 0, 1, &cb);
+
+	enum { NT = 60 };
+	struct vtx v[NT * 3];
+	g_seed = 22;
+	for (int i = 0; i < NT * 3; i++) {
+		struct vtx t = {
+			{ rnd() * 2.4f - 1.2f, rnd() * 2.4f - 1.2f, 0.1f + rnd() * 0.8f },
+			{ rnd(), rnd(), rnd(), 1 },
+		};
+		v[i] = t;
+	}
+	void *vb = mkbuf(v, sizeof(v), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtx));
+
+	void *vs[2] = { VS(vs_xform), VS(vs_mvp_mul) };
+	void *ps[2] = { ps_pc, PS(ps_color_mul1) };
+	uint32_t *img[2];
+	for (int k = 0; k < 2; k++) {
+		C(VSSetShader, vs[k], NULL, 0);
+		C(PSSetShader, ps[k], NULL, 0);
+		clear(0, 0, 0);
+		C(Draw, NT * 3, 0);
+		uint32_t *px = readback();
+		img[k] = malloc((size_t)W * H * 4);
+		memcpy(img[k], px, (size_t)W * H * 4);
+	}
+	int diff = 0, lit = 0;
+	for (int i = 0; i < W * H; i++) {
+		diff += (img[0][i] & 0xFFFFFF) != (img[1][i] & 0xFFFFFF);
+		lit += (img[0][i] & 0xFFFFFF) != 0;
+	}
+	expect(lit > W * H / 4, "only %d pixels drawn", lit);
+	expect(diff == 0, "kernel vs VM: %d pixels differ", diff);
+	image("kernel_xform", img[0]);
+	free(img[0]);
+	free(img[1]);
+}
+
+/* PS_TEX와 흰색 정점 PS_TEX_COLOR는 같은 이미지, 색을 곱하면 텍셀 * 색 */
+static void test_kernel_tex(void)
+{
+	target(96, 64);
+	use_tex_shaders();
+	static uint32_t tx[16 * 16];
+	g_seed = 23;
+	for (int i = 0; i < 16 * 16; i++)
+		tx[i] = 0xFF000000u | (uint32_t)(rnd() * 0xFFFFFF);
+	void *tex = mktex(16, 16, 0, DXGI_FORMAT_B8G8R8A8_UNORM,
+			  D3D11_BIND_SHADER_RESOURCE, tx, 64);
+	void *srv = mksrv(tex), *smp = sampler(D3D11_FILTER_MIN_MAG_MIP_LINEAR);
+	C(PSSetShaderResources, 0, 1, &srv);
+	C(PSSetSamplers, 0, 1, &smp);
+
+	uint32_t *img[2];
+	void *ps[2] = { PS(ps_tex_only), PS(ps_tex) };
+	for (int k = 0; k < 2; k++) {
+		C(PSSetShader, ps[k], NULL, 0);
+		clear(0, 0, 0);
+		draw_tex_quad(4, 4, 40, 40);        /* 확대 */
+		draw_tex_quad(60, 10, 11, 11);      /* 축소 */
+		uint32_t *px = readback();
+		img[k] = malloc((size_t)W * H * 4);
+		memcpy(img[k], px, (size_t)W * H * 4);
+	}
+	int diff = 0;
+	for (int i = 0; i < W * H; i++)
+		diff += (img[0][i] & 0xFFFFFF) != (img[1][i] & 0xFFFFFF);
+	expect(diff == 0, "PS_TEX vs PS_TEX_COLOR: %d pixels differ", diff);
+	image("kernel_tex", img[0]);
+
+	/* 정점 색 (0.5, 1, 0.25)을 곱함 — 채널마다 반올림 ±1 */
+	float x0 = ndc_x(4), x1 = ndc_x(44), y0 = ndc_y(44), y1 = ndc_y(4);
+	struct vtxt q[6] = {
+		{ { x0, y1, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 0, 0 } },
+		{ { x1, y1, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 1, 0 } },
+		{ { x0, y0, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 0, 1 } },
+		{ { x1, y1, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 1, 0 } },
+		{ { x1, y0, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 1, 1 } },
+		{ { x0, y0, 0.5f }, { 0.5f, 1, 0.25f, 1 }, { 0, 1 } },
+	};
+	void *vb = mkbuf(q, sizeof(q), D3D11_BIND_VERTEX_BUFFER);
+	use_vb(vb, sizeof(struct vtxt));
+	clear(0, 0, 0);
+	C(Draw, 6, 0);
+	uint32_t *px = readback();
+	static const float mul[3] = { 0.5f, 1, 0.25f };
+	int bad = 0;
+	for (int y = 4; y < 44; y++)
+		for (int x = 4; x < 44; x++) {
+			uint32_t t = img[0][y * W + x], c = pixel(px, x, y);
+			for (int ch = 0; ch < 3; ch++) {
+				int sh = 16 - ch * 8;
+				int want = (int)((t >> sh & 0xFF) * mul[ch] + 0.5f);
+				int got = (int)(c >> sh & 0xFF);
+				if (got < want - 1 || got > want + 1) bad++;
+			}
+		}
+	expect(bad == 0, "texel * colour: %d channels off", bad);
+	free(img[0]);
+	free(img[1]);
+}
+
+/* ============================================================
+ * [23] 동적 해상도
+ * ============================================================ */
+
+/* Present 한 번: 동적 해상도 확대를 시도하고 다음 배율을 정함 */
+static int present(uint32_t *dst)
+{
+	struct timespec ts = { 0, 20000 };
+	submit();
+	d3d11_flush();
+	d3d11_resolve_resource(g_sc.res_idx);
+	int done = d3d11_dynres_present(g_sc.res_idx, dst, W, W, H);
+	nanosleep(&ts, NULL);
+	return done;
+}
+
+static void test_dynres(void)
+{
+	/*
+	 * CITC_D3D11_DYNRES는 처음 쓸 때 한 번 읽힌다. 앞선 테스트는
+	 * SwapChain 백버퍼에 그리지 않으므로 여기서 켜도 된다. 예산이 거의
+	 * 0이라 Present마다 초과 → 배율이 최소(0.5)에 머문다.
+	 */
+	setenv("CITC_D3D11_DYNRES", "0.000001", 1);
+	target(128, 96);
+	g_sc.w = W;
+	g_sc.h = H;
+	g_sc.pixels = calloc((size_t)W * H, 4);
+	uint32_t *dst = calloc((size_t)W * H, 4);
+	void *rtv_sc = NULL;
+	D(CreateRenderTargetView, &g_sc, NULL, &rtv_sc);
+	expect(rtv_sc && g_sc.res_idx >= 0, "backbuffer RTV failed");
+
+	use_shaders();
+	C(OMSetRenderTargets, 1, &rtv_sc, dsv);
+	float black[4] = { 0, 0, 0, 1 };
+	for (int i = 0; i < 16; i++)
+		present(dst);
+
+	/* 왼쪽 절반 빨강, 오른쪽 절반 파랑 */
+	C(ClearRenderTargetView, rtv_sc, black);
+	draw_quad(-1, -1, 0, 1, 0.5f, 1, 0, 0);
+	draw_quad(0, -1, 1, 1, 0.5f, 0, 0, 1);
+	submit();
+	d3d11_flush();
+	d3d11_resolve_resource(g_sc.res_idx);
+
+	/* 백버퍼에는 W/2 x H/2만 그려짐 */
+	const uint32_t *bb = g_sc.pixels;
+	expect((bb[(H / 8) * W + W / 8] & 0xFFFFFF) == 0xFF0000 &&
+	       (bb[(H / 8) * W + W * 3 / 8] & 0xFFFFFF) == 0x0000FF,
+	       "scaled draw %06x %06x", bb[(H / 8) * W + W / 8] & 0xFFFFFF,
+	       bb[(H / 8) * W + W * 3 / 8] & 0xFFFFFF);
+	expect((bb[(H * 3 / 4) * W + W * 3 / 4] & 0xFFFFFF) == 0,
+	       "drawn outside the scaled viewport");
+
+	expect(present(dst) == 1, "Present did not upscale");
+	int bad = 0;
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x++) {
+			uint32_t c = dst[y * W + x] & 0xFFFFFF;
+			if (x < W / 2 - 2 && c != 0xFF0000) bad++;
+			if (x >= W / 2 + 2 && c != 0x0000FF) bad++;
+		}
+	expect(bad == 0, "upscaled image: %d pixels wrong", bad);
+	image("dynres_upscale", dst);
+
+	/* 일반 렌더 타깃은 줄이지 않음 */
+	C(OMSetRenderTargets, 1, &rtv, dsv);
+	clear(0, 0, 0);
+	draw_quad(-1, -1, 1, 1, 0.5f, 0, 1, 0);
+	uint32_t *px = readback();
+	expect(count_color(px, 0x00FF00) == W * H, "offscreen RT scaled");
+
+	d3d11_release_swapchain_texture(g_sc.res_idx);
+	g_sc.res_idx = -1;
+	free(g_sc.pixels);
+	g_sc.pixels = NULL;
+	free(dst);
+}
+
+/* ============================================================
+ * [24] 쿼리 / 프레디케이션
+ * ============================================================ */
+
+static void *mkquery(D3D11_QUERY type)
+{
+	D3D11_QUERY_DESC qd = { type, 0 };
+	void *q = NULL;
+	if (type == D3D11_QUERY_OCCLUSION_PREDICATE)
+		D(CreatePredicate, &qd, &q);
+	else
+		D(CreateQuery, &qd, &q);
+	return q;
+}
+
+static HRESULT get_u64(void *q, uint64_t *v)
+{
+	*v = 0xDEAD;
+	return I(GetData, q, v, sizeof(*v), 0);
+}
+
+static void test_queries(void)
+{
+	target(128, 96);
+	use_shaders();
+	use_depth_less();
+
+	static const struct zrect occluder = { 0, 0, 128, 96, 0.5f, 0x0000FF };
+	static const struct zrect behind = { 40, 30, 72, 62, 0.7f, 0xFF0000 };
+	static const struct zrect front = { 40, 30, 72, 62, 0.1f, 0x00FF00 };
+	static const struct zrect small = { 48, 38, 64, 54, 0.05f, 0xFFFF00 };
+	static const struct zrect hidden = { 0, 0, 16, 16, 0.9f, 0xFF00FF };
+	static const struct zrect full = { 0, 0, 128, 96, 0.0f, 0xFFFFFF };
+
+	void *qa = mkquery(D3D11_QUERY_OCCLUSION);
+	void *qb = mkquery(D3D11_QUERY_OCCLUSION);
+	void *pr = mkquery(D3D11_QUERY_OCCLUSION_PREDICATE);
+	void *ts1 = mkquery(D3D11_QUERY_TIMESTAMP);
+	void *ts2 = mkquery(D3D11_QUERY_TIMESTAMP);
+	void *tsd = mkquery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+	void *ev = mkquery(D3D11_QUERY_EVENT);
+
+	clear(0, 0, 0);
+	C(Begin, tsd);
+	C(End, ts1);
+
+	/* qb는 qa 안에서 시작하고 끝남 — 둘 다 자기 구간을 모두 셈 */
+	C(Begin, qa);
+	zrect_draw(&occluder);
+	C(Begin, qb);
+	zrect_draw(&behind);
+	zrect_draw(&front);
+	C(End, qb);
+	zrect_draw(&small);
+	C(End, qa);
+
+	/* 가려진 Draw로 만든 프레디케이트 → FALSE면 다음 Draw 생략 */
+	C(Begin, pr);
+	zrect_draw(&hidden);
+	C(End, pr);
+	C(SetPredication, pr, FALSE);
+	zrect_draw(&full);
+	C(SetPredication, NULL, FALSE);
+
+	C(End, ts2);
+	C(End, tsd);
+	C(End, ev);
+	uint32_t *px = readback();
+
+	uint64_t sa, sb, t1, t2;
+	expect(get_u64(qa, &sa) == S_OK && sa == 128 * 96 + 32 * 32 + 16 * 16,
+	       "outer occlusion %llu", (unsigned long long)sa);
+	expect(get_u64(qb, &sb) == S_OK && sb == 32 * 32,
+	       "inner occlusion %llu", (unsigned long long)sb);
+	BOOL pv = TRUE, evd = FALSE;
+	expect(I(GetData, pr, &pv, sizeof(pv), 0) == S_OK && !pv,
+	       "hidden predicate %d", pv);
+	expect(I(GetData, ev, &evd, sizeof(evd), 0) == S_OK && evd,
+	       "event not signalled");
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT dj = { 0, TRUE };
+	expect(I(GetData, tsd, &dj, sizeof(dj), 0) == S_OK &&
+	       dj.Frequency == 1000000000ull && !dj.Disjoint,
+	       "disjoint %llu %d", (unsigned long long)dj.Frequency, dj.Disjoint);
+	expect(get_u64(ts1, &t1) == S_OK && get_u64(ts2, &t2) == S_OK &&
+	       t1 && t2 >= t1, "timestamps %llu %llu",
+	       (unsigned long long)t1, (unsigned long long)t2);
+	expect(pixel(px, 5, 5) == 0x0000FF && pixel(px, 44, 34) == 0x00FF00 &&
+	       pixel(px, 56, 46) == 0xFFFF00, "image %06x %06x %06x",
+	       pixel(px, 5, 5), pixel(px, 44, 34), pixel(px, 56, 46));
+
+	/* 보이는 프레디케이트 → Draw가 실행됨 */
+	clear(0, 0, 0);
+	C(Begin, pr);
+	zrect_draw(&front);
+	C(End, pr);
+	C(SetPredication, pr, FALSE);
+	zrect_draw(&full);
+	C(SetPredication, NULL, FALSE);
+	px = readback();
+	expect(pixel(px, 5, 5) == 0xFFFFFF, "visible predicate skipped the draw");
+	pv = FALSE;
+	expect(I(GetData, pr, &pv, sizeof(pv), D3D11_ASYNC_GETDATA_DONOTFLUSH) ==
+	       S_OK && pv, "visible predicate %d", pv);
+
+	/*
+	 * 겹친 쿼리 9개: 드라이버 한도(컨텍스트당 8개) 안의 것은 정확히 세고,
+	 * 넘친 것은 잘린 값을 내지 않고 실패를 알림.
+	 */
+	enum { NQ = 9 };
+	void *qs[NQ];
+	clear(0, 0, 0);
+	for (int i = 0; i < NQ; i++) {
+		struct zrect nearer = small;
+		nearer.z = 0.4f - i * 0.04f;
+		qs[i] = mkquery(D3D11_QUERY_OCCLUSION);
+		C(Begin, qs[i]);
+		zrect_draw(&nearer);
+	}
+	for (int i = NQ - 1; i >= 0; i--)
+		C(End, qs[i]);
+	readback();
+	for (int i = 0; i < NQ - 1; i++) {
+		uint64_t v;
+		HRESULT hr = get_u64(qs[i], &v);
+		/* Draw마다 앞으로 오므로 i번 이후의 Draw가 모두 통과 */
+		expect(hr == S_OK && v == (uint64_t)(NQ - i) * 16 * 16,
+		       "nested query %d: %llu", i, (unsigned long long)v);
+	}
+	uint64_t v;
+	expect(get_u64(qs[NQ - 1], &v) == E_FAIL, "query over the limit succeeded");
+}
+
+/* ============================================================
+ * [25] 핸들 테이블
+ * ============================================================ */
+
+/* 백버퍼를 Map(READ)해 (x, y) 픽셀 */
+static uint32_t backbuffer_pixel(int x, int y)
+{
+	D3D11_MAPPED_SUBRESOURCE m;
+	submit();
+	if (I(Map, &g_sc, 0, D3D11_MAP_READ, 0, &m) != S_OK)
+		return 0xDEAD;
+	uint32_t c = *(uint32_t *)((uint8_t *)m.pData + (size_t)y * m.RowPitch +
+				   x * 4);
+	I(Unmap, &g_sc, 0);
+	return c & 0xFFFFFF;
+}
+
+/*
+ * SwapChain 백버퍼 w x h를 만들어 RTV로 묶고 색 하나로 채움.
+ * 앞선 dynres 테스트가 동적 해상도를 켜 두었으므로, 줄이지 않는
+ * 크기(한 변 < 16)만 쓴다.
+ */
+static void *backbuffer_fill(int w, int h, float r, float g, float b)
+{
+	g_sc.w = w;
+	g_sc.h = h;
+	g_sc.pixels = calloc((size_t)w * h, 4);
+	void *rtv_sc = NULL;
+	D(CreateRenderTargetView, &g_sc, NULL, &rtv_sc);
+	D3D11_VIEWPORT vp = { 0, 0, (float)w, (float)h, 0, 1 };
+	C(OMSetRenderTargets, 1, &rtv_sc, NULL);
+	C(RSSetViewports, 1, &vp);
+	draw_quad(-1, -1, 1, 1, 0.5f, r, g, b);
+	return rtv_sc;
+}
+
+static void backbuffer_release(void)
+{
+	submit();
+	d3d11_release_swapchain_texture(g_sc.res_idx);
+	g_sc.res_idx = -1;
+	free(g_sc.pixels);
+	g_sc.pixels = NULL;
+}
+
+static void test_handle_table(void)
+{
+	/* 테이블 자체: slab 여러 개에 걸친 할당, 해제 후 옛 핸들 */
+	static struct handle_table t = HANDLE_TABLE_INIT(int, 0x7E);
+	enum { NH = 3000 };
+	static void *h[NH];
+	int bad = 0;
+	for (int i = 0; i < NH; i++) {
+		int idx = ht_alloc(&t);
+		if (idx < 0) { bad++; continue; }
+		*(int *)ht_slot(&t, idx) = i;
+		h[i] = ht_handle(&t, idx);
+	}
+	expect(bad == 0, "%d allocations failed", bad);
+	for (int i = 0; i < NH; i += 3)
+		ht_free(&t, ht_lookup(&t, h[i]));
+	bad = 0;
+	for (int i = 0; i < NH; i++) {
+		int idx = ht_lookup(&t, h[i]);
+		if (i % 3 == 0 ? idx >= 0 : idx < 0 || *(int *)ht_slot(&t, idx) != i)
+			bad++;
+	}
+	expect(bad == 0, "%d lookups wrong after free", bad);
+	/* 해제된 슬롯이 재사용돼도 옛 핸들은 여전히 실패 */
+	int reused = 0;
+	bad = 0;
+	for (int i = 0; i < NH; i += 3) {
+		int idx = ht_alloc(&t);
+		void *nh = ht_handle(&t, idx);
+		reused += idx < NH;
+		if (ht_lookup(&t, nh) != idx || ht_lookup(&t, h[i]) >= 0) bad++;
+	}
+	expect(reused == NH / 3, "only %d of %d slots reused", reused, NH / 3);
+	expect(bad == 0, "%d stale handles resolved", bad);
+	expect(ht_lookup(&t, (void *)((uintptr_t)h[1] ^ (1ull << HT_TAG_SHIFT))) < 0,
+	       "handle of another kind resolved");
+
+	/* 옛 배열 한도(32..256)를 훨씬 넘는 리소스/뷰/셰이더 뒤에 만든 것으로 그림 */
+	enum { NOBJ = 600 };
+	uint8_t junk[64] = {0};
+	for (int i = 0; i < NOBJ; i++) {
+		void *b = mkbuf(junk, sizeof(junk), D3D11_BIND_VERTEX_BUFFER);
+		void *tx = mktex(4, 4, 1, DXGI_FORMAT_B8G8R8A8_UNORM,
+				 D3D11_BIND_SHADER_RESOURCE, junk, 16);
+		void *sv = mksrv(tx);
+		if (!b || !tx || !sv) {
+			expect(0, "object %d not created", i);
+			break;
+		}
+	}
+	target(96, 64);
+	use_shaders();
+	C(VSSetShader, VS(vs_pass), NULL, 0);
+	C(PSSetShader, PS(ps_color), NULL, 0);
+	clear(0, 0, 0);
+	draw_quad(-1, -1, 1, 1, 0.5f, 0, 1, 1);
+	uint32_t *px = readback();
+	expect(count_color(px, 0x00FFFF) == W * H, "draw after %d objects: %d px",
+	       NOBJ * 3, count_color(px, 0x00FFFF));
+
+	/* 백버퍼 해제 (ResizeBuffers) 후 새 크기로 다시 등록 */
+	backbuffer_fill(40, 12, 1, 0, 0);
+	expect(backbuffer_pixel(39, 11) == 0xFF0000, "backbuffer %06x",
+	       backbuffer_pixel(39, 11));
+	backbuffer_release();
+	backbuffer_fill(13, 30, 0, 1, 0);
+	expect(backbuffer_pixel(12, 29) == 0x00FF00, "resized backbuffer %06x",
+	       backbuffer_pixel(12, 29));
+	backbuffer_release();
+}
+
+/*
+ * 여러 스레드가 동시에 할당/조회/해제: 같은 슬롯을 두 스레드가 받으면
+ * 안 되고 (owner CAS), 해제한 핸들은 슬롯이 재사용돼도 조회되면 안 된다.
+ * 라운드마다 스레드당 HT_LIVE개를 잡았다 놓으므로 slab 경계를 넘나들며
+ * free list와 새 slab 공개가 겹친다. 세대(16비트)가 한 바퀴 돌지 않도록
+ * 전체 해제 수는 65536 미만.
+ */
+enum { HT_THREADS = 8, HT_ROUNDS = 20, HT_LIVE = 300 };
+
+static struct handle_table g_ht_mt = HANDLE_TABLE_INIT(uint32_t, 0x7D);
+static uint8_t g_ht_owner[1 << 16];
+static int g_ht_go;
+
+struct ht_worker {
+	int id;
+	int fail, dup, lost, stale;
+};
+
+static void *ht_worker_main(void *arg)
+{
+	struct ht_worker *w = arg;
+	int idx[HT_LIVE];
+	void *h[HT_LIVE];
+
+	while (!__atomic_load_n(&g_ht_go, __ATOMIC_ACQUIRE))
+		;
+	for (int r = 0; r < HT_ROUNDS; r++) {
+		for (int i = 0; i < HT_LIVE; i++) {
+			int k = ht_alloc(&g_ht_mt);
+			idx[i] = k;
+			if (k < 0 || k >= (int)sizeof(g_ht_owner)) {
+				w->fail++;
+				idx[i] = -1;
+				continue;
+			}
+			uint8_t none = 0;
+			if (!__atomic_compare_exchange_n(&g_ht_owner[k], &none,
+							 (uint8_t)(w->id + 1), 0,
+							 __ATOMIC_ACQ_REL,
+							 __ATOMIC_ACQUIRE))
+				w->dup++;
+			uint32_t *slot = ht_slot(&g_ht_mt, k);
+			if (*slot != 0) w->dup++;
+			*slot = (uint32_t)(w->id << 24 | r << 12 | i);
+			h[i] = ht_handle(&g_ht_mt, k);
+		}
+		for (int i = 0; i < HT_LIVE; i++) {
+			if (idx[i] < 0) continue;
+			if (ht_lookup(&g_ht_mt, h[i]) != idx[i] ||
+			    *(uint32_t *)ht_slot(&g_ht_mt, idx[i]) !=
+			    (uint32_t)(w->id << 24 | r << 12 | i))
+				w->lost++;
+		}
+		for (int i = 0; i < HT_LIVE; i++) {
+			if (idx[i] < 0) continue;
+			__atomic_store_n(&g_ht_owner[idx[i]], 0, __ATOMIC_RELEASE);
+			ht_free(&g_ht_mt, idx[i]);
+		}
+		for (int i = 0; i < HT_LIVE; i++)
+			if (idx[i] >= 0 && ht_lookup(&g_ht_mt, h[i]) >= 0)
+				w->stale++;
+	}
+	return NULL;
+}
+
+static void test_handle_threads(void)
+{
+	pthread_t th[HT_THREADS];
+	struct ht_worker w[HT_THREADS];
+	int started = 0;
+	memset(w, 0, sizeof(w));
+	for (int i = 0; i < HT_THREADS; i++) {
+		w[i].id = i;
+		if (pthread_create(&th[i], NULL, ht_worker_main, &w[i]) != 0)
+			break;
+		started++;
+	}
+	__atomic_store_n(&g_ht_go, 1, __ATOMIC_RELEASE);
+	struct ht_worker sum = {0};
+	for (int i = 0; i < started; i++) {
+		pthread_join(th[i], NULL);
+		sum.fail += w[i].fail;
+		sum.dup += w[i].dup;
+		sum.lost += w[i].lost;
+		sum.stale += w[i].stale;
+	}
+	expect(started == HT_THREADS, "only %d threads started", started);
+	expect(sum.fail == 0, "%d allocations failed", sum.fail);
+	expect(sum.dup == 0, "%d slots handed out twice", sum.dup);
+	expect(sum.lost == 0, "%d live handles lost their slot", sum.lost);
+	expect(sum.stale == 0, "%d freed handles still resolved", sum.stale);
+
+	/* 해제가 하나도 빠지지 않았으면 count 안쪽 슬롯이 모두 free list에 */
+	int n = ht_count(&g_ht_mt);
+	expect(n >= HT_LIVE && n <= HT_THREADS * HT_LIVE,
+	       "%d slots used by %d x %d live handles", n, HT_THREADS, HT_LIVE);
+	int bad = 0;
+	memset(g_ht_owner, 0, sizeof(g_ht_owner));
+	for (int i = 0; i < n; i++) {
+		int k = ht_alloc(&g_ht_mt);
+		if (k < 0 || k >= n || g_ht_owner[k]++) bad++;
+	}
+	expect(bad == 0, "%d of %d freed slots missing from the free list",
+	       bad, n);
+	expect(ht_alloc(&g_ht_mt) == n, "free list not empty after reuse");
+}
+
+/* ============================================================
+ * 실행
+ * ============================================================ */
+
+struct test {
+	const char *name;
+	void (*fn)(void);
+	int sample;             /* PS가 텍스처를 샘플함 (no_sample 모드에서 건너뜀) */
+};
+
+static const struct test tests[] = {
+	{ "bin_coverage",   test_bin_coverage,    0 },
+	{ "bin_flush",      test_bin_flush,       0 },
+	{ "edge_fan",       test_edge_fan,        0 },
+	{ "fill_rule",      test_fill_rule,       0 },
+	{ "attr_plane",     test_attr_plane,      0 },
+	{ "vcache",         test_vcache,          0 },
+	{ "vm_alu",         test_vm_alu,          0 },
+	{ "soa_branch",     test_soa_branch,      0 },
+	{ "hiz_depth",      test_hiz_depth,       0 },
+	{ "fast_clear",     test_fast_clear,      0 },
+	{ "update_box",     test_update_box,      0 },
+	{ "fetch_layouts",  test_fetch_layouts,   0 },
+	{ "pipeline_state", test_pipeline_state,  0 },
+	{ "map_dynamic",    test_map_dynamic,     0 },
+	{ "map_append",     test_map_append,      0 },
+	{ "instancing",     test_instancing,      0 },
+	{ "blend_modes",    test_blend_modes,     0 },
+	{ "mip_sampling",   test_mip_sampling,    1 },
+	{ "bc_sampling",    test_bc_sampling,     1 },
+	{ "clip_scissor",   test_clip_scissor,    0 },
+	{ "tbdr_overdraw",  test_tbdr_overdraw,   0 },
+	{ "tbdr_lod",       test_tbdr_lod,        1 },
+	{ "compute",        test_compute,         0 },
+	{ "native_kernels", test_native_kernels,  0 },
+	{ "kernel_tex",     test_kernel_tex,      1 },
+	{ "dynres",         test_dynres,          0 },
+	{ "queries",        test_queries,         0 },
+	{ "handle_table",   test_handle_table,    0 },
+	{ "handle_threads", test_handle_threads,  0 },
+};
+
+#define N_TESTS (int)(sizeof(tests) / sizeof(tests[0]))
+
+static void setup_device(void)
+{
+	create_device_fn create = NULL;
+	for (struct stub_entry *e = d3d11_stub_table; e->func_name; e++)
+		if (strcmp(e->func_name, "D3D11CreateDevice") == 0)
+			create = (create_device_fn)e->func_ptr;
+	D3D_FEATURE_LEVEL fl;
+	if (!create || create(NULL, 1, NULL, 0, NULL, 0, 7, (void **)&dev, &fl,
+			      (void **)&imm) != S_OK) {
+		printf("  D3D11CreateDevice failed\n");
+		_exit(1);
+	}
+	ctx = imm;
+	if (modes[g_mode].deferred &&
+	    D(CreateDeferredContext, 0, (void **)&ctx) != S_OK) {
+		printf("  CreateDeferredContext failed\n");
+		_exit(1);
+	}
+
+	D3D11_INPUT_ELEMENT_DESC el[2] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 0, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, 0, 0 },
+	};
+	D(CreateInputLayout, el, 2, NULL, 0, &layout_pc);
+	vs_pc = VS(vs_pass);
+	ps_pc = PS(ps_color);
+}
+
+/* 자식 프로세스: 한 모드로 모든 테스트 실행 */
+static int run_mode(void)
+{
+	int failed = 0;
+	setup_device();
+	for (int t = 0; t < N_TESTS; t++) {
+		g_fail = 0;
+		printf("  [%-10s] %-20s ", modes[g_mode].name, tests[t].name);
+		if (tests[t].sample && modes[g_mode].no_sample) {
+			printf("SKIP\n");
+			continue;
+		}
+		fflush(stdout);
+		reset();
+		tests[t].fn();
+		printf("%s\n", g_fail ? "FAIL" : "PASS");
+		if (g_fail) failed++;
+	}
+	return failed;
+}
+
+int main(void)
+{
+	g_res = mmap(NULL, sizeof(*g_res), PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (g_res == MAP_FAILED) return 1;
+
+	printf("\n=== D3D11 rasterizer tests ===\n\n");
+	int fail = 0;
+	for (int m = 0; m < N_MODES; m++) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if (pid == 0) {
+			if (modes[m].env) setenv(modes[m].env, modes[m].value, 1);
+			g_mode = m;
+			int n = run_mode();
+			fflush(stdout);
+			_exit(n ? 1 : 0);
+		}
+		int st = 0;
+		if (pid < 0 || waitpid(pid, &st, 0) < 0 || !WIFEXITED(st)) {
+			printf("  [%-10s] crashed\n", modes[m].name);
+			fail++;
+		} else if (WEXITSTATUS(st)) {
+			fail++;
+		}
+	}
+
+	/* 모드 사이 이미지 비교 (이름으로 짝지음 — 건너뛴 테스트는 이미지가 없음) */
+	for (int m = 1; m < N_MODES; m++) {
+		if (!modes[m].exact) continue;
+		int n = g_res->nimages[m];
+		if (n != g_res->nimages[0] && !modes[m].no_sample) {
+			printf("  [%-10s] image count %d != %d\n", modes[m].name, n,
+			       g_res->nimages[0]);
+			fail++;
+			continue;
+		}
+		for (int i = 0; i < n; i++) {
+			int j = 0;
+			while (j < g_res->nimages[0] &&
+			       strcmp(g_res->name[0][j], g_res->name[m][i]) != 0)
+				j++;
+			if (j < g_res->nimages[0] &&
+			    g_res->hash[m][i] == g_res->hash[0][j])
+				continue;
+			printf("  [%-10s] image %s differs from default\n",
+			       modes[m].name, g_res->name[m][i]);
+			fail++;
+		}
+	}
+
+	printf("\n=== %s ===\n", fail ? "SOME TESTS FAILED" : "ALL PASS");
+	return fail ? 1 : 0;
+}
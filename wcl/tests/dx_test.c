@@ -295,14 +295,16 @@ typedef struct {
 		const void *, unsigned __int64, void **);
 	HRESULT (__attribute__((ms_abi)) *CreateVertexShader)(void *,
 		const void *, unsigned __int64, void *, void **);
-	/* ... hull, domain, geometry ... */
-	HRESULT (__attribute__((ms_abi)) *CreateHullShader)(void *, const void *, unsigned __int64, void *, void **);
-	HRESULT (__attribute__((ms_abi)) *CreateDomainShader)(void *, const void *, unsigned __int64, void *, void **);
+	/* ... geometry, pixel, hull, domain, compute ... */
 	HRESULT (__attribute__((ms_abi)) *CreateGeometryShader)(void *, const void *, unsigned __int64, void *, void **);
 	HRESULT (__attribute__((ms_abi)) *CreateGeometryShaderWithStreamOutput)(void *,
 		const void *, unsigned __int64, void *, UINT, void *, UINT, UINT, void *, void **);
 	HRESULT (__attribute__((ms_abi)) *CreatePixelShader)(void *,
 		const void *, unsigned __int64, void *, void **);
+	HRESULT (__attribute__((ms_abi)) *CreateHullShader)(void *, const void *, unsigned __int64, void *, void **);
+	HRESULT (__attribute__((ms_abi)) *CreateDomainShader)(void *, const void *, unsigned __int64, void *, void **);
+	HRESULT (__attribute__((ms_abi)) *CreateComputeShader)(void *, const void *, unsigned __int64, void *, void **);
+	HRESULT (__attribute__((ms_abi)) *CreateClassLinkage)(void *, void **);
 	HRESULT (__attribute__((ms_abi)) *CreateBlendState)(void *, void *, void **);
 	HRESULT (__attribute__((ms_abi)) *CreateDepthStencilState)(void *, const D3D11_DEPTH_STENCIL_DESC *, void **);
 	HRESULT (__attribute__((ms_abi)) *CreateRasterizerState)(void *, const D3D11_RASTERIZER_DESC *, void **);
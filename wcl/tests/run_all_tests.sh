@@ -28,6 +28,19 @@ run_test() {
     fi
 }
 
+# 호스트 네이티브 테스트 (citcrun 없이 직접 실행)
+run_host_test() {
+    local name="$1"
+    ((TOTAL++))
+    if make -s -C ./wcl/tests check-host > /dev/null 2>&1; then
+        echo "  PASS: $name"
+        ((PASS++))
+    else
+        echo "  FAIL: $name"
+        ((FAIL++))
+    fi
+}
+
 echo ""
 echo "=== CITC OS WCL — Full Test Suite ==="
 echo ""
@@ -43,6 +56,7 @@ run_test com_test
 run_test net_test
 run_test d3d12_test
 run_test app_test
+run_host_test d3d11_raster_test
 
 echo ""
 echo "=== Results: $PASS/$TOTAL passed, $FAIL failed ==="